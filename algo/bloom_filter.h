@@ -0,0 +1,205 @@
+/**
+ * Bloom filter.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/key_traits.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <new>
+
+
+namespace algo {
+
+// Internal implementation.
+namespace bloom_filter__ {
+
+	// A block is 8 x 32-bit words, one bit is set in every word.
+	const size_t const_block_words = 8;
+	const size_t const_block_bytes = const_block_words * sizeof(uint32_t);
+
+	// Odd multipliers to derive the bit of every word from a 32-bit hash.
+	const uint32_t const_salts[const_block_words] = {
+		0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+		0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+	};
+
+	// splitmix64 finalizer, KeyTraits::hash() could be weak (e.g. identity).
+	inline uint64_t mix(uint64_t value) {
+		value ^= value >> 30;
+		value *= 0xBF58476D1CE4E5B9ULL;
+		value ^= value >> 27;
+		value *= 0x94D049BB133111EBULL;
+		value ^= value >> 31;
+		return value;
+	}
+
+	// Bits of a block for a 32-bit hash. The loop has no branches,
+	// so compilers turn it into a few SIMD instructions.
+	inline void make_mask(uint32_t hash, uint32_t* mask) {
+		for (size_t i = 0; i < const_block_words; ++i) {
+			mask[i] = (uint32_t) 1 << ((hash * const_salts[i]) >> 27);
+		}
+	}
+
+} // namespace bloom_filter__
+
+
+/**
+ * Blocked Bloom filter ("split block" variant).
+ *
+ * Every key sets 8 bits in a single 32-byte block, which never crosses
+ * a cache line, so a lookup costs one memory access. With the default
+ * 10 bits per key, the false positive rate is about 1%.
+ *
+ * Keys could not be removed. Lookups by any type which KeyTraits could
+ * hash are supported, e.g. "const char*" for std::string keys.
+ */
+template <class Key, class KeyTraits = key_traits_t<Key>>
+class bloom_filter_t {
+private:
+	typedef bloom_filter_t<Key, KeyTraits> self_type;
+
+public:
+	typedef Key key_type;
+	typedef KeyTraits key_traits;
+
+	static const size_t const_default_bits_per_key = 10;
+
+public:
+	explicit bloom_filter_t(size_t capacity = 0,
+		size_t bits_per_key = const_default_bits_per_key,
+		const KeyTraits& key_traits = KeyTraits())
+		: m_buffer(0), m_blocks(0), m_block_count(0), m_capacity(0),
+		m_bits_per_key(bits_per_key), m_key_traits(key_traits) {
+		assert(bits_per_key > 0);
+		this->reset(capacity);
+	}
+
+	bloom_filter_t(const self_type& another)
+		: m_buffer(0), m_blocks(0), m_block_count(0), m_capacity(0),
+		m_bits_per_key(another.m_bits_per_key), m_key_traits(another.m_key_traits) {
+		*this = another;
+	}
+
+	~bloom_filter_t() {
+		::operator delete(m_buffer);
+	}
+
+	self_type& operator=(const self_type& another) {
+		if (this != &another) {
+			m_bits_per_key = another.m_bits_per_key;
+			m_key_traits = another.m_key_traits;
+			this->allocate_i(another.m_block_count);
+			m_capacity = another.m_capacity;
+
+			memcpy(m_blocks, another.m_blocks, m_block_count * bloom_filter__::const_block_bytes);
+		}
+
+		return *this;
+	}
+
+	// Number of keys the filter is sized for.
+	size_t capacity() const {
+		return m_capacity;
+	}
+
+	size_t bits_per_key() const {
+		return m_bits_per_key;
+	}
+
+	size_t memory_bytes() const {
+		return m_block_count * bloom_filter__::const_block_bytes;
+	}
+
+	// Resize the filter for "capacity" keys, and remove all keys.
+	void reset(size_t capacity) {
+		size_t block_count = (capacity * m_bits_per_key + 255) / 256;
+		if (block_count == 0) {
+			block_count = 1;
+		}
+
+		if (block_count != m_block_count) {
+			this->allocate_i(block_count);
+		}
+
+		m_capacity = capacity;
+		this->clear();
+	}
+
+	void clear() {
+		memset(m_blocks, 0, m_block_count * bloom_filter__::const_block_bytes);
+	}
+
+	template <class K>
+	void insert(const K& key) {
+		this->insert_hash(m_key_traits.hash(key));
+	}
+
+	// Return false if the key was definitely not inserted.
+	template <class K>
+	bool contains(const K& key) const {
+		return this->contains_hash(m_key_traits.hash(key));
+	}
+
+	// Same as insert(), by "KeyTraits::hash(key)".
+	void insert_hash(size_t hash) {
+		uint32_t mask[bloom_filter__::const_block_words];
+		const auto block = this->block_i(hash, mask);
+
+		for (size_t i = 0; i < bloom_filter__::const_block_words; ++i) {
+			block[i] |= mask[i];
+		}
+	}
+
+	// Same as contains(), by "KeyTraits::hash(key)".
+	bool contains_hash(size_t hash) const {
+		uint32_t mask[bloom_filter__::const_block_words];
+		const auto block = this->block_i(hash, mask);
+
+		uint32_t missing = 0;
+		for (size_t i = 0; i < bloom_filter__::const_block_words; ++i) {
+			missing |= mask[i] & ~block[i];
+		}
+
+		return missing == 0;
+	}
+
+private:
+	uint32_t* block_i(size_t hash, uint32_t* mask) const {
+		const auto value = bloom_filter__::mix((uint64_t) hash);
+		const auto index = (size_t) (((value >> 32) * (uint64_t) m_block_count) >> 32);
+
+		bloom_filter__::make_mask((uint32_t) value, mask);
+		return m_blocks + index * bloom_filter__::const_block_words;
+	}
+
+	void allocate_i(size_t block_count) {
+		assert(block_count <= 0xFFFFFFFFU);
+
+		// Blocks are aligned to their size, so they never cross cache lines.
+		const auto bytes = block_count * bloom_filter__::const_block_bytes;
+		const auto buffer = (char*) ::operator new(bytes + bloom_filter__::const_block_bytes);
+
+		::operator delete(m_buffer);
+		m_buffer = buffer;
+		m_blocks = (uint32_t*) (((uintptr_t) buffer + bloom_filter__::const_block_bytes - 1)
+			& ~(uintptr_t) (bloom_filter__::const_block_bytes - 1));
+		m_block_count = block_count;
+	}
+
+private:
+	char* m_buffer;
+	uint32_t* m_blocks;
+	size_t m_block_count;
+	size_t m_capacity;
+	size_t m_bits_per_key;
+	KeyTraits m_key_traits;
+};
+
+} // namespace algo
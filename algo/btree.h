@@ -0,0 +1,1670 @@
+/**
+ * B+ Tree.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace algo {
+
+// B+ Tree internal implementation.
+namespace btree__ {
+
+	// Target size of a node, i.e. four cache lines.
+	const size_t const_node_bytes = 256;
+
+	// A node has at least 3 children, so 64 levels are never reached.
+	const size_t const_max_height = 64;
+
+	// Mapped type of sets, nothing is stored for it.
+	struct no_value_t {
+	};
+
+	// Uninitialized storage of "Count" objects.
+	template <class T, size_t Count>
+	struct slots_t {
+		T* data() {
+			return (T*) &m_data;
+		}
+
+		const T* data() const {
+			return (const T*) &m_data;
+		}
+
+		typename std::aligned_storage<sizeof(T) * Count, alignof(T)>::type m_data;
+	};
+
+	// Mapped values of a leaf, they are empty for sets.
+	template <class Mapped, size_t Count>
+	struct value_slots_t {
+		Mapped* values() {
+			return m_values.data();
+		}
+
+		const Mapped* values() const {
+			return m_values.data();
+		}
+
+		slots_t<Mapped, Count> m_values;
+	};
+
+	template <size_t Count>
+	struct value_slots_t<no_value_t, Count> {
+		no_value_t* values() {
+			return 0;
+		}
+
+		const no_value_t* values() const {
+			return 0;
+		}
+	};
+
+	// Primitives on arrays of slots, objects in [0, count) are constructed.
+	// They do nothing on mapped values of sets.
+
+	// Construct "value" at "pos", and shift [pos, count) to the right.
+	template <class T, class Arg>
+	inline void insert_slot(T* slots, size_t count, size_t pos, Arg&& value) {
+		if (pos == count) {
+			new (slots + count) T(std::forward<Arg>(value));
+		}
+		else {
+			new (slots + count) T(std::move(slots[count - 1]));
+			std::move_backward(slots + pos, slots + count - 1, slots + count);
+			slots[pos] = std::forward<Arg>(value);
+		}
+	}
+
+	template <class Arg>
+	inline void insert_slot(no_value_t* slots, size_t count, size_t pos, Arg&& value) {
+	}
+
+	// Shift (pos, count) to the left, and destroy the last one.
+	template <class T>
+	inline void erase_slot(T* slots, size_t count, size_t pos) {
+		std::move(slots + pos + 1, slots + count, slots + pos);
+		slots[count - 1].~T();
+	}
+
+	inline void erase_slot(no_value_t* slots, size_t count, size_t pos) {
+	}
+
+	// Move "count" objects to uninitialized "dest", and destroy them in "src".
+	template <class T>
+	inline void move_slots(T* dest, T* src, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			new (dest + i) T(std::move(src[i]));
+			src[i].~T();
+		}
+	}
+
+	inline void move_slots(no_value_t* dest, no_value_t* src, size_t count) {
+	}
+
+	// Copy "count" objects to uninitialized "dest".
+	template <class T>
+	inline void copy_slots(T* dest, const T* src, size_t count) {
+		size_t i = 0;
+
+		try {
+			for (; i < count; ++i) {
+				new (dest + i) T(src[i]);
+			}
+		}
+		catch (...) {
+			while (i > 0) {
+				dest[--i].~T();
+			}
+
+			throw;
+		}
+	}
+
+	inline void copy_slots(no_value_t* dest, const no_value_t* src, size_t count) {
+	}
+
+	// Rvalue of a slot.
+	template <class T>
+	inline T&& slot_rvalue(T* slots, size_t index) {
+		return std::move(slots[index]);
+	}
+
+	inline no_value_t slot_rvalue(no_value_t* slots, size_t index) {
+		return no_value_t();
+	}
+
+	template <class T>
+	inline void destroy_slots(T* slots, size_t count) {
+		for (size_t i = 0; i < count; ++i) {
+			slots[i].~T();
+		}
+	}
+
+	inline void destroy_slots(no_value_t* slots, size_t count) {
+	}
+
+	// Common header of leaf & inner nodes.
+	struct node_t {
+		uint32_t m_count;
+		bool m_leaf;
+	};
+
+	// Leaf node, keys and mapped values are kept in separate arrays,
+	// so that keys are searched without touching mapped values.
+	template <class Key, class Mapped, size_t Count>
+	struct leaf_t : public node_t, public value_slots_t<Mapped, Count> {
+		Key* keys() {
+			return m_keys.data();
+		}
+
+		const Key* keys() const {
+			return m_keys.data();
+		}
+
+		leaf_t* m_prev;
+		leaf_t* m_next;
+		slots_t<Key, Count> m_keys;
+	};
+
+	// Inner node, all keys in "m_children[i]" are not less than "keys()[i - 1]"
+	// and less than "keys()[i]".
+	template <class Key, size_t Count>
+	struct inner_t : public node_t {
+		Key* keys() {
+			return m_keys.data();
+		}
+
+		const Key* keys() const {
+			return m_keys.data();
+		}
+
+		slots_t<Key, Count> m_keys;
+		node_t* m_children[Count + 1];
+	};
+
+	// Number of keys per node, so that a node takes about const_node_bytes.
+	template <class Key, class Mapped>
+	struct layout_t {
+		static const size_t const_mapped_size = std::is_same<Mapped, no_value_t>::value ? 0 : sizeof(Mapped);
+		static const size_t const_leaf_header = sizeof(node_t) + 2 * sizeof(void*);
+		static const size_t const_inner_header = sizeof(node_t) + sizeof(void*);
+
+		static const size_t const_leaf_fit = const_node_bytes > const_leaf_header
+			? (const_node_bytes - const_leaf_header) / (sizeof(Key) + const_mapped_size) : 0;
+		static const size_t const_inner_fit = (const_node_bytes - const_inner_header) / (sizeof(Key) + sizeof(void*));
+
+		static const size_t const_leaf_count = const_leaf_fit < 4 ? 4 : const_leaf_fit;
+		static const size_t const_inner_count = const_inner_fit < 4 ? 4 : const_inner_fit;
+	};
+
+	// Keys are compared by plain "<" without branches if "Compare" is
+	// std::less of an arithmetic type, compilers turn the loop into
+	// SIMD instructions. Otherwise, it's a binary search by "Compare".
+	template <class Key, class Compare>
+	struct is_simd_searchable_t : std::integral_constant<bool,
+		std::is_arithmetic<Key>::value && std::is_same<Compare, std::less<Key>>::value> {
+	};
+
+	// Keys compared per block by the SIMD search.
+	const size_t const_search_block = 8;
+
+	// Index of the first key which is not less than "key".
+	template <class Key, class Compare>
+	inline size_t lower_index(const Key* keys, size_t count, const Key& key, const Compare& less, const std::true_type&) {
+		size_t result = 0;
+		size_t i = 0;
+
+		// Fixed-length blocks are vectorized by GCC at -O2 as well.
+		for (; i + const_search_block <= count; i += const_search_block) {
+			size_t block = 0;
+			for (size_t j = 0; j < const_search_block; ++j) {
+				block += keys[i + j] < key ? 1 : 0;
+			}
+			result += block;
+		}
+
+		for (; i < count; ++i) {
+			result += keys[i] < key ? 1 : 0;
+		}
+
+		return result;
+	}
+
+	template <class Key, class Compare>
+	inline size_t lower_index(const Key* keys, size_t count, const Key& key, const Compare& less, const std::false_type&) {
+		return std::lower_bound(keys, keys + count, key, less) - keys;
+	}
+
+	// Index of the first key which is greater than "key".
+	template <class Key, class Compare>
+	inline size_t upper_index(const Key* keys, size_t count, const Key& key, const Compare& less, const std::true_type&) {
+		size_t result = 0;
+		size_t i = 0;
+
+		for (; i + const_search_block <= count; i += const_search_block) {
+			size_t block = 0;
+			for (size_t j = 0; j < const_search_block; ++j) {
+				block += keys[i + j] <= key ? 1 : 0;
+			}
+			result += block;
+		}
+
+		for (; i < count; ++i) {
+			result += keys[i] <= key ? 1 : 0;
+		}
+
+		return result;
+	}
+
+	template <class Key, class Compare>
+	inline size_t upper_index(const Key* keys, size_t count, const Key& key, const Compare& less, const std::false_type&) {
+		return std::upper_bound(keys, keys + count, key, less) - keys;
+	}
+
+	// Element of a leaf.
+	template <class Leaf>
+	struct position_t {
+		position_t() : m_leaf(0), m_index(0) {}
+		position_t(Leaf* leaf, size_t index) : m_leaf(leaf), m_index(index) {}
+
+		Leaf* m_leaf;
+		size_t m_index;
+	};
+
+	// Result of operator->() of map iterators, which hold a pair of references.
+	template <class Reference>
+	struct arrow_t {
+		typedef Reference reference_type;
+
+		explicit arrow_t(const Reference& reference) : m_reference(reference) {
+		}
+
+		const Reference* operator->() const {
+			return &m_reference;
+		}
+
+		Reference m_reference;
+	};
+
+	// How iterators expose elements. Map elements are "std::pair<const Key&, T&>",
+	// since keys and mapped values are not stored together.
+	template <class Key, class Mapped>
+	struct entry_traits_t {
+		typedef std::pair<const Key, Mapped> value_type;
+		typedef std::pair<const Key&, Mapped&> reference;
+		typedef std::pair<const Key&, const Mapped&> const_reference;
+		typedef arrow_t<reference> pointer;
+		typedef arrow_t<const_reference> const_pointer;
+
+		template <class Reference, class Leaf>
+		static Reference get(Leaf* leaf, size_t index) {
+			return Reference(leaf->keys()[index], leaf->values()[index]);
+		}
+
+		template <class Pointer, class Leaf>
+		static Pointer arrow(Leaf* leaf, size_t index) {
+			return Pointer(get<typename Pointer::reference_type>(leaf, index));
+		}
+	};
+
+	// Set elements could not be modified.
+	template <class Key>
+	struct entry_traits_t<Key, no_value_t> {
+		typedef Key value_type;
+		typedef const Key& reference;
+		typedef const Key& const_reference;
+		typedef const Key* pointer;
+		typedef const Key* const_pointer;
+
+		template <class Reference, class Leaf>
+		static Reference get(Leaf* leaf, size_t index) {
+			return leaf->keys()[index];
+		}
+
+		template <class Pointer, class Leaf>
+		static Pointer arrow(Leaf* leaf, size_t index) {
+			return leaf->keys() + index;
+		}
+	};
+
+	// Internal data container.
+	template <class Key, class Mapped, class Compare, class Allocator>
+	class ctner_t {
+	public:
+		typedef ctner_t<Key, Mapped, Compare, Allocator> self_type;
+		typedef layout_t<Key, Mapped> layout_type;
+		typedef leaf_t<Key, Mapped, layout_type::const_leaf_count> leaf_type;
+		typedef inner_t<Key, layout_type::const_inner_count> inner_type;
+		typedef position_t<leaf_type> position_type;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<leaf_type> leaf_allocator_type;
+		typedef std::allocator_traits<leaf_allocator_type> leaf_allocator_traits;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<inner_type> inner_allocator_type;
+		typedef std::allocator_traits<inner_allocator_type> inner_allocator_traits;
+		typedef is_simd_searchable_t<Key, Compare> simd_type;
+
+		static const size_t const_leaf_count = layout_type::const_leaf_count;
+		static const size_t const_inner_count = layout_type::const_inner_count;
+
+		// Non-root nodes are at least half full.
+		static const size_t const_min_leaf_count = const_leaf_count / 2;
+		static const size_t const_min_inner_count = const_inner_count / 2;
+
+		// Inner nodes from the root to a leaf, and the child taken in every one.
+		struct path_t {
+			path_t() : m_depth(0) {}
+
+			inner_type* m_nodes[const_max_height];
+			size_t m_slots[const_max_height];
+			size_t m_depth;
+		};
+
+	public:
+		explicit ctner_t(const Compare& less = Compare(), const Allocator& allocator = Allocator())
+			: m_root(0), m_first(0), m_last(0), m_size(0), m_height(0),
+			m_leaf_nodes(0), m_inner_nodes(0), m_less(less),
+			m_leaf_allocator(allocator), m_inner_allocator(allocator) {
+		}
+
+		~ctner_t() {
+			this->clear();
+		}
+
+		void clear() {
+			if (m_root != 0) {
+				this->delete_subtree_i(m_root);
+			}
+
+			m_root = 0;
+			m_first = 0;
+			m_last = 0;
+			m_size = 0;
+			m_height = 0;
+		}
+
+		Compare key_compare() const {
+			return m_less;
+		}
+
+		Allocator get_allocator() const {
+			return Allocator(m_leaf_allocator);
+		}
+
+		// Bytes of all nodes.
+		size_t memory_bytes() const {
+			return m_leaf_nodes * sizeof(leaf_type) + m_inner_nodes * sizeof(inner_type);
+		}
+
+		position_type find(const Key& key) const {
+			if (m_root == 0) {
+				return position_type();
+			}
+
+			const auto leaf = this->descend_i(key, 0);
+			const auto index = lower_index(leaf->keys(), leaf->m_count, key, m_less, simd_type());
+
+			if (index == leaf->m_count || m_less(key, leaf->keys()[index])) {
+				return position_type();
+			}
+
+			return position_type(leaf, index);
+		}
+
+		// The first element which is not less than "key".
+		position_type lower_bound(const Key& key) const {
+			if (m_root == 0) {
+				return position_type();
+			}
+
+			const auto leaf = this->descend_i(key, 0);
+			return this->normalize_i(leaf, lower_index(leaf->keys(), leaf->m_count, key, m_less, simd_type()));
+		}
+
+		// The first element which is greater than "key".
+		position_type upper_bound(const Key& key) const {
+			if (m_root == 0) {
+				return position_type();
+			}
+
+			const auto leaf = this->descend_i(key, 0);
+			return this->normalize_i(leaf, upper_index(leaf->keys(), leaf->m_count, key, m_less, simd_type()));
+		}
+
+		template <class K, class M>
+		std::pair<position_type, bool> insert(K&& key, M&& mapped) {
+			if (m_root == 0) {
+				const auto leaf = this->new_leaf_i();
+				insert_slot(leaf->keys(), 0, 0, std::forward<K>(key));
+				insert_slot(leaf->values(), 0, 0, std::forward<M>(mapped));
+				leaf->m_count = 1;
+
+				m_root = leaf;
+				m_first = leaf;
+				m_last = leaf;
+				m_height = 1;
+				m_size = 1;
+
+				return std::pair<position_type, bool>(position_type(leaf, 0), true);
+			}
+
+			path_t path;
+			auto leaf = this->descend_i(key, &path);
+			auto index = lower_index(leaf->keys(), leaf->m_count, (const Key&) key, m_less, simd_type());
+
+			// The key already exists.
+			if (index < leaf->m_count && !m_less(key, leaf->keys()[index])) {
+				return std::pair<position_type, bool>(position_type(leaf, index), false);
+			}
+
+			if (leaf->m_count == const_leaf_count) {
+				// Appending to the last leaf leaves it full, so that
+				// sorted input fills leaves completely.
+				const size_t middle = index == const_leaf_count && leaf->m_next == 0
+					? const_leaf_count : const_leaf_count / 2;
+
+				const auto right = this->split_leaf_i(leaf, middle);
+
+				if (index > middle || (index == middle && middle == const_leaf_count)) {
+					leaf = right;
+					index -= middle;
+				}
+
+				insert_slot(leaf->keys(), leaf->m_count, index, std::forward<K>(key));
+				insert_slot(leaf->values(), leaf->m_count, index, std::forward<M>(mapped));
+				++leaf->m_count;
+
+				this->insert_parent_i(path, path.m_depth, right->keys()[0], right);
+			}
+			else {
+				insert_slot(leaf->keys(), leaf->m_count, index, std::forward<K>(key));
+				insert_slot(leaf->values(), leaf->m_count, index, std::forward<M>(mapped));
+				++leaf->m_count;
+			}
+
+			++m_size;
+
+		#ifdef ALGO_BTREE_CHECK_INVARIANTS
+			assert(this->check_invariants());
+		#endif
+
+			return std::pair<position_type, bool>(position_type(leaf, index), true);
+		}
+
+		// Erase an element, return the next one.
+		position_type erase(position_type position) {
+			assert(position.m_leaf != 0 && position.m_index < position.m_leaf->m_count);
+
+			path_t path;
+			const auto leaf = this->descend_i(position.m_leaf->keys()[position.m_index], &path);
+			assert(leaf == position.m_leaf);
+
+			const auto result = this->erase_i(path, leaf, position.m_index);
+
+		#ifdef ALGO_BTREE_CHECK_INVARIANTS
+			assert(this->check_invariants());
+		#endif
+
+			return result;
+		}
+
+		void assign(const self_type& another) {
+			if (this != &another) {
+				this->clear();
+				m_less = another.m_less;
+
+				if (another.m_root != 0) {
+					leaf_type* prev = 0;
+					m_root = this->copy_i(another.m_root, &prev);
+					m_first = this->first_leaf_i();
+					m_last = prev;
+					m_size = another.m_size;
+					m_height = another.m_height;
+				}
+			}
+		}
+
+		/**
+		 * Check all B+ Tree properties, it's O(n).
+		 *
+		 * 1) All leaves are at the same depth.
+		 * 2) Non-root nodes are at least half full, except the last leaf
+		 *    (appending leaves the previous leaf full instead).
+		 * 3) Keys of a node are increasing, and within the separators of its parents.
+		 * 4) Leaves are linked in order, and hold size() elements.
+		 *
+		 * If ALGO_BTREE_CHECK_INVARIANTS is defined, it's asserted
+		 * after every insert & erase of debug builds.
+		 */
+		bool check_invariants() const {
+			if (m_root == 0) {
+				return m_size == 0 && m_height == 0 && m_first == 0 && m_last == 0;
+			}
+
+			if (m_root->m_count == 0 || m_first->m_prev != 0 || m_last->m_next != 0) {
+				return false;
+			}
+
+			const leaf_type* expected = m_first;
+			size_t count = 0;
+
+			if (!this->check_i(m_root, 1, 0, 0, &expected, &count)) {
+				return false;
+			}
+
+			return expected == 0 && count == m_size;
+		}
+
+	private:
+		// Disable copy constructor & operator=().
+		ctner_t(const self_type&) = delete;
+		self_type& operator=(const self_type&) = delete;
+
+		leaf_type* descend_i(const Key& key, path_t* path) const {
+			auto ptr = m_root;
+
+			while (!ptr->m_leaf) {
+				const auto inner = (inner_type*) ptr;
+				const auto slot = upper_index(inner->keys(), inner->m_count, key, m_less, simd_type());
+
+				if (path != 0) {
+					path->m_nodes[path->m_depth] = inner;
+					path->m_slots[path->m_depth] = slot;
+					++path->m_depth;
+				}
+
+				ptr = inner->m_children[slot];
+			}
+
+			return (leaf_type*) ptr;
+		}
+
+		// The end of a leaf is the beginning of the next one.
+		static position_type normalize_i(leaf_type* leaf, size_t index) {
+			if (index == leaf->m_count) {
+				return position_type(leaf->m_next, 0);
+			}
+
+			return position_type(leaf, index);
+		}
+
+		leaf_type* first_leaf_i() const {
+			auto ptr = m_root;
+			while (!ptr->m_leaf) {
+				ptr = ((inner_type*) ptr)->m_children[0];
+			}
+
+			return (leaf_type*) ptr;
+		}
+
+		// Move [middle, count) to a new leaf on the right.
+		leaf_type* split_leaf_i(leaf_type* leaf, size_t middle) {
+			const auto right = this->new_leaf_i();
+			const auto moved = leaf->m_count - middle;
+
+			move_slots(right->keys(), leaf->keys() + middle, moved);
+			move_slots(right->values(), leaf->values() + middle, moved);
+			right->m_count = (uint32_t) moved;
+			leaf->m_count = (uint32_t) middle;
+
+			right->m_prev = leaf;
+			right->m_next = leaf->m_next;
+			if (leaf->m_next != 0) {
+				leaf->m_next->m_prev = right;
+			}
+			else {
+				m_last = right;
+			}
+			leaf->m_next = right;
+
+			return right;
+		}
+
+		// Add "key" and its right child "right" to the parent at "depth" (of the path).
+		void insert_parent_i(path_t& path, size_t depth, const Key& key, node_t* right) {
+			if (depth == 0) {
+				// The root has been split.
+				const auto root = this->new_inner_i();
+				insert_slot(root->keys(), 0, 0, key);
+				root->m_children[0] = m_root;
+				root->m_children[1] = right;
+				root->m_count = 1;
+
+				m_root = root;
+				++m_height;
+				return;
+			}
+
+			const auto inner = path.m_nodes[depth - 1];
+			const auto pos = path.m_slots[depth - 1];
+
+			if (inner->m_count < const_inner_count) {
+				this->insert_inner_i(inner, pos, key, right);
+				return;
+			}
+
+			// Split the full node, the key in the middle goes up.
+			const size_t middle = const_inner_count / 2;
+			const auto sibling = this->new_inner_i();
+
+			if (pos == middle) {
+				// The new key goes up, "right" is the first child of the sibling.
+				move_slots(sibling->keys(), inner->keys() + middle, const_inner_count - middle);
+				std::copy(inner->m_children + middle + 1, inner->m_children + const_inner_count + 1, sibling->m_children + 1);
+				sibling->m_children[0] = right;
+				sibling->m_count = (uint32_t) (const_inner_count - middle);
+				inner->m_count = (uint32_t) middle;
+
+				this->insert_parent_i(path, depth - 1, key, sibling);
+				return;
+			}
+
+			// The key which goes up, "middle - 1" or "middle" of the full node.
+			const size_t up = pos < middle ? middle - 1 : middle;
+			Key up_key(std::move(inner->keys()[up]));
+
+			move_slots(sibling->keys(), inner->keys() + up + 1, const_inner_count - up - 1);
+			std::copy(inner->m_children + up + 1, inner->m_children + const_inner_count + 1, sibling->m_children);
+			sibling->m_count = (uint32_t) (const_inner_count - up - 1);
+			inner->keys()[up].~Key();
+			inner->m_count = (uint32_t) up;
+
+			if (pos < middle) {
+				this->insert_inner_i(inner, pos, key, right);
+			}
+			else {
+				this->insert_inner_i(sibling, pos - up - 1, key, right);
+			}
+
+			this->insert_parent_i(path, depth - 1, up_key, sibling);
+		}
+
+		// Insert "key" at "pos", and "right" as the child after it.
+		static void insert_inner_i(inner_type* inner, size_t pos, const Key& key, node_t* right) {
+			insert_slot(inner->keys(), inner->m_count, pos, key);
+			std::copy_backward(inner->m_children + pos + 1, inner->m_children + inner->m_count + 1,
+				inner->m_children + inner->m_count + 2);
+			inner->m_children[pos + 1] = right;
+			++inner->m_count;
+		}
+
+		// Remove the key at "pos", and the child after it.
+		static void erase_inner_i(inner_type* inner, size_t pos) {
+			erase_slot(inner->keys(), inner->m_count, pos);
+			std::copy(inner->m_children + pos + 2, inner->m_children + inner->m_count + 1, inner->m_children + pos + 1);
+			--inner->m_count;
+		}
+
+		position_type erase_i(path_t& path, leaf_type* leaf, size_t index) {
+			erase_slot(leaf->keys(), leaf->m_count, index);
+			erase_slot(leaf->values(), leaf->m_count, index);
+			--leaf->m_count;
+			--m_size;
+
+			if (path.m_depth == 0) {
+				// The root leaf.
+				if (leaf->m_count == 0) {
+					this->delete_leaf_i(leaf);
+					m_root = 0;
+					m_first = 0;
+					m_last = 0;
+					m_height = 0;
+					return position_type();
+				}
+
+				return normalize_i(leaf, index);
+			}
+
+			if (leaf->m_count >= const_min_leaf_count) {
+				return normalize_i(leaf, index);
+			}
+
+			const auto parent = path.m_nodes[path.m_depth - 1];
+			const auto slot = path.m_slots[path.m_depth - 1];
+			const auto left = slot > 0 ? (leaf_type*) parent->m_children[slot - 1] : 0;
+			const auto right = slot < parent->m_count ? (leaf_type*) parent->m_children[slot + 1] : 0;
+
+			// Borrow the last element of the left sibling.
+			if (left != 0 && left->m_count > const_min_leaf_count) {
+				insert_slot(leaf->keys(), leaf->m_count, 0, std::move(left->keys()[left->m_count - 1]));
+				insert_slot(leaf->values(), leaf->m_count, 0, slot_rvalue(left->values(), left->m_count - 1));
+				++leaf->m_count;
+				erase_slot(left->keys(), left->m_count, left->m_count - 1);
+				erase_slot(left->values(), left->m_count, left->m_count - 1);
+				--left->m_count;
+
+				parent->keys()[slot - 1] = leaf->keys()[0];
+				return normalize_i(leaf, index + 1);
+			}
+
+			// Borrow the first element of the right sibling.
+			if (right != 0 && right->m_count > const_min_leaf_count) {
+				insert_slot(leaf->keys(), leaf->m_count, leaf->m_count, std::move(right->keys()[0]));
+				insert_slot(leaf->values(), leaf->m_count, leaf->m_count, slot_rvalue(right->values(), 0));
+				++leaf->m_count;
+				erase_slot(right->keys(), right->m_count, 0);
+				erase_slot(right->values(), right->m_count, 0);
+				--right->m_count;
+
+				parent->keys()[slot] = right->keys()[0];
+				return normalize_i(leaf, index);
+			}
+
+			position_type result;
+
+			if (left != 0) {
+				// Merge into the left sibling.
+				const auto offset = left->m_count;
+				this->merge_leaf_i(left, leaf);
+				erase_inner_i(parent, slot - 1);
+				result = normalize_i(left, offset + index);
+			}
+			else {
+				// Merge the right sibling.
+				this->merge_leaf_i(leaf, right);
+				erase_inner_i(parent, slot);
+				result = position_type(leaf, index);
+			}
+
+			this->fix_inner_i(path, path.m_depth - 1);
+			return result;
+		}
+
+		// Move all elements of "right" to "left", and delete "right".
+		void merge_leaf_i(leaf_type* left, leaf_type* right) {
+			move_slots(left->keys() + left->m_count, right->keys(), right->m_count);
+			move_slots(left->values() + left->m_count, right->values(), right->m_count);
+			left->m_count += right->m_count;
+			right->m_count = 0;
+
+			left->m_next = right->m_next;
+			if (right->m_next != 0) {
+				right->m_next->m_prev = left;
+			}
+			else {
+				m_last = left;
+			}
+
+			this->delete_leaf_i(right);
+		}
+
+		// An inner node at "depth" (of the path) has lost a key.
+		void fix_inner_i(path_t& path, size_t depth) {
+			const auto inner = path.m_nodes[depth];
+
+			if (depth == 0) {
+				// The root goes away once it has a single child.
+				if (inner->m_count == 0) {
+					m_root = inner->m_children[0];
+					this->delete_inner_i(inner);
+					--m_height;
+				}
+
+				return;
+			}
+
+			if (inner->m_count >= const_min_inner_count) {
+				return;
+			}
+
+			const auto parent = path.m_nodes[depth - 1];
+			const auto slot = path.m_slots[depth - 1];
+			const auto left = slot > 0 ? (inner_type*) parent->m_children[slot - 1] : 0;
+			const auto right = slot < parent->m_count ? (inner_type*) parent->m_children[slot + 1] : 0;
+
+			// Rotate the last child of the left sibling through the parent.
+			if (left != 0 && left->m_count > const_min_inner_count) {
+				insert_slot(inner->keys(), inner->m_count, 0, std::move(parent->keys()[slot - 1]));
+				std::copy_backward(inner->m_children, inner->m_children + inner->m_count + 1,
+					inner->m_children + inner->m_count + 2);
+				inner->m_children[0] = left->m_children[left->m_count];
+				++inner->m_count;
+
+				parent->keys()[slot - 1] = std::move(left->keys()[left->m_count - 1]);
+				erase_slot(left->keys(), left->m_count, left->m_count - 1);
+				--left->m_count;
+				return;
+			}
+
+			// Rotate the first child of the right sibling through the parent.
+			if (right != 0 && right->m_count > const_min_inner_count) {
+				insert_slot(inner->keys(), inner->m_count, inner->m_count, std::move(parent->keys()[slot]));
+				inner->m_children[inner->m_count + 1] = right->m_children[0];
+				++inner->m_count;
+
+				parent->keys()[slot] = std::move(right->keys()[0]);
+				erase_slot(right->keys(), right->m_count, 0);
+				std::copy(right->m_children + 1, right->m_children + right->m_count + 1, right->m_children);
+				--right->m_count;
+				return;
+			}
+
+			if (left != 0) {
+				this->merge_inner_i(left, inner, parent, slot - 1);
+			}
+			else {
+				this->merge_inner_i(inner, right, parent, slot);
+			}
+
+			this->fix_inner_i(path, depth - 1);
+		}
+
+		// Move the separator "pos" of "parent" and everything of "right" to "left", and delete "right".
+		void merge_inner_i(inner_type* left, inner_type* right, inner_type* parent, size_t pos) {
+			insert_slot(left->keys(), left->m_count, left->m_count, std::move(parent->keys()[pos]));
+			move_slots(left->keys() + left->m_count + 1, right->keys(), right->m_count);
+			std::copy(right->m_children, right->m_children + right->m_count + 1, left->m_children + left->m_count + 1);
+			left->m_count += right->m_count + 1;
+			right->m_count = 0;
+
+			erase_inner_i(parent, pos);
+			this->delete_inner_i(right);
+		}
+
+		// Copy a subtree, "prev" is the last leaf copied so far.
+		node_t* copy_i(const node_t* node_ptr, leaf_type** prev) {
+			if (node_ptr->m_leaf) {
+				const auto another = (const leaf_type*) node_ptr;
+				const auto leaf = this->new_leaf_i();
+
+				try {
+					copy_slots(leaf->keys(), another->keys(), another->m_count);
+
+					try {
+						copy_slots(leaf->values(), another->values(), another->m_count);
+					}
+					catch (...) {
+						destroy_slots(leaf->keys(), another->m_count);
+						throw;
+					}
+				}
+				catch (...) {
+					this->delete_leaf_i(leaf);
+					throw;
+				}
+
+				leaf->m_count = another->m_count;
+				leaf->m_prev = *prev;
+				if (*prev != 0) {
+					(*prev)->m_next = leaf;
+				}
+				*prev = leaf;
+
+				return leaf;
+			}
+
+			const auto another = (const inner_type*) node_ptr;
+			const auto inner = this->new_inner_i();
+
+			try {
+				copy_slots(inner->keys(), another->keys(), another->m_count);
+			}
+			catch (...) {
+				this->delete_inner_i(inner);
+				throw;
+			}
+
+			inner->m_count = another->m_count;
+			size_t copied = 0;
+
+			try {
+				for (; copied <= another->m_count; ++copied) {
+					inner->m_children[copied] = this->copy_i(another->m_children[copied], prev);
+				}
+			}
+			catch (...) {
+				for (size_t i = 0; i < copied; ++i) {
+					this->delete_subtree_i(inner->m_children[i]);
+				}
+
+				inner->m_count = 0;
+				destroy_slots(inner->keys(), another->m_count);
+				this->delete_inner_i(inner);
+				throw;
+			}
+
+			return inner;
+		}
+
+		bool check_i(const node_t* node_ptr, size_t depth, const Key* low, const Key* high,
+			const leaf_type** expected, size_t* count) const {
+			const auto min_count = node_ptr == m_root || node_ptr == m_last ? 1
+				: (node_ptr->m_leaf ? const_min_leaf_count : const_min_inner_count);
+			const auto max_count = node_ptr->m_leaf ? const_leaf_count : const_inner_count;
+
+			if (node_ptr->m_count < min_count || node_ptr->m_count > max_count) {
+				return false;
+			}
+
+			const auto keys = node_ptr->m_leaf ? ((const leaf_type*) node_ptr)->keys() : ((const inner_type*) node_ptr)->keys();
+
+			for (size_t i = 0; i < node_ptr->m_count; ++i) {
+				if ((i > 0 && !m_less(keys[i - 1], keys[i]))
+					|| (low != 0 && m_less(keys[i], *low))
+					|| (high != 0 && !m_less(keys[i], *high))) {
+					return false;
+				}
+			}
+
+			if (node_ptr->m_leaf) {
+				if (depth != m_height || node_ptr != *expected) {
+					return false;
+				}
+
+				const auto leaf = (const leaf_type*) node_ptr;
+				if (leaf->m_next != 0 && leaf->m_next->m_prev != leaf) {
+					return false;
+				}
+
+				*expected = leaf->m_next;
+				*count += leaf->m_count;
+				return true;
+			}
+
+			const auto inner = (const inner_type*) node_ptr;
+
+			for (size_t i = 0; i <= inner->m_count; ++i) {
+				if (!this->check_i(inner->m_children[i], depth + 1,
+					i == 0 ? low : keys + i - 1, i == inner->m_count ? high : keys + i, expected, count)) {
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Recursion depth is the tree height, i.e. O(log n).
+		void delete_subtree_i(node_t* node_ptr) {
+			if (node_ptr->m_leaf) {
+				this->delete_leaf_i((leaf_type*) node_ptr);
+				return;
+			}
+
+			const auto inner = (inner_type*) node_ptr;
+			for (size_t i = 0; i <= inner->m_count; ++i) {
+				this->delete_subtree_i(inner->m_children[i]);
+			}
+
+			this->delete_inner_i(inner);
+		}
+
+		leaf_type* new_leaf_i() {
+			auto ptr = leaf_allocator_traits::allocate(m_leaf_allocator, 1);
+			leaf_allocator_traits::construct(m_leaf_allocator, ptr);
+
+			ptr->m_count = 0;
+			ptr->m_leaf = true;
+			ptr->m_prev = 0;
+			ptr->m_next = 0;
+
+			++m_leaf_nodes;
+			return ptr;
+		}
+
+		void delete_leaf_i(leaf_type* ptr) {
+			destroy_slots(ptr->keys(), ptr->m_count);
+			destroy_slots(ptr->values(), ptr->m_count);
+
+			leaf_allocator_traits::destroy(m_leaf_allocator, ptr);
+			leaf_allocator_traits::deallocate(m_leaf_allocator, ptr, 1);
+			--m_leaf_nodes;
+		}
+
+		inner_type* new_inner_i() {
+			auto ptr = inner_allocator_traits::allocate(m_inner_allocator, 1);
+			inner_allocator_traits::construct(m_inner_allocator, ptr);
+
+			ptr->m_count = 0;
+			ptr->m_leaf = false;
+
+			++m_inner_nodes;
+			return ptr;
+		}
+
+		void delete_inner_i(inner_type* ptr) {
+			destroy_slots(ptr->keys(), ptr->m_count);
+
+			inner_allocator_traits::destroy(m_inner_allocator, ptr);
+			inner_allocator_traits::deallocate(m_inner_allocator, ptr, 1);
+			--m_inner_nodes;
+		}
+
+	public:
+		node_t* m_root;
+		leaf_type* m_first;
+		leaf_type* m_last;
+		size_t m_size;
+
+		// Number of levels, 0 if the tree is empty.
+		size_t m_height;
+
+		size_t m_leaf_nodes;
+		size_t m_inner_nodes;
+
+		Compare m_less;
+		leaf_allocator_type m_leaf_allocator;
+		inner_allocator_type m_inner_allocator;
+	};
+
+	// Iterator implementation, elements of a leaf are visited before the next leaf.
+	template <class Key, class Mapped, class Reference, class Pointer, class CtnerPointer, class LeafPointer>
+	class iterator_t : public std::iterator<
+			std::bidirectional_iterator_tag,
+			typename entry_traits_t<Key, Mapped>::value_type, std::ptrdiff_t, Pointer, Reference> {
+	private:
+		typedef iterator_t<Key, Mapped, Reference, Pointer, CtnerPointer, LeafPointer> self_type;
+
+	public:
+		iterator_t() : m_ctner(0), m_leaf(0), m_index(0) {
+		}
+
+		explicit iterator_t(CtnerPointer ctner)
+			: m_ctner(ctner), m_leaf(0), m_index(0) {
+		}
+
+		iterator_t(CtnerPointer ctner, LeafPointer leaf, size_t index)
+			: m_ctner(ctner), m_leaf(leaf), m_index(index) {
+		}
+
+		Reference operator*() const {
+			assert(m_ctner != 0);
+			assert(m_leaf != 0);
+
+			return entry_traits_t<Key, Mapped>::template get<Reference>(m_leaf, m_index);
+		}
+
+		Pointer operator->() const {
+			assert(m_ctner != 0);
+			assert(m_leaf != 0);
+
+			return entry_traits_t<Key, Mapped>::template arrow<Pointer>(m_leaf, m_index);
+		}
+
+		self_type& operator++() {
+			assert(m_leaf != 0);
+
+			if (++m_index == m_leaf->m_count) {
+				m_leaf = m_leaf->m_next;
+				m_index = 0;
+			}
+
+			return *this;
+		}
+
+		self_type operator++(int) {
+			const self_type old(*this);
+			this->operator++();
+			return old;
+		}
+
+		self_type& operator--() {
+			assert(m_ctner != 0);
+
+			if (m_leaf == 0) {
+				m_leaf = m_ctner->m_last;
+				m_index = m_leaf->m_count - 1;
+			}
+			else if (m_index == 0) {
+				m_leaf = m_leaf->m_prev;
+				m_index = m_leaf->m_count - 1;
+			}
+			else {
+				--m_index;
+			}
+
+			return *this;
+		}
+
+		self_type operator--(int) {
+			const self_type old(*this);
+			this->operator--();
+			return old;
+		}
+
+		bool operator==(const self_type& it) const {
+			return m_ctner == it.m_ctner && m_leaf == it.m_leaf && m_index == it.m_index;
+		}
+
+		bool operator!=(const self_type& it) const {
+			return !this->operator==(it);
+		}
+
+		CtnerPointer get_ctner_ptr__() const {
+			return m_ctner;
+		}
+
+		LeafPointer get_leaf_ptr__() const {
+			return m_leaf;
+		}
+
+		size_t get_index__() const {
+			return m_index;
+		}
+
+	private:
+		CtnerPointer m_ctner;
+		LeafPointer m_leaf;
+		size_t m_index;
+	};
+
+
+	/**
+	 * Common part of btree_set_t and btree_map_t.
+	 *
+	 * Like rbtree_t, the container is allocated on the heap,
+	 * so moving a tree only moves a pointer.
+	 */
+	template <class Key, class Mapped, class Compare, class Allocator>
+	class tree_t {
+	private:
+		typedef tree_t<Key, Mapped, Compare, Allocator> self_type;
+		typedef entry_traits_t<Key, Mapped> entry_traits;
+
+	protected:
+		typedef ctner_t<Key, Mapped, Compare, Allocator> ctner_type;
+		typedef typename ctner_type::leaf_type leaf_type;
+		typedef typename ctner_type::position_type position_type;
+
+	public:
+		typedef Key key_type;
+		typedef Compare key_compare;
+		typedef Allocator allocator_type;
+		typedef typename entry_traits::value_type value_type;
+		typedef typename entry_traits::reference reference;
+		typedef typename entry_traits::const_reference const_reference;
+		typedef typename entry_traits::pointer pointer;
+		typedef typename entry_traits::const_pointer const_pointer;
+		typedef size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+
+		typedef iterator_t<Key, Mapped, reference, pointer, ctner_type*, leaf_type*> iterator;
+		typedef iterator_t<Key, Mapped, const_reference, const_pointer, const ctner_type*, const leaf_type*> const_iterator;
+		typedef std::reverse_iterator<iterator> reverse_iterator;
+		typedef std::reverse_iterator<const_iterator> reverse_const_iterator;
+
+		// Maximum number of elements in a leaf.
+		static const size_t const_leaf_count = ctner_type::const_leaf_count;
+
+		// Maximum number of keys in an inner node.
+		static const size_t const_inner_count = ctner_type::const_inner_count;
+
+	public:
+		explicit tree_t(const Compare& less = Compare(), const Allocator& allocator = Allocator()) {
+			m_ctner = new ctner_type(less, allocator);
+		}
+
+		tree_t(const self_type& another) {
+			m_ctner = new ctner_type(another.key_comp(),
+				std::allocator_traits<Allocator>::select_on_container_copy_construction(another.get_allocator()));
+
+			try {
+				*this = another;
+			}
+			catch (...) {
+				delete m_ctner;
+				throw;
+			}
+		}
+
+		tree_t(self_type&& another) {
+			m_ctner = another.m_ctner;
+			another.m_ctner = 0;
+		}
+
+		virtual ~tree_t() {
+			delete m_ctner;
+			m_ctner = 0;
+		}
+
+		size_t size() const {
+			return m_ctner == 0 ? 0 : m_ctner->m_size;
+		}
+
+		size_t max_size() const {
+			return size_t(-1);
+		}
+
+		bool empty() const {
+			return this->size() == 0;
+		}
+
+		void clear() {
+			if (m_ctner != 0) {
+				m_ctner->clear();
+			}
+		}
+
+		key_compare key_comp() const {
+			return m_ctner == 0 ? key_compare() : m_ctner->key_compare();
+		}
+
+		allocator_type get_allocator() const {
+			return m_ctner == 0 ? allocator_type() : m_ctner->get_allocator();
+		}
+
+		// Number of levels from the root to leaves.
+		size_t height() const {
+			return m_ctner == 0 ? 0 : m_ctner->m_height;
+		}
+
+		// Bytes of all nodes.
+		size_t memory_bytes() const {
+			return m_ctner == 0 ? 0 : m_ctner->memory_bytes();
+		}
+
+		// Check B+ Tree properties, it's O(n). See btree__::ctner_t::check_invariants().
+		bool check_invariants() const {
+			return m_ctner == 0 || m_ctner->check_invariants();
+		}
+
+		iterator find(const Key& key) {
+			return m_ctner == 0 ? this->end() : this->make_iterator_i(m_ctner->find(key));
+		}
+
+		const_iterator find(const Key& key) const {
+			return m_ctner == 0 ? this->end() : this->make_iterator_i(m_ctner->find(key));
+		}
+
+		size_t count(const Key& key) const {
+			return m_ctner == 0 || m_ctner->find(key).m_leaf == 0 ? 0 : 1;
+		}
+
+		// The first element which is not less than "key".
+		iterator lower_bound(const Key& key) {
+			return m_ctner == 0 ? this->end() : this->make_iterator_i(m_ctner->lower_bound(key));
+		}
+
+		const_iterator lower_bound(const Key& key) const {
+			return m_ctner == 0 ? this->end() : this->make_iterator_i(m_ctner->lower_bound(key));
+		}
+
+		// The first element which is greater than "key".
+		iterator upper_bound(const Key& key) {
+			return m_ctner == 0 ? this->end() : this->make_iterator_i(m_ctner->upper_bound(key));
+		}
+
+		const_iterator upper_bound(const Key& key) const {
+			return m_ctner == 0 ? this->end() : this->make_iterator_i(m_ctner->upper_bound(key));
+		}
+
+		std::pair<iterator, iterator> equal_range(const Key& key) {
+			return std::pair<iterator, iterator>(this->lower_bound(key), this->upper_bound(key));
+		}
+
+		std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+			return std::pair<const_iterator, const_iterator>(this->lower_bound(key), this->upper_bound(key));
+		}
+
+		// Erase an element, return the next one. Other iterators are invalidated.
+		iterator erase(iterator it) {
+			// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+			assert(m_ctner != 0);
+			assert(it.get_ctner_ptr__() == m_ctner && it != this->end());
+
+			return this->make_iterator_i(m_ctner->erase(position_type(it.get_leaf_ptr__(), it.get_index__())));
+		}
+
+		iterator erase(iterator first, iterator last) {
+			if (first == this->begin() && last == this->end()) {
+				this->clear();
+				return this->end();
+			}
+
+			for (auto count = std::distance(first, last); count > 0; --count) {
+				first = this->erase(first);
+			}
+
+			return first;
+		}
+
+		size_t erase(const Key& key) {
+			// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+			assert(m_ctner != 0);
+
+			const auto found = m_ctner->find(key);
+			if (found.m_leaf == 0) {
+				return 0;
+			}
+
+			m_ctner->erase(found);
+			return 1;
+		}
+
+		iterator begin() {
+			return m_ctner == 0 ? this->end() : iterator(m_ctner, m_ctner->m_first, 0);
+		}
+
+		iterator end() {
+			return iterator(m_ctner);
+		}
+
+		const_iterator begin() const {
+			return m_ctner == 0 ? this->end() : const_iterator(m_ctner, m_ctner->m_first, 0);
+		}
+
+		const_iterator end() const {
+			return const_iterator(m_ctner);
+		}
+
+		reverse_iterator rbegin() {
+			return reverse_iterator(this->end());
+		}
+
+		reverse_iterator rend() {
+			return reverse_iterator(this->begin());
+		}
+
+		reverse_const_iterator rbegin() const {
+			return reverse_const_iterator(this->end());
+		}
+
+		reverse_const_iterator rend() const {
+			return reverse_const_iterator(this->begin());
+		}
+
+		self_type& operator=(const self_type& another) {
+			if (this != &another) {
+				if (another.m_ctner == 0) {
+					this->clear();
+				}
+				else {
+					if (m_ctner == 0) {
+						m_ctner = new ctner_type();
+					}
+
+					m_ctner->assign(*another.m_ctner);
+				}
+			}
+
+			return *this;
+		}
+
+		self_type& operator=(self_type&& another) {
+			if (this != &another) {
+				delete m_ctner;
+				m_ctner = another.m_ctner;
+				another.m_ctner = 0;
+			}
+
+			return *this;
+		}
+
+		self_type& swap(self_type& another) {
+			std::swap(m_ctner, another.m_ctner);
+			return *this;
+		}
+
+	protected:
+		template <class K, class M>
+		std::pair<iterator, bool> insert_i(K&& key, M&& mapped) {
+			// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+			assert(m_ctner != 0);
+
+			const auto result = m_ctner->insert(std::forward<K>(key), std::forward<M>(mapped));
+			return std::pair<iterator, bool>(this->make_iterator_i(result.first), result.second);
+		}
+
+		iterator make_iterator_i(const position_type& position) {
+			return iterator(m_ctner, position.m_leaf, position.m_index);
+		}
+
+		const_iterator make_iterator_i(const position_type& position) const {
+			return const_iterator(m_ctner, position.m_leaf, position.m_index);
+		}
+
+	protected:
+		ctner_type* m_ctner;
+	};
+
+} // namespace btree__
+
+
+/**
+ * Ordered set based on a B+ Tree.
+ *
+ * A node takes about 256 bytes (four cache lines) and holds many keys,
+ * e.g. 58 "int" keys per leaf, so a lookup touches a few nodes only
+ * and an element takes a few bytes instead of a Red-Black Tree node.
+ * If "Compare" is std::less of an arithmetic type, keys of a node are
+ * compared without branches (vectorized by compilers), otherwise they
+ * are binary searched.
+ *
+ * Leaves are linked, so iterating is a walk over arrays. Elements
+ * could not be modified through iterators, and an insert or erase
+ * invalidates all iterators.
+ */
+template <class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key>>
+class btree_set_t : private btree__::tree_t<Key, btree__::no_value_t, Compare, Allocator> {
+private:
+	typedef btree_set_t<Key, Compare, Allocator> self_type;
+	typedef btree__::tree_t<Key, btree__::no_value_t, Compare, Allocator> base_type;
+
+public:
+	typedef typename base_type::key_type key_type;
+	typedef typename base_type::value_type value_type;
+	typedef typename base_type::key_compare key_compare;
+	typedef typename base_type::key_compare value_compare;
+	typedef typename base_type::allocator_type allocator_type;
+	typedef typename base_type::reference reference;
+	typedef typename base_type::const_reference const_reference;
+	typedef typename base_type::pointer pointer;
+	typedef typename base_type::const_pointer const_pointer;
+	typedef typename base_type::size_type size_type;
+	typedef typename base_type::difference_type difference_type;
+	typedef typename base_type::iterator iterator;
+	typedef typename base_type::const_iterator const_iterator;
+	typedef typename base_type::reverse_iterator reverse_iterator;
+	typedef typename base_type::reverse_const_iterator reverse_const_iterator;
+
+	using base_type::const_leaf_count;
+	using base_type::const_inner_count;
+
+public:
+	btree_set_t() {
+	}
+
+	explicit btree_set_t(const Compare& less, const Allocator& allocator = Allocator())
+		: base_type(less, allocator) {
+	}
+
+	btree_set_t(std::initializer_list<Key> list, const Compare& less = Compare(),
+		const Allocator& allocator = Allocator())
+		: base_type(less, allocator) {
+		this->insert(list);
+	}
+
+	using base_type::size;
+	using base_type::max_size;
+	using base_type::empty;
+	using base_type::clear;
+	using base_type::key_comp;
+	using base_type::get_allocator;
+	using base_type::height;
+	using base_type::memory_bytes;
+	using base_type::check_invariants;
+	using base_type::find;
+	using base_type::count;
+	using base_type::lower_bound;
+	using base_type::upper_bound;
+	using base_type::equal_range;
+	using base_type::erase;
+	using base_type::begin;
+	using base_type::end;
+	using base_type::rbegin;
+	using base_type::rend;
+
+	value_compare value_comp() const {
+		return this->key_comp();
+	}
+
+	std::pair<iterator, bool> insert(const Key& key) {
+		return this->insert_i(key, btree__::no_value_t());
+	}
+
+	std::pair<iterator, bool> insert(Key&& key) {
+		return this->insert_i(std::move(key), btree__::no_value_t());
+	}
+
+	template <class Iterator>
+	void insert(Iterator first, Iterator last) {
+		for (; first != last; ++first) {
+			this->insert(*first);
+		}
+	}
+
+	void insert(std::initializer_list<Key> list) {
+		this->insert(list.begin(), list.end());
+	}
+
+	self_type& operator=(std::initializer_list<Key> list) {
+		this->clear();
+		this->insert(list);
+		return *this;
+	}
+
+	self_type& swap(self_type& another) {
+		base_type::swap(another);
+		return *this;
+	}
+};
+
+
+/**
+ * Ordered map based on a B+ Tree, see btree_set_t.
+ *
+ * Keys and mapped values are stored in separate arrays of a leaf, so
+ * lookups only scan keys. Thus, iterators expose an element as
+ * "std::pair<const Key&, T&>" (by value) instead of a reference to
+ * "std::pair<const Key, T>", "it->first" and "it->second" still work.
+ */
+template <class Key, class T, class Compare = std::less<Key>,
+	class Allocator = std::allocator<std::pair<const Key, T>>>
+class btree_map_t : private btree__::tree_t<Key, T, Compare, Allocator> {
+private:
+	typedef btree_map_t<Key, T, Compare, Allocator> self_type;
+	typedef btree__::tree_t<Key, T, Compare, Allocator> base_type;
+
+public:
+	typedef typename base_type::key_type key_type;
+	typedef T mapped_type;
+	typedef typename base_type::value_type value_type;
+	typedef typename base_type::key_compare key_compare;
+	typedef typename base_type::allocator_type allocator_type;
+	typedef typename base_type::reference reference;
+	typedef typename base_type::const_reference const_reference;
+	typedef typename base_type::pointer pointer;
+	typedef typename base_type::const_pointer const_pointer;
+	typedef typename base_type::size_type size_type;
+	typedef typename base_type::difference_type difference_type;
+	typedef typename base_type::iterator iterator;
+	typedef typename base_type::const_iterator const_iterator;
+	typedef typename base_type::reverse_iterator reverse_iterator;
+	typedef typename base_type::reverse_const_iterator reverse_const_iterator;
+
+	using base_type::const_leaf_count;
+	using base_type::const_inner_count;
+
+public:
+	btree_map_t() {
+	}
+
+	explicit btree_map_t(const Compare& less, const Allocator& allocator = Allocator())
+		: base_type(less, allocator) {
+	}
+
+	btree_map_t(std::initializer_list<value_type> list, const Compare& less = Compare(),
+		const Allocator& allocator = Allocator())
+		: base_type(less, allocator) {
+		this->insert(list);
+	}
+
+	using base_type::size;
+	using base_type::max_size;
+	using base_type::empty;
+	using base_type::clear;
+	using base_type::key_comp;
+	using base_type::get_allocator;
+	using base_type::height;
+	using base_type::memory_bytes;
+	using base_type::check_invariants;
+	using base_type::find;
+	using base_type::count;
+	using base_type::lower_bound;
+	using base_type::upper_bound;
+	using base_type::equal_range;
+	using base_type::erase;
+	using base_type::begin;
+	using base_type::end;
+	using base_type::rbegin;
+	using base_type::rend;
+
+	// Insert if the key does not exist, the mapped value is not updated otherwise.
+	std::pair<iterator, bool> insert(const Key& key, const T& value) {
+		return this->insert_i(key, value);
+	}
+
+	std::pair<iterator, bool> insert(Key&& key, T&& value) {
+		return this->insert_i(std::move(key), std::move(value));
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return this->insert_i(value.first, value.second);
+	}
+
+	template <class Iterator>
+	void insert(Iterator first, Iterator last) {
+		for (; first != last; ++first) {
+			this->insert_i((*first).first, (*first).second);
+		}
+	}
+
+	void insert(std::initializer_list<value_type> list) {
+		this->insert(list.begin(), list.end());
+	}
+
+	// Insert a default mapped value if the key does not exist.
+	T& operator[](const Key& key) {
+		return (*this->insert_i(key, T()).first).second;
+	}
+
+	self_type& operator=(std::initializer_list<value_type> list) {
+		this->clear();
+		this->insert(list);
+		return *this;
+	}
+
+	self_type& swap(self_type& another) {
+		base_type::swap(another);
+		return *this;
+	}
+};
+
+} // namespace algo
+
+
+namespace std {
+
+// Override std::swap() to offer better performance.
+template <class Key, class Compare, class Allocator>
+inline void swap(algo::btree_set_t<Key, Compare, Allocator>& v1, algo::btree_set_t<Key, Compare, Allocator>& v2) {
+	v1.swap(v2);
+}
+
+template <class Key, class T, class Compare, class Allocator>
+inline void swap(algo::btree_map_t<Key, T, Compare, Allocator>& v1, algo::btree_map_t<Key, T, Compare, Allocator>& v2) {
+	v1.swap(v2);
+}
+
+}
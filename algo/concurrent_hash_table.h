@@ -0,0 +1,536 @@
+/**
+ * Concurrent hash table.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/key_traits.h"
+#include <assert.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <functional>
+
+
+namespace algo {
+
+// Internal implementation.
+namespace concurrent_hash_table__ {
+
+	// Most CPUs have 64-byte cache lines.
+	const size_t const_cache_line_size = 64;
+
+	// An object retired by a writer, waiting for all readers to leave.
+	struct retired_t {
+		void* m_ptr;
+		void (*m_deleter)(void*);
+		uint64_t m_epoch;
+	};
+
+	// Epoch-based memory reclamation.
+	//
+	// A reader announces the global epoch in a slot before touching shared
+	// nodes and clears the slot when it is done. A writer tags every unlinked
+	// object with the global epoch, and the object is freed only when every
+	// announced epoch is greater than that tag.
+	class epoch_t {
+	public:
+		static const size_t const_slot_count = 128;
+		static const size_t const_reclaim_threshold = 64;
+
+		epoch_t() : m_epoch(1) {
+			for (size_t i = 0; i < const_slot_count; ++i) {
+				m_slots[i].m_value.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		~epoch_t() {
+			// All readers must have left.
+			for (auto it = m_retired.begin(); it != m_retired.end(); ++it) {
+				(*it).m_deleter((*it).m_ptr);
+			}
+		}
+
+		// Returns slot index, which should be passed to leave().
+		size_t enter() {
+			const auto start = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+			while (true) {
+				const auto epoch = m_epoch.load(std::memory_order_relaxed);
+
+				for (size_t i = 0; i < const_slot_count; ++i) {
+					const auto index = (start + i) % const_slot_count;
+					uint64_t expected = 0;
+
+					if (m_slots[index].m_value.compare_exchange_strong(expected, epoch)) {
+						// Readers must not load shared pointers before the announcement is visible.
+						std::atomic_thread_fence(std::memory_order_seq_cst);
+						return index;
+					}
+				}
+
+				// All slots are busy (more than const_slot_count readers).
+				std::this_thread::yield();
+			}
+		}
+
+		void leave(size_t index) {
+			assert(index < const_slot_count);
+			m_slots[index].m_value.store(0, std::memory_order_release);
+		}
+
+		// The object must have been unlinked from all shared structures.
+		void retire(void* ptr, void (*deleter)(void*)) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			retired_t retired;
+			retired.m_ptr = ptr;
+			retired.m_deleter = deleter;
+			retired.m_epoch = m_epoch.load();
+			m_retired.push_back(retired);
+
+			if (m_retired.size() >= const_reclaim_threshold) {
+				m_epoch.fetch_add(1);
+				this->reclaim_i();
+			}
+		}
+
+	private:
+		epoch_t(const epoch_t&) = delete;
+		epoch_t& operator=(const epoch_t&) = delete;
+
+		void reclaim_i() {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			auto min_epoch = m_epoch.load();
+			for (size_t i = 0; i < const_slot_count; ++i) {
+				const auto value = m_slots[i].m_value.load(std::memory_order_acquire);
+				if (value != 0 && value < min_epoch) {
+					min_epoch = value;
+				}
+			}
+
+			size_t kept = 0;
+			for (size_t i = 0; i < m_retired.size(); ++i) {
+				if (m_retired[i].m_epoch < min_epoch) {
+					m_retired[i].m_deleter(m_retired[i].m_ptr);
+				}
+				else {
+					m_retired[kept++] = m_retired[i];
+				}
+			}
+
+			m_retired.resize(kept);
+		}
+
+	private:
+		// Padded to avoid false sharing between readers.
+		struct slot_t {
+			std::atomic<uint64_t> m_value;
+			char m_padding[const_cache_line_size - sizeof(std::atomic<uint64_t>)];
+		};
+
+		std::atomic<uint64_t> m_epoch;
+		slot_t m_slots[const_slot_count];
+		std::mutex m_mutex;
+		std::vector<retired_t> m_retired;
+	};
+
+	// RAII reader section.
+	class epoch_guard_t {
+	public:
+		explicit epoch_guard_t(epoch_t& epoch) : m_epoch(epoch), m_index(epoch.enter()) {
+		}
+
+		~epoch_guard_t() {
+			m_epoch.leave(m_index);
+		}
+
+	private:
+		epoch_guard_t(const epoch_guard_t&) = delete;
+		epoch_guard_t& operator=(const epoch_guard_t&) = delete;
+
+		epoch_t& m_epoch;
+		const size_t m_index;
+	};
+
+	// A published node is never modified except for "m_next",
+	// so readers could access the value without any lock.
+	template <class Key, class T>
+	struct node_t {
+		node_t(const Key& key, const T& value, node_t* next)
+			: m_next(next), m_value(key, value) {
+		}
+
+		std::atomic<node_t*> m_next;
+		const std::pair<const Key, T> m_value;
+	};
+
+	// Bucket array. Its size is always a power of two.
+	template <class Key, class T>
+	struct table_t {
+		explicit table_t(size_t array_size) : m_array_size(array_size) {
+			m_array = new std::atomic<node_t<Key, T>*>[array_size];
+			for (size_t i = 0; i < array_size; ++i) {
+				m_array[i].store(0, std::memory_order_relaxed);
+			}
+		}
+
+		~table_t() {
+			for (size_t i = 0; i < m_array_size; ++i) {
+				for (auto current = m_array[i].load(std::memory_order_relaxed); current != 0;) {
+					auto deleted = current;
+					current = current->m_next.load(std::memory_order_relaxed);
+					delete deleted;
+				}
+			}
+
+			delete[] m_array;
+		}
+
+		static void destroy(void* ptr) {
+			delete (table_t<Key, T>*) ptr;
+		}
+
+		const size_t m_array_size;
+		std::atomic<node_t<Key, T>*>* m_array;
+	};
+}
+
+
+/**
+ * Concurrent hash table.
+ *
+ * Writers take one of const_stripe_count mutexes, chosen by the low bits of
+ * the key hash. Since the bucket array size is always a power of two which is
+ * not less than const_stripe_count, a bucket always belongs to the same stripe.
+ *
+ * Readers never take a lock: they walk the bucket chain under an epoch guard,
+ * and unlinked nodes are freed only after all readers which might see them
+ * have left. A node is immutable once published, so updating a value
+ * replaces the node.
+ *
+ * Resizing takes all stripes, copies the nodes into a new bucket array,
+ * and then publishes the new array. Readers keep working on the old array
+ * (which is frozen) until they notice the new one.
+ *
+ * Note that it's not allowed to destroy the table while other threads are using it.
+ */
+template <class Key, class T, class KeyTraits = key_traits_t<Key>>
+class concurrent_hash_table_t {
+private:
+	typedef concurrent_hash_table_t<Key, T, KeyTraits> self_type;
+	typedef concurrent_hash_table__::node_t<Key, T> node_type;
+	typedef concurrent_hash_table__::table_t<Key, T> table_type;
+	typedef concurrent_hash_table__::epoch_guard_t guard_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef std::pair<const Key, T> value_type;
+	typedef KeyTraits key_traits;
+	typedef size_t size_type;
+
+	// Number of writer locks.
+	static const size_t const_stripe_count = 64;
+
+	// Default hash table array size.
+	static const size_t const_default_array_size = 256;
+
+	// The table grows when "size() > array size * const_max_load_factor".
+	static const size_t const_max_load_factor = 2;
+
+public:
+	concurrent_hash_table_t() : concurrent_hash_table_t(KeyTraits(), const_default_array_size) {
+	}
+
+	explicit concurrent_hash_table_t(size_t array_size)
+		: concurrent_hash_table_t(KeyTraits(), array_size) {
+	}
+
+	explicit concurrent_hash_table_t(const KeyTraits& key_traits, size_t array_size = const_default_array_size)
+		: m_key_traits(key_traits), m_size(0) {
+		m_table.store(new table_type(round_array_size(array_size)));
+	}
+
+	~concurrent_hash_table_t() {
+		delete m_table.load();
+	}
+
+	size_t size() const {
+		return m_size.load(std::memory_order_relaxed);
+	}
+
+	bool empty() const {
+		return this->size() == 0;
+	}
+
+	size_t array_size() const {
+		guard_type guard(m_epoch);
+		return m_table.load(std::memory_order_acquire)->m_array_size;
+	}
+
+	key_traits key_comp() const {
+		return m_key_traits;
+	}
+
+	bool find(const Key& key, T* value) const;
+	bool contains(const Key& key) const;
+
+	bool insert(const Key& key, const T& value);
+	bool insert_or_assign(const Key& key, const T& value);
+	size_t erase(const Key& key);
+	void clear();
+
+	/**
+	 * Visit all elements of a consistent bucket array snapshot without any lock.
+	 *
+	 * Functor prototype: void functor(const std::pair<const Key, T>& value);
+	 */
+	template <class Functor>
+	void for_each(const Functor& functor) const {
+		guard_type guard(m_epoch);
+
+		const auto table = m_table.load(std::memory_order_acquire);
+		for (size_t i = 0; i < table->m_array_size; ++i) {
+			for (auto ptr = table->m_array[i].load(std::memory_order_acquire);
+				ptr != 0; ptr = ptr->m_next.load(std::memory_order_acquire)) {
+				functor(ptr->m_value);
+			}
+		}
+	}
+
+private:
+	concurrent_hash_table_t(const self_type&) = delete;
+	self_type& operator=(const self_type&) = delete;
+
+	static size_t round_array_size(size_t array_size) {
+		size_t result = const_stripe_count;
+		while (result < array_size) {
+			result <<= 1;
+		}
+
+		return result;
+	}
+
+	std::mutex& stripe(size_t hash) const {
+		return m_stripes[hash & (const_stripe_count - 1)].m_mutex;
+	}
+
+	const node_type* find_i(const Key& key) const;
+	void grow_i(size_t old_array_size);
+
+	// Lock all stripes in order, so that no writer could run.
+	void lock_all_i() const {
+		for (size_t i = 0; i < const_stripe_count; ++i) {
+			m_stripes[i].m_mutex.lock();
+		}
+	}
+
+	void unlock_all_i() const {
+		for (size_t i = const_stripe_count; i > 0; --i) {
+			m_stripes[i - 1].m_mutex.unlock();
+		}
+	}
+
+private:
+	struct stripe_t {
+		std::mutex m_mutex;
+		char m_padding[concurrent_hash_table__::const_cache_line_size];
+	};
+
+	KeyTraits m_key_traits;
+	std::atomic<table_type*> m_table;
+	std::atomic<size_t> m_size;
+	mutable stripe_t m_stripes[const_stripe_count];
+	mutable concurrent_hash_table__::epoch_t m_epoch;
+};
+
+
+template <class Key, class T, class KeyTraits>
+inline bool concurrent_hash_table_t<Key, T, KeyTraits>::find(const Key& key, T* value) const {
+	assert(value != 0);
+
+	guard_type guard(m_epoch);
+
+	const auto ptr = this->find_i(key);
+	if (ptr == 0) {
+		return false;
+	}
+
+	*value = ptr->m_value.second;
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+inline bool concurrent_hash_table_t<Key, T, KeyTraits>::contains(const Key& key) const {
+	guard_type guard(m_epoch);
+	return this->find_i(key) != 0;
+}
+
+template <class Key, class T, class KeyTraits>
+inline bool concurrent_hash_table_t<Key, T, KeyTraits>::insert(const Key& key, const T& value) {
+	const auto hash = m_key_traits.hash(key);
+	size_t array_size = 0;
+	size_t size = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(this->stripe(hash));
+
+		// Resizing needs all stripes, so the bucket array could not change here.
+		const auto table = m_table.load(std::memory_order_relaxed);
+		auto& head = table->m_array[hash & (table->m_array_size - 1)];
+
+		for (auto ptr = head.load(std::memory_order_relaxed); ptr != 0;
+			ptr = ptr->m_next.load(std::memory_order_relaxed)) {
+			if (m_key_traits.equal(ptr->m_value.first, key)) {
+				return false;
+			}
+		}
+
+		head.store(new node_type(key, value, head.load(std::memory_order_relaxed)), std::memory_order_release);
+		array_size = table->m_array_size;
+
+		// Counted under the stripe lock, so clear() could not reset the size in between.
+		size = m_size.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	if (size > array_size * const_max_load_factor) {
+		this->grow_i(array_size);
+	}
+
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+inline bool concurrent_hash_table_t<Key, T, KeyTraits>::insert_or_assign(const Key& key, const T& value) {
+	const auto hash = m_key_traits.hash(key);
+	size_t array_size = 0;
+	size_t size = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(this->stripe(hash));
+
+		const auto table = m_table.load(std::memory_order_relaxed);
+		auto& head = table->m_array[hash & (table->m_array_size - 1)];
+
+		for (auto prev = &head; ; ) {
+			const auto ptr = prev->load(std::memory_order_relaxed);
+			if (ptr == 0) {
+				break;
+			}
+
+			if (m_key_traits.equal(ptr->m_value.first, key)) {
+				// Replace the node, readers see either the old one or the new one.
+				prev->store(new node_type(key, value, ptr->m_next.load(std::memory_order_relaxed)),
+					std::memory_order_release);
+				m_epoch.retire(ptr, [](void* p) { delete (node_type*) p; });
+				return false;
+			}
+
+			prev = &ptr->m_next;
+		}
+
+		head.store(new node_type(key, value, head.load(std::memory_order_relaxed)), std::memory_order_release);
+		array_size = table->m_array_size;
+
+		size = m_size.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	if (size > array_size * const_max_load_factor) {
+		this->grow_i(array_size);
+	}
+
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+inline size_t concurrent_hash_table_t<Key, T, KeyTraits>::erase(const Key& key) {
+	const auto hash = m_key_traits.hash(key);
+
+	std::lock_guard<std::mutex> lock(this->stripe(hash));
+
+	const auto table = m_table.load(std::memory_order_relaxed);
+
+	for (auto prev = &table->m_array[hash & (table->m_array_size - 1)]; ; ) {
+		const auto ptr = prev->load(std::memory_order_relaxed);
+		if (ptr == 0) {
+			return 0;
+		}
+
+		if (m_key_traits.equal(ptr->m_value.first, key)) {
+			prev->store(ptr->m_next.load(std::memory_order_relaxed), std::memory_order_release);
+			m_size.fetch_sub(1, std::memory_order_relaxed);
+			m_epoch.retire(ptr, [](void* p) { delete (node_type*) p; });
+			return 1;
+		}
+
+		prev = &ptr->m_next;
+	}
+}
+
+template <class Key, class T, class KeyTraits>
+inline void concurrent_hash_table_t<Key, T, KeyTraits>::clear() {
+	this->lock_all_i();
+
+	const auto old_table = m_table.load(std::memory_order_relaxed);
+	m_table.store(new table_type(old_table->m_array_size), std::memory_order_release);
+	m_size.store(0, std::memory_order_relaxed);
+
+	this->unlock_all_i();
+
+	m_epoch.retire(old_table, &table_type::destroy);
+}
+
+template <class Key, class T, class KeyTraits>
+inline const typename concurrent_hash_table_t<Key, T, KeyTraits>::node_type*
+concurrent_hash_table_t<Key, T, KeyTraits>::find_i(const Key& key) const {
+	const auto hash = m_key_traits.hash(key);
+	const auto table = m_table.load(std::memory_order_acquire);
+
+	for (auto ptr = table->m_array[hash & (table->m_array_size - 1)].load(std::memory_order_acquire);
+		ptr != 0; ptr = ptr->m_next.load(std::memory_order_acquire)) {
+		if (m_key_traits.equal(ptr->m_value.first, key)) {
+			return ptr;
+		}
+	}
+
+	return 0;
+}
+
+template <class Key, class T, class KeyTraits>
+inline void concurrent_hash_table_t<Key, T, KeyTraits>::grow_i(size_t old_array_size) {
+	this->lock_all_i();
+
+	const auto old_table = m_table.load(std::memory_order_relaxed);
+
+	// Another thread has done it.
+	if (old_table->m_array_size != old_array_size) {
+		this->unlock_all_i();
+		return;
+	}
+
+	// Readers might be walking the old chains, so nodes are copied instead of relinked.
+	const auto new_table = new table_type(old_array_size * 2);
+	for (size_t i = 0; i < old_table->m_array_size; ++i) {
+		for (auto ptr = old_table->m_array[i].load(std::memory_order_relaxed);
+			ptr != 0; ptr = ptr->m_next.load(std::memory_order_relaxed)) {
+			auto& head = new_table->m_array[m_key_traits.hash(ptr->m_value.first) & (new_table->m_array_size - 1)];
+			head.store(new node_type(ptr->m_value.first, ptr->m_value.second,
+				head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+		}
+	}
+
+	m_table.store(new_table, std::memory_order_release);
+
+	this->unlock_all_i();
+
+	m_epoch.retire(old_table, &table_type::destroy);
+}
+
+} // namespace algo
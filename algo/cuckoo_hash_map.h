@@ -0,0 +1,763 @@
+/**
+ * Cuckoo hash map.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/key_traits.h"
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <algorithm>
+#include <utility>
+#include <iterator>
+#include <vector>
+#include <initializer_list>
+
+
+namespace algo {
+
+// Internal implementation.
+namespace cuckoo_hash_map__ {
+
+	// Slots per bucket.
+	const size_t const_slots = 4;
+
+	// Limits of the breadth-first search for a displacement path.
+	const size_t const_max_path_length = 5;
+	const size_t const_max_search_nodes = 512;
+
+	// A failed insert doubles the table only if it's at least this full (percent),
+	// otherwise keys collide too much for a bigger table to help.
+	const size_t const_min_grow_load = 50;
+
+	const size_t const_cache_line = 64;
+
+	// Buckets no bigger than a cache line are aligned to a power of 2,
+	// so that they never cross a cache line.
+	template <size_t Size, size_t Align = 1>
+	struct bucket_align_t {
+		static const size_t value = Align >= Size ? Align : bucket_align_t<Size, Align * 2>::value;
+	};
+
+	template <size_t Size>
+	struct bucket_align_t<Size, const_cache_line> {
+		static const size_t value = const_cache_line;
+	};
+
+	template <class Key, class T>
+	struct bucket_t {
+		typedef std::pair<const Key, T> value_type;
+
+		value_type* slot(size_t index) {
+			return (value_type*) &m_slots[index];
+		}
+
+		const value_type* slot(size_t index) const {
+			return (const value_type*) &m_slots[index];
+		}
+
+		// Non-zero fingerprints of keys, 0 means free slot.
+		uint8_t m_tags[const_slots];
+		typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type m_slots[const_slots];
+	};
+
+	// splitmix64 finalizer, KeyTraits::hash() could be weak (e.g. identity).
+	inline uint64_t mix(uint64_t value) {
+		value ^= value >> 30;
+		value *= 0xBF58476D1CE4E5B9ULL;
+		value ^= value >> 27;
+		value *= 0x94D049BB133111EBULL;
+		value ^= value >> 31;
+		return value;
+	}
+
+	// Slot position.
+	struct position_t {
+		position_t() : m_bucket(0), m_slot(0) {
+		}
+
+		position_t(size_t bucket, size_t slot) : m_bucket(bucket), m_slot(slot) {
+		}
+
+		size_t m_bucket;
+		size_t m_slot;
+	};
+
+	template <class Value, class Pointer, class Reference, class CtnerPointer>
+	class iterator_t : public std::iterator<std::forward_iterator_tag, Value, std::ptrdiff_t, Pointer, Reference> {
+	private:
+		typedef iterator_t<Value, Pointer, Reference, CtnerPointer> self_type;
+
+	public:
+		iterator_t() : m_ctner(0), m_bucket(0), m_slot(0) {
+		}
+
+		iterator_t(CtnerPointer ctner, size_t bucket, size_t slot)
+			: m_ctner(ctner), m_bucket(bucket), m_slot(slot) {
+		}
+
+		Reference operator*() const {
+			assert(m_ctner != 0 && m_bucket <= m_ctner->bucket_count());
+			return *m_ctner->value(m_bucket, m_slot);
+		}
+
+		Pointer operator->() const {
+			return &this->operator*();
+		}
+
+		self_type& operator++() {
+			assert(m_ctner != 0 && m_bucket <= m_ctner->bucket_count());
+
+			this->skip_i(m_bucket, m_slot + 1);
+			return *this;
+		}
+
+		self_type operator++(int) {
+			const self_type old(*this);
+			this->operator++();
+			return old;
+		}
+
+		bool operator==(const self_type& it) const {
+			return m_ctner == it.m_ctner && m_bucket == it.m_bucket && m_slot == it.m_slot;
+		}
+
+		bool operator!=(const self_type& it) const {
+			return !this->operator==(it);
+		}
+
+		// Move to the first used slot at or after (bucket, slot).
+		// Stashed elements follow the buckets, as if in bucket "bucket_count()".
+		void skip_i(size_t bucket, size_t slot) {
+			for (; bucket < m_ctner->bucket_count(); ++bucket, slot = 0) {
+				for (; slot < const_slots; ++slot) {
+					if (m_ctner->bucket(bucket).m_tags[slot] != 0) {
+						m_bucket = bucket;
+						m_slot = slot;
+						return;
+					}
+				}
+			}
+
+			if (bucket == m_ctner->bucket_count() && slot < m_ctner->stash_size()) {
+				m_bucket = bucket;
+				m_slot = slot;
+				return;
+			}
+
+			m_bucket = m_ctner->bucket_count() + 1;
+			m_slot = 0;
+		}
+
+	private:
+		CtnerPointer m_ctner;
+		size_t m_bucket;
+		size_t m_slot;
+	};
+
+} // namespace cuckoo_hash_map__
+
+
+/**
+ * Bucketized cuckoo hash map.
+ *
+ * Every key could only live in one of its two candidate buckets of 4
+ * slots, so a lookup checks at most 8 slots (2 cache lines if a bucket
+ * fits in one), regardless of the load. Slots are screened by 8-bit
+ * fingerprints before keys are compared.
+ *
+ * If both buckets are full, insert() searches breadth-first for the
+ * shortest path of displacements to a free slot, and doubles the
+ * table if there is none. The load factor usually reaches 95%.
+ *
+ * Keys sharing a hash value share their buckets too, so no table could
+ * hold more than 8 of them. If a table at most half full has no room
+ * for a key, it goes to a stash instead, which lookups scan after
+ * the two buckets. The stash stays empty with a decent hash function.
+ *
+ * Unlike hash_table_t, insert() could move elements, so it invalidates
+ * iterators and references.
+ */
+template <class Key, class T, class KeyTraits = key_traits_t<Key>>
+class cuckoo_hash_map_t {
+private:
+	typedef cuckoo_hash_map_t<Key, T, KeyTraits> self_type;
+	typedef cuckoo_hash_map__::bucket_t<Key, T> bucket_type;
+	typedef cuckoo_hash_map__::position_t position_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef std::pair<const Key, T> value_type;
+	typedef KeyTraits key_traits;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+	typedef size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef value_type* pointer;
+	typedef const value_type* const_pointer;
+	typedef cuckoo_hash_map__::iterator_t<value_type, pointer, reference, self_type*> iterator;
+	typedef cuckoo_hash_map__::iterator_t<value_type, const_pointer, const_reference, const self_type*> const_iterator;
+
+	static const size_t const_bucket_align = cuckoo_hash_map__::bucket_align_t<sizeof(bucket_type)>::value;
+
+public:
+	explicit cuckoo_hash_map_t(size_t capacity = 0, const KeyTraits& key_traits = KeyTraits())
+		: m_buffer(0), m_buckets(0), m_bucket_count(0), m_size(0), m_key_traits(key_traits) {
+		this->allocate_i(bucket_count_i(capacity));
+	}
+
+	cuckoo_hash_map_t(std::initializer_list<value_type> list, const KeyTraits& key_traits = KeyTraits())
+		: cuckoo_hash_map_t(list.size(), key_traits) {
+		this->insert(list);
+	}
+
+	cuckoo_hash_map_t(const self_type& another)
+		: m_buffer(0), m_buckets(0), m_bucket_count(0), m_size(0), m_key_traits(another.m_key_traits) {
+		this->allocate_i(another.m_bucket_count);
+
+		try {
+			this->copy_i(another);
+		}
+		catch (...) {
+			// The destructor is not called if a constructor throws.
+			this->clear();
+			::operator delete(m_buffer);
+			throw;
+		}
+	}
+
+	cuckoo_hash_map_t(self_type&& another)
+		: m_buffer(0), m_buckets(0), m_bucket_count(0), m_size(0), m_key_traits(another.m_key_traits) {
+		this->swap(another);
+	}
+
+	~cuckoo_hash_map_t() {
+		this->clear();
+		::operator delete(m_buffer);
+	}
+
+	self_type& operator=(const self_type& another) {
+		if (this != &another) {
+			this->clear();
+
+			if (m_bucket_count != another.m_bucket_count) {
+				::operator delete(m_buffer);
+				m_buffer = 0;
+				this->allocate_i(another.m_bucket_count);
+			}
+
+			m_key_traits = another.m_key_traits;
+			this->copy_i(another);
+		}
+
+		return *this;
+	}
+
+	self_type& operator=(self_type&& another) {
+		this->swap(another);
+		return *this;
+	}
+
+	self_type& swap(self_type& another) {
+		std::swap(m_buffer, another.m_buffer);
+		std::swap(m_buckets, another.m_buckets);
+		std::swap(m_bucket_count, another.m_bucket_count);
+		std::swap(m_size, another.m_size);
+		std::swap(m_key_traits, another.m_key_traits);
+		m_stash.swap(another.m_stash);
+		return *this;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	// Number of slots.
+	size_t capacity() const {
+		return m_bucket_count * cuckoo_hash_map__::const_slots;
+	}
+
+	double load_factor() const {
+		return (double) m_size / this->capacity();
+	}
+
+	key_traits key_comp() const {
+		return m_key_traits;
+	}
+
+	void clear();
+	void reserve(size_t count);
+
+	iterator find(const Key& key) {
+		const auto found = this->find_i(key);
+		return found.m_bucket > m_bucket_count ? this->end() : iterator(this, found.m_bucket, found.m_slot);
+	}
+
+	const_iterator find(const Key& key) const {
+		const auto found = this->find_i(key);
+		return found.m_bucket > m_bucket_count ? this->end() : const_iterator(this, found.m_bucket, found.m_slot);
+	}
+
+	size_t count(const Key& key) const {
+		return this->find_i(key).m_bucket > m_bucket_count ? 0 : 1;
+	}
+
+	// Heterogeneous lookup, available if "KeyTraits::is_transparent" is defined.
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	iterator find(const K& key) {
+		const auto found = this->find_i(key);
+		return found.m_bucket > m_bucket_count ? this->end() : iterator(this, found.m_bucket, found.m_slot);
+	}
+
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	const_iterator find(const K& key) const {
+		const auto found = this->find_i(key);
+		return found.m_bucket > m_bucket_count ? this->end() : const_iterator(this, found.m_bucket, found.m_slot);
+	}
+
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	size_t count(const K& key) const {
+		return this->find_i(key).m_bucket > m_bucket_count ? 0 : 1;
+	}
+
+	std::pair<iterator, bool> insert(const Key& key, const T& value);
+	void insert(std::initializer_list<value_type> list);
+
+	size_t erase(const Key& key);
+
+	mapped_type& operator[](const key_type& key);
+
+	iterator begin() {
+		iterator it(this, 0, 0);
+		it.skip_i(0, 0);
+		return it;
+	}
+
+	iterator end() {
+		return iterator(this, m_bucket_count + 1, 0);
+	}
+
+	const_iterator begin() const {
+		const_iterator it(this, 0, 0);
+		it.skip_i(0, 0);
+		return it;
+	}
+
+	const_iterator end() const {
+		return const_iterator(this, m_bucket_count + 1, 0);
+	}
+
+	// Used by iterators.
+	size_t bucket_count() const {
+		return m_bucket_count;
+	}
+
+	bucket_type& bucket(size_t index) {
+		return m_buckets[index];
+	}
+
+	const bucket_type& bucket(size_t index) const {
+		return m_buckets[index];
+	}
+
+	size_t stash_size() const {
+		return m_stash.size();
+	}
+
+	// Element in a slot, or in the stash if "bucket" is "bucket_count()".
+	value_type* value(size_t bucket, size_t slot) {
+		return bucket < m_bucket_count ? m_buckets[bucket].slot(slot) : m_stash[slot];
+	}
+
+	const value_type* value(size_t bucket, size_t slot) const {
+		return bucket < m_bucket_count ? m_buckets[bucket].slot(slot) : m_stash[slot];
+	}
+
+private:
+	static size_t bucket_count_i(size_t capacity) {
+		size_t count = 2;
+
+		while (count * cuckoo_hash_map__::const_slots * 9 < capacity * 10) {
+			count *= 2;
+		}
+
+		return count;
+	}
+
+	static uint8_t tag_i(uint64_t hash) {
+		const auto tag = (uint8_t) (hash >> 56);
+		return tag == 0 ? 1 : tag;
+	}
+
+	// The other candidate bucket, it's computed from the fingerprint only,
+	// so elements could be displaced without hashing their keys again.
+	size_t alternate_i(size_t bucket, uint8_t tag) const {
+		return (bucket ^ ((size_t) tag * 0x5BD1E995U)) & (m_bucket_count - 1);
+	}
+
+	template <class K>
+	position_type find_i(const K& key) const;
+
+	template <class K, class V>
+	bool insert_i(uint64_t hash, K&& key, V&& value, position_type* position);
+	template <class K, class V>
+	position_type stash_i(K&& key, V&& value);
+	bool search_path_i(size_t bucket1, size_t bucket2, std::vector<position_type>* path) const;
+	void grow_i();
+	void allocate_i(size_t bucket_count);
+	void copy_i(const self_type& another);
+
+private:
+	char* m_buffer;
+	bucket_type* m_buckets;
+	size_t m_bucket_count;
+	size_t m_size;
+	KeyTraits m_key_traits;
+
+	// Elements without room in their buckets.
+	std::vector<value_type*> m_stash;
+};
+
+
+template <class Key, class T, class KeyTraits>
+inline void cuckoo_hash_map_t<Key, T, KeyTraits>::clear() {
+	for (size_t i = 0; i < m_stash.size(); ++i) {
+		delete m_stash[i];
+		--m_size;
+	}
+
+	m_stash.clear();
+
+	for (size_t i = 0; i < m_bucket_count && m_size > 0; ++i) {
+		for (size_t k = 0; k < cuckoo_hash_map__::const_slots; ++k) {
+			if (m_buckets[i].m_tags[k] != 0) {
+				m_buckets[i].slot(k)->~value_type();
+				m_buckets[i].m_tags[k] = 0;
+				--m_size;
+			}
+		}
+	}
+
+	assert(m_size == 0);
+}
+
+template <class Key, class T, class KeyTraits>
+inline void cuckoo_hash_map_t<Key, T, KeyTraits>::reserve(size_t count) {
+	while (this->capacity() * 9 < count * 10) {
+		this->grow_i();
+	}
+}
+
+template <class Key, class T, class KeyTraits>
+template <class K>
+inline typename cuckoo_hash_map_t<Key, T, KeyTraits>::position_type
+cuckoo_hash_map_t<Key, T, KeyTraits>::find_i(const K& key) const {
+	const auto hash = cuckoo_hash_map__::mix((uint64_t) m_key_traits.hash(key));
+	const auto tag = tag_i(hash);
+	const auto bucket1 = (size_t) hash & (m_bucket_count - 1);
+	const auto bucket2 = this->alternate_i(bucket1, tag);
+
+	for (size_t k = 0; k < cuckoo_hash_map__::const_slots; ++k) {
+		if (m_buckets[bucket1].m_tags[k] == tag && m_key_traits.equal(m_buckets[bucket1].slot(k)->first, key)) {
+			return position_type(bucket1, k);
+		}
+	}
+
+	for (size_t k = 0; k < cuckoo_hash_map__::const_slots; ++k) {
+		if (m_buckets[bucket2].m_tags[k] == tag && m_key_traits.equal(m_buckets[bucket2].slot(k)->first, key)) {
+			return position_type(bucket2, k);
+		}
+	}
+
+	for (size_t i = 0; i < m_stash.size(); ++i) {
+		if (m_key_traits.equal(m_stash[i]->first, key)) {
+			return position_type(m_bucket_count, i);
+		}
+	}
+
+	return position_type(m_bucket_count + 1, 0);
+}
+
+template <class Key, class T, class KeyTraits>
+inline std::pair<typename cuckoo_hash_map_t<Key, T, KeyTraits>::iterator, bool>
+cuckoo_hash_map_t<Key, T, KeyTraits>::insert(const Key& key, const T& value) {
+	const auto found = this->find_i(key);
+	if (found.m_bucket <= m_bucket_count) {
+		return std::pair<iterator, bool>(iterator(this, found.m_bucket, found.m_slot), false);
+	}
+
+	const auto hash = cuckoo_hash_map__::mix((uint64_t) m_key_traits.hash(key));
+	position_type position;
+
+	if (!this->insert_i(hash, key, value, &position)) {
+		// Grow once at most, a table still without room after that is
+		// mostly empty, so the key collides with too many others.
+		bool placed = false;
+
+		if (m_size * 100 >= this->capacity() * cuckoo_hash_map__::const_min_grow_load) {
+			this->grow_i();
+			placed = this->insert_i(hash, key, value, &position);
+		}
+
+		if (!placed) {
+			position = this->stash_i(key, value);
+		}
+	}
+
+	return std::pair<iterator, bool>(iterator(this, position.m_bucket, position.m_slot), true);
+}
+
+template <class Key, class T, class KeyTraits>
+inline void cuckoo_hash_map_t<Key, T, KeyTraits>::insert(std::initializer_list<value_type> list) {
+	for (auto it = list.begin(); it != list.end(); ++it) {
+		this->insert((*it).first, (*it).second);
+	}
+}
+
+template <class Key, class T, class KeyTraits>
+inline size_t cuckoo_hash_map_t<Key, T, KeyTraits>::erase(const Key& key) {
+	const auto found = this->find_i(key);
+	if (found.m_bucket > m_bucket_count) {
+		return 0;
+	}
+
+	if (found.m_bucket == m_bucket_count) {
+		delete m_stash[found.m_slot];
+		m_stash[found.m_slot] = m_stash.back();
+		m_stash.pop_back();
+		--m_size;
+
+		return 1;
+	}
+
+	m_buckets[found.m_bucket].slot(found.m_slot)->~value_type();
+	m_buckets[found.m_bucket].m_tags[found.m_slot] = 0;
+	--m_size;
+
+	return 1;
+}
+
+template <class Key, class T, class KeyTraits>
+inline T& cuckoo_hash_map_t<Key, T, KeyTraits>::operator[](const key_type& key) {
+	return (*this->insert(key, T()).first).second;
+}
+
+// Insert a new key, return false if there is no free slot within reach.
+template <class Key, class T, class KeyTraits>
+template <class K, class V>
+inline bool cuckoo_hash_map_t<Key, T, KeyTraits>::insert_i(
+	uint64_t hash, K&& key, V&& value, position_type* position) {
+	const auto tag = tag_i(hash);
+	const auto bucket1 = (size_t) hash & (m_bucket_count - 1);
+	const auto bucket2 = this->alternate_i(bucket1, tag);
+
+	std::vector<position_type> path;
+	if (!this->search_path_i(bucket1, bucket2, &path)) {
+		return false;
+	}
+
+	// Move elements along the path, from the free slot backward.
+	for (size_t i = path.size() - 1; i > 0; --i) {
+		auto& from = m_buckets[path[i - 1].m_bucket];
+		auto& to = m_buckets[path[i].m_bucket];
+
+		assert(to.m_tags[path[i].m_slot] == 0);
+		new (to.slot(path[i].m_slot)) value_type(std::move(*from.slot(path[i - 1].m_slot)));
+		to.m_tags[path[i].m_slot] = from.m_tags[path[i - 1].m_slot];
+
+		from.slot(path[i - 1].m_slot)->~value_type();
+		from.m_tags[path[i - 1].m_slot] = 0;
+	}
+
+	auto& bucket = m_buckets[path[0].m_bucket];
+	new (bucket.slot(path[0].m_slot)) value_type(std::forward<K>(key), std::forward<V>(value));
+	bucket.m_tags[path[0].m_slot] = tag;
+	++m_size;
+
+	*position = path[0];
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+template <class K, class V>
+inline typename cuckoo_hash_map_t<Key, T, KeyTraits>::position_type
+cuckoo_hash_map_t<Key, T, KeyTraits>::stash_i(K&& key, V&& value) {
+	// Make room first, so that the new element never leaks.
+	m_stash.push_back(0);
+
+	try {
+		m_stash.back() = new value_type(std::forward<K>(key), std::forward<V>(value));
+	}
+	catch (...) {
+		m_stash.pop_back();
+		throw;
+	}
+
+	++m_size;
+	return position_type(m_bucket_count, m_stash.size() - 1);
+}
+
+// Breadth-first search for the shortest displacement path.
+//
+// On success, path[0] is a slot of "bucket1" or "bucket2", path[i]
+// is a slot of the alternate bucket of the element at path[i - 1],
+// and the last one is free.
+template <class Key, class T, class KeyTraits>
+inline bool cuckoo_hash_map_t<Key, T, KeyTraits>::search_path_i(
+	size_t bucket1, size_t bucket2, std::vector<position_type>* path) const {
+	struct node_t {
+		size_t m_bucket;
+		size_t m_parent;
+		size_t m_slot;
+		size_t m_depth;
+	};
+
+	const size_t npos = (size_t) -1;
+	std::vector<node_t> nodes;
+
+	const node_t root1 = { bucket1, npos, 0, 0 };
+	const node_t root2 = { bucket2, npos, 0, 0 };
+	nodes.push_back(root1);
+	if (bucket2 != bucket1) {
+		nodes.push_back(root2);
+	}
+
+	for (size_t current = 0; current < nodes.size(); ++current) {
+		const auto node = nodes[current];
+		const auto& bucket = m_buckets[node.m_bucket];
+
+		for (size_t k = 0; k < cuckoo_hash_map__::const_slots; ++k) {
+			if (bucket.m_tags[k] != 0) {
+				continue;
+			}
+
+			// Found a free slot, collect the path from the root.
+			path->clear();
+			path->push_back(position_type(node.m_bucket, k));
+
+			for (auto index = current; nodes[index].m_parent != npos; index = nodes[index].m_parent) {
+				path->push_back(position_type(nodes[nodes[index].m_parent].m_bucket, nodes[index].m_slot));
+			}
+
+			std::reverse(path->begin(), path->end());
+			return true;
+		}
+
+		if (node.m_depth >= cuckoo_hash_map__::const_max_path_length) {
+			continue;
+		}
+
+		for (size_t k = 0; k < cuckoo_hash_map__::const_slots
+			&& nodes.size() < cuckoo_hash_map__::const_max_search_nodes; ++k) {
+			const auto alternate = this->alternate_i(node.m_bucket, bucket.m_tags[k]);
+
+			// A bucket must not appear twice in a path.
+			bool visited = false;
+			for (auto index = current; index != npos; index = nodes[index].m_parent) {
+				if (nodes[index].m_bucket == alternate) {
+					visited = true;
+					break;
+				}
+			}
+
+			if (!visited) {
+				const node_t child = { alternate, current, k, node.m_depth + 1 };
+				nodes.push_back(child);
+			}
+		}
+	}
+
+	return false;
+}
+
+template <class Key, class T, class KeyTraits>
+inline void cuckoo_hash_map_t<Key, T, KeyTraits>::grow_i() {
+	self_type bigger(0, m_key_traits);
+
+	::operator delete(bigger.m_buffer);
+	bigger.m_buffer = 0;
+	bigger.allocate_i(m_bucket_count * 2);
+
+	// Elements are copied, and "this" is swapped with "bigger" only after
+	// all of them are placed, so "this" is unchanged if anything throws.
+	const auto copy_to_bigger = [&bigger, this](const value_type& value) {
+		const auto hash = cuckoo_hash_map__::mix((uint64_t) m_key_traits.hash(value.first));
+		position_type position;
+
+		if (!bigger.insert_i(hash, value.first, value.second, &position)) {
+			bigger.stash_i(value.first, value.second);
+		}
+	};
+
+	for (size_t i = 0; i < m_bucket_count; ++i) {
+		for (size_t k = 0; k < cuckoo_hash_map__::const_slots; ++k) {
+			if (m_buckets[i].m_tags[k] != 0) {
+				copy_to_bigger(*m_buckets[i].slot(k));
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_stash.size(); ++i) {
+		copy_to_bigger(*m_stash[i]);
+	}
+
+	this->swap(bigger);
+}
+
+template <class Key, class T, class KeyTraits>
+inline void cuckoo_hash_map_t<Key, T, KeyTraits>::allocate_i(size_t bucket_count) {
+	assert(m_buffer == 0 && (bucket_count & (bucket_count - 1)) == 0);
+
+	const auto bytes = bucket_count * sizeof(bucket_type);
+	m_buffer = (char*) ::operator new(bytes + const_bucket_align);
+	m_buckets = (bucket_type*) (((uintptr_t) m_buffer + const_bucket_align - 1) & ~(uintptr_t) (const_bucket_align - 1));
+	m_bucket_count = bucket_count;
+
+	for (size_t i = 0; i < bucket_count; ++i) {
+		for (size_t k = 0; k < cuckoo_hash_map__::const_slots; ++k) {
+			m_buckets[i].m_tags[k] = 0;
+		}
+	}
+}
+
+template <class Key, class T, class KeyTraits>
+inline void cuckoo_hash_map_t<Key, T, KeyTraits>::copy_i(const self_type& another) {
+	assert(m_size == 0 && m_bucket_count == another.m_bucket_count);
+
+	for (size_t i = 0; i < m_bucket_count; ++i) {
+		for (size_t k = 0; k < cuckoo_hash_map__::const_slots; ++k) {
+			if (another.m_buckets[i].m_tags[k] != 0) {
+				new (m_buckets[i].slot(k)) value_type(*another.m_buckets[i].slot(k));
+				m_buckets[i].m_tags[k] = another.m_buckets[i].m_tags[k];
+				++m_size;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < another.m_stash.size(); ++i) {
+		this->stash_i(another.m_stash[i]->first, another.m_stash[i]->second);
+	}
+}
+
+} // namespace algo
+
+
+namespace std {
+
+// Override std::swap() to offer better performance.
+template <class Key, class T, class KeyTraits>
+inline void swap(algo::cuckoo_hash_map_t<Key, T, KeyTraits>& v1,
+	algo::cuckoo_hash_map_t<Key, T, KeyTraits>& v2) {
+	v1.swap(v2);
+}
+
+}
@@ -0,0 +1,285 @@
+/**
+ * Hash set.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/hash_table.h"
+#include "algo/key_traits.h"
+#include <assert.h>
+#include <stddef.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <initializer_list>
+#include <vector>
+#include <functional>
+#include <thread>
+
+
+namespace algo {
+
+/**
+ * Hash set, i.e. a hash_table_t whose nodes hold keys only.
+ *
+ * Bucketing, treeification, iterators, node handles, the lookup filter
+ * and allocator behavior are all the same as hash_table_t. Elements
+ * could not be modified through iterators.
+ *
+ * See hash_set_union(), hash_set_intersection() and hash_set_difference()
+ * for bulk set algebra.
+ */
+template <class Key, class KeyTraits = key_traits_t<Key>, class Allocator = std::allocator<Key>>
+class hash_set_t : private hash_table_t<Key, hash_table__::no_value_t, KeyTraits, Allocator> {
+private:
+	typedef hash_set_t<Key, KeyTraits, Allocator> self_type;
+	typedef hash_table_t<Key, hash_table__::no_value_t, KeyTraits, Allocator> base_type;
+
+public:
+	typedef typename base_type::key_type key_type;
+	typedef typename base_type::value_type value_type;
+	typedef typename base_type::key_traits key_traits;
+	typedef typename base_type::allocator_type allocator_type;
+	typedef typename base_type::reference reference;
+	typedef typename base_type::const_reference const_reference;
+	typedef typename base_type::size_type size_type;
+	typedef typename base_type::difference_type difference_type;
+	typedef typename base_type::pointer pointer;
+	typedef typename base_type::const_pointer const_pointer;
+	typedef typename base_type::iterator iterator;
+	typedef typename base_type::const_iterator const_iterator;
+	typedef typename base_type::reverse_iterator reverse_iterator;
+	typedef typename base_type::reverse_const_iterator reverse_const_iterator;
+	typedef typename base_type::node_type node_type;
+	typedef typename base_type::insert_return_type insert_return_type;
+
+	using base_type::const_default_array_size;
+	using base_type::const_treeify_threshold;
+	using base_type::const_treeify_ratio;
+	using base_type::const_untreeify_threshold;
+
+public:
+	hash_set_t() {
+	}
+
+	explicit hash_set_t(size_t array_size) : base_type(array_size) {
+	}
+
+	explicit hash_set_t(const KeyTraits& key_traits,
+		size_t array_size = const_default_array_size,
+		const Allocator& allocator = Allocator())
+		: base_type(key_traits, array_size, allocator) {
+	}
+
+	hash_set_t(std::initializer_list<Key> list,
+		const KeyTraits& key_traits = KeyTraits(),
+		size_t array_size = const_default_array_size,
+		const Allocator& allocator = Allocator())
+		: base_type(key_traits, array_size, allocator) {
+		base_type::insert(list);
+	}
+
+	using base_type::size;
+	using base_type::empty;
+	using base_type::bucket_count;
+	using base_type::key_comp;
+	using base_type::get_allocator;
+	using base_type::clear;
+	using base_type::find;
+	using base_type::count;
+	using base_type::erase;
+	using base_type::extract;
+	using base_type::build;
+	using base_type::enable_filter;
+	using base_type::disable_filter;
+	using base_type::filter_enabled;
+	using base_type::stats;
+	using base_type::hash_quality;
+	using base_type::begin;
+	using base_type::end;
+	using base_type::rbegin;
+	using base_type::rend;
+
+	bool contains(const Key& key) const {
+		return this->count(key) != 0;
+	}
+
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	bool contains(const K& key) const {
+		return this->count(key) != 0;
+	}
+
+	std::pair<iterator, bool> insert(const Key& key) {
+		return base_type::insert(key, hash_table__::no_value_t());
+	}
+
+	void insert(std::initializer_list<Key> list) {
+		base_type::insert(list);
+	}
+
+	insert_return_type insert(node_type&& node) {
+		return base_type::insert(std::move(node));
+	}
+
+	// Move the keys which do not exist in this set from "source".
+	void merge(self_type& source) {
+		base_type::merge(source);
+	}
+
+	void merge(self_type&& source) {
+		base_type::merge(source);
+	}
+
+	self_type& operator=(std::initializer_list<Key> list) {
+		base_type::operator=(list);
+		return *this;
+	}
+
+	self_type& swap(self_type& another) {
+		base_type::swap(another);
+		return *this;
+	}
+};
+
+
+// Internal implementation.
+namespace hash_set__ {
+
+	// Pick keys of "source" which exist (or not) in "probed", i.e. "source"
+	// is walked once and "probed" is probed once per key. With more than one
+	// thread, every thread probes a slice of the keys.
+	template <class Set>
+	std::vector<std::reference_wrapper<const typename Set::key_type>> select(
+		const Set& source, const Set& probed, bool existing, size_t threads) {
+		typedef std::reference_wrapper<const typename Set::key_type> key_ref_t;
+
+		std::vector<key_ref_t> keys;
+		keys.reserve(source.size());
+
+		for (auto it = source.begin(); it != source.end(); ++it) {
+			keys.push_back(std::cref(*it));
+		}
+
+		if (threads == 0) {
+			threads = std::thread::hardware_concurrency();
+		}
+
+		// Not worth starting threads for a small input.
+		if (threads > keys.size() / 1024) {
+			threads = keys.size() / 1024;
+		}
+
+		if (threads == 0) {
+			threads = 1;
+		}
+
+		std::vector<char> selected(keys.size(), 0);
+		const auto slice = (keys.size() + threads - 1) / threads;
+
+		hash_table__::parallel_for(threads, threads, [&](size_t thread) {
+			const auto end = std::min(keys.size(), (thread + 1) * slice);
+
+			for (auto i = thread * slice; i < end; ++i) {
+				selected[i] = (probed.count(keys[i].get()) != 0) == existing ? 1 : 0;
+			}
+		});
+
+		size_t count = 0;
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (selected[i] != 0) {
+				keys[count++] = keys[i];
+			}
+		}
+
+		keys.erase(keys.begin() + count, keys.end());
+		return keys;
+	}
+
+} // namespace hash_set__
+
+
+/**
+ * Keys which exist in "set1" or "set2".
+ *
+ * The bigger set is copied (bucket by bucket, without hashing) and
+ * the smaller one is bulk-inserted by hash_set_t::build(), so it
+ * costs O(n + m). "threads" is passed to build().
+ */
+template <class Key, class KeyTraits, class Allocator>
+inline hash_set_t<Key, KeyTraits, Allocator> hash_set_union(
+	const hash_set_t<Key, KeyTraits, Allocator>& set1,
+	const hash_set_t<Key, KeyTraits, Allocator>& set2, size_t threads = 1) {
+	const auto& bigger = set1.size() >= set2.size() ? set1 : set2;
+	const auto& smaller = set1.size() >= set2.size() ? set2 : set1;
+
+	hash_set_t<Key, KeyTraits, Allocator> result(bigger);
+	result.build(smaller.begin(), smaller.end(), threads);
+
+	return result;
+}
+
+/**
+ * Keys which exist in both "set1" and "set2".
+ *
+ * Every key of the smaller set is probed in the bigger one, by
+ * "threads" threads, and the result is built by hash_set_t::build().
+ */
+template <class Key, class KeyTraits, class Allocator>
+inline hash_set_t<Key, KeyTraits, Allocator> hash_set_intersection(
+	const hash_set_t<Key, KeyTraits, Allocator>& set1,
+	const hash_set_t<Key, KeyTraits, Allocator>& set2, size_t threads = 1) {
+	const auto& bigger = set1.size() >= set2.size() ? set1 : set2;
+	const auto& smaller = set1.size() >= set2.size() ? set2 : set1;
+
+	const auto keys = hash_set__::select(smaller, bigger, true, threads);
+
+	hash_set_t<Key, KeyTraits, Allocator> result(set1.key_comp(), smaller.bucket_count(), set1.get_allocator());
+	result.build(keys.begin(), keys.end(), threads);
+
+	return result;
+}
+
+/**
+ * Keys which exist in "set1" but not in "set2".
+ *
+ * If "set2" is the smaller one, "set1" is copied and keys of "set2" are
+ * erased from the copy. Otherwise, every key of "set1" is probed in
+ * "set2" by "threads" threads, and the result is built by build().
+ */
+template <class Key, class KeyTraits, class Allocator>
+inline hash_set_t<Key, KeyTraits, Allocator> hash_set_difference(
+	const hash_set_t<Key, KeyTraits, Allocator>& set1,
+	const hash_set_t<Key, KeyTraits, Allocator>& set2, size_t threads = 1) {
+	if (set2.size() < set1.size()) {
+		hash_set_t<Key, KeyTraits, Allocator> result(set1);
+
+		for (auto it = set2.begin(); it != set2.end(); ++it) {
+			result.erase(*it);
+		}
+
+		return result;
+	}
+
+	const auto keys = hash_set__::select(set1, set2, false, threads);
+
+	hash_set_t<Key, KeyTraits, Allocator> result(set1.key_comp(), set1.bucket_count(), set1.get_allocator());
+	result.build(keys.begin(), keys.end(), threads);
+
+	return result;
+}
+
+} // namespace algo
+
+
+namespace std {
+
+// Override std::swap() to offer better performance.
+template <class Key, class KeyTraits, class Allocator>
+inline void swap(algo::hash_set_t<Key, KeyTraits, Allocator>& v1,
+	algo::hash_set_t<Key, KeyTraits, Allocator>& v2) {
+	v1.swap(v2);
+}
+
+}
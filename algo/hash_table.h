@@ -7,16 +7,43 @@
 #pragma once
 
 #include "algo/key_traits.h"
+#include "algo/rbtree.h"
+#include "algo/bloom_filter.h"
 #include <string.h>
 #include <assert.h>
+#include <new>
+#include <algorithm>
+#include <exception>
 #include <utility>
+#include <memory>
+#include <type_traits>
 #include <initializer_list>
+#include <iterator>
+#include <vector>
+#include <thread>
 
 
 namespace algo {
 
 // Internal implementation.
 namespace hash_table__ {
+	// Mapped type of hash tables without values, e.g. hash_set_t.
+	struct no_value_t {
+	};
+
+	// Value type, and the type actually stored in a node.
+	template <class Key, class T>
+	struct value_traits_t {
+		typedef std::pair<const Key, T> value_type;
+		typedef value_type stored_type;
+	};
+
+	template <class Key>
+	struct value_traits_t<Key, no_value_t> {
+		typedef Key value_type;
+		typedef const Key stored_type;
+	};
+
 	template <class Key, class T>
 	struct node_t {
 		node_t(const Key& key, const T& value)
@@ -28,13 +55,197 @@ namespace hash_table__ {
 		std::pair<const Key, T> m_value;
 	};
 
+	// Only the key is stored.
+	template <class Key>
+	struct node_t<Key, no_value_t> {
+		node_t(const Key& key, const no_value_t&)
+			: m_prev(0), m_next(0), m_value(key) {
+		}
+
+		node_t* m_prev;
+		node_t* m_next;
+		const Key m_value;
+	};
+
+	template <class Key, class T>
+	inline const Key& node_key(const node_t<Key, T>* ptr) {
+		return ptr->m_value.first;
+	}
+
+	template <class Key>
+	inline const Key& node_key(const node_t<Key, no_value_t>* ptr) {
+		return ptr->m_value;
+	}
+
+	template <class Key, class T>
+	inline const T& node_mapped(const node_t<Key, T>* ptr) {
+		return ptr->m_value.second;
+	}
+
+	template <class Key>
+	inline no_value_t node_mapped(const node_t<Key, no_value_t>* ptr) {
+		return no_value_t();
+	}
+
+	// Key and mapped value of input records, e.g. of insert(std::initializer_list)
+	// and build(). A record is a pair, or just a key if there is no value.
+	template <class Key, class T>
+	struct record_t {
+		template <class Record>
+		static auto key(const Record& record) -> decltype((record.first)) {
+			return record.first;
+		}
+
+		template <class Record>
+		static auto mapped(const Record& record) -> decltype((record.second)) {
+			return record.second;
+		}
+	};
+
+	template <class Key>
+	struct record_t<Key, no_value_t> {
+		static const Key& key(const Key& record) {
+			return record;
+		}
+
+		static no_value_t mapped(const Key& record) {
+			return no_value_t();
+		}
+	};
+
+	// Tree node indexing a node of a long bucket chain.
+	template <class Key, class T>
+	struct tree_node_t {
+		tree_node_t* m_parent;
+		tree_node_t* m_left;
+		tree_node_t* m_right;
+		node_t<Key, T>* m_node;
+		size_t m_hash;
+		bool m_black;
+	};
+
+	// Balanced tree of a treeified bucket, ordered by (hash, KeyTraits::less()).
+	//
+	// The chain itself is kept as is, so iterators are not affected.
+	template <class Key, class T>
+	struct tree_t {
+		tree_node_t<Key, T>* m_root;
+		size_t m_size;
+	};
+
+	// "std::true_type" if "KeyTraits::less()" could compare K1 with K2.
+	template <class KeyTraits, class K1, class K2>
+	struct has_less_t {
+		template <class Traits>
+		static auto test(int) -> decltype(
+			std::declval<const Traits&>().less(std::declval<const K1&>(), std::declval<const K2&>()),
+			std::true_type());
+
+		template <class Traits>
+		static std::false_type test(...);
+
+		typedef decltype(test<KeyTraits>(0)) type;
+	};
+
+	// "std::true_type" if a bucket tree could be searched by K.
+	template <class KeyTraits, class Key, class K>
+	struct tree_tag_t {
+		typedef std::integral_constant<bool,
+			has_less_t<KeyTraits, Key, Key>::type::value
+			&& has_less_t<KeyTraits, K, Key>::type::value
+			&& has_less_t<KeyTraits, Key, K>::type::value> type;
+	};
+
+	// Compare (hash, key) with a tree node.
+	template <class Key, class T, class KeyTraits, class K>
+	inline int tree_compare(const KeyTraits& key_traits, size_t hash, const K& key, const tree_node_t<Key, T>* tree_node_ptr) {
+		if (hash != tree_node_ptr->m_hash) {
+			return hash < tree_node_ptr->m_hash ? -1 : 1;
+		}
+
+		if (key_traits.less(key, node_key(tree_node_ptr->m_node))) {
+			return -1;
+		}
+
+		if (key_traits.less(node_key(tree_node_ptr->m_node), key)) {
+			return 1;
+		}
+
+		return 0;
+	}
+
+	template <class Key, class T, class KeyTraits, class K>
+	inline tree_node_t<Key, T>* tree_find(const KeyTraits& key_traits, const tree_t<Key, T>* tree, size_t hash, const K& key) {
+		auto ptr = tree->m_root;
+
+		while (ptr != 0) {
+			const auto result = tree_compare(key_traits, hash, key, ptr);
+
+			if (result < 0) {
+				ptr = ptr->m_left;
+			}
+			else if (result > 0) {
+				ptr = ptr->m_right;
+			}
+			else {
+				return ptr;
+			}
+		}
+
+		return 0;
+	}
+
+	// Find the parent of a new tree node, the key must not exist in the tree.
 	template <class Key, class T, class KeyTraits>
+	inline void tree_find_parent(const KeyTraits& key_traits, const tree_t<Key, T>* tree,
+		const tree_node_t<Key, T>* tree_node_ptr, tree_node_t<Key, T>** parent, bool* left) {
+		*parent = 0;
+		*left = false;
+
+		for (auto ptr = tree->m_root; ptr != 0;) {
+			*parent = ptr;
+			*left = tree_compare(key_traits, tree_node_ptr->m_hash, node_key(tree_node_ptr->m_node), ptr) < 0;
+			ptr = *left ? ptr->m_left : ptr->m_right;
+		}
+	}
+
+	// Link a new tree node under the parent found by tree_find_parent(), it never throws.
+	template <class Key, class T>
+	inline void tree_link(tree_t<Key, T>* tree, tree_node_t<Key, T>* tree_node_ptr, tree_node_t<Key, T>* parent, bool left) {
+		tree_node_ptr->m_parent = parent;
+		tree_node_ptr->m_left = 0;
+		tree_node_ptr->m_right = 0;
+
+		if (parent == 0) {
+			tree->m_root = tree_node_ptr;
+		}
+		else if (left) {
+			parent->m_left = tree_node_ptr;
+		}
+		else {
+			parent->m_right = tree_node_ptr;
+		}
+
+		rbtree__::rebalance_after_insert(tree->m_root, tree_node_ptr);
+		tree->m_size++;
+	}
+
+	template <class Key, class T, class KeyTraits, class Allocator>
 	struct ctner_t {
-		typedef ctner_t<Key, T, KeyTraits> self_type;
+		typedef ctner_t<Key, T, KeyTraits, Allocator> self_type;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<node_t<Key, T>> node_allocator_type;
+		typedef std::allocator_traits<node_allocator_type> node_allocator_traits;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tree_node_t<Key, T>> tree_node_allocator_type;
+		typedef std::allocator_traits<tree_node_allocator_type> tree_node_allocator_traits;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<tree_t<Key, T>> tree_allocator_type;
+		typedef std::allocator_traits<tree_allocator_type> tree_allocator_traits;
 
 		struct link_t {
 			node_t<Key, T>* m_first;
 			node_t<Key, T>* m_last;
+
+			// Not null if the bucket has been treeified.
+			tree_t<Key, T>* m_tree;
 		};
 
 		// Remove copy constructor and operator=().
@@ -42,7 +253,9 @@ namespace hash_table__ {
 		ctner_t(const self_type&) = delete;
 		self_type& operator=(const self_type&) = delete;
 
-		ctner_t(const KeyTraits& key_traits, size_t array_size) {
+		ctner_t(const KeyTraits& key_traits, size_t array_size, const Allocator& allocator)
+			: m_allocator(allocator), m_tree_node_allocator(allocator), m_tree_allocator(allocator),
+			m_filter(0), m_filter_stale(0) {
 			assert(array_size > 0);
 
 			m_array_size = array_size;
@@ -72,6 +285,7 @@ namespace hash_table__ {
 
 		~ctner_t() {
 			this->destroy();
+			delete m_filter;
 		}
 
 		void destroy() {
@@ -83,28 +297,123 @@ namespace hash_table__ {
 
 		void clear() {
 			for (size_t i = 0; i < m_array_size; ++i) {
+				if (m_array[i].m_tree != 0) {
+					this->delete_tree(m_array[i].m_tree);
+				}
+
 				for (auto current = m_array[i].m_first; current != 0;) {
 					auto deleted = current;
 					current = current->m_next;
-					delete deleted;
+					this->delete_node(deleted);
 				}
 			}
 
 			memset(m_array, 0, sizeof(m_array[0]) * m_array_size);
 			m_size = 0;
+
+			if (m_filter != 0) {
+				m_filter->clear();
+				m_filter_stale = 0;
+			}
+		}
+
+		node_t<Key, T>* new_node(const Key& key, const T& value) {
+			auto ptr = node_allocator_traits::allocate(m_allocator, 1);
+
+			try {
+				node_allocator_traits::construct(m_allocator, ptr, key, value);
+			}
+			catch (...) {
+				node_allocator_traits::deallocate(m_allocator, ptr, 1);
+				throw;
+			}
+
+			return ptr;
+		}
+
+		void delete_node(node_t<Key, T>* ptr) {
+			node_allocator_traits::destroy(m_allocator, ptr);
+			node_allocator_traits::deallocate(m_allocator, ptr, 1);
+		}
+
+		tree_node_t<Key, T>* new_tree_node(node_t<Key, T>* node_ptr, size_t hash) {
+			auto ptr = tree_node_allocator_traits::allocate(m_tree_node_allocator, 1);
+			tree_node_allocator_traits::construct(m_tree_node_allocator, ptr);
+
+			ptr->m_node = node_ptr;
+			ptr->m_hash = hash;
+			return ptr;
+		}
+
+		// Add a node to a tree, the tree is not changed if it throws.
+		void add_tree_node(tree_t<Key, T>* tree, node_t<Key, T>* node_ptr, size_t hash) {
+			const auto tree_node_ptr = this->new_tree_node(node_ptr, hash);
+			tree_node_t<Key, T>* parent = 0;
+			bool left = false;
+
+			try {
+				tree_find_parent(m_key_traits, tree, tree_node_ptr, &parent, &left);
+			}
+			catch (...) {
+				this->delete_tree_node(tree_node_ptr);
+				throw;
+			}
+
+			tree_link(tree, tree_node_ptr, parent, left);
+		}
+
+		void delete_tree_node(tree_node_t<Key, T>* ptr) {
+			tree_node_allocator_traits::destroy(m_tree_node_allocator, ptr);
+			tree_node_allocator_traits::deallocate(m_tree_node_allocator, ptr, 1);
+		}
+
+		tree_t<Key, T>* new_tree() {
+			auto ptr = tree_allocator_traits::allocate(m_tree_allocator, 1);
+			tree_allocator_traits::construct(m_tree_allocator, ptr);
+			return ptr;
+		}
+
+		// Delete the tree only, nodes of the chain are not touched.
+		void delete_tree(tree_t<Key, T>* ptr) {
+			if (ptr->m_root != 0) {
+				this->delete_subtree_i(ptr->m_root);
+			}
+
+			tree_allocator_traits::destroy(m_tree_allocator, ptr);
+			tree_allocator_traits::deallocate(m_tree_allocator, ptr, 1);
 		}
 
 		link_t* m_array;
 		size_t m_array_size;
 		size_t m_size;
 		KeyTraits m_key_traits;
+		node_allocator_type m_allocator;
+		tree_node_allocator_type m_tree_node_allocator;
+		tree_allocator_type m_tree_allocator;
+
+		// Optional filter of lookups, and number of erased keys still in it.
+		bloom_filter_t<Key, KeyTraits>* m_filter;
+		size_t m_filter_stale;
+
+	private:
+		void delete_subtree_i(tree_node_t<Key, T>* ptr) {
+			if (ptr->m_left != 0) {
+				this->delete_subtree_i(ptr->m_left);
+			}
+
+			if (ptr->m_right != 0) {
+				this->delete_subtree_i(ptr->m_right);
+			}
+
+			this->delete_tree_node(ptr);
+		}
 	};
 
 
 	template <class Key, class T, class Pointer, class Reference, class CtnerPointer, class NodePointer>
 	class iterator_t : public std::iterator<
 			std::bidirectional_iterator_tag,
-			std::pair<const Key, T>, std::ptrdiff_t, Pointer, Reference> {
+			typename value_traits_t<Key, T>::value_type, std::ptrdiff_t, Pointer, Reference> {
 	private:
 		typedef iterator_t<Key, T, Pointer, Reference, CtnerPointer, NodePointer> self_type;
 
@@ -208,7 +517,7 @@ namespace hash_table__ {
 			return *this;
 		}
 
-		bool operator==(const self_type& it) {
+		bool operator==(const self_type& it) const {
 			if (this->m_ctner == it.m_ctner
 				&& this->m_current == it.m_current
 				&& this->m_index == it.m_index) {
@@ -218,16 +527,144 @@ namespace hash_table__ {
 			return false;
 		}
 
-		bool operator!=(const self_type& it) {
+		bool operator!=(const self_type& it) const {
 			return !this->operator==(it);
 		}
 
+		CtnerPointer get_ctner_ptr__() const {
+			return this->m_ctner;
+		}
+
+		NodePointer get_node_ptr__() const {
+			return this->m_current;
+		}
+
+		int get_index__() const {
+			return this->m_index;
+		}
+
 	private:
 		CtnerPointer m_ctner;
 		NodePointer m_current;
 		int m_index;
 	};
 
+	// Node handle, it owns a node extracted from a hash table.
+	template <class Key, class T, class NodeAllocator>
+	class node_handle_t {
+	private:
+		typedef node_handle_t<Key, T, NodeAllocator> self_type;
+		typedef std::allocator_traits<NodeAllocator> node_allocator_traits;
+
+	public:
+		typedef Key key_type;
+		typedef T mapped_type;
+
+	public:
+		node_handle_t() : m_node(0) {
+		}
+
+		node_handle_t(node_t<Key, T>* node_ptr, const NodeAllocator& allocator) : m_node(node_ptr) {
+			assert(node_ptr != 0);
+			new (&m_allocator) NodeAllocator(allocator);
+		}
+
+		node_handle_t(self_type&& another) : m_node(0) {
+			*this = std::move(another);
+		}
+
+		~node_handle_t() {
+			this->reset();
+		}
+
+		self_type& operator=(self_type&& another) {
+			if (this != &another) {
+				this->reset();
+
+				if (another.m_node != 0) {
+					new (&m_allocator) NodeAllocator(std::move(*another.allocator_ptr()));
+					m_node = another.m_node;
+
+					another.allocator_ptr()->~NodeAllocator();
+					another.m_node = 0;
+				}
+			}
+
+			return *this;
+		}
+
+		bool empty() const {
+			return m_node == 0;
+		}
+
+		explicit operator bool() const {
+			return m_node != 0;
+		}
+
+		const Key& key() const {
+			assert(m_node != 0);
+			return node_key(m_node);
+		}
+
+		T& mapped() const {
+			assert(m_node != 0);
+			return m_node->m_value.second;
+		}
+
+		// Delete the owned node, if any.
+		void reset() {
+			if (m_node != 0) {
+				node_allocator_traits::destroy(*this->allocator_ptr(), m_node);
+				node_allocator_traits::deallocate(*this->allocator_ptr(), m_node, 1);
+				this->allocator_ptr()->~NodeAllocator();
+				m_node = 0;
+			}
+		}
+
+		const NodeAllocator& get_allocator__() const {
+			assert(m_node != 0);
+			return *this->allocator_ptr();
+		}
+
+		const node_t<Key, T>* get_node_ptr__() const {
+			return m_node;
+		}
+
+		// Give up the ownership of the node.
+		node_t<Key, T>* release__() {
+			assert(m_node != 0);
+
+			auto ptr = m_node;
+			this->allocator_ptr()->~NodeAllocator();
+			m_node = 0;
+
+			return ptr;
+		}
+
+	private:
+		// Remove copy constructor and operator=().
+		node_handle_t(const self_type&) = delete;
+		self_type& operator=(const self_type&) = delete;
+
+		NodeAllocator* allocator_ptr() const {
+			return (NodeAllocator*) &m_allocator;
+		}
+
+	private:
+		node_t<Key, T>* m_node;
+
+		// Constructed only if "m_node" is not null.
+		typename std::aligned_storage<sizeof(NodeAllocator), alignof(NodeAllocator)>::type m_allocator;
+	};
+
+	// Result of inserting a node handle.
+	template <class Iterator, class NodeHandle>
+	struct insert_return_t {
+		Iterator position;
+		bool inserted;
+		NodeHandle node;
+	};
+
 	template <class Key, class T>
 	struct find_t {
 		find_t() : m_node_ptr(0), m_index(0) {
@@ -239,28 +676,174 @@ namespace hash_table__ {
 		node_t<Key, T>* m_node_ptr;
 		size_t m_index;
 	};
+
+	// Sum and maximum of (depth + 1) of all tree nodes, i.e. the number
+	// of comparisons to find every key of a treeified bucket.
+	template <class Key, class T>
+	void tree_probe_lengths(const tree_node_t<Key, T>* ptr, size_t depth, size_t* sum, size_t* max) {
+		for (; ptr != 0; ptr = ptr->m_right, ++depth) {
+			*sum += depth + 1;
+			if (*max < depth + 1) {
+				*max = depth + 1;
+			}
+
+			tree_probe_lengths(ptr->m_left, depth + 1, sum, max);
+		}
+	}
+
+	// Input record of hash_table_t::build(), with its hash value and bucket index.
+	template <class Iterator>
+	struct build_entry_t {
+		size_t m_hash;
+		size_t m_index;
+		Iterator m_it;
+	};
+
+	// Nodes could be allocated by multiple threads at the same time.
+	template <class Allocator>
+	struct is_thread_safe_allocator_t
+		: std::is_same<Allocator, std::allocator<typename Allocator::value_type>> {
+	};
+
+	// Run "functor(task)" for tasks [0, tasks) on "threads" threads, i.e. thread
+	// "i" runs tasks i, i + threads, ... The calling thread is one of them, and
+	// also runs the tasks of threads which could not be started.
+	// The first exception thrown by a task is rethrown after all threads end.
+	template <class Functor>
+	void parallel_for(size_t tasks, size_t threads, Functor functor) {
+		if (threads > tasks) {
+			threads = tasks;
+		}
+
+		std::vector<std::exception_ptr> errors(threads);
+		std::vector<std::thread> workers;
+		workers.reserve(threads);
+
+		auto worker = [tasks, threads, &errors, &functor](size_t thread) {
+			try {
+				for (size_t task = thread; task < tasks; task += threads) {
+					functor(task);
+				}
+			}
+			catch (...) {
+				errors[thread] = std::current_exception();
+			}
+		};
+
+		size_t started = 1;
+
+		try {
+			for (; started < threads; ++started) {
+				workers.push_back(std::thread(worker, started));
+			}
+		}
+		catch (...) {
+		}
+
+		if (threads > 0) {
+			worker(0);
+		}
+
+		for (auto i = started; i < threads; ++i) {
+			worker(i);
+		}
+
+		for (auto it = workers.begin(); it != workers.end(); ++it) {
+			(*it).join();
+		}
+
+		for (auto it = errors.begin(); it != errors.end(); ++it) {
+			if (*it) {
+				std::rethrow_exception(*it);
+			}
+		}
+	}
+
+	// Estimated bytes taken from a general purpose allocator (e.g. glibc
+	// malloc) by a block of "size" bytes: a header word, 16-byte granularity.
+	inline size_t allocated_bytes(size_t size) {
+		const auto bytes = (size + sizeof(size_t) + 15) & ~(size_t) 15;
+		return bytes < 32 ? 32 : bytes;
+	}
 }
 
 
+/**
+ * Shape and memory statistics of a hash_table_t, see hash_table_t::stats().
+ */
+struct hash_table_stats_t {
+	// Buckets are counted by chain length in "m_histogram[length]",
+	// the last one counts all longer chains too.
+	static const size_t const_histogram_size = 16;
+
+	hash_table_stats_t() : m_size(0), m_bucket_count(0), m_load_factor(0),
+		m_empty_buckets(0), m_treeified_buckets(0), m_max_chain_length(0),
+		m_max_probe_length(0), m_mean_probe_length(0), m_chi_squared(0),
+		m_payload_bytes(0), m_total_bytes(0) {
+		for (size_t i = 0; i < const_histogram_size; ++i) {
+			m_histogram[i] = 0;
+		}
+	}
+
+	size_t m_size;
+	size_t m_bucket_count;
+	double m_load_factor;
+	size_t m_empty_buckets;
+	size_t m_treeified_buckets;
+	size_t m_histogram[const_histogram_size];
+	size_t m_max_chain_length;
+
+	// Keys compared to find an existing key: its position in the chain,
+	// or its depth in the tree of a treeified bucket.
+	size_t m_max_probe_length;
+	double m_mean_probe_length;
+
+	// Chi-squared statistic of bucket occupancy against a uniform
+	// distribution, divided by its degrees of freedom. It's about 1
+	// for a good hash function, and far above 1 for a clustering one.
+	double m_chi_squared;
+
+	// Bytes of all objects (table, buckets, nodes, trees & filter), and
+	// the estimate including per-allocation overhead of the allocator.
+	size_t m_payload_bytes;
+	size_t m_total_bytes;
+};
+
+
 // Hash table.
-template <class Key, class T, class KeyTraits = key_traits_t<Key>>
+//
+// Nodes are allocated by "Allocator" (rebound to the internal node type),
+// e.g. algo::pool_allocator_t gives every table its own node arena.
+//
+// enable_filter() puts a Bloom filter in front of lookups, so that most
+// lookups of missing keys return without touching the bucket array.
+//
+// If "KeyTraits::less()" is defined, a bucket chain longer than
+// const_treeify_threshold, and const_treeify_ratio times longer than the
+// average chain, is indexed by a Red-Black tree, so lookup in a bucket full
+// of colliding keys is O(log n) instead of O(n). The tree is dropped once
+// the bucket shrinks to 3/4 of that length. So a table loaded beyond its
+// array size does not treeify every bucket.
+template <class Key, class T, class KeyTraits = key_traits_t<Key>,
+	class Allocator = std::allocator<std::pair<const Key, T>>>
 class hash_table_t {
 private:
-	typedef hash_table_t<Key, T, KeyTraits> self_type;
+	typedef hash_table_t<Key, T, KeyTraits, Allocator> self_type;
 	typedef hash_table__::node_t<Key, T>* node_ptr_t;
 	typedef const hash_table__::node_t<Key, T>* const_node_ptr_t;
-	typedef hash_table__::ctner_t<Key, T, KeyTraits> ctner_type;
+	typedef hash_table__::ctner_t<Key, T, KeyTraits, Allocator> ctner_type;
 
 public:
 	typedef Key key_type;
 	typedef T mapped_type;
-	typedef std::pair<const Key, T> value_type;
+	typedef typename hash_table__::value_traits_t<Key, T>::value_type value_type;
 	typedef KeyTraits key_traits;
-	typedef value_type& reference;
+	typedef Allocator allocator_type;
+	typedef typename hash_table__::value_traits_t<Key, T>::stored_type& reference;
 	typedef const value_type& const_reference;
 	typedef size_t size_type;
 	typedef std::ptrdiff_t difference_type;
-	typedef value_type* pointer;
+	typedef typename hash_table__::value_traits_t<Key, T>::stored_type* pointer;
 	typedef const value_type* const_pointer;
 	typedef hash_table__::iterator_t<Key, T, pointer, reference,
 		ctner_type*, node_ptr_t> iterator;
@@ -268,10 +851,21 @@ public:
 		const ctner_type*, const_node_ptr_t> const_iterator;
 	typedef std::reverse_iterator<iterator> reverse_iterator;
 	typedef std::reverse_iterator<const_iterator> reverse_const_iterator;
+	typedef hash_table__::node_handle_t<Key, T, typename ctner_type::node_allocator_type> node_type;
+	typedef hash_table__::insert_return_t<iterator, node_type> insert_return_type;
 
 	// Default hash table array size.
 	static const size_t const_default_array_size = 256;
 
+	// A bucket is treeified when its chain gets longer than this,
+	// and longer than const_treeify_ratio times the average chain.
+	static const size_t const_treeify_threshold = 8;
+	static const size_t const_treeify_ratio = 4;
+
+	// A treeified bucket goes back to a plain chain at this size (scaled
+	// like const_treeify_threshold when the average chain is long).
+	static const size_t const_untreeify_threshold = 6;
+
 public:
 	hash_table_t() : hash_table_t(KeyTraits(), const_default_array_size) {
 	}
@@ -280,8 +874,10 @@ public:
 		: hash_table_t(KeyTraits(), array_size) {
 	}
 
-	explicit hash_table_t(const KeyTraits& key_traits, size_t array_size = const_default_array_size) {
-		this->m_ctner = new ctner_type(key_traits, array_size);
+	explicit hash_table_t(const KeyTraits& key_traits,
+		size_t array_size = const_default_array_size,
+		const Allocator& allocator = Allocator()) {
+		this->m_ctner = new ctner_type(key_traits, array_size, allocator);
 	}
 
 	hash_table_t(const self_type& another) {
@@ -291,10 +887,16 @@ public:
 		else {
 			this->m_ctner = new ctner_type(
 				another.m_ctner->m_key_traits,
-				another.m_ctner->m_array_size);
+				another.m_ctner->m_array_size,
+				std::allocator_traits<Allocator>::select_on_container_copy_construction(
+					Allocator(another.m_ctner->m_allocator)));
 
-			for (const_iterator it = another.begin(); it != another.end(); ++it) {
-				this->insert(it->first, it->second);
+			try {
+				this->copy_i(another);
+			}
+			catch (...) {
+				delete this->m_ctner;
+				throw;
 			}
 		}
 	}
@@ -306,7 +908,8 @@ public:
 
 	hash_table_t(std::initializer_list<value_type> list,
 		const KeyTraits& key_traits = KeyTraits(),
-		size_t array_size = const_default_array_size) : hash_table_t(key_traits, array_size) {
+		size_t array_size = const_default_array_size,
+		const Allocator& allocator = Allocator()) : hash_table_t(key_traits, array_size, allocator) {
 		this->insert(list);
 	}
 
@@ -323,6 +926,10 @@ public:
 		return this->size() == 0;
 	}
 
+	size_t bucket_count() const {
+		return this->m_ctner == 0 ? 0 : this->m_ctner->m_array_size;
+	}
+
 	key_traits key_comp() const {
 		if (this->m_ctner != 0) {
 			return this->m_ctner->m_key_traits;
@@ -332,17 +939,136 @@ public:
 		}
 	}
 
+	allocator_type get_allocator() const {
+		if (this->m_ctner != 0) {
+			return allocator_type(this->m_ctner->m_allocator);
+		}
+		else {
+			return allocator_type();
+		}
+	}
+
 	void clear();
 
 	iterator find(const Key& key);
 	const_iterator find(const Key& key) const;
+	size_t count(const Key& key) const;
+
+	// Heterogeneous lookup, available if "KeyTraits::is_transparent" is defined.
+	// "KeyTraits::hash(key)" must be equal to the hash value of the matching Key.
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	iterator find(const K& key);
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	const_iterator find(const K& key) const;
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	size_t count(const K& key) const;
 
 	std::pair<iterator, bool> insert(const Key& key, const T& value);
 	void insert(std::initializer_list<value_type> list);
 
+	// Insert an extracted node, no allocation if both tables have equal allocators.
+	// If the key already exists, the node is given back by "insert_return_type::node".
+	insert_return_type insert(node_type&& node);
+
+	iterator erase(iterator it);
 	size_t erase(const Key& key);
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	size_t erase(const K& key);
+
+	// Unlink an element and give its node to the caller.
+	node_type extract(iterator it);
+	node_type extract(const Key& key);
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	node_type extract(const K& key);
+
+	// Move the elements whose keys do not exist in this table from "source".
+	//
+	// Nodes are relinked rather than copied if both tables have equal allocators
+	// (e.g. std::allocator, or pool_allocator_t sharing the same pool).
+	void merge(self_type& source);
+	void merge(self_type&& source);
+
 	mapped_type& operator[](const key_type& key);
 
+	/**
+	 * Insert or update an element with a single lookup.
+	 *
+	 * If the key does not exist, a new element with value "init()" is
+	 * inserted, otherwise "update(T& value)" is called on the existing one.
+	 *
+	 * @return The element, and true if it's newly inserted.
+	 */
+	template <class Init, class Update>
+	std::pair<iterator, bool> upsert(const Key& key, Init init, Update update);
+
+	/**
+	 * Group records in [first, last) by key, i.e. for every record,
+	 * "value_fn(record)" is combined into the element of "key_fn(record)"
+	 * by "combine_fn(T& value, const T& another)".
+	 *
+	 * With more than one thread, every thread aggregates a slice of the
+	 * input into its own partial table, and the partial tables are merged
+	 * at the end. So "combine_fn" must be associative, and the functors
+	 * must be safe to call from multiple threads. The first exception
+	 * thrown by a functor is rethrown after all threads end.
+	 *
+	 * The input is walked more than once, so Iterator must be a forward iterator.
+	 *
+	 * @param threads [in] Number of threads, 0 means std::thread::hardware_concurrency().
+	 */
+	template <class Iterator, class KeyFn, class ValueFn, class CombineFn>
+	void aggregate(Iterator first, Iterator last, KeyFn key_fn,
+		ValueFn value_fn, CombineFn combine_fn, size_t threads = 1);
+
+	/**
+	 * Insert records of [first, last) in bulk, the result is the same as
+	 * calling insert(record.first, record.second) for every record in
+	 * order, i.e. the first record of a key wins, and existing keys are kept.
+	 *
+	 * Records are hashed by all threads, radix-partitioned by bucket index
+	 * (every thread owns a range of buckets, so chains are linked without
+	 * locks), and sorted by bucket within a partition. So nodes are allocated
+	 * in bucket order, and a chain is usually contiguous in memory.
+	 *
+	 * Nodes are allocated by multiple threads only if Allocator is
+	 * std::allocator, otherwise (e.g. pool_allocator_t) they are linked
+	 * by the calling thread after parallel hashing and partitioning.
+	 *
+	 * @param threads [in] Number of threads, 0 means std::thread::hardware_concurrency().
+	 */
+	template <class Iterator>
+	void build(Iterator first, Iterator last, size_t threads = 1);
+
+	/**
+	 * Check lookups against a Bloom filter before walking bucket chains.
+	 *
+	 * The filter is kept in sync by insert() & erase(). Erased keys stay in
+	 * the filter (they only make false positives more likely) until they
+	 * add up to half of its capacity, then the filter is rebuilt. It's also
+	 * rebuilt with double capacity when the table outgrows it.
+	 */
+	void enable_filter(size_t bits_per_key = bloom_filter_t<Key, KeyTraits>::const_default_bits_per_key);
+	void disable_filter();
+
+	bool filter_enabled() const {
+		return this->m_ctner != 0 && this->m_ctner->m_filter != 0;
+	}
+
+	/**
+	 * Collect shape and memory statistics, it walks all buckets and nodes.
+	 */
+	hash_table_stats_t stats() const;
+
+	/**
+	 * Chi-squared statistic of the occupancy of "sample_buckets" buckets
+	 * evenly spread over the array (all buckets if there are fewer),
+	 * normalized like hash_table_stats_t::m_chi_squared.
+	 *
+	 * It's cheap enough to be called on live tables to spot
+	 * a bad "KeyTraits::hash()".
+	 */
+	double hash_quality(size_t sample_buckets = 1024) const;
+
 	iterator begin();
 	iterator end();
 	const_iterator begin() const;
@@ -359,22 +1085,80 @@ public:
 	self_type& swap(self_type& another);
 
 private:
-	hash_table__::find_t<Key, T> find_i(const Key& key) const;
+	typedef typename hash_table__::tree_tag_t<KeyTraits, Key, Key>::type tree_tag_type;
+
+	template <class K>
+	hash_table__::find_t<Key, T> find_i(const K& key) const;
+	size_t erase_i(const hash_table__::find_t<Key, T>& found);
+	void unlink_i(const hash_table__::find_t<Key, T>& found);
+	void link_i(size_t index, size_t hash, node_ptr_t node_ptr, size_t length);
+	void link_new_i(size_t index, size_t hash, node_ptr_t node_ptr, size_t length);
+	void relink_i(self_type& source, const hash_table__::find_t<Key, T>& found, size_t index, size_t hash, size_t length);
+	void link_bucket_i(size_t index, size_t hash, node_ptr_t node_ptr, size_t length);
+	void on_linked_i(size_t hash);
+	void copy_i(const self_type& another);
+
+	template <class CombineFn>
+	void merge_combine_i(self_type& source, CombineFn combine_fn);
+
+	void rebuild_filter_i(size_t capacity);
+
+	template <class K>
+	node_ptr_t find_chain_i(size_t index, const K& key, size_t* length) const;
+	template <class K>
+	node_ptr_t find_bucket_i(size_t index, size_t hash, const K& key, size_t* length, const std::false_type&) const;
+	template <class K>
+	node_ptr_t find_bucket_i(size_t index, size_t hash, const K& key, size_t* length, const std::true_type&) const;
+
+	// Tree changes of linking a node to a bucket. They are prepared before the
+	// chain is touched, so nothing is linked if allocating or comparing throws.
+	struct tree_link_t {
+		// New tree of the bucket if it's treeified now, or 0.
+		hash_table__::tree_t<Key, T>* m_tree;
+
+		// New node of the existing tree, and where it goes, or 0.
+		hash_table__::tree_node_t<Key, T>* m_node;
+		hash_table__::tree_node_t<Key, T>* m_parent;
+		bool m_left;
+	};
+
+	tree_link_t prepare_link_i(size_t index, size_t hash, node_ptr_t node_ptr, size_t length, const std::false_type&) {
+		return tree_link_t();
+	}
+	tree_link_t prepare_link_i(size_t index, size_t hash, node_ptr_t node_ptr, size_t length, const std::true_type&);
+	void commit_link_i(size_t index, const tree_link_t& tree_link);
+	void link_chain_i(size_t index, node_ptr_t node_ptr, const tree_link_t& tree_link);
+
+	hash_table__::tree_t<Key, T>* build_tree_i(size_t index, node_ptr_t node_ptr, size_t hash);
+
+	// Chains longer than this are treeified.
+	size_t treeify_length_i() const {
+		const auto length = m_ctner->m_size / m_ctner->m_array_size * const_treeify_ratio;
+		return length > const_treeify_threshold ? length : const_treeify_threshold;
+	}
+
+	void treeify_i(size_t index, const std::false_type&) {
+	}
+	void treeify_i(size_t index, const std::true_type&);
+
+	void on_erase_i(size_t index, node_ptr_t node_ptr, const std::false_type&) {
+	}
+	void on_erase_i(size_t index, node_ptr_t node_ptr, const std::true_type&);
 
 private:
 	ctner_type* m_ctner;
 };
 
 
-template <class Key, class T, class KeyTraits>
-inline void hash_table_t<Key, T, KeyTraits>::clear() {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::clear() {
 	if (this->m_ctner != 0) {
 		this->m_ctner->clear();
 	}
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::iterator hash_table_t<Key, T, KeyTraits>::find(const Key& key) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator hash_table_t<Key, T, KeyTraits, Allocator>::find(const Key& key) {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -383,9 +1167,9 @@ inline typename hash_table_t<Key, T, KeyTraits>::iterator hash_table_t<Key, T, K
 	return iterator(this->m_ctner, found.m_node_ptr, (int)found.m_index);
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::const_iterator
-hash_table_t<Key, T, KeyTraits>::find(const Key& key) const {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::const_iterator
+hash_table_t<Key, T, KeyTraits, Allocator>::find(const Key& key) const {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -394,55 +1178,259 @@ hash_table_t<Key, T, KeyTraits>::find(const Key& key) const {
 	return const_iterator(this->m_ctner, found.m_node_ptr, (int)found.m_index);
 }
 
-template <class Key, class T, class KeyTraits>
-inline std::pair<typename hash_table_t<Key, T, KeyTraits>::iterator, bool>
-hash_table_t<Key, T, KeyTraits>::insert(const Key& key, const T& value) {
-	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
-	assert(this->m_ctner != 0);
+template <class Key, class T, class KeyTraits, class Allocator>
+inline size_t hash_table_t<Key, T, KeyTraits, Allocator>::count(const Key& key) const {
+	if (this->m_ctner == 0) {
+		return 0;
+	}
 
-	const auto index = this->m_ctner->m_key_traits.hash(key) % m_ctner->m_array_size;
+	return this->find_i(key).m_node_ptr != 0 ? 1 : 0;
+}
 
-	for (auto ptr = m_ctner->m_array[index].m_first; ptr != 0; ptr = ptr->m_next) {
-		if (this->m_ctner->m_key_traits.equal(ptr->m_value.first, key)) {
-			return std::pair<typename hash_table_t<Key, T, KeyTraits>::iterator, bool>(iterator(m_ctner, ptr, (int)index), false);
-		}
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K, class Traits, class>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator
+hash_table_t<Key, T, KeyTraits, Allocator>::find(const K& key) {
+	if (this->m_ctner == 0) {
+		return this->end();
 	}
 
-	auto new_ptr = new hash_table__::node_t<Key, T>(key, value);
+	const auto found(this->find_i(key));
+	return iterator(this->m_ctner, found.m_node_ptr, (int)found.m_index);
+}
 
-	if (m_ctner->m_array[index].m_first == 0) {
-		m_ctner->m_array[index].m_first = new_ptr;
-		m_ctner->m_array[index].m_last = new_ptr;
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K, class Traits, class>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::const_iterator
+hash_table_t<Key, T, KeyTraits, Allocator>::find(const K& key) const {
+	if (this->m_ctner == 0) {
+		return this->end();
 	}
-	else {
-		m_ctner->m_array[index].m_last->m_next = new_ptr;
-		new_ptr->m_prev = m_ctner->m_array[index].m_last;
-		m_ctner->m_array[index].m_last = new_ptr;
+
+	const auto found(this->find_i(key));
+	return const_iterator(this->m_ctner, found.m_node_ptr, (int)found.m_index);
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K, class Traits, class>
+inline size_t hash_table_t<Key, T, KeyTraits, Allocator>::count(const K& key) const {
+	if (this->m_ctner == 0) {
+		return 0;
 	}
 
-	m_ctner->m_size++;
-	return std::pair<typename hash_table_t<Key, T, KeyTraits>::iterator, bool>(iterator(m_ctner, new_ptr, (int)index), true);
+	return this->find_i(key).m_node_ptr != 0 ? 1 : 0;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline std::pair<typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator, bool>
+hash_table_t<Key, T, KeyTraits, Allocator>::insert(const Key& key, const T& value) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	const auto hash = this->m_ctner->m_key_traits.hash(key);
+	const auto index = hash % m_ctner->m_array_size;
+	size_t length = 0;
+
+	const auto ptr = this->find_bucket_i(index, hash, key, &length, tree_tag_type());
+	if (ptr != 0) {
+		return std::pair<typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator, bool>(iterator(m_ctner, ptr, (int)index), false);
+	}
+
+	auto new_ptr = this->m_ctner->new_node(key, value);
+	this->link_new_i(index, hash, new_ptr, length + 1);
+
+	return std::pair<typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator, bool>(iterator(m_ctner, new_ptr, (int)index), true);
 }
 
-template <class Key, class T, class KeyTraits>
-inline void hash_table_t<Key, T, KeyTraits>::insert(
-	std::initializer_list<typename hash_table_t<Key, T, KeyTraits>::value_type> list) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::insert(
+	std::initializer_list<typename hash_table_t<Key, T, KeyTraits, Allocator>::value_type> list) {
 	for (auto it = list.begin(); it != list.end(); ++it) {
-		this->insert((*it).first, (*it).second);
+		this->insert(hash_table__::record_t<Key, T>::key(*it), hash_table__::record_t<Key, T>::mapped(*it));
 	}
 }
 
-template <class Key, class T, class KeyTraits>
-inline size_t hash_table_t<Key, T, KeyTraits>::erase(const Key& key) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::insert_return_type
+hash_table_t<Key, T, KeyTraits, Allocator>::insert(typename hash_table_t<Key, T, KeyTraits, Allocator>::node_type&& node) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	if (node.empty()) {
+		return insert_return_type{ this->end(), false, node_type() };
+	}
+
+	const auto hash = this->m_ctner->m_key_traits.hash(node.key());
+	const auto index = hash % m_ctner->m_array_size;
+	size_t length = 0;
+
+	const auto ptr = this->find_bucket_i(index, hash, node.key(), &length, tree_tag_type());
+	if (ptr != 0) {
+		return insert_return_type{ iterator(m_ctner, ptr, (int)index), false, std::move(node) };
+	}
+
+	node_ptr_t new_ptr = 0;
+
+	if (node.get_allocator__() == this->m_ctner->m_allocator) {
+		new_ptr = node.release__();
+		new_ptr->m_prev = 0;
+		new_ptr->m_next = 0;
+
+		try {
+			this->link_bucket_i(index, hash, new_ptr, length + 1);
+		}
+		catch (...) {
+			// The node is given back, it's not linked.
+			node = node_type(new_ptr, this->m_ctner->m_allocator);
+			throw;
+		}
+
+		this->on_linked_i(hash);
+	}
+	else {
+		new_ptr = this->m_ctner->new_node(node.key(), hash_table__::node_mapped(node.get_node_ptr__()));
+		this->link_new_i(index, hash, new_ptr, length + 1);
+		node.reset();
+	}
+
+	return insert_return_type{ iterator(m_ctner, new_ptr, (int)index), true, node_type() };
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator
+hash_table_t<Key, T, KeyTraits, Allocator>::erase(typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator it) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+	assert(it.get_ctner_ptr__() == this->m_ctner);
+	assert(it != this->end());
+
+	auto next(it);
+	++next;
+
+	this->erase_i(hash_table__::find_t<Key, T>(it.get_node_ptr__(), (size_t)it.get_index__()));
+	return next;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::node_type
+hash_table_t<Key, T, KeyTraits, Allocator>::extract(typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator it) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+	assert(it.get_ctner_ptr__() == this->m_ctner);
+	assert(it != this->end());
+
+	this->unlink_i(hash_table__::find_t<Key, T>(it.get_node_ptr__(), (size_t)it.get_index__()));
+	return node_type(it.get_node_ptr__(), this->m_ctner->m_allocator);
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::node_type
+hash_table_t<Key, T, KeyTraits, Allocator>::extract(const Key& key) {
 	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
 	assert(this->m_ctner != 0);
 
 	const auto found(this->find_i(key));
+	if (found.m_node_ptr == 0) {
+		return node_type();
+	}
 
+	this->unlink_i(found);
+	return node_type(found.m_node_ptr, this->m_ctner->m_allocator);
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K, class Traits, class>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::node_type
+hash_table_t<Key, T, KeyTraits, Allocator>::extract(const K& key) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	const auto found(this->find_i(key));
+	if (found.m_node_ptr == 0) {
+		return node_type();
+	}
+
+	this->unlink_i(found);
+	return node_type(found.m_node_ptr, this->m_ctner->m_allocator);
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::merge(
+	typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& source) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	if (this == &source || source.m_ctner == 0) {
+		return;
+	}
+
+	const bool relink = this->m_ctner->m_allocator == source.m_ctner->m_allocator;
+
+	for (size_t i = 0; i < source.m_ctner->m_array_size; ++i) {
+		for (auto ptr = source.m_ctner->m_array[i].m_first; ptr != 0;) {
+			const auto next = ptr->m_next;
+			const auto hash = this->m_ctner->m_key_traits.hash(hash_table__::node_key(ptr));
+			const auto index = hash % m_ctner->m_array_size;
+			size_t length = 0;
+
+			if (this->find_bucket_i(index, hash, hash_table__::node_key(ptr), &length, tree_tag_type()) == 0) {
+				const hash_table__::find_t<Key, T> found(ptr, i);
+
+				if (relink) {
+					this->relink_i(source, found, index, hash, length + 1);
+				}
+				else {
+					this->link_new_i(index, hash, this->m_ctner->new_node(hash_table__::node_key(ptr), hash_table__::node_mapped(ptr)), length + 1);
+					source.erase_i(found);
+				}
+			}
+
+			ptr = next;
+		}
+	}
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::merge(
+	typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type&& source) {
+	this->merge(source);
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline size_t hash_table_t<Key, T, KeyTraits, Allocator>::erase(const Key& key) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	return this->erase_i(this->find_i(key));
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K, class Traits, class>
+inline size_t hash_table_t<Key, T, KeyTraits, Allocator>::erase(const K& key) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	return this->erase_i(this->find_i(key));
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline size_t hash_table_t<Key, T, KeyTraits, Allocator>::erase_i(const hash_table__::find_t<Key, T>& found) {
 	if (found.m_node_ptr == 0) {
 		return 0;
 	}
 
+	this->unlink_i(found);
+	this->m_ctner->delete_node(found.m_node_ptr);
+
+	return 1;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::unlink_i(const hash_table__::find_t<Key, T>& found) {
+	assert(found.m_node_ptr != 0);
+
+	this->on_erase_i(found.m_index, found.m_node_ptr, tree_tag_type());
+
 	if (found.m_node_ptr->m_prev != 0) {
 		found.m_node_ptr->m_prev->m_next = found.m_node_ptr->m_next;
 	}
@@ -459,14 +1447,322 @@ inline size_t hash_table_t<Key, T, KeyTraits>::erase(const Key& key) {
 		m_ctner->m_array[found.m_index].m_last = found.m_node_ptr->m_prev;
 	}
 
-	delete found.m_node_ptr;
 	this->m_ctner->m_size--;
 
-	return 1;
+	if (this->m_ctner->m_filter != 0
+		&& ++this->m_ctner->m_filter_stale > this->m_ctner->m_filter->capacity() / 2) {
+		this->rebuild_filter_i(this->m_ctner->m_filter->capacity());
+	}
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::link_i(
+	size_t index, size_t hash, node_ptr_t node_ptr, size_t length) {
+	this->link_bucket_i(index, hash, node_ptr, length);
+	this->on_linked_i(hash);
+}
+
+// Count a node just linked, and add its hash to the filter.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::on_linked_i(size_t hash) {
+	m_ctner->m_size++;
+
+	if (this->m_ctner->m_filter != 0) {
+		if (m_ctner->m_size > this->m_ctner->m_filter->capacity()) {
+			this->rebuild_filter_i(m_ctner->m_size * 2);
+		}
+		else {
+			this->m_ctner->m_filter->insert_hash(hash);
+		}
+	}
+}
+
+// Link a node created for it, the node is deleted if linking throws.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::link_new_i(
+	size_t index, size_t hash, node_ptr_t node_ptr, size_t length) {
+	try {
+		this->link_bucket_i(index, hash, node_ptr, length);
+	}
+	catch (...) {
+		this->m_ctner->delete_node(node_ptr);
+		throw;
+	}
+
+	this->on_linked_i(hash);
+}
+
+// Move a node of "source" into bucket "index". Its tree node is prepared
+// first, so the node stays in "source" if that throws.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::relink_i(self_type& source,
+	const hash_table__::find_t<Key, T>& found, size_t index, size_t hash, size_t length) {
+	const auto node_ptr = found.m_node_ptr;
+	const auto tree_link = this->prepare_link_i(index, hash, node_ptr, length, tree_tag_type());
+
+	source.unlink_i(found);
+	node_ptr->m_prev = 0;
+	node_ptr->m_next = 0;
+
+	this->link_chain_i(index, node_ptr, tree_link);
+	this->on_linked_i(hash);
+}
+
+// Append a node to a bucket, without touching the size or the filter.
+// If it throws, the node is not linked.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::link_bucket_i(
+	size_t index, size_t hash, node_ptr_t node_ptr, size_t length) {
+	this->link_chain_i(index, node_ptr, this->prepare_link_i(index, hash, node_ptr, length, tree_tag_type()));
+}
+
+// Append a node to a chain, and commit its prepared tree changes. It never throws.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::link_chain_i(
+	size_t index, node_ptr_t node_ptr, const tree_link_t& tree_link) {
+	auto& link = m_ctner->m_array[index];
+
+	if (link.m_first == 0) {
+		link.m_first = node_ptr;
+		link.m_last = node_ptr;
+	}
+	else {
+		link.m_last->m_next = node_ptr;
+		node_ptr->m_prev = link.m_last;
+		link.m_last = node_ptr;
+	}
+
+	this->commit_link_i(index, tree_link);
+}
+
+// Copy "another" bucket by bucket, "this" must be empty and have the same array size.
+//
+// Chains keep their order and keys are neither hashed nor compared,
+// except that treeified buckets have their trees rebuilt.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::copy_i(
+	const typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& another) {
+	assert(this->m_ctner != 0 && this->m_ctner->m_size == 0);
+	assert(this->m_ctner->m_array_size == another.m_ctner->m_array_size);
+
+	try {
+		for (size_t i = 0; i < another.m_ctner->m_array_size; ++i) {
+			auto& link = this->m_ctner->m_array[i];
+
+			for (auto ptr = another.m_ctner->m_array[i].m_first; ptr != 0; ptr = ptr->m_next) {
+				auto new_ptr = this->m_ctner->new_node(hash_table__::node_key(ptr), hash_table__::node_mapped(ptr));
+
+				if (link.m_first == 0) {
+					link.m_first = new_ptr;
+				}
+				else {
+					link.m_last->m_next = new_ptr;
+					new_ptr->m_prev = link.m_last;
+				}
+
+				link.m_last = new_ptr;
+				this->m_ctner->m_size++;
+			}
+
+			if (another.m_ctner->m_array[i].m_tree != 0) {
+				this->treeify_i(i, tree_tag_type());
+			}
+		}
+	}
+	catch (...) {
+		// The filter of "this" was cleared, it must not miss the nodes copied so far.
+		if (this->m_ctner->m_filter != 0) {
+			try {
+				this->rebuild_filter_i(this->m_ctner->m_size * 2);
+			}
+			catch (...) {
+				delete this->m_ctner->m_filter;
+				this->m_ctner->m_filter = 0;
+			}
+		}
+
+		throw;
+	}
+
+	delete this->m_ctner->m_filter;
+	this->m_ctner->m_filter = 0;
+
+	if (another.m_ctner->m_filter != 0) {
+		this->m_ctner->m_filter = new bloom_filter_t<Key, KeyTraits>(*another.m_ctner->m_filter);
+		this->m_ctner->m_filter_stale = another.m_ctner->m_filter_stale;
+	}
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::iterator hash_table_t<Key, T, KeyTraits>::begin() {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::enable_filter(size_t bits_per_key) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	if (this->m_ctner->m_filter == 0 || this->m_ctner->m_filter->bits_per_key() != bits_per_key) {
+		delete this->m_ctner->m_filter;
+		this->m_ctner->m_filter = 0;
+		this->m_ctner->m_filter = new bloom_filter_t<Key, KeyTraits>(0, bits_per_key, this->m_ctner->m_key_traits);
+		this->rebuild_filter_i(this->m_ctner->m_size * 2);
+	}
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::disable_filter() {
+	if (this->m_ctner != 0) {
+		delete this->m_ctner->m_filter;
+		this->m_ctner->m_filter = 0;
+	}
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline hash_table_stats_t hash_table_t<Key, T, KeyTraits, Allocator>::stats() const {
+	hash_table_stats_t stats;
+
+	stats.m_payload_bytes = sizeof(*this);
+	stats.m_total_bytes = sizeof(*this);
+
+	if (this->m_ctner == 0) {
+		return stats;
+	}
+
+	const auto ctner = this->m_ctner;
+	const double expected = (double) ctner->m_size / ctner->m_array_size;
+	double chi_squared = 0;
+	size_t probes = 0;
+	size_t tree_nodes = 0;
+
+	for (size_t i = 0; i < ctner->m_array_size; ++i) {
+		const auto& link = ctner->m_array[i];
+		size_t length = 0;
+
+		if (link.m_tree != 0) {
+			++stats.m_treeified_buckets;
+			length = link.m_tree->m_size;
+			tree_nodes += length;
+			hash_table__::tree_probe_lengths(link.m_tree->m_root, 0, &probes, &stats.m_max_probe_length);
+		}
+		else {
+			for (auto ptr = link.m_first; ptr != 0; ptr = ptr->m_next) {
+				++length;
+				probes += length;
+			}
+
+			if (stats.m_max_probe_length < length) {
+				stats.m_max_probe_length = length;
+			}
+		}
+
+		if (length == 0) {
+			++stats.m_empty_buckets;
+		}
+
+		if (stats.m_max_chain_length < length) {
+			stats.m_max_chain_length = length;
+		}
+
+		const auto slot = length < hash_table_stats_t::const_histogram_size
+			? length : hash_table_stats_t::const_histogram_size - 1;
+		++stats.m_histogram[slot];
+
+		chi_squared += (length - expected) * (length - expected);
+	}
+
+	stats.m_size = ctner->m_size;
+	stats.m_bucket_count = ctner->m_array_size;
+	stats.m_load_factor = expected;
+
+	if (ctner->m_size > 0) {
+		stats.m_mean_probe_length = (double) probes / ctner->m_size;
+		stats.m_chi_squared = ctner->m_array_size < 2 ? 0
+			: chi_squared / expected / (ctner->m_array_size - 1);
+	}
+
+	const size_t node_bytes = sizeof(hash_table__::node_t<Key, T>);
+	const size_t tree_node_bytes = sizeof(hash_table__::tree_node_t<Key, T>);
+	const size_t tree_bytes = sizeof(hash_table__::tree_t<Key, T>);
+	const size_t array_bytes = sizeof(ctner->m_array[0]) * ctner->m_array_size;
+	const size_t filter_bytes = ctner->m_filter == 0 ? 0 : ctner->m_filter->memory_bytes();
+
+	stats.m_payload_bytes += sizeof(*ctner) + array_bytes
+		+ node_bytes * ctner->m_size
+		+ tree_node_bytes * tree_nodes
+		+ tree_bytes * stats.m_treeified_buckets;
+
+	stats.m_total_bytes += hash_table__::allocated_bytes(sizeof(*ctner))
+		+ hash_table__::allocated_bytes(array_bytes)
+		+ hash_table__::allocated_bytes(node_bytes) * ctner->m_size
+		+ hash_table__::allocated_bytes(tree_node_bytes) * tree_nodes
+		+ hash_table__::allocated_bytes(tree_bytes) * stats.m_treeified_buckets;
+
+	if (ctner->m_filter != 0) {
+		stats.m_payload_bytes += sizeof(*ctner->m_filter) + filter_bytes;
+
+		// The filter over-allocates a block for alignment.
+		stats.m_total_bytes += hash_table__::allocated_bytes(sizeof(*ctner->m_filter))
+			+ hash_table__::allocated_bytes(filter_bytes + bloom_filter__::const_block_bytes);
+	}
+
+	return stats;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline double hash_table_t<Key, T, KeyTraits, Allocator>::hash_quality(size_t sample_buckets) const {
+	if (this->m_ctner == 0 || this->m_ctner->m_size == 0 || this->m_ctner->m_array_size < 2) {
+		return 0;
+	}
+
+	const auto ctner = this->m_ctner;
+	const auto count = sample_buckets == 0 || sample_buckets > ctner->m_array_size
+		? ctner->m_array_size : sample_buckets;
+	const double expected = (double) ctner->m_size / ctner->m_array_size;
+	double chi_squared = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+		const auto& link = ctner->m_array[(size_t) ((double) i * ctner->m_array_size / count)];
+		size_t length = 0;
+
+		if (link.m_tree != 0) {
+			length = link.m_tree->m_size;
+		}
+		else {
+			for (auto ptr = link.m_first; ptr != 0; ptr = ptr->m_next) {
+				++length;
+			}
+		}
+
+		chi_squared += (length - expected) * (length - expected);
+	}
+
+	// The mean is known, so the sample has "count" degrees of freedom,
+	// except when it's the whole array.
+	const auto freedom = count == ctner->m_array_size ? count - 1 : count;
+	return chi_squared / expected / freedom;
+}
+
+// Re-insert all keys to the filter.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::rebuild_filter_i(size_t capacity) {
+	auto filter = this->m_ctner->m_filter;
+	assert(filter != 0);
+
+	// Leave room to grow.
+	if (capacity < 1024) {
+		capacity = 1024;
+	}
+
+	filter->reset(capacity);
+
+	for (size_t i = 0; i < this->m_ctner->m_array_size; ++i) {
+		for (auto ptr = this->m_ctner->m_array[i].m_first; ptr != 0; ptr = ptr->m_next) {
+			filter->insert_hash(this->m_ctner->m_key_traits.hash(hash_table__::node_key(ptr)));
+		}
+	}
+
+	this->m_ctner->m_filter_stale = 0;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator hash_table_t<Key, T, KeyTraits, Allocator>::begin() {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -480,8 +1776,8 @@ inline typename hash_table_t<Key, T, KeyTraits>::iterator hash_table_t<Key, T, K
 	return this->end();
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::iterator hash_table_t<Key, T, KeyTraits>::end() {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator hash_table_t<Key, T, KeyTraits, Allocator>::end() {
 	if (this->m_ctner == 0) {
 		return iterator();
 	}
@@ -490,8 +1786,8 @@ inline typename hash_table_t<Key, T, KeyTraits>::iterator hash_table_t<Key, T, K
 	}
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::const_iterator hash_table_t<Key, T, KeyTraits>::begin() const {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::const_iterator hash_table_t<Key, T, KeyTraits, Allocator>::begin() const {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -505,8 +1801,8 @@ inline typename hash_table_t<Key, T, KeyTraits>::const_iterator hash_table_t<Key
 	return this->end();
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::const_iterator hash_table_t<Key, T, KeyTraits>::end() const {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::const_iterator hash_table_t<Key, T, KeyTraits, Allocator>::end() const {
 	if (this->m_ctner == 0) {
 		return const_iterator();
 	}
@@ -515,29 +1811,29 @@ inline typename hash_table_t<Key, T, KeyTraits>::const_iterator hash_table_t<Key
 	}
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::reverse_iterator hash_table_t<Key, T, KeyTraits>::rbegin() {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::reverse_iterator hash_table_t<Key, T, KeyTraits, Allocator>::rbegin() {
 	return reverse_iterator(this->end());
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::reverse_iterator hash_table_t<Key, T, KeyTraits>::rend() {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::reverse_iterator hash_table_t<Key, T, KeyTraits, Allocator>::rend() {
 	return reverse_iterator(this->begin());
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::reverse_const_iterator hash_table_t<Key, T, KeyTraits>::rbegin() const {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::reverse_const_iterator hash_table_t<Key, T, KeyTraits, Allocator>::rbegin() const {
 	return reverse_const_iterator(this->end());
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::reverse_const_iterator hash_table_t<Key, T, KeyTraits>::rend() const {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::reverse_const_iterator hash_table_t<Key, T, KeyTraits, Allocator>::rend() const {
 	return reverse_const_iterator(this->begin());
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::self_type& hash_table_t<Key, T, KeyTraits>::operator=(
-	const typename hash_table_t<Key, T, KeyTraits>::self_type& another) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& hash_table_t<Key, T, KeyTraits, Allocator>::operator=(
+	const typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& another) {
 
 	if (this == &another) {
 		return *this;
@@ -550,23 +1846,22 @@ inline typename hash_table_t<Key, T, KeyTraits>::self_type& hash_table_t<Key, T,
 	}
 	else {
 		if (this->m_ctner == 0) {
-			this->m_ctner = new ctner_type(another.m_ctner->m_key_traits, another.m_ctner->m_array_size);
+			this->m_ctner = new ctner_type(another.m_ctner->m_key_traits,
+				another.m_ctner->m_array_size, Allocator());
 		}
 		else {
 			this->m_ctner->reset(another.m_ctner->m_key_traits, another.m_ctner->m_array_size);
 		}
 
-		for (const_iterator it = another.begin(); it != another.end(); ++it) {
-			this->insert(it->first, it->second);
-		}
+		this->copy_i(another);
 	}
 
 	return *this;
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::self_type& hash_table_t<Key, T, KeyTraits>::operator=(
-	typename hash_table_t<Key, T, KeyTraits>::self_type&& another) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& hash_table_t<Key, T, KeyTraits, Allocator>::operator=(
+	typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type&& another) {
 
 	if (this == &another) {
 		return *this;
@@ -579,17 +1874,17 @@ inline typename hash_table_t<Key, T, KeyTraits>::self_type& hash_table_t<Key, T,
 	return *this;
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::self_type& hash_table_t<Key, T, KeyTraits>::operator=(
-	std::initializer_list<typename hash_table_t<Key, T, KeyTraits>::value_type> list) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& hash_table_t<Key, T, KeyTraits, Allocator>::operator=(
+	std::initializer_list<typename hash_table_t<Key, T, KeyTraits, Allocator>::value_type> list) {
 	this->clear();
 	this->insert(list);
 	return *this;
 }
 
-template <class Key, class T, class KeyTraits>
-inline typename hash_table_t<Key, T, KeyTraits>::self_type& hash_table_t<Key, T, KeyTraits>::swap(
-	typename hash_table_t<Key, T, KeyTraits>::self_type& another) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& hash_table_t<Key, T, KeyTraits, Allocator>::swap(
+	typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& another) {
 
 	if (this != &another) {
 		auto tmp(this->m_ctner);
@@ -600,8 +1895,8 @@ inline typename hash_table_t<Key, T, KeyTraits>::self_type& hash_table_t<Key, T,
 	return *this;
 }
 
-template <class Key, class T, class KeyTraits>
-inline T& hash_table_t<Key, T, KeyTraits>::operator[](const key_type& key) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline T& hash_table_t<Key, T, KeyTraits, Allocator>::operator[](const key_type& key) {
 	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
 	assert(this->m_ctner != 0);
 
@@ -614,30 +1909,445 @@ inline T& hash_table_t<Key, T, KeyTraits>::operator[](const key_type& key) {
 	return (*it).second;
 }
 
-template <class Key, class T, class KeyTraits>
-inline hash_table__::find_t<Key, T> hash_table_t<Key, T, KeyTraits>::find_i(const Key& key) const {
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class Init, class Update>
+inline std::pair<typename hash_table_t<Key, T, KeyTraits, Allocator>::iterator, bool>
+hash_table_t<Key, T, KeyTraits, Allocator>::upsert(const Key& key, Init init, Update update) {
 	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
 	assert(this->m_ctner != 0);
 
-	const auto index = this->m_ctner->m_key_traits.hash(key) % m_ctner->m_array_size;
+	const auto hash = this->m_ctner->m_key_traits.hash(key);
+	const auto index = hash % m_ctner->m_array_size;
+	size_t length = 0;
 
-	for (auto ptr = m_ctner->m_array[index].m_first; ptr != 0; ptr = ptr->m_next) {
-		if (this->m_ctner->m_key_traits.equal(ptr->m_value.first, key)) {
-			return hash_table__::find_t<Key, T>((node_ptr_t) ptr, index);
+	const auto ptr = this->find_bucket_i(index, hash, key, &length, tree_tag_type());
+	if (ptr != 0) {
+		update(ptr->m_value.second);
+		return std::pair<iterator, bool>(iterator(m_ctner, ptr, (int)index), false);
+	}
+
+	auto new_ptr = this->m_ctner->new_node(key, init());
+	this->link_new_i(index, hash, new_ptr, length + 1);
+
+	return std::pair<iterator, bool>(iterator(m_ctner, new_ptr, (int)index), true);
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class Iterator, class KeyFn, class ValueFn, class CombineFn>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::aggregate(Iterator first, Iterator last,
+	KeyFn key_fn, ValueFn value_fn, CombineFn combine_fn, size_t threads) {
+	static_assert(std::is_base_of<std::forward_iterator_tag,
+		typename std::iterator_traits<Iterator>::iterator_category>::value,
+		"aggregate() needs forward iterators.");
+
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+
+	const auto count = (size_t) std::distance(first, last);
+
+	// Not worth starting threads for a small input.
+	if (threads > count / 1024) {
+		threads = count / 1024;
+	}
+
+	if (threads <= 1) {
+		for (auto it = first; it != last; ++it) {
+			const T value(value_fn(*it));
+
+			this->upsert(key_fn(*it),
+				[&value]() { return value; },
+				[&value, &combine_fn](T& current) { combine_fn(current, value); });
+		}
+
+		return;
+	}
+
+	// Every partial table has its own allocator (e.g. its own node pool),
+	// so that threads never share one.
+	std::vector<self_type> partials;
+	partials.reserve(threads);
+
+	for (size_t i = 0; i < threads; ++i) {
+		partials.push_back(self_type(this->m_ctner->m_key_traits, this->m_ctner->m_array_size,
+			std::allocator_traits<Allocator>::select_on_container_copy_construction(
+				Allocator(this->m_ctner->m_allocator))));
+	}
+
+	// Slice "i" is [slice_begins[i], slice_begins[i + 1]).
+	std::vector<Iterator> slice_begins;
+	slice_begins.reserve(threads + 1);
+	slice_begins.push_back(first);
+
+	for (size_t i = 0; i < threads; ++i) {
+		auto end = slice_begins.back();
+		std::advance(end, count / threads + (i < count % threads ? 1 : 0));
+		slice_begins.push_back(end);
+	}
+
+	hash_table__::parallel_for(threads, threads, [&](size_t slice) {
+		partials[slice].aggregate(slice_begins[slice], slice_begins[slice + 1], key_fn, value_fn, combine_fn, 1);
+	});
+
+	for (auto it = partials.begin(); it != partials.end(); ++it) {
+		this->merge_combine_i(*it, combine_fn);
+	}
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class Iterator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::build(Iterator first, Iterator last, size_t threads) {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	typedef hash_table__::build_entry_t<Iterator> entry_t;
+
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+
+	const auto count = (size_t) std::distance(first, last);
+
+	// Not worth starting threads for a small input.
+	if (threads > count / 1024) {
+		threads = count / 1024;
+	}
+
+	if (threads == 0) {
+		threads = 1;
+	}
+
+	// Partition "p" owns buckets [p * span, (p + 1) * span).
+	const auto array_size = this->m_ctner->m_array_size;
+	const auto span = (array_size + threads - 1) / threads;
+	const auto partitions = (array_size + span - 1) / span;
+
+	std::vector<Iterator> slice_begins;
+	std::vector<size_t> slice_sizes;
+	auto begin = first;
+
+	for (size_t i = 0; i < threads; ++i) {
+		slice_begins.push_back(begin);
+		slice_sizes.push_back(count / threads + (i < count % threads ? 1 : 0));
+		std::advance(begin, slice_sizes.back());
+	}
+
+	// Hash records, and count them by (slice, partition).
+	std::vector<std::vector<entry_t>> slices(threads);
+	std::vector<size_t> offsets(threads * partitions, 0);
+
+	hash_table__::parallel_for(threads, threads, [&](size_t slice) {
+		auto& entries = slices[slice];
+		entries.reserve(slice_sizes[slice]);
+
+		auto it = slice_begins[slice];
+		for (size_t i = 0; i < slice_sizes[slice]; ++i, ++it) {
+			entry_t entry;
+			entry.m_hash = this->m_ctner->m_key_traits.hash(hash_table__::record_t<Key, T>::key(*it));
+			entry.m_index = entry.m_hash % array_size;
+			entry.m_it = it;
+
+			entries.push_back(entry);
+			++offsets[slice * partitions + entry.m_index / span];
+		}
+	});
+
+	// Offsets of (slice, partition) in the partitioned array. A partition holds
+	// records of slice 0 first, then slice 1, etc, so the input order is kept.
+	std::vector<size_t> partition_begins(partitions + 1, 0);
+	size_t total = 0;
+
+	for (size_t p = 0; p < partitions; ++p) {
+		partition_begins[p] = total;
+
+		for (size_t slice = 0; slice < threads; ++slice) {
+			const auto size = offsets[slice * partitions + p];
+			offsets[slice * partitions + p] = total;
+			total += size;
+		}
+	}
+
+	partition_begins[partitions] = total;
+
+	std::vector<entry_t> partitioned(count);
+
+	hash_table__::parallel_for(threads, threads, [&](size_t slice) {
+		const auto& entries = slices[slice];
+
+		for (auto it = entries.begin(); it != entries.end(); ++it) {
+			partitioned[offsets[slice * partitions + (*it).m_index / span]++] = *it;
+		}
+
+		std::vector<entry_t>().swap(slices[slice]);
+	});
+
+	// Link chains, every partition touches its own buckets only.
+	std::vector<size_t> inserted(partitions, 0);
+
+	const auto link = [&](size_t p) {
+		const auto first_index = p * span;
+		const auto buckets = std::min(span, array_size - first_index);
+
+		// Stable counting sort by bucket index.
+		std::vector<size_t> bucket_offsets(buckets + 1, 0);
+		for (auto i = partition_begins[p]; i < partition_begins[p + 1]; ++i) {
+			++bucket_offsets[partitioned[i].m_index - first_index + 1];
 		}
+
+		for (size_t i = 1; i <= buckets; ++i) {
+			bucket_offsets[i] += bucket_offsets[i - 1];
+		}
+
+		std::vector<entry_t> entries(partition_begins[p + 1] - partition_begins[p]);
+		for (auto i = partition_begins[p]; i < partition_begins[p + 1]; ++i) {
+			entries[bucket_offsets[partitioned[i].m_index - first_index]++] = partitioned[i];
+		}
+
+		for (auto it = entries.begin(); it != entries.end(); ++it) {
+			const auto& key = hash_table__::record_t<Key, T>::key(*(*it).m_it);
+			size_t length = 0;
+
+			if (this->find_bucket_i((*it).m_index, (*it).m_hash, key, &length, tree_tag_type()) == 0) {
+				const auto node_ptr = this->m_ctner->new_node(key, hash_table__::record_t<Key, T>::mapped(*(*it).m_it));
+
+				try {
+					this->link_bucket_i((*it).m_index, (*it).m_hash, node_ptr, length + 1);
+				}
+				catch (...) {
+					this->m_ctner->delete_node(node_ptr);
+					throw;
+				}
+
+				++inserted[p];
+			}
+		}
+	};
+
+	// Also called if a node could not be created, to keep linked ones consistent.
+	const auto finish = [&]() {
+		for (auto it = inserted.begin(); it != inserted.end(); ++it) {
+			this->m_ctner->m_size += *it;
+		}
+
+		if (this->m_ctner->m_filter != 0) {
+			this->rebuild_filter_i(this->m_ctner->m_size * 2);
+		}
+	};
+
+	try {
+		hash_table__::parallel_for(partitions,
+			hash_table__::is_thread_safe_allocator_t<Allocator>::value ? threads : 1, link);
+	}
+	catch (...) {
+		finish();
+		throw;
+	}
+
+	finish();
+}
+
+// Move all elements of "source" into this table, values of existing keys are combined.
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class CombineFn>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::merge_combine_i(
+	typename hash_table_t<Key, T, KeyTraits, Allocator>::self_type& source, CombineFn combine_fn) {
+	const bool relink = this->m_ctner->m_allocator == source.m_ctner->m_allocator;
+
+	for (size_t i = 0; i < source.m_ctner->m_array_size; ++i) {
+		for (auto ptr = source.m_ctner->m_array[i].m_first; ptr != 0;) {
+			const auto next = ptr->m_next;
+			const auto hash = this->m_ctner->m_key_traits.hash(hash_table__::node_key(ptr));
+			const auto index = hash % m_ctner->m_array_size;
+			size_t length = 0;
+
+			const auto found = this->find_bucket_i(index, hash, hash_table__::node_key(ptr), &length, tree_tag_type());
+			if (found != 0) {
+				combine_fn(found->m_value.second, (const T&) ptr->m_value.second);
+			}
+			else if (relink) {
+				this->relink_i(source, hash_table__::find_t<Key, T>(ptr, i), index, hash, length + 1);
+			}
+			else {
+				this->link_new_i(index, hash, this->m_ctner->new_node(hash_table__::node_key(ptr), hash_table__::node_mapped(ptr)), length + 1);
+			}
+
+			ptr = next;
+		}
+	}
+
+	source.clear();
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K>
+inline hash_table__::find_t<Key, T> hash_table_t<Key, T, KeyTraits, Allocator>::find_i(const K& key) const {
+	// Once a rvalue hash table has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	const auto hash = this->m_ctner->m_key_traits.hash(key);
+
+	if (this->m_ctner->m_filter != 0 && !this->m_ctner->m_filter->contains_hash(hash)) {
+		return hash_table__::find_t<Key, T>(0, m_ctner->m_array_size);
+	}
+
+	const auto index = hash % m_ctner->m_array_size;
+	size_t length = 0;
+
+	const auto ptr = this->find_bucket_i(index, hash, key, &length,
+		typename hash_table__::tree_tag_t<KeyTraits, Key, K>::type());
+
+	if (ptr != 0) {
+		return hash_table__::find_t<Key, T>(ptr, index);
 	}
 
 	return hash_table__::find_t<Key, T>(0, m_ctner->m_array_size);
 }
 
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::node_ptr_t
+hash_table_t<Key, T, KeyTraits, Allocator>::find_chain_i(size_t index, const K& key, size_t* length) const {
+	for (auto ptr = m_ctner->m_array[index].m_first; ptr != 0; ptr = ptr->m_next) {
+		if (this->m_ctner->m_key_traits.equal(hash_table__::node_key(ptr), key)) {
+			return ptr;
+		}
+
+		++*length;
+	}
+
+	return 0;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::node_ptr_t
+hash_table_t<Key, T, KeyTraits, Allocator>::find_bucket_i(
+	size_t index, size_t hash, const K& key, size_t* length, const std::false_type&) const {
+	return this->find_chain_i(index, key, length);
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+template <class K>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::node_ptr_t
+hash_table_t<Key, T, KeyTraits, Allocator>::find_bucket_i(
+	size_t index, size_t hash, const K& key, size_t* length, const std::true_type&) const {
+	const auto tree = m_ctner->m_array[index].m_tree;
+
+	if (tree == 0) {
+		return this->find_chain_i(index, key, length);
+	}
+
+	*length = tree->m_size;
+
+	const auto tree_node_ptr = hash_table__::tree_find(this->m_ctner->m_key_traits, tree, hash, key);
+	return tree_node_ptr == 0 ? 0 : tree_node_ptr->m_node;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline typename hash_table_t<Key, T, KeyTraits, Allocator>::tree_link_t
+hash_table_t<Key, T, KeyTraits, Allocator>::prepare_link_i(
+	size_t index, size_t hash, node_ptr_t node_ptr, size_t length, const std::true_type&) {
+	const auto& link = m_ctner->m_array[index];
+	tree_link_t tree_link = tree_link_t();
+
+	if (link.m_tree != 0) {
+		tree_link.m_node = this->m_ctner->new_tree_node(node_ptr, hash);
+
+		try {
+			hash_table__::tree_find_parent(this->m_ctner->m_key_traits, link.m_tree,
+				tree_link.m_node, &tree_link.m_parent, &tree_link.m_left);
+		}
+		catch (...) {
+			this->m_ctner->delete_tree_node(tree_link.m_node);
+			throw;
+		}
+	}
+	else if (length > this->treeify_length_i()) {
+		tree_link.m_tree = this->build_tree_i(index, node_ptr, hash);
+	}
+
+	return tree_link;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::commit_link_i(size_t index, const tree_link_t& tree_link) {
+	auto& link = m_ctner->m_array[index];
+
+	if (tree_link.m_tree != 0) {
+		assert(link.m_tree == 0);
+		link.m_tree = tree_link.m_tree;
+	}
+	else if (tree_link.m_node != 0) {
+		hash_table__::tree_link(link.m_tree, tree_link.m_node, tree_link.m_parent, tree_link.m_left);
+	}
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::treeify_i(size_t index, const std::true_type&) {
+	assert(m_ctner->m_array[index].m_tree == 0);
+	m_ctner->m_array[index].m_tree = this->build_tree_i(index, 0, 0);
+}
+
+// Tree of a bucket's chain, and of "node_ptr" (not linked yet) unless it's 0.
+template <class Key, class T, class KeyTraits, class Allocator>
+inline hash_table__::tree_t<Key, T>* hash_table_t<Key, T, KeyTraits, Allocator>::build_tree_i(
+	size_t index, node_ptr_t node_ptr, size_t hash) {
+	const auto tree = this->m_ctner->new_tree();
+
+	try {
+		for (auto ptr = m_ctner->m_array[index].m_first; ptr != 0; ptr = ptr->m_next) {
+			this->m_ctner->add_tree_node(tree, ptr, this->m_ctner->m_key_traits.hash(hash_table__::node_key(ptr)));
+		}
+
+		if (node_ptr != 0) {
+			this->m_ctner->add_tree_node(tree, node_ptr, hash);
+		}
+	}
+	catch (...) {
+		this->m_ctner->delete_tree(tree);
+		throw;
+	}
+
+	return tree;
+}
+
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void hash_table_t<Key, T, KeyTraits, Allocator>::on_erase_i(
+	size_t index, node_ptr_t node_ptr, const std::true_type&) {
+	auto& link = m_ctner->m_array[index];
+
+	if (link.m_tree == 0) {
+		return;
+	}
+
+	if (link.m_tree->m_size - 1 <= this->treeify_length_i() * const_untreeify_threshold / const_treeify_threshold) {
+		this->m_ctner->delete_tree(link.m_tree);
+		link.m_tree = 0;
+		return;
+	}
+
+	const auto hash = this->m_ctner->m_key_traits.hash(hash_table__::node_key(node_ptr));
+	const auto tree_node_ptr = hash_table__::tree_find(this->m_ctner->m_key_traits,
+		link.m_tree, hash, hash_table__::node_key(node_ptr));
+	assert(tree_node_ptr != 0 && tree_node_ptr->m_node == node_ptr);
+
+	rbtree__::erase_and_rebalance(link.m_tree->m_root, tree_node_ptr);
+	this->m_ctner->delete_tree_node(tree_node_ptr);
+	link.m_tree->m_size--;
+}
+
 } // namespace algo
 
 
 namespace std {
 
 // Override std::swap() to offer better performance.
-template <class Key, class T, class KeyTraits>
-inline void swap(algo::hash_table_t<Key, T, KeyTraits>& v1, algo::hash_table_t<Key, T, KeyTraits>& v2) {
+template <class Key, class T, class KeyTraits, class Allocator>
+inline void swap(algo::hash_table_t<Key, T, KeyTraits, Allocator>& v1,
+	algo::hash_table_t<Key, T, KeyTraits, Allocator>& v2) {
 	v1.swap(v2);
 }
 
@@ -0,0 +1,634 @@
+/**
+ * Compact hash set & map of integer keys.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ALGO_INT_HASH_TABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace algo {
+
+// Internal implementation.
+namespace int_hash_table__ {
+
+	// A block is one cache line of keys, it's the unit of probing.
+	const size_t const_block_bytes = 64;
+
+	inline unsigned int lowest_bit(uint64_t mask) {
+		assert(mask != 0);
+
+	#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return (unsigned int) index;
+	#else
+		return (unsigned int) __builtin_ctzll(mask);
+	#endif
+	}
+
+	// Compare all keys of a block with "key", return a bit mask of matched slots.
+	template <class Key, size_t Size = sizeof(Key)>
+	struct block_t {
+		static const size_t const_slots = const_block_bytes / sizeof(Key);
+
+		static uint64_t match(const Key* block, Key key) {
+			uint64_t mask = 0;
+
+			for (size_t i = 0; i < const_slots; ++i) {
+				if (block[i] == key) {
+					mask |= (uint64_t) 1 << i;
+				}
+			}
+
+			return mask;
+		}
+	};
+
+#ifdef ALGO_INT_HASH_TABLE_SSE2
+	template <class Key>
+	struct block_t<Key, 4> {
+		static const size_t const_slots = const_block_bytes / 4;
+
+		static uint64_t match(const Key* block, Key key) {
+			const auto value = _mm_set1_epi32((int) key);
+			uint64_t mask = 0;
+
+			for (size_t i = 0; i < const_block_bytes / 16; ++i) {
+				const auto keys = _mm_load_si128((const __m128i*) block + i);
+				const auto result = _mm_castsi128_ps(_mm_cmpeq_epi32(keys, value));
+				mask |= (uint64_t) _mm_movemask_ps(result) << (i * 4);
+			}
+
+			return mask;
+		}
+	};
+
+	template <class Key>
+	struct block_t<Key, 8> {
+		static const size_t const_slots = const_block_bytes / 8;
+
+		static uint64_t match(const Key* block, Key key) {
+			const auto value = _mm_set1_epi64x((long long) key);
+			uint64_t mask = 0;
+
+			for (size_t i = 0; i < const_block_bytes / 16; ++i) {
+				const auto keys = _mm_load_si128((const __m128i*) block + i);
+
+				// SSE2 has no 64-bit compare, both 32-bit halves must be equal.
+				auto result = _mm_cmpeq_epi32(keys, value);
+				result = _mm_and_si128(result, _mm_shuffle_epi32(result, _MM_SHUFFLE(2, 3, 0, 1)));
+				mask |= (uint64_t) _mm_movemask_pd(_mm_castsi128_pd(result)) << (i * 2);
+			}
+
+			return mask;
+		}
+	};
+#endif
+
+	// Value array, nothing is stored for sets.
+	template <class T>
+	struct values_t {
+		values_t() : m_data(0) {
+		}
+
+		void allocate(size_t count) {
+			m_data = new T[count];
+		}
+
+		void free() {
+			delete[] m_data;
+			m_data = 0;
+		}
+
+		void move(size_t to, size_t from) {
+			m_data[to] = std::move(m_data[from]);
+		}
+
+		void move(size_t to, values_t<T>& another, size_t from) {
+			m_data[to] = std::move(another.m_data[from]);
+		}
+
+		void copy(const values_t<T>& another, size_t count) {
+			std::copy(another.m_data, another.m_data + count, m_data);
+		}
+
+		T* m_data;
+	};
+
+	template <>
+	struct values_t<void> {
+		void allocate(size_t count) {
+		}
+
+		void free() {
+		}
+
+		void move(size_t to, size_t from) {
+		}
+
+		void move(size_t to, values_t<void>& another, size_t from) {
+		}
+
+		void copy(const values_t<void>& another, size_t count) {
+		}
+	};
+
+	/**
+	 * Open addressing table, keys and values are in separate arrays.
+	 *
+	 * A key is put in the first block (starting from its home block)
+	 * which has a free slot, so a lookup stops at the first block with
+	 * a free slot. Free slots hold "EmptyKey", there is no per-slot
+	 * metadata, and erase() shifts keys backward instead of leaving
+	 * tombstones.
+	 */
+	template <class Key, class T, Key EmptyKey>
+	class table_t {
+	private:
+		typedef table_t<Key, T, EmptyKey> self_type;
+		typedef typename std::make_unsigned<Key>::type unsigned_key_type;
+
+	public:
+		static const size_t const_block_slots = block_t<Key>::const_slots;
+		static const size_t npos = (size_t) -1;
+
+	public:
+		explicit table_t(size_t capacity) : m_size(0) {
+			this->allocate_i(block_count_i(capacity));
+		}
+
+		table_t(const self_type& another) : m_size(0) {
+			this->allocate_i(another.m_block_count);
+			this->copy_i(another);
+		}
+
+		~table_t() {
+			this->free_i();
+		}
+
+		self_type& operator=(const self_type& another) {
+			if (this != &another) {
+				if (m_block_count != another.m_block_count) {
+					this->free_i();
+					this->allocate_i(another.m_block_count);
+				}
+
+				this->copy_i(another);
+			}
+
+			return *this;
+		}
+
+		size_t size() const {
+			return m_size;
+		}
+
+		// Number of slots.
+		size_t capacity() const {
+			return m_block_count * const_block_slots;
+		}
+
+		size_t memory_bytes() const {
+			return this->capacity() * (sizeof(Key) + value_size_i());
+		}
+
+		size_t find(Key key) const {
+			if (key == EmptyKey) {
+				return npos;
+			}
+
+			for (auto block = this->home_i(key);; block = (block + 1) & m_block_mask) {
+				const auto keys = m_keys + block * const_block_slots;
+
+				const auto matched = block_t<Key>::match(keys, key);
+				if (matched != 0) {
+					return block * const_block_slots + lowest_bit(matched);
+				}
+
+				if (block_t<Key>::match(keys, EmptyKey) != 0) {
+					return npos;
+				}
+			}
+		}
+
+		// Return the slot of the key, and whether it's newly inserted.
+		std::pair<size_t, bool> insert(Key key) {
+			assert(key != EmptyKey);
+
+			if ((m_size + 1) * 8 > this->capacity() * 7) {
+				this->rehash_i(m_block_count * 2);
+			}
+
+			for (auto block = this->home_i(key);; block = (block + 1) & m_block_mask) {
+				const auto keys = m_keys + block * const_block_slots;
+
+				const auto matched = block_t<Key>::match(keys, key);
+				if (matched != 0) {
+					return std::make_pair(block * const_block_slots + lowest_bit(matched), false);
+				}
+
+				const auto empty = block_t<Key>::match(keys, EmptyKey);
+				if (empty != 0) {
+					const auto slot = block * const_block_slots + lowest_bit(empty);
+
+					m_keys[slot] = key;
+					++m_size;
+
+					return std::make_pair(slot, true);
+				}
+			}
+		}
+
+		bool erase(Key key) {
+			const auto slot = this->find(key);
+			if (slot == npos) {
+				return false;
+			}
+
+			m_keys[slot] = EmptyKey;
+			--m_size;
+
+			// Move keys, which have passed the hole's block, back into the hole.
+			auto hole = slot;
+			const auto first_block = slot / const_block_slots;
+
+			for (auto block = (first_block + 1) & m_block_mask; block != first_block; block = (block + 1) & m_block_mask) {
+				const auto keys = m_keys + block * const_block_slots;
+				const auto hole_distance = (block - hole / const_block_slots) & m_block_mask;
+				const bool had_empty = block_t<Key>::match(keys, EmptyKey) != 0;
+
+				for (size_t i = 0; i < const_block_slots; ++i) {
+					if (keys[i] == EmptyKey
+						|| ((block - this->home_i(keys[i])) & m_block_mask) < hole_distance) {
+						continue;
+					}
+
+					const auto moved = block * const_block_slots + i;
+
+					m_keys[hole] = keys[i];
+					m_values.move(hole, moved);
+					m_keys[moved] = EmptyKey;
+					hole = moved;
+					break;
+				}
+
+				// No key after this block has passed it.
+				if (had_empty) {
+					break;
+				}
+			}
+
+			return true;
+		}
+
+		void clear() {
+			std::fill(m_keys, m_keys + this->capacity(), EmptyKey);
+			m_size = 0;
+		}
+
+		void reserve(size_t count) {
+			const auto block_count = block_count_i(count);
+
+			if (block_count > m_block_count) {
+				this->rehash_i(block_count);
+			}
+		}
+
+		Key key_at(size_t slot) const {
+			return m_keys[slot];
+		}
+
+		values_t<T>& values() {
+			return m_values;
+		}
+
+		const values_t<T>& values() const {
+			return m_values;
+		}
+
+		// Call functor(slot) for every element.
+		template <class Functor>
+		void for_each_slot(Functor functor) const {
+			const auto capacity = this->capacity();
+
+			for (size_t i = 0; i < capacity; ++i) {
+				if (m_keys[i] != EmptyKey) {
+					functor(i);
+				}
+			}
+		}
+
+	private:
+		static size_t value_size_i() {
+			return std::is_void<T>::value ? 0 : sizeof(typename std::conditional<std::is_void<T>::value, char, T>::type);
+		}
+
+		// Power of 2 (at least 2) blocks, enough for "capacity" elements under the max load factor.
+		static size_t block_count_i(size_t capacity) {
+			size_t block_count = 2;
+
+			while (block_count * const_block_slots * 7 < capacity * 8) {
+				block_count *= 2;
+			}
+
+			return block_count;
+		}
+
+		size_t home_i(Key key) const {
+			return (size_t) (((uint64_t) (unsigned_key_type) key * 0x9E3779B97F4A7C15ULL) >> m_shift);
+		}
+
+		void allocate_i(size_t block_count) {
+			// Blocks are aligned to cache lines.
+			const auto buffer = (char*) ::operator new(block_count * const_block_bytes + const_block_bytes);
+			const auto keys = (Key*) (((uintptr_t) buffer + const_block_bytes - 1) & ~(uintptr_t) (const_block_bytes - 1));
+
+			try {
+				m_values.allocate(block_count * const_block_slots);
+			}
+			catch (...) {
+				::operator delete(buffer);
+				throw;
+			}
+
+			m_buffer = buffer;
+			m_keys = keys;
+			m_block_count = block_count;
+			m_block_mask = block_count - 1;
+			m_size = 0;
+
+			m_shift = 64;
+			for (auto count = block_count; count > 1; count /= 2) {
+				--m_shift;
+			}
+
+			std::fill(m_keys, m_keys + this->capacity(), EmptyKey);
+		}
+
+		void free_i() {
+			m_values.free();
+			::operator delete(m_buffer);
+			m_buffer = 0;
+			m_keys = 0;
+		}
+
+		void copy_i(const self_type& another) {
+			assert(m_block_count == another.m_block_count);
+
+			memcpy(m_keys, another.m_keys, this->capacity() * sizeof(Key));
+			m_values.copy(another.m_values, this->capacity());
+			m_size = another.m_size;
+		}
+
+		void rehash_i(size_t block_count) {
+			const auto old_buffer = m_buffer;
+			const auto old_keys = m_keys;
+			const auto old_capacity = this->capacity();
+			const auto old_size = m_size;
+			auto old_values = m_values;
+
+			try {
+				this->allocate_i(block_count);
+			}
+			catch (...) {
+				m_values = old_values;
+				throw;
+			}
+
+			for (size_t i = 0; i < old_capacity; ++i) {
+				if (old_keys[i] != EmptyKey) {
+					const auto slot = this->insert(old_keys[i]).first;
+					m_values.move(slot, old_values, i);
+				}
+			}
+
+			assert(m_size == old_size);
+			(void) old_size;
+
+			old_values.free();
+			::operator delete(old_buffer);
+		}
+
+	private:
+		char* m_buffer;
+		Key* m_keys;
+		values_t<T> m_values;
+		size_t m_block_count;
+		size_t m_block_mask;
+		unsigned int m_shift;
+		size_t m_size;
+	};
+
+} // namespace int_hash_table__
+
+
+/**
+ * Hash set of integer keys.
+ *
+ * Keys are stored in a flat array of cache-line sized blocks which are
+ * probed with SSE2, so memory per element is close to sizeof(Key) and
+ * a lookup usually touches a single cache line.
+ *
+ * "EmptyKey" marks free slots, so it could not be inserted.
+ */
+template <class Key, Key EmptyKey = (Key) -1>
+class int_hash_set_t {
+private:
+	static_assert(std::is_integral<Key>::value && sizeof(Key) <= 8, "Key must be an integer");
+	typedef int_hash_table__::table_t<Key, void, EmptyKey> table_type;
+
+public:
+	typedef Key key_type;
+	typedef Key value_type;
+
+public:
+	explicit int_hash_set_t(size_t capacity = 0) : m_table(capacity) {
+	}
+
+	size_t size() const {
+		return m_table.size();
+	}
+
+	bool empty() const {
+		return m_table.size() == 0;
+	}
+
+	// Number of slots.
+	size_t capacity() const {
+		return m_table.capacity();
+	}
+
+	size_t memory_bytes() const {
+		return m_table.memory_bytes();
+	}
+
+	// Return true if the key is newly inserted.
+	bool insert(Key key) {
+		return m_table.insert(key).second;
+	}
+
+	bool contains(Key key) const {
+		return m_table.find(key) != table_type::npos;
+	}
+
+	size_t count(Key key) const {
+		return this->contains(key) ? 1 : 0;
+	}
+
+	bool erase(Key key) {
+		return m_table.erase(key);
+	}
+
+	void clear() {
+		m_table.clear();
+	}
+
+	void reserve(size_t count) {
+		m_table.reserve(count);
+	}
+
+	template <class Functor>
+	void for_each(Functor functor) const {
+		const auto& table = m_table;
+
+		m_table.for_each_slot([&](size_t slot) {
+			functor(table.key_at(slot));
+		});
+	}
+
+private:
+	table_type m_table;
+};
+
+
+/**
+ * Hash map of integer keys, see int_hash_set_t.
+ *
+ * Values are kept in an array parallel to the keys, so "T" should be
+ * small and cheap to default-construct.
+ */
+template <class Key, class T, Key EmptyKey = (Key) -1>
+class int_hash_map_t {
+private:
+	static_assert(std::is_integral<Key>::value && sizeof(Key) <= 8, "Key must be an integer");
+	typedef int_hash_table__::table_t<Key, T, EmptyKey> table_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+
+public:
+	explicit int_hash_map_t(size_t capacity = 0) : m_table(capacity) {
+	}
+
+	size_t size() const {
+		return m_table.size();
+	}
+
+	bool empty() const {
+		return m_table.size() == 0;
+	}
+
+	// Number of slots.
+	size_t capacity() const {
+		return m_table.capacity();
+	}
+
+	size_t memory_bytes() const {
+		return m_table.memory_bytes();
+	}
+
+	// Return true if the key is newly inserted, an existing value is not changed.
+	bool insert(Key key, const T& value) {
+		const auto result = m_table.insert(key);
+
+		if (result.second) {
+			m_table.values().m_data[result.first] = value;
+		}
+
+		return result.second;
+	}
+
+	T& operator[](Key key) {
+		const auto result = m_table.insert(key);
+
+		if (result.second) {
+			m_table.values().m_data[result.first] = T();
+		}
+
+		return m_table.values().m_data[result.first];
+	}
+
+	T* find(Key key) {
+		const auto slot = m_table.find(key);
+		return slot == table_type::npos ? 0 : m_table.values().m_data + slot;
+	}
+
+	const T* find(Key key) const {
+		const auto slot = m_table.find(key);
+		return slot == table_type::npos ? 0 : m_table.values().m_data + slot;
+	}
+
+	bool contains(Key key) const {
+		return m_table.find(key) != table_type::npos;
+	}
+
+	size_t count(Key key) const {
+		return this->contains(key) ? 1 : 0;
+	}
+
+	bool erase(Key key) {
+		return m_table.erase(key);
+	}
+
+	void clear() {
+		m_table.clear();
+	}
+
+	void reserve(size_t count) {
+		m_table.reserve(count);
+	}
+
+	// Call functor(key, value) for every element.
+	template <class Functor>
+	void for_each(Functor functor) {
+		auto& table = m_table;
+
+		m_table.for_each_slot([&](size_t slot) {
+			functor(table.key_at(slot), table.values().m_data[slot]);
+		});
+	}
+
+	template <class Functor>
+	void for_each(Functor functor) const {
+		const auto& table = m_table;
+
+		m_table.for_each_slot([&](size_t slot) {
+			functor(table.key_at(slot), (const T&) table.values().m_data[slot]);
+		});
+	}
+
+private:
+	table_type m_table;
+};
+
+} // namespace algo
@@ -6,12 +6,17 @@
 
 #pragma once
 
+#include "algo/string_ref.h"
 #include <string>
 
 
 namespace algo {
 
 // Key traits, used by hash_table_t, etc.
+//
+// "less()" is optional. If it's defined, hash_table_t turns long
+// bucket chains into balanced trees, and it must be consistent with
+// "equal()" (neither less than the other means equal).
 template <class Key>
 class key_traits_t {
 public:
@@ -22,26 +27,94 @@ public:
 	bool equal(const Key& key1, const Key& key2) const {
 		return key1 == key2;
 	}
+
+	bool less(const Key& key1, const Key& key2) const {
+		return key1 < key2;
+	}
 };
 
 
+// Key traits of strings.
+//
+// It's transparent ("is_transparent" is defined), so a hash table of
+// std::basic_string could be searched by "const Char*" or basic_string_ref_t
+// without creating a temporary string. All of them have the same hash value.
 template <class Char, class CharTraits, class Allocator>
 class key_traits_t<std::basic_string<Char, CharTraits, Allocator>> {
 public:
-	size_t hash(const std::basic_string<Char, CharTraits, Allocator>& key) const {
-		size_t value = 0;
+	typedef void is_transparent;
 
-		for (auto it = key.c_str(); *it != 0; ++it) {
-			value += (size_t)(*it);
-		}
+	typedef std::basic_string<Char, CharTraits, Allocator> string_type;
+	typedef basic_string_ref_t<Char, CharTraits> string_ref_type;
 
-		return value;
+public:
+	size_t hash(const string_type& key) const {
+		return hash_i(key.data(), key.size());
+	}
+
+	size_t hash(const Char* key) const {
+		return hash_i(key, CharTraits::length(key));
+	}
+
+	size_t hash(const string_ref_type& key) const {
+		return hash_i(key.data(), key.size());
+	}
+
+	bool equal(const string_type& key1, const string_type& key2) const {
+		return key1 == key2;
+	}
+
+	bool equal(const string_type& key1, const Char* key2) const {
+		return key1.compare(key2) == 0;
+	}
+
+	bool equal(const string_type& key1, const string_ref_type& key2) const {
+		return key1.size() == key2.size()
+			&& CharTraits::compare(key1.data(), key2.data(), key2.size()) == 0;
+	}
+
+	bool equal(const string_ref_type& key1, const string_type& key2) const {
+		return this->equal(key2, key1);
 	}
 
-	bool equal(const std::basic_string<Char, CharTraits, Allocator>& key1,
-		const std::basic_string<Char, CharTraits, Allocator>& key2) const {
+	bool equal(const string_ref_type& key1, const Char* key2) const {
+		return key1 == string_ref_type(key2);
+	}
+
+	bool equal(const string_ref_type& key1, const string_ref_type& key2) const {
 		return key1 == key2;
 	}
+
+	bool less(const string_type& key1, const string_type& key2) const {
+		return key1 < key2;
+	}
+
+	bool less(const string_type& key1, const Char* key2) const {
+		return key1.compare(key2) < 0;
+	}
+
+	bool less(const Char* key1, const string_type& key2) const {
+		return key2.compare(key1) > 0;
+	}
+
+	bool less(const string_type& key1, const string_ref_type& key2) const {
+		return string_ref_type(key1).compare(key2) < 0;
+	}
+
+	bool less(const string_ref_type& key1, const string_type& key2) const {
+		return key1.compare(string_ref_type(key2)) < 0;
+	}
+
+private:
+	static size_t hash_i(const Char* key, size_t size) {
+		size_t value = 0;
+
+		for (size_t i = 0; i < size; ++i) {
+			value += (size_t)(key[i]);
+		}
+
+		return value;
+	}
 };
 
 } // namespace algo
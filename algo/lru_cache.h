@@ -0,0 +1,303 @@
+/**
+ * LRU cache.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/hash_table.h"
+#include "algo/key_traits.h"
+#include <assert.h>
+#include <stddef.h>
+#include <utility>
+
+
+namespace algo {
+
+/**
+ * Bounded cache, the least recently used element is evicted
+ * when a new one is put into a full cache.
+ *
+ * Every element lives in a single hash_table_t node, and the recency
+ * list is threaded through the same node, so get() is one lookup and
+ * put() is one allocation (plus one free on eviction).
+ *
+ * In mode_clock (second chance), a hit just marks the element as
+ * referenced instead of moving it to the list head. On eviction, the
+ * clock hand skips (and unmarks) referenced elements. It costs less
+ * per hit, but approximates LRU.
+ *
+ * It's not thread-safe.
+ */
+template <class Key, class T, class KeyTraits = key_traits_t<Key>>
+class lru_cache_t {
+private:
+	typedef lru_cache_t<Key, T, KeyTraits> self_type;
+
+	struct slot_t;
+	typedef std::pair<const Key, slot_t> entry_t;
+
+	struct slot_t {
+		explicit slot_t(const T& value) : m_value(value), m_prev(0), m_next(0), m_referenced(false) {
+		}
+
+		T m_value;
+		entry_t* m_prev;
+		entry_t* m_next;
+		bool m_referenced;
+	};
+
+	typedef hash_table_t<Key, slot_t, KeyTraits> table_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef KeyTraits key_traits;
+
+	enum mode_t {
+		// Move an element to the list head on every hit.
+		mode_lru,
+
+		// Second chance, a hit only sets the "referenced" bit.
+		mode_clock
+	};
+
+public:
+	explicit lru_cache_t(size_t capacity, mode_t mode = mode_lru, const KeyTraits& key_traits = KeyTraits())
+		: m_table(key_traits, capacity), m_capacity(capacity), m_mode(mode), m_head(0),
+		m_hits(0), m_misses(0), m_evictions(0) {
+		assert(capacity > 0);
+	}
+
+	size_t size() const {
+		return m_table.size();
+	}
+
+	bool empty() const {
+		return m_table.empty();
+	}
+
+	size_t capacity() const {
+		return m_capacity;
+	}
+
+	mode_t mode() const {
+		return m_mode;
+	}
+
+	/**
+	 * Find an element and mark it as recently used.
+	 *
+	 * The returned pointer is valid until the element is evicted or erased.
+	 * Null is returned if the key does not exist.
+	 */
+	T* get(const Key& key);
+
+	/**
+	 * Insert or update an element, the least recently used
+	 * one is evicted if the cache is full.
+	 *
+	 * Return true if a new element was inserted.
+	 */
+	bool put(const Key& key, const T& value);
+
+	// Check if a key exists, without updating recency or counters.
+	bool contains(const Key& key) const {
+		return m_table.count(key) != 0;
+	}
+
+	bool erase(const Key& key);
+	void clear();
+
+	size_t hits() const {
+		return m_hits;
+	}
+
+	size_t misses() const {
+		return m_misses;
+	}
+
+	size_t evictions() const {
+		return m_evictions;
+	}
+
+	void reset_counters() {
+		m_hits = 0;
+		m_misses = 0;
+		m_evictions = 0;
+	}
+
+	// Visit elements from the most recently used one (mode_lru),
+	// or from the clock hand (mode_clock).
+	template <class Functor>
+	void for_each(Functor functor) const {
+		if (m_head == 0) {
+			return;
+		}
+
+		auto ptr = m_head;
+		do {
+			functor(ptr->first, (const T&) ptr->second.m_value);
+			ptr = ptr->second.m_next;
+		} while (ptr != m_head);
+	}
+
+private:
+	// Remove copy constructor and operator=().
+	lru_cache_t(const self_type&) = delete;
+	self_type& operator=(const self_type&) = delete;
+
+	void touch_i(entry_t* entry);
+	void link_i(entry_t* entry);
+	void unlink_i(entry_t* entry);
+	void evict_i();
+
+private:
+	table_type m_table;
+	size_t m_capacity;
+	mode_t m_mode;
+
+	// The list is circular. In mode_lru, "m_head" is the most recently
+	// used element and "m_head->m_prev" is the least recently used one.
+	// In mode_clock, "m_head" is the clock hand.
+	entry_t* m_head;
+
+	size_t m_hits;
+	size_t m_misses;
+	size_t m_evictions;
+};
+
+
+template <class Key, class T, class KeyTraits>
+inline T* lru_cache_t<Key, T, KeyTraits>::get(const Key& key) {
+	const auto it = m_table.find(key);
+
+	if (it == m_table.end()) {
+		++m_misses;
+		return 0;
+	}
+
+	++m_hits;
+
+	const auto entry = &(*it);
+	this->touch_i(entry);
+
+	return &entry->second.m_value;
+}
+
+template <class Key, class T, class KeyTraits>
+inline bool lru_cache_t<Key, T, KeyTraits>::put(const Key& key, const T& value) {
+	const auto result = m_table.insert(key, slot_t(value));
+	const auto entry = &(*result.first);
+
+	if (!result.second) {
+		entry->second.m_value = value;
+		this->touch_i(entry);
+		return false;
+	}
+
+	// The new element is not in the list yet, so it could not be the victim.
+	if (m_table.size() > m_capacity) {
+		this->evict_i();
+	}
+
+	this->link_i(entry);
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+inline bool lru_cache_t<Key, T, KeyTraits>::erase(const Key& key) {
+	const auto it = m_table.find(key);
+
+	if (it == m_table.end()) {
+		return false;
+	}
+
+	this->unlink_i(&(*it));
+	m_table.erase(it);
+
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+inline void lru_cache_t<Key, T, KeyTraits>::clear() {
+	m_table.clear();
+	m_head = 0;
+}
+
+template <class Key, class T, class KeyTraits>
+inline void lru_cache_t<Key, T, KeyTraits>::touch_i(entry_t* entry) {
+	if (m_mode == mode_clock) {
+		entry->second.m_referenced = true;
+	}
+	else if (entry != m_head) {
+		this->unlink_i(entry);
+		this->link_i(entry);
+	}
+}
+
+template <class Key, class T, class KeyTraits>
+inline void lru_cache_t<Key, T, KeyTraits>::link_i(entry_t* entry) {
+	if (m_head == 0) {
+		entry->second.m_prev = entry;
+		entry->second.m_next = entry;
+		m_head = entry;
+		return;
+	}
+
+	// Insert in front of "m_head", i.e. at the end of the circle.
+	const auto tail = m_head->second.m_prev;
+
+	entry->second.m_prev = tail;
+	entry->second.m_next = m_head;
+	tail->second.m_next = entry;
+	m_head->second.m_prev = entry;
+
+	// In mode_lru, the new element becomes the most recently used one.
+	// In mode_clock, it's visited last by the clock hand.
+	if (m_mode == mode_lru) {
+		m_head = entry;
+	}
+}
+
+template <class Key, class T, class KeyTraits>
+inline void lru_cache_t<Key, T, KeyTraits>::unlink_i(entry_t* entry) {
+	if (entry->second.m_next == entry) {
+		assert(m_head == entry);
+		m_head = 0;
+		return;
+	}
+
+	entry->second.m_prev->second.m_next = entry->second.m_next;
+	entry->second.m_next->second.m_prev = entry->second.m_prev;
+
+	if (m_head == entry) {
+		m_head = entry->second.m_next;
+	}
+}
+
+template <class Key, class T, class KeyTraits>
+inline void lru_cache_t<Key, T, KeyTraits>::evict_i() {
+	assert(m_head != 0);
+
+	entry_t* victim = 0;
+
+	if (m_mode == mode_lru) {
+		victim = m_head->second.m_prev;
+	}
+	else {
+		while (m_head->second.m_referenced) {
+			m_head->second.m_referenced = false;
+			m_head = m_head->second.m_next;
+		}
+
+		victim = m_head;
+	}
+
+	this->unlink_i(victim);
+	m_table.erase(victim->first);
+	++m_evictions;
+}
+
+} // namespace algo
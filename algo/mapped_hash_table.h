@@ -0,0 +1,616 @@
+/**
+ * Memory-mapped immutable hash table.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/hash_table.h"
+#include "algo/key_traits.h"
+#include "algo/string_ref.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+namespace algo {
+
+// Internal implementation.
+namespace mapped_hash_table__ {
+
+	// File layout:
+	//
+	// [header_t]
+	// [uint64_t bucket offsets * (array size + 1)]
+	// [entries of bucket 0][entries of bucket 1]...
+	//
+	// An entry is an encoded key followed by an encoded value, and both of
+	// them are padded to const_alignment. Offsets are relative to the
+	// beginning of the entries, so the file is position-independent.
+	// Integers are stored in native byte order.
+	const char const_magic[8] = { 'A', 'L', 'G', 'O', 'M', 'H', 'T', 0 };
+	const uint32_t const_version = 2;
+	const size_t const_alignment = 8;
+
+	struct header_t {
+		char m_magic[8];
+		uint32_t m_version;
+		uint32_t m_reserved;
+		uint32_t m_key_tag;
+		uint32_t m_value_tag;
+		uint64_t m_array_size;
+		uint64_t m_size;
+		uint64_t m_entries_offset;
+		uint64_t m_file_size;
+	};
+
+	// "std::true_type" if "KeyTraits::equal()" could compare K1 with K2.
+	template <class KeyTraits, class K1, class K2>
+	struct has_equal_t {
+		template <class Traits>
+		static auto test(int) -> decltype(
+			std::declval<const Traits&>().equal(std::declval<const K1&>(), std::declval<const K2&>()),
+			std::true_type());
+
+		template <class Traits>
+		static std::false_type test(...);
+
+		typedef decltype(test<KeyTraits>(0)) type;
+	};
+
+	// Tag of a trivially-copyable type, i.e. its size (bits 0-15), its
+	// alignment (bits 16-23) and its kind, so that "int" differs from
+	// "float" and "int64_t" from "double". Bit 31 is for strings.
+	template <class T>
+	struct type_tag_t {
+		static const uint32_t value = ((uint32_t) sizeof(T) & 0xFFFF)
+			| (((uint32_t) alignof(T) & 0xFF) << 16)
+			| (std::is_same<T, bool>::value ? 0x01000000 : 0)
+			| (std::is_integral<T>::value && std::is_signed<T>::value ? 0x02000000 : 0)
+			| (std::is_integral<T>::value && std::is_unsigned<T>::value ? 0x04000000 : 0)
+			| (std::is_floating_point<T>::value ? 0x08000000 : 0)
+			| (std::is_enum<T>::value ? 0x10000000 : 0)
+			| (std::is_pointer<T>::value ? 0x20000000 : 0)
+			| (std::is_class<T>::value || std::is_union<T>::value || std::is_array<T>::value ? 0x40000000 : 0);
+	};
+
+	inline size_t align(size_t size) {
+		return (size + const_alignment - 1) & ~(const_alignment - 1);
+	}
+
+	// Encoding of trivially-copyable types: raw bytes.
+	// Values are copied out with memcpy(), so there is no alignment requirement.
+	template <class T>
+	struct codec_t {
+		static_assert(std::is_trivially_copyable<T>::value,
+			"mapped_hash_table_t only supports trivially-copyable types and std::basic_string");
+
+		typedef T view_type;
+
+		// Used to detect type mismatch between the writer and the reader.
+		static const uint32_t const_tag = type_tag_t<T>::value;
+
+		static size_t encoded_size(const T&) {
+			return align(sizeof(T));
+		}
+
+		static size_t encoded_size(const char*) {
+			return align(sizeof(T));
+		}
+
+		// Encoded size, or 0 if it's bigger than "available" bytes.
+		static uint64_t checked_size(const char*, uint64_t available) {
+			return align(sizeof(T)) <= available ? align(sizeof(T)) : 0;
+		}
+
+		static void encode(const T& value, char* buffer) {
+			memcpy(buffer, &value, sizeof(T));
+		}
+
+		static view_type decode(const char* ptr) {
+			T value;
+			memcpy(&value, ptr, sizeof(T));
+			return value;
+		}
+
+		template <class K, class KeyTraits>
+		static bool equal(const char* ptr, const K& key, const KeyTraits& key_traits) {
+			return key_traits.equal(decode(ptr), key);
+		}
+	};
+
+	// Encoding of strings: uint32_t length (in characters) followed by the characters.
+	// Decoded strings are references into the mapping.
+	template <class Char, class CharTraits, class Allocator>
+	struct codec_t<std::basic_string<Char, CharTraits, Allocator>> {
+		typedef std::basic_string<Char, CharTraits, Allocator> string_type;
+		typedef basic_string_ref_t<Char, CharTraits> view_type;
+
+		static const uint32_t const_tag = 0x80000000 | (uint32_t) sizeof(Char);
+
+		static size_t encoded_size(const string_type& value) {
+			return align(sizeof(uint32_t) + value.size() * sizeof(Char));
+		}
+
+		static size_t encoded_size(const char* ptr) {
+			uint32_t length;
+			memcpy(&length, ptr, sizeof(length));
+			return align(sizeof(uint32_t) + length * sizeof(Char));
+		}
+
+		// Encoded size, or 0 if it's bigger than "available" bytes.
+		static uint64_t checked_size(const char* ptr, uint64_t available) {
+			if (available < sizeof(uint32_t)) {
+				return 0;
+			}
+
+			uint32_t length;
+			memcpy(&length, ptr, sizeof(length));
+
+			const uint64_t size = (sizeof(uint32_t) + (uint64_t) length * sizeof(Char) + const_alignment - 1)
+				& ~(uint64_t) (const_alignment - 1);
+			return size <= available ? size : 0;
+		}
+
+		static void encode(const string_type& value, char* buffer) {
+			const auto length = (uint32_t) value.size();
+			memcpy(buffer, &length, sizeof(length));
+			memcpy(buffer + sizeof(length), value.data(), value.size() * sizeof(Char));
+		}
+
+		static view_type decode(const char* ptr) {
+			uint32_t length;
+			memcpy(&length, ptr, sizeof(length));
+			return view_type((const Char*) (ptr + sizeof(length)), length);
+		}
+
+		// Keys are compared by KeyTraits, which hashes them too. A key is
+		// copied into a string only if KeyTraits could not compare its view.
+		template <class K, class KeyTraits>
+		static bool equal(const char* ptr, const K& key, const KeyTraits& key_traits) {
+			return equal_i(decode(ptr), key, key_traits, typename has_equal_t<KeyTraits, view_type, K>::type());
+		}
+
+		template <class K, class KeyTraits>
+		static bool equal_i(const view_type& view, const K& key, const KeyTraits& key_traits, const std::true_type&) {
+			return key_traits.equal(view, key);
+		}
+
+		template <class K, class KeyTraits>
+		static bool equal_i(const view_type& view, const K& key, const KeyTraits& key_traits, const std::false_type&) {
+			return key_traits.equal(string_type(view), key);
+		}
+	};
+}
+
+
+/**
+ * Write a hash table into a binary file, which could be opened by mapped_hash_table_t.
+ *
+ * Key and T must be trivially-copyable or std::basic_string.
+ *
+ * @param table [in] Hash table.
+ * @param path [in] File path.
+ * @param array_size [in] Bucket count of the file, 0 means "table.size()".
+ * @return true if succeeded.
+ */
+template <class Key, class T, class KeyTraits, class Allocator>
+inline bool freeze_hash_table(const hash_table_t<Key, T, KeyTraits, Allocator>& table,
+	const char* path, size_t array_size = 0) {
+
+	typedef mapped_hash_table__::codec_t<Key> key_codec_t;
+	typedef mapped_hash_table__::codec_t<T> value_codec_t;
+	typedef typename hash_table_t<Key, T, KeyTraits, Allocator>::const_iterator const_iterator;
+
+	assert(path != 0);
+
+	if (array_size == 0) {
+		array_size = table.size() > 0 ? table.size() : 1;
+	}
+
+	const auto key_traits = table.key_comp();
+
+	// Group entries by bucket (counting sort).
+	std::vector<size_t> indexes;
+	std::vector<uint64_t> offsets(array_size + 1, 0);
+	indexes.reserve(table.size());
+
+	for (auto it = table.begin(); it != table.end(); ++it) {
+		const auto index = key_traits.hash((*it).first) % array_size;
+		indexes.push_back(index);
+		offsets[index + 1] += key_codec_t::encoded_size((*it).first) + value_codec_t::encoded_size((*it).second);
+	}
+
+	for (size_t i = 1; i <= array_size; ++i) {
+		offsets[i] += offsets[i - 1];
+	}
+
+	std::vector<const_iterator> sorted(table.size());
+	{
+		std::vector<size_t> positions(array_size + 1, 0);
+		for (auto it = indexes.begin(); it != indexes.end(); ++it) {
+			++positions[*it + 1];
+		}
+
+		for (size_t i = 1; i <= array_size; ++i) {
+			positions[i] += positions[i - 1];
+		}
+
+		size_t k = 0;
+		for (auto it = table.begin(); it != table.end(); ++it, ++k) {
+			sorted[positions[indexes[k]]++] = it;
+		}
+	}
+
+	mapped_hash_table__::header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.m_magic, mapped_hash_table__::const_magic, sizeof(header.m_magic));
+	header.m_version = mapped_hash_table__::const_version;
+	header.m_key_tag = key_codec_t::const_tag;
+	header.m_value_tag = value_codec_t::const_tag;
+	header.m_array_size = array_size;
+	header.m_size = table.size();
+	header.m_entries_offset = mapped_hash_table__::align(sizeof(header) + sizeof(uint64_t) * (array_size + 1));
+	header.m_file_size = header.m_entries_offset + offsets[array_size];
+
+	auto file = fopen(path, "wb");
+	if (file == 0) {
+		return false;
+	}
+
+	bool result = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), file) == offsets.size();
+
+	const char zeros[mapped_hash_table__::const_alignment] = { 0 };
+	const auto padding = header.m_entries_offset - sizeof(header) - sizeof(uint64_t) * (array_size + 1);
+	if (result && padding > 0) {
+		result = fwrite(zeros, 1, (size_t) padding, file) == padding;
+	}
+
+	std::vector<char> buffer;
+	for (auto it = sorted.begin(); result && it != sorted.end(); ++it) {
+		const auto key_size = key_codec_t::encoded_size((**it).first);
+		const auto value_size = value_codec_t::encoded_size((**it).second);
+
+		buffer.assign(key_size + value_size, 0);
+		key_codec_t::encode((**it).first, &buffer[0]);
+		value_codec_t::encode((**it).second, &buffer[key_size]);
+
+		result = fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+	}
+
+	if (fclose(file) != 0) {
+		result = false;
+	}
+
+	if (!result) {
+		remove(path);
+	}
+
+	return result;
+}
+
+
+/**
+ * Read-only hash table which answers lookups directly from a memory-mapped
+ * file written by freeze_hash_table(), without deserializing it.
+ *
+ * Opening a file walks all entries once to check that every bucket and
+ * string lies within the file, so a corrupt file is rejected instead of
+ * making lookups read past the mapping. All processes which map the same
+ * file share one copy in the page cache.
+ *
+ * Keys of std::basic_string are returned as basic_string_ref_t, which
+ * refers to the mapping and is valid until close().
+ */
+template <class Key, class T, class KeyTraits = key_traits_t<Key>>
+class mapped_hash_table_t {
+private:
+	typedef mapped_hash_table_t<Key, T, KeyTraits> self_type;
+	typedef mapped_hash_table__::codec_t<Key> key_codec_t;
+	typedef mapped_hash_table__::codec_t<T> value_codec_t;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef KeyTraits key_traits;
+	typedef typename key_codec_t::view_type key_view;
+	typedef typename value_codec_t::view_type value_view;
+
+public:
+	explicit mapped_hash_table_t(const KeyTraits& key_traits = KeyTraits())
+		: m_key_traits(key_traits), m_data(0), m_data_size(0), m_header(0), m_offsets(0), m_entries(0) {
+#ifdef _WIN32
+		m_file = INVALID_HANDLE_VALUE;
+		m_mapping = 0;
+#endif
+	}
+
+	~mapped_hash_table_t() {
+		this->close();
+	}
+
+	bool open(const char* path);
+	void close();
+
+	bool is_open() const {
+		return m_data != 0;
+	}
+
+	size_t size() const {
+		return m_header == 0 ? 0 : (size_t) m_header->m_size;
+	}
+
+	bool empty() const {
+		return this->size() == 0;
+	}
+
+	size_t array_size() const {
+		return m_header == 0 ? 0 : (size_t) m_header->m_array_size;
+	}
+
+	key_traits key_comp() const {
+		return m_key_traits;
+	}
+
+	bool find(const Key& key, value_view* value) const {
+		return this->find_i(key, value);
+	}
+
+	bool contains(const Key& key) const {
+		return this->find_i(key, (value_view*) 0);
+	}
+
+	// Heterogeneous lookup, available if "KeyTraits::is_transparent" is defined.
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	bool find(const K& key, value_view* value) const {
+		return this->find_i(key, value);
+	}
+
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	bool contains(const K& key) const {
+		return this->find_i(key, (value_view*) 0);
+	}
+
+	/**
+	 * Visit all elements.
+	 *
+	 * Functor prototype: void functor(const key_view& key, const value_view& value);
+	 */
+	template <class Functor>
+	void for_each(const Functor& functor) const {
+		if (m_header == 0) {
+			return;
+		}
+
+		const auto first = m_entries;
+		const auto last = m_entries + m_offsets[m_header->m_array_size];
+
+		for (auto ptr = first; ptr < last; ) {
+			const auto value_ptr = ptr + key_codec_t::encoded_size(ptr);
+			functor(key_codec_t::decode(ptr), value_codec_t::decode(value_ptr));
+			ptr = value_ptr + value_codec_t::encoded_size(value_ptr);
+		}
+	}
+
+private:
+	mapped_hash_table_t(const self_type&) = delete;
+	self_type& operator=(const self_type&) = delete;
+
+	template <class K>
+	bool find_i(const K& key, value_view* value) const;
+
+	bool validate_i(size_t file_size) const;
+
+private:
+	KeyTraits m_key_traits;
+	const char* m_data;
+	size_t m_data_size;
+	const mapped_hash_table__::header_t* m_header;
+	const uint64_t* m_offsets;
+	const char* m_entries;
+
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#endif
+};
+
+
+template <class Key, class T, class KeyTraits>
+inline bool mapped_hash_table_t<Key, T, KeyTraits>::open(const char* path) {
+	assert(path != 0);
+
+	this->close();
+
+	size_t file_size = 0;
+
+#ifdef _WIN32
+	m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart < (LONGLONG) sizeof(mapped_hash_table__::header_t)) {
+		this->close();
+		return false;
+	}
+
+	file_size = (size_t) size.QuadPart;
+	m_mapping = CreateFileMappingA(m_file, 0, PAGE_READONLY, 0, 0, 0);
+	if (m_mapping == 0) {
+		this->close();
+		return false;
+	}
+
+	m_data = (const char*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (m_data == 0) {
+		this->close();
+		return false;
+	}
+#else
+	const int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(mapped_hash_table__::header_t)) {
+		::close(fd);
+		return false;
+	}
+
+	file_size = (size_t) st.st_size;
+	void* ptr = mmap(0, file_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	// The mapping keeps its own reference to the file.
+	::close(fd);
+
+	if (ptr == MAP_FAILED) {
+		return false;
+	}
+
+	m_data = (const char*) ptr;
+#endif
+
+	m_data_size = file_size;
+	m_header = (const mapped_hash_table__::header_t*) m_data;
+	m_offsets = (const uint64_t*) (m_data + sizeof(mapped_hash_table__::header_t));
+	m_entries = m_data + (size_t) m_header->m_entries_offset;
+
+	if (!this->validate_i(file_size)) {
+		this->close();
+		return false;
+	}
+
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+inline void mapped_hash_table_t<Key, T, KeyTraits>::close() {
+#ifdef _WIN32
+	if (m_data != 0) {
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping != 0) {
+		CloseHandle(m_mapping);
+		m_mapping = 0;
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE) {
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_data != 0) {
+		munmap((void*) m_data, m_data_size);
+	}
+#endif
+
+	m_data = 0;
+	m_data_size = 0;
+	m_header = 0;
+	m_offsets = 0;
+	m_entries = 0;
+}
+
+template <class Key, class T, class KeyTraits>
+inline bool mapped_hash_table_t<Key, T, KeyTraits>::validate_i(size_t file_size) const {
+	const auto header = m_header;
+
+	if (memcmp(header->m_magic, mapped_hash_table__::const_magic, sizeof(header->m_magic)) != 0
+		|| header->m_version != mapped_hash_table__::const_version
+		|| header->m_key_tag != key_codec_t::const_tag
+		|| header->m_value_tag != value_codec_t::const_tag
+		|| header->m_file_size != file_size
+		|| header->m_array_size == 0) {
+		return false;
+	}
+
+	// Bucket offsets must fit in the file.
+	if (header->m_array_size > (file_size - sizeof(*header)) / sizeof(uint64_t) - 1
+		|| header->m_entries_offset < sizeof(*header) + sizeof(uint64_t) * (header->m_array_size + 1)
+		|| header->m_entries_offset > file_size) {
+		return false;
+	}
+
+	const auto entries_size = file_size - header->m_entries_offset;
+	if (m_offsets[0] != 0 || m_offsets[header->m_array_size] != entries_size) {
+		return false;
+	}
+
+	// Every bucket must be a whole number of entries.
+	uint64_t count = 0;
+
+	for (uint64_t i = 0; i < header->m_array_size; ++i) {
+		const auto last = m_offsets[i + 1];
+
+		if (m_offsets[i] > last || last > entries_size) {
+			return false;
+		}
+
+		for (auto offset = m_offsets[i]; offset < last; ++count) {
+			const auto key_size = key_codec_t::checked_size(m_entries + offset, last - offset);
+			if (key_size == 0) {
+				return false;
+			}
+
+			offset += key_size;
+
+			const auto value_size = value_codec_t::checked_size(m_entries + offset, last - offset);
+			if (value_size == 0) {
+				return false;
+			}
+
+			offset += value_size;
+		}
+	}
+
+	return count == header->m_size;
+}
+
+template <class Key, class T, class KeyTraits>
+template <class K>
+inline bool mapped_hash_table_t<Key, T, KeyTraits>::find_i(const K& key, value_view* value) const {
+	if (m_header == 0) {
+		return false;
+	}
+
+	const auto index = m_key_traits.hash(key) % (size_t) m_header->m_array_size;
+	const auto last = m_entries + m_offsets[index + 1];
+
+	for (auto ptr = m_entries + m_offsets[index]; ptr < last; ) {
+		const auto value_ptr = ptr + key_codec_t::encoded_size(ptr);
+
+		if (key_codec_t::equal(ptr, key, m_key_traits)) {
+			if (value != 0) {
+				*value = value_codec_t::decode(value_ptr);
+			}
+
+			return true;
+		}
+
+		ptr = value_ptr + value_codec_t::encoded_size(value_ptr);
+	}
+
+	return false;
+}
+
+} // namespace algo
@@ -0,0 +1,231 @@
+/**
+ * Node pool and pool allocator.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <new>
+#include <memory>
+#include <vector>
+
+
+namespace algo {
+
+/**
+ * Node pool (arena) for small fixed-size objects, e.g. container nodes.
+ *
+ * Memory is carved from big chunks, and each size class (a multiple of
+ * const_granularity bytes) has its own free list, so allocate() and
+ * deallocate() are O(1) and never call malloc() in steady state.
+ * Bigger objects go to operator new directly.
+ *
+ * The pool is not thread-safe.
+ */
+class node_pool_t {
+public:
+	// Size class granularity, it's also the alignment of pooled objects.
+	static const size_t const_granularity = sizeof(void*);
+
+	// Objects bigger than this go to operator new.
+	static const size_t const_max_pooled_size = 256;
+
+	// Default chunk size.
+	static const size_t const_default_chunk_size = 64 * 1024;
+
+public:
+	explicit node_pool_t(size_t chunk_size = const_default_chunk_size)
+		: m_chunk_size(chunk_size), m_current(0), m_end(0), m_allocated(0) {
+		assert(chunk_size >= const_max_pooled_size);
+
+		for (size_t i = 0; i < const_class_count; ++i) {
+			m_free[i] = 0;
+		}
+	}
+
+	~node_pool_t() {
+		this->release();
+	}
+
+	void* allocate(size_t size) {
+		if (size > const_max_pooled_size) {
+			return ::operator new(size);
+		}
+
+		const auto index = class_index(size);
+		auto ptr = m_free[index];
+
+		if (ptr != 0) {
+			m_free[index] = ptr->m_next;
+		}
+		else {
+			const auto bytes = (index + 1) * const_granularity;
+
+			if (m_current == 0 || m_current + bytes > m_end) {
+				m_current = (char*) ::operator new(m_chunk_size);
+				m_end = m_current + m_chunk_size;
+				m_chunks.push_back(m_current);
+			}
+
+			ptr = (free_block_t*) m_current;
+			m_current += bytes;
+		}
+
+		++m_allocated;
+		return ptr;
+	}
+
+	void deallocate(void* ptr, size_t size) {
+		if (ptr == 0) {
+			return;
+		}
+
+		if (size > const_max_pooled_size) {
+			::operator delete(ptr);
+			return;
+		}
+
+		const auto index = class_index(size);
+		auto block = (free_block_t*) ptr;
+
+		block->m_next = m_free[index];
+		m_free[index] = block;
+
+		assert(m_allocated > 0);
+		--m_allocated;
+	}
+
+	/**
+	 * Give all chunks back to the system at once.
+	 *
+	 * Objects allocated from the pool must not be used any more,
+	 * the caller is responsible for running their destructors if needed.
+	 */
+	void release() {
+		for (auto it = m_chunks.begin(); it != m_chunks.end(); ++it) {
+			::operator delete(*it);
+		}
+
+		m_chunks.clear();
+		m_current = 0;
+		m_end = 0;
+		m_allocated = 0;
+
+		for (size_t i = 0; i < const_class_count; ++i) {
+			m_free[i] = 0;
+		}
+	}
+
+	// Number of pooled objects in use.
+	size_t allocated() const {
+		return m_allocated;
+	}
+
+	// Bytes reserved from the system.
+	size_t capacity() const {
+		return m_chunks.size() * m_chunk_size;
+	}
+
+private:
+	node_pool_t(const node_pool_t&) = delete;
+	node_pool_t& operator=(const node_pool_t&) = delete;
+
+	static const size_t const_class_count = const_max_pooled_size / const_granularity;
+
+	static size_t class_index(size_t size) {
+		return size == 0 ? 0 : (size - 1) / const_granularity;
+	}
+
+	struct free_block_t {
+		free_block_t* m_next;
+	};
+
+	size_t m_chunk_size;
+	char* m_current;
+	char* m_end;
+	size_t m_allocated;
+	std::vector<char*> m_chunks;
+	free_block_t* m_free[const_class_count];
+};
+
+
+/**
+ * Allocator which takes single objects from a node_pool_t.
+ *
+ * Copies (including rebound ones) share the same pool. A default
+ * constructed allocator creates a new pool, and so does a container
+ * copy, so that every container owns its own arena by default.
+ */
+template <class T>
+class pool_allocator_t {
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind {
+		typedef pool_allocator_t<U> other;
+	};
+
+public:
+	pool_allocator_t() : m_pool(std::make_shared<node_pool_t>()) {
+	}
+
+	explicit pool_allocator_t(const std::shared_ptr<node_pool_t>& pool) : m_pool(pool) {
+		assert(pool);
+	}
+
+	template <class U>
+	pool_allocator_t(const pool_allocator_t<U>& another) : m_pool(another.get_pool()) {
+	}
+
+	T* allocate(size_t n) {
+		// Objects with extended alignment or arrays are not pooled.
+		if (n != 1 || alignof(T) > node_pool_t::const_granularity) {
+			return (T*) ::operator new(n * sizeof(T));
+		}
+
+		return (T*) m_pool->allocate(sizeof(T));
+	}
+
+	void deallocate(T* ptr, size_t n) {
+		if (n != 1 || alignof(T) > node_pool_t::const_granularity) {
+			::operator delete(ptr);
+			return;
+		}
+
+		m_pool->deallocate(ptr, sizeof(T));
+	}
+
+	// A container copy gets a new arena.
+	pool_allocator_t select_on_container_copy_construction() const {
+		return pool_allocator_t();
+	}
+
+	const std::shared_ptr<node_pool_t>& get_pool() const {
+		return m_pool;
+	}
+
+	template <class U>
+	bool operator==(const pool_allocator_t<U>& another) const {
+		return m_pool == another.get_pool();
+	}
+
+	template <class U>
+	bool operator!=(const pool_allocator_t<U>& another) const {
+		return m_pool != another.get_pool();
+	}
+
+private:
+	std::shared_ptr<node_pool_t> m_pool;
+};
+
+} // namespace algo
@@ -0,0 +1,576 @@
+/**
+ * Minimal perfect hash map.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/key_traits.h"
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace algo {
+
+// Internal implementation.
+namespace perfect_hash_map__ {
+
+	// Keys per partition. Partitions are built independently (in parallel),
+	// and the partition table is small enough to stay in cache.
+	const size_t const_partition_size = 1 << 16;
+
+	// Average keys per bucket, a pilot (uint16_t) is stored for each bucket.
+	const size_t const_bucket_size = 5;
+
+	// Table size is "keys / const_load_factor", positions beyond the key count
+	// are remapped to the free slots, so the map stays minimal.
+	const double const_load_factor = 0.99;
+
+	// Give up after this many seeds for a single partition.
+	const uint32_t const_max_seeds = 64;
+
+	const uint32_t const_max_pilot = 0xFFFF;
+
+	inline uint64_t mix(uint64_t value) {
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+		return value ^ (value >> 31);
+	}
+
+	// Map a 32-bit value to [0, range) without division.
+	inline uint32_t fast_range(uint32_t value, uint32_t range) {
+		return (uint32_t) (((uint64_t) value * range) >> 32);
+	}
+
+	inline uint64_t seed_value(uint32_t seed) {
+		return mix(0x9E3779B97F4A7C15ULL * (seed + 1));
+	}
+
+	// Positions of keys in the same bucket must be independent for each pilot,
+	// so the result is mixed again after combining with the pilot.
+	inline uint32_t position(uint64_t key_hash, uint32_t pilot, uint32_t table_size) {
+		return fast_range((uint32_t) mix(key_hash ^ (0x9E3779B97F4A7C15ULL * (pilot + 1))), table_size);
+	}
+
+	struct partition_t {
+		partition_t() : m_value_offset(0), m_bucket_offset(0), m_remap_offset(0),
+			m_seed(0), m_size(0), m_bucket_count(0), m_table_size(0), m_seed_value(0) {
+		}
+
+		size_t m_value_offset;
+		size_t m_bucket_offset;
+		size_t m_remap_offset;
+		uint32_t m_seed;
+		uint32_t m_size;
+		uint32_t m_bucket_count;
+		uint32_t m_table_size;
+		uint64_t m_seed_value;
+	};
+
+	/**
+	 * Build a single partition.
+	 *
+	 * @param hashes [in] Mixed key hashes of this partition, must be distinct.
+	 * @param partition [in,out] Sizes must be set, m_seed is the first seed to try.
+	 * @param pilots [out] Pilot of each bucket.
+	 * @param remap [out] Slots of positions beyond m_size.
+	 * @param positions [out] Final position of each key.
+	 * @return false if no pilot could be found for const_max_seeds seeds.
+	 */
+	inline bool build_partition(const std::vector<uint64_t>& hashes, partition_t& partition,
+		uint16_t* pilots, uint32_t* remap, std::vector<uint32_t>& positions) {
+
+		const auto size = partition.m_size;
+		const auto bucket_count = partition.m_bucket_count;
+		const auto table_size = partition.m_table_size;
+
+		positions.assign(size, 0);
+		if (size == 0) {
+			return true;
+		}
+
+		// (bucket, index, seeded hash) of each key.
+		std::vector<std::pair<std::pair<uint32_t, uint32_t>, uint64_t>> keys(size);
+		std::vector<uint32_t> bucket_first(bucket_count + 1);
+		std::vector<uint32_t> buckets(bucket_count);
+		std::vector<bool> taken(table_size);
+		std::vector<uint32_t> candidates;
+
+		for (uint32_t seed = partition.m_seed; seed < partition.m_seed + const_max_seeds; ++seed) {
+			const auto seed_hash = seed_value(seed);
+
+			// Sort keys by bucket.
+			for (uint32_t i = 0; i < size; ++i) {
+				const auto key_hash = mix(hashes[i] ^ seed_hash);
+				keys[i] = std::make_pair(std::make_pair(fast_range((uint32_t) (key_hash >> 32), bucket_count), i), key_hash);
+			}
+
+			std::sort(keys.begin(), keys.end());
+
+			std::fill(bucket_first.begin(), bucket_first.end(), 0);
+			for (uint32_t i = 0; i < size; ++i) {
+				++bucket_first[keys[i].first.first + 1];
+			}
+
+			for (uint32_t i = 1; i <= bucket_count; ++i) {
+				bucket_first[i] += bucket_first[i - 1];
+			}
+
+			// Biggest buckets first.
+			for (uint32_t i = 0; i < bucket_count; ++i) {
+				buckets[i] = i;
+			}
+
+			std::stable_sort(buckets.begin(), buckets.end(), [&bucket_first](uint32_t b1, uint32_t b2) {
+				return bucket_first[b1 + 1] - bucket_first[b1] > bucket_first[b2 + 1] - bucket_first[b2];
+			});
+
+			std::fill(taken.begin(), taken.end(), false);
+			bool failed = false;
+
+			for (uint32_t i = 0; i < bucket_count && !failed; ++i) {
+				const auto bucket = buckets[i];
+				const auto first = bucket_first[bucket];
+				const auto last = bucket_first[bucket + 1];
+
+				pilots[bucket] = 0;
+				if (first == last) {
+					continue;
+				}
+
+				bool found = false;
+
+				for (uint32_t pilot = 0; pilot <= const_max_pilot && !found; ++pilot) {
+					candidates.clear();
+
+					for (auto k = first; k < last; ++k) {
+						const auto pos = position(keys[k].second, pilot, table_size);
+
+						if (taken[pos] || std::find(candidates.begin(), candidates.end(), pos) != candidates.end()) {
+							break;
+						}
+
+						candidates.push_back(pos);
+					}
+
+					if (candidates.size() == last - first) {
+						found = true;
+						pilots[bucket] = (uint16_t) pilot;
+
+						for (auto k = first; k < last; ++k) {
+							taken[candidates[k - first]] = true;
+							positions[keys[k].first.second] = candidates[k - first];
+						}
+					}
+				}
+
+				failed = !found;
+			}
+
+			if (failed) {
+				continue;
+			}
+
+			// Move keys beyond "size" into free slots.
+			uint32_t free_slot = 0;
+			for (uint32_t pos = size; pos < table_size; ++pos) {
+				remap[pos - size] = 0;
+
+				if (!taken[pos]) {
+					continue;
+				}
+
+				while (taken[free_slot]) {
+					++free_slot;
+				}
+
+				assert(free_slot < size);
+				remap[pos - size] = free_slot++;
+			}
+
+			for (uint32_t i = 0; i < size; ++i) {
+				if (positions[i] >= size) {
+					positions[i] = remap[positions[i] - size];
+				}
+			}
+
+			partition.m_seed = seed;
+			partition.m_seed_value = seed_hash;
+			return true;
+		}
+
+		return false;
+	}
+}
+
+
+/**
+ * Minimal perfect hash map for a static key set (PTHash-like).
+ *
+ * Keys are split into partitions by hash, and each partition is split into
+ * buckets of about 5 keys. For every bucket a 16-bit "pilot" is searched so
+ * that all keys of the bucket land on free slots of a dense array. Lookup
+ * evaluates KeyTraits::hash() once, reads one pilot and then one element,
+ * and metadata costs about 3.5 bits per key.
+ *
+ * Keys whose KeyTraits::hash() equals that of another key could not be told
+ * apart by the hash function. They are kept aside sorted by hash value, and
+ * a lookup which misses its slot compares them by KeyTraits::equal().
+ */
+template <class Key, class T, class KeyTraits = key_traits_t<Key>>
+class perfect_hash_map_t {
+private:
+	typedef perfect_hash_map_t<Key, T, KeyTraits> self_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef std::pair<Key, T> value_type;
+	typedef KeyTraits key_traits;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+public:
+	explicit perfect_hash_map_t(const KeyTraits& key_traits = KeyTraits()) : m_key_traits(key_traits) {
+	}
+
+	/**
+	 * Build the map from std::pair<Key, T> elements in [first, last).
+	 *
+	 * @param threads [in] Number of threads, 0 means std::thread::hardware_concurrency().
+	 * @return false if keys are not unique.
+	 */
+	template <class Iterator>
+	bool build(Iterator first, Iterator last, size_t threads = 0);
+
+	size_t size() const {
+		return m_values.size();
+	}
+
+	bool empty() const {
+		return m_values.empty();
+	}
+
+	key_traits key_comp() const {
+		return m_key_traits;
+	}
+
+	void clear() {
+		m_partitions.clear();
+		m_pilots.clear();
+		m_remap.clear();
+		m_values.clear();
+		m_overflow.clear();
+	}
+
+	// Returns 0 if the key does not exist.
+	const T* find(const Key& key) const {
+		return this->find_i(key);
+	}
+
+	bool contains(const Key& key) const {
+		return this->find_i(key) != 0;
+	}
+
+	// Heterogeneous lookup, available if "KeyTraits::is_transparent" is defined.
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	const T* find(const K& key) const {
+		return this->find_i(key);
+	}
+
+	template <class K, class Traits = KeyTraits, class = typename Traits::is_transparent>
+	bool contains(const K& key) const {
+		return this->find_i(key) != 0;
+	}
+
+	const_iterator begin() const {
+		return m_values.begin();
+	}
+
+	const_iterator end() const {
+		return m_values.end();
+	}
+
+	// Bytes used by the hash function (excluding keys and values).
+	size_t metadata_bytes() const {
+		return m_partitions.size() * sizeof(m_partitions[0])
+			+ m_pilots.size() * sizeof(m_pilots[0])
+			+ m_remap.size() * sizeof(m_remap[0])
+			+ m_overflow.size() * sizeof(m_overflow[0]);
+	}
+
+	double bits_per_key() const {
+		return m_values.empty() ? 0 : (double) this->metadata_bytes() * 8 / m_values.size();
+	}
+
+private:
+	template <class K>
+	const T* find_i(const K& key) const;
+
+private:
+	KeyTraits m_key_traits;
+	std::vector<perfect_hash_map__::partition_t> m_partitions;
+	std::vector<uint16_t> m_pilots;
+	std::vector<uint32_t> m_remap;
+	std::vector<value_type> m_values;
+
+	// (hash value, index of m_values) of keys sharing the hash value of a placed key, sorted.
+	std::vector<std::pair<uint64_t, size_t>> m_overflow;
+};
+
+
+template <class Key, class T, class KeyTraits>
+template <class Iterator>
+inline bool perfect_hash_map_t<Key, T, KeyTraits>::build(Iterator first, Iterator last, size_t threads) {
+	using namespace perfect_hash_map__;
+
+	this->clear();
+
+	std::vector<value_type> elements(first, last);
+
+	if (elements.empty()) {
+		return true;
+	}
+
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+
+	// Only the first key of each hash value is placed by the hash function,
+	// keys sharing its hash value go to "overflow".
+	std::vector<uint64_t> element_hashes(elements.size());
+	std::vector<size_t> by_hash(elements.size());
+
+	for (size_t i = 0; i < elements.size(); ++i) {
+		element_hashes[i] = mix((uint64_t) m_key_traits.hash(elements[i].first));
+		by_hash[i] = i;
+	}
+
+	std::sort(by_hash.begin(), by_hash.end(), [&element_hashes](size_t v1, size_t v2) {
+		return element_hashes[v1] < element_hashes[v2];
+	});
+
+	std::vector<value_type> input;
+	std::vector<uint64_t> hashes;
+	std::vector<value_type> overflow;
+
+	for (size_t i = 0; i < by_hash.size(); ) {
+		const auto hash = element_hashes[by_hash[i]];
+		auto group_end = i + 1;
+
+		while (group_end < by_hash.size() && element_hashes[by_hash[group_end]] == hash) {
+			++group_end;
+		}
+
+		// Check the whole group for duplicates before any key is moved out.
+		for (auto k = i + 1; k < group_end; ++k) {
+			for (auto j = i; j < k; ++j) {
+				if (m_key_traits.equal(elements[by_hash[j]].first, elements[by_hash[k]].first)) {
+					this->clear();
+					return false;
+				}
+			}
+		}
+
+		input.push_back(std::move(elements[by_hash[i]]));
+		hashes.push_back(hash);
+
+		for (auto k = i + 1; k < group_end; ++k) {
+			m_overflow.push_back(std::make_pair(hash, overflow.size()));
+			overflow.push_back(std::move(elements[by_hash[k]]));
+		}
+
+		i = group_end;
+	}
+
+	const auto size = input.size();
+
+	// Partitions.
+	const auto partition_count = (uint32_t) ((size + const_partition_size - 1) / const_partition_size);
+	std::vector<uint32_t> partition_of(size);
+
+	m_partitions.resize(partition_count);
+
+	for (size_t i = 0; i < size; ++i) {
+		partition_of[i] = fast_range((uint32_t) (hashes[i] >> 32), partition_count);
+		++m_partitions[partition_of[i]].m_size;
+	}
+
+	std::vector<size_t> partition_first(partition_count + 1, 0);
+	size_t buckets = 0;
+	size_t remaps = 0;
+
+	for (uint32_t i = 0; i < partition_count; ++i) {
+		auto& partition = m_partitions[i];
+
+		partition.m_value_offset = partition_first[i];
+		partition.m_bucket_offset = buckets;
+		partition.m_remap_offset = remaps;
+		partition.m_bucket_count = (partition.m_size + const_bucket_size - 1) / const_bucket_size;
+		partition.m_table_size = std::max(partition.m_size, (uint32_t) (partition.m_size / const_load_factor));
+
+		partition_first[i + 1] = partition_first[i] + partition.m_size;
+		buckets += partition.m_bucket_count;
+		remaps += partition.m_table_size - partition.m_size;
+	}
+
+	// Indexes of the input grouped by partition.
+	std::vector<size_t> grouped(size);
+	{
+		std::vector<size_t> positions(partition_first.begin(), partition_first.end() - 1);
+		for (size_t i = 0; i < size; ++i) {
+			grouped[positions[partition_of[i]]++] = i;
+		}
+	}
+
+	m_pilots.assign(buckets, 0);
+	m_remap.assign(remaps, 0);
+
+	// Final slot of each input element.
+	std::vector<size_t> slots(size);
+	std::atomic<uint32_t> next_partition(0);
+	std::atomic<bool> failed(false);
+
+	if (threads > partition_count) {
+		threads = partition_count;
+	}
+
+	// The first exception thrown by a worker is rethrown after all workers end.
+	std::vector<std::exception_ptr> errors(threads);
+
+	auto worker = [&](size_t thread) {
+		try {
+			std::vector<uint64_t> partition_hashes;
+			std::vector<uint32_t> positions;
+
+			while (!failed.load(std::memory_order_relaxed)) {
+				const auto index = next_partition.fetch_add(1);
+				if (index >= partition_count) {
+					break;
+				}
+
+				auto& partition = m_partitions[index];
+				const auto begin = partition_first[index];
+
+				partition_hashes.resize(partition.m_size);
+				for (uint32_t k = 0; k < partition.m_size; ++k) {
+					partition_hashes[k] = hashes[grouped[begin + k]];
+				}
+
+				if (!build_partition(partition_hashes, partition,
+						m_pilots.empty() ? 0 : &m_pilots[partition.m_bucket_offset],
+						m_remap.empty() ? 0 : &m_remap[partition.m_remap_offset], positions)) {
+					failed.store(true);
+					break;
+				}
+
+				for (uint32_t k = 0; k < partition.m_size; ++k) {
+					slots[grouped[begin + k]] = begin + positions[k];
+				}
+			}
+		}
+		catch (...) {
+			errors[thread] = std::current_exception();
+			failed.store(true);
+		}
+	};
+
+	// Partitions are taken one by one, so the calling thread does the rest
+	// if a thread could not be started.
+	std::vector<std::thread> workers;
+	workers.reserve(threads);
+
+	try {
+		for (size_t i = 1; i < threads; ++i) {
+			workers.push_back(std::thread(worker, i));
+		}
+	}
+	catch (...) {
+	}
+
+	worker(0);
+
+	for (auto it = workers.begin(); it != workers.end(); ++it) {
+		(*it).join();
+	}
+
+	for (auto it = errors.begin(); it != errors.end(); ++it) {
+		if (*it) {
+			this->clear();
+			std::rethrow_exception(*it);
+		}
+	}
+
+	if (failed.load()) {
+		this->clear();
+		return false;
+	}
+
+	// Place values by slot.
+	std::vector<size_t> order(size);
+	for (size_t i = 0; i < size; ++i) {
+		order[slots[i]] = i;
+	}
+
+	m_values.reserve(size + overflow.size());
+	for (size_t i = 0; i < size; ++i) {
+		m_values.push_back(std::move(input[order[i]]));
+	}
+
+	for (size_t i = 0; i < overflow.size(); ++i) {
+		m_overflow[i].second += size;
+		m_values.push_back(std::move(overflow[i]));
+	}
+
+	return true;
+}
+
+template <class Key, class T, class KeyTraits>
+template <class K>
+inline const T* perfect_hash_map_t<Key, T, KeyTraits>::find_i(const K& key) const {
+	using namespace perfect_hash_map__;
+
+	if (m_values.empty()) {
+		return 0;
+	}
+
+	const auto hash = mix((uint64_t) m_key_traits.hash(key));
+	const auto& partition = m_partitions[fast_range((uint32_t) (hash >> 32), (uint32_t) m_partitions.size())];
+
+	if (partition.m_size == 0) {
+		return 0;
+	}
+
+	const auto key_hash = mix(hash ^ partition.m_seed_value);
+	const auto bucket = fast_range((uint32_t) (key_hash >> 32), partition.m_bucket_count);
+	auto pos = position(key_hash, m_pilots[partition.m_bucket_offset + bucket], partition.m_table_size);
+
+	if (pos >= partition.m_size) {
+		pos = m_remap[partition.m_remap_offset + pos - partition.m_size];
+	}
+
+	const auto& value = m_values[partition.m_value_offset + pos];
+	if (m_key_traits.equal(value.first, key)) {
+		return &value.second;
+	}
+
+	// Keys sharing the hash value.
+	for (auto it = std::lower_bound(m_overflow.begin(), m_overflow.end(), std::make_pair(hash, size_t(0)));
+		it != m_overflow.end() && (*it).first == hash; ++it) {
+		const auto& another = m_values[(*it).second];
+
+		if (m_key_traits.equal(another.first, key)) {
+			return &another.second;
+		}
+	}
+
+	return 0;
+}
+
+} // namespace algo
@@ -0,0 +1,902 @@
+/**
+ * Persistent Red-Black Tree.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/rbtree.h"
+#include <assert.h>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+namespace algo {
+
+
+// Persistent Red-Black Tree internal implementation
+namespace persistent_rbtree__ {
+
+	// Tree node. Nodes are shared by tree versions, so they have
+	// no parent pointers, and are never changed once linked.
+	template <class T>
+	struct node_t {
+		template <class... Args>
+		node_t(node_t* left, node_t* right, bool black, Args&&... args)
+			: m_refs(1), m_left(left), m_right(right), m_value(std::forward<Args>(args)...), m_black(black) {
+		}
+
+		// Number of parents & trees holding the node.
+		std::atomic<size_t> m_refs;
+
+		node_t* m_left;
+		node_t* m_right;
+		T m_value;
+		bool m_black;
+	};
+
+	// Iterator keeping the path from the root, since nodes have no parent pointers.
+	template <class T, class Node>
+	class iterator_t : public std::iterator<
+			std::forward_iterator_tag,
+			T, std::ptrdiff_t, const T*, const T&> {
+	private:
+		typedef iterator_t<T, Node> self_type;
+
+	public:
+		iterator_t() {
+		}
+
+		// "path" has the current node at the end, after ancestors
+		// whose left subtrees have it, i.e. the next ones in order.
+		explicit iterator_t(std::vector<const Node*>&& path) : m_path(std::move(path)) {
+		}
+
+		const T& operator*() const {
+			assert(!m_path.empty());
+
+			return m_path.back()->m_value;
+		}
+
+		const T* operator->() const {
+			assert(!m_path.empty());
+
+			return &m_path.back()->m_value;
+		}
+
+		self_type& operator++() {
+			assert(!m_path.empty());
+
+			auto ptr = m_path.back()->m_right;
+			m_path.pop_back();
+
+			for (; ptr != 0; ptr = ptr->m_left) {
+				m_path.push_back(ptr);
+			}
+
+			return *this;
+		}
+
+		self_type operator++(int) {
+			const self_type old(*this);
+			this->operator++();
+			return old;
+		}
+
+		bool operator==(const self_type& it) const {
+			return this->get_node_ptr__() == it.get_node_ptr__();
+		}
+
+		bool operator!=(const self_type& it) const {
+			return !this->operator==(it);
+		}
+
+		const Node* get_node_ptr__() const {
+			return m_path.empty() ? 0 : m_path.back();
+		}
+
+	private:
+		std::vector<const Node*> m_path;
+	};
+
+} // namespace persistent_rbtree__
+
+
+/**
+ * Persistent Red-Black Tree.
+ *
+ * Nodes are never changed once linked. insert() and erase() copy the
+ * O(log n) nodes on the path from the root to the change (plus a few
+ * for rebalancing), and share all other nodes with older versions by
+ * reference counting. So snapshot() is O(1), and a snapshot never sees
+ * later changes of the tree. Nodes are freed when the last version
+ * holding them is changed or destroyed.
+ *
+ * Reference counts are atomic, so snapshots could be read, copied and
+ * destroyed by other threads without locks while the tree is changed.
+ * One tree object must not be changed and accessed by different threads
+ * at the same time, like other containers.
+ *
+ * The path is rebuilt bottom-up by joining copied values with untouched
+ * sibling subtrees, like rbtree_t::split() & join(). If copying a value
+ * or allocating throws, the tree is not changed.
+ */
+template <class T, class Compare = std::less<T>, class Allocator = std::allocator<T>>
+class persistent_rbtree_t {
+private:
+	typedef persistent_rbtree_t<T, Compare, Allocator> self_type;
+	typedef persistent_rbtree__::node_t<T> node_type;
+	typedef rbtree__::subtree_t<node_type> subtree_type;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<node_type> node_allocator_type;
+	typedef std::allocator_traits<node_allocator_type> node_allocator_traits;
+
+public:
+	typedef Compare key_compare;
+	typedef Compare value_compare;
+	typedef Allocator allocator_type;
+	typedef T key_type;
+	typedef T value_type;
+	typedef const value_type& reference;
+	typedef const value_type& const_reference;
+	typedef size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const value_type* pointer;
+	typedef const value_type* const_pointer;
+
+	// Values could not be changed in place, since they may be shared.
+	typedef persistent_rbtree__::iterator_t<value_type, node_type> const_iterator;
+	typedef const_iterator iterator;
+
+public:
+	persistent_rbtree_t() : persistent_rbtree_t(Compare()) {
+	}
+
+	explicit persistent_rbtree_t(const Compare& less, const Allocator& allocator = Allocator())
+		: m_root(0), m_black_height(0), m_size(0), m_less(less), m_allocator(allocator) {
+	}
+
+	// It's O(1), all nodes are shared.
+	persistent_rbtree_t(const self_type& another)
+		: m_root(acquire_i(another.m_root)), m_black_height(another.m_black_height),
+		m_size(another.m_size), m_less(another.m_less), m_allocator(another.m_allocator) {
+	}
+
+	persistent_rbtree_t(self_type&& another)
+		: m_root(another.m_root), m_black_height(another.m_black_height),
+		m_size(another.m_size), m_less(another.m_less), m_allocator(another.m_allocator) {
+		another.m_root = 0;
+		another.m_black_height = 0;
+		another.m_size = 0;
+	}
+
+	persistent_rbtree_t(std::initializer_list<T> list, const Compare& less = Compare(),
+		const Allocator& allocator = Allocator())
+		: persistent_rbtree_t(less, allocator) {
+		this->insert(list);
+	}
+
+	~persistent_rbtree_t() {
+		this->release_i(m_root);
+	}
+
+	size_t size() const {
+		return this->m_size;
+	}
+
+	size_t max_size() const {
+		return size_t(-1);
+	}
+
+	bool empty() const {
+		return this->m_size == 0;
+	}
+
+	// Nodes shared by snapshots are kept by them.
+	void clear() {
+		this->release_i(m_root);
+		m_root = 0;
+		m_black_height = 0;
+		m_size = 0;
+	}
+
+	key_compare key_comp() const {
+		return this->m_less;
+	}
+
+	value_compare value_comp() const {
+		return this->m_less;
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type(this->m_allocator);
+	}
+
+	/**
+	 * Immutable version of the tree in O(1).
+	 *
+	 * The tree and the snapshot share all nodes, later changes of either
+	 * of them copy the changed paths only. The snapshot could be given to
+	 * other threads, e.g. readers of an index updated by one writer.
+	 */
+	self_type snapshot() const;
+
+	const_iterator find(const T& value) const;
+	size_t count(const T& value) const;
+
+	// The first element which is not less than "value".
+	const_iterator lower_bound(const T& value) const;
+
+	// The first element which is greater than "value".
+	const_iterator upper_bound(const T& value) const;
+
+	/**
+	 * Insert a value, O(log n) nodes are created.
+	 *
+	 * @return False if an equal value exists, and the tree is not changed.
+	 */
+	bool insert(const T& value);
+	bool insert(T&& value);
+	void insert(std::initializer_list<T> list);
+
+	template <class Iterator>
+	void insert(Iterator first, Iterator last);
+
+	// Erase the element equal to "value", O(log n) nodes are created.
+	size_t erase(const T& value);
+
+	// Iterators stay valid while the version they come from is alive,
+	// i.e. the tree is not changed, or a snapshot of it is kept.
+	const_iterator begin() const;
+	const_iterator end() const;
+
+	// Number of nodes on the longest path from the root to a leaf, it's O(n).
+	size_t height() const;
+
+	// Check Red-Black properties, the order of values and the size, it's O(n).
+	bool check_invariants() const;
+
+	self_type& operator=(const self_type& another);
+	self_type& operator=(self_type&& another);
+	self_type& operator=(std::initializer_list<T> list);
+	self_type& swap(self_type& another);
+
+private:
+	// Reference to a node, released unless it's given away.
+	class holder_t {
+	public:
+		holder_t(self_type* tree, node_type* node_ptr) : m_tree(tree), m_node_ptr(node_ptr) {
+		}
+
+		~holder_t() {
+			m_tree->release_i(m_node_ptr);
+		}
+
+		node_type* release() {
+			const auto node_ptr = m_node_ptr;
+			m_node_ptr = 0;
+			return node_ptr;
+		}
+
+	private:
+		holder_t(const holder_t&) = delete;
+		holder_t& operator=(const holder_t&) = delete;
+
+		self_type* m_tree;
+		node_type* m_node_ptr;
+	};
+
+	// Functions below take references to nodes of "subtree_type" arguments
+	// (released even if they throw), unless the argument is "const", and
+	// return new references. Only new nodes and nodes which no one else
+	// holds are changed.
+
+	static node_type* acquire_i(node_type* node_ptr);
+	void release_i(node_type* node_ptr);
+
+	template <class... Args>
+	node_type* new_node_i(node_type* left, node_type* right, bool black, Args&&... args);
+
+	subtree_type blacken_i(subtree_type tree);
+
+	template <class V>
+	subtree_type join_i(subtree_type left, V&& value, subtree_type right);
+
+	template <class V>
+	node_type* join_right_i(subtree_type left, V&& value, subtree_type right);
+
+	template <class V>
+	node_type* join_left_i(subtree_type left, V&& value, subtree_type right);
+
+	subtree_type join_i(subtree_type left, subtree_type right);
+	subtree_type split_last_i(subtree_type tree, node_type*& last);
+
+	template <class V>
+	bool insert_value_i(V&& value);
+
+	template <class V>
+	subtree_type insert_i(const subtree_type& tree, V&& value, bool& inserted);
+
+	subtree_type erase_i(const subtree_type& tree, const T& value, bool& erased);
+	void replace_root_i(subtree_type tree, size_t size);
+
+	static size_t height_i(const node_type* node_ptr);
+	size_t black_height_i(const node_type* node_ptr, const node_type*& prev, size_t& count) const;
+
+private:
+	node_type* m_root;
+
+	// Number of black nodes on every path from the root down to a leaf.
+	size_t m_black_height;
+
+	size_t m_size;
+	Compare m_less;
+	node_allocator_type m_allocator;
+};
+
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::self_type persistent_rbtree_t<T, Compare, Allocator>::snapshot() const {
+	return *this;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::const_iterator persistent_rbtree_t<T, Compare, Allocator>::find(const T& value) const {
+	const auto it = this->lower_bound(value);
+
+	if (it == this->end() || this->m_less(value, *it)) {
+		return this->end();
+	}
+
+	return it;
+}
+
+template <class T, class Compare, class Allocator>
+inline size_t persistent_rbtree_t<T, Compare, Allocator>::count(const T& value) const {
+	for (const node_type* ptr = m_root; ptr != 0;) {
+		if (this->m_less(value, ptr->m_value)) {
+			ptr = ptr->m_left;
+		}
+		else if (this->m_less(ptr->m_value, value)) {
+			ptr = ptr->m_right;
+		}
+		else {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::const_iterator persistent_rbtree_t<T, Compare, Allocator>::lower_bound(const T& value) const {
+	std::vector<const node_type*> path;
+	path.reserve(m_black_height * 2);
+
+	for (const node_type* ptr = m_root; ptr != 0;) {
+		if (this->m_less(ptr->m_value, value)) {
+			ptr = ptr->m_right;
+		}
+		else {
+			path.push_back(ptr);
+			ptr = ptr->m_left;
+		}
+	}
+
+	return const_iterator(std::move(path));
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::const_iterator persistent_rbtree_t<T, Compare, Allocator>::upper_bound(const T& value) const {
+	std::vector<const node_type*> path;
+	path.reserve(m_black_height * 2);
+
+	for (const node_type* ptr = m_root; ptr != 0;) {
+		if (this->m_less(value, ptr->m_value)) {
+			path.push_back(ptr);
+			ptr = ptr->m_left;
+		}
+		else {
+			ptr = ptr->m_right;
+		}
+	}
+
+	return const_iterator(std::move(path));
+}
+
+template <class T, class Compare, class Allocator>
+inline bool persistent_rbtree_t<T, Compare, Allocator>::insert(const T& value) {
+	return this->insert_value_i(value);
+}
+
+template <class T, class Compare, class Allocator>
+inline bool persistent_rbtree_t<T, Compare, Allocator>::insert(T&& value) {
+	return this->insert_value_i(std::move(value));
+}
+
+template <class T, class Compare, class Allocator>
+inline void persistent_rbtree_t<T, Compare, Allocator>::insert(std::initializer_list<T> list) {
+	this->insert(list.begin(), list.end());
+}
+
+template <class T, class Compare, class Allocator>
+template <class Iterator>
+inline void persistent_rbtree_t<T, Compare, Allocator>::insert(Iterator first, Iterator last) {
+	for (auto it = first; it != last; ++it) {
+		this->insert(*it);
+	}
+}
+
+template <class T, class Compare, class Allocator>
+inline size_t persistent_rbtree_t<T, Compare, Allocator>::erase(const T& value) {
+	bool erased = false;
+	const auto result = this->erase_i(subtree_type(m_root, m_black_height), value, erased);
+
+	if (!erased) {
+		return 0;
+	}
+
+	this->replace_root_i(result, m_size - 1);
+	return 1;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::const_iterator persistent_rbtree_t<T, Compare, Allocator>::begin() const {
+	std::vector<const node_type*> path;
+	path.reserve(m_black_height * 2);
+
+	for (const node_type* ptr = m_root; ptr != 0; ptr = ptr->m_left) {
+		path.push_back(ptr);
+	}
+
+	return const_iterator(std::move(path));
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::const_iterator persistent_rbtree_t<T, Compare, Allocator>::end() const {
+	return const_iterator();
+}
+
+template <class T, class Compare, class Allocator>
+inline size_t persistent_rbtree_t<T, Compare, Allocator>::height() const {
+	return height_i(m_root);
+}
+
+template <class T, class Compare, class Allocator>
+inline bool persistent_rbtree_t<T, Compare, Allocator>::check_invariants() const {
+	if (m_root != 0 && !m_root->m_black) {
+		return false;
+	}
+
+	const node_type* prev = 0;
+	size_t count = 0;
+
+	return this->black_height_i(m_root, prev, count) == m_black_height + 1 && count == m_size;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::self_type& persistent_rbtree_t<T, Compare, Allocator>::operator=(
+	const typename persistent_rbtree_t<T, Compare, Allocator>::self_type& another) {
+	if (this != &another) {
+		const auto root = acquire_i(another.m_root);
+
+		this->release_i(m_root);
+		m_root = root;
+		m_black_height = another.m_black_height;
+		m_size = another.m_size;
+		m_less = another.m_less;
+	}
+
+	return *this;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::self_type& persistent_rbtree_t<T, Compare, Allocator>::operator=(
+	typename persistent_rbtree_t<T, Compare, Allocator>::self_type&& another) {
+	if (this != &another) {
+		this->clear();
+		this->swap(another);
+	}
+
+	return *this;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::self_type& persistent_rbtree_t<T, Compare, Allocator>::operator=(std::initializer_list<T> list) {
+	this->clear();
+	this->insert(list);
+	return *this;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::self_type& persistent_rbtree_t<T, Compare, Allocator>::swap(
+	typename persistent_rbtree_t<T, Compare, Allocator>::self_type& another) {
+	if (this != &another) {
+		std::swap(m_root, another.m_root);
+		std::swap(m_black_height, another.m_black_height);
+		std::swap(m_size, another.m_size);
+		std::swap(m_less, another.m_less);
+		std::swap(m_allocator, another.m_allocator);
+	}
+
+	return *this;
+}
+
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::node_type* persistent_rbtree_t<T, Compare, Allocator>::acquire_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::node_type* node_ptr) {
+	if (node_ptr != 0) {
+		node_ptr->m_refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return node_ptr;
+}
+
+// The last reference frees the node, and releases its children.
+// Recursion depth is the tree height, i.e. O(log n).
+template <class T, class Compare, class Allocator>
+inline void persistent_rbtree_t<T, Compare, Allocator>::release_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::node_type* node_ptr) {
+	while (node_ptr != 0 && node_ptr->m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		const auto left = node_ptr->m_left;
+		const auto right = node_ptr->m_right;
+
+		node_allocator_traits::destroy(m_allocator, node_ptr);
+		node_allocator_traits::deallocate(m_allocator, node_ptr, 1);
+
+		this->release_i(left);
+		node_ptr = right;
+	}
+}
+
+template <class T, class Compare, class Allocator>
+template <class... Args>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::node_type* persistent_rbtree_t<T, Compare, Allocator>::new_node_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::node_type* left,
+	typename persistent_rbtree_t<T, Compare, Allocator>::node_type* right, bool black, Args&&... args) {
+	holder_t left_holder(this, left);
+	holder_t right_holder(this, right);
+
+	const auto node_ptr = node_allocator_traits::allocate(m_allocator, 1);
+
+	try {
+		node_allocator_traits::construct(m_allocator, node_ptr, left, right, black, std::forward<Args>(args)...);
+	}
+	catch (...) {
+		node_allocator_traits::deallocate(m_allocator, node_ptr, 1);
+		throw;
+	}
+
+	left_holder.release();
+	right_holder.release();
+
+	return node_ptr;
+}
+
+// A red root is turned black, it's copied if someone else holds it.
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type persistent_rbtree_t<T, Compare, Allocator>::blacken_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type tree) {
+	const auto root = tree.m_root;
+
+	if (root == 0 || root->m_black) {
+		return tree;
+	}
+
+	if (root->m_refs.load(std::memory_order_acquire) == 1) {
+		root->m_black = true;
+	}
+	else {
+		holder_t root_holder(this, root);
+		tree.m_root = this->new_node_i(acquire_i(root->m_left), acquire_i(root->m_right), true, root->m_value);
+	}
+
+	return subtree_type(tree.m_root, tree.m_black_height + 1);
+}
+
+/**
+ * Join "left" < "value" < "right" into a valid tree, whose root could be red.
+ *
+ * A new node of "value" is linked on the facing spine of the taller tree,
+ * where the black height is the other tree's, and spine nodes above it are
+ * copied and rebalanced on the way back. So it's O(difference of black heights).
+ */
+template <class T, class Compare, class Allocator>
+template <class V>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type persistent_rbtree_t<T, Compare, Allocator>::join_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type left, V&& value,
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type right) {
+	// The lower tree must have a black root, it becomes a child of a red node.
+	if (left.m_black_height > right.m_black_height) {
+		holder_t left_holder(this, left.m_root);
+		right = this->blacken_i(right);
+		left_holder.release();
+	}
+	else if (left.m_black_height < right.m_black_height) {
+		holder_t right_holder(this, right.m_root);
+		left = this->blacken_i(left);
+		right_holder.release();
+	}
+
+	if (left.m_black_height == right.m_black_height) {
+		const auto black = (left.m_root != 0 && !left.m_root->m_black) || (right.m_root != 0 && !right.m_root->m_black);
+		const auto root = this->new_node_i(left.m_root, right.m_root, black, std::forward<V>(value));
+
+		return subtree_type(root, left.m_black_height + (black ? 1 : 0));
+	}
+
+	const auto taller_left = left.m_black_height > right.m_black_height;
+	const auto root = taller_left ? this->join_right_i(left, std::forward<V>(value), right)
+		: this->join_left_i(left, std::forward<V>(value), right);
+	const auto child = taller_left ? root->m_right : root->m_left;
+	auto height = taller_left ? left.m_black_height : right.m_black_height;
+
+	// A new red root with a red child.
+	if (!root->m_black && child != 0 && !child->m_black) {
+		root->m_black = true;
+		++height;
+	}
+
+	return subtree_type(root, height);
+}
+
+template <class T, class Compare, class Allocator>
+template <class V>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::node_type* persistent_rbtree_t<T, Compare, Allocator>::join_right_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type left, V&& value,
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type right) {
+	const auto root = left.m_root;
+
+	if (left.m_black_height == right.m_black_height && (root == 0 || root->m_black)) {
+		return this->new_node_i(root, right.m_root, false, std::forward<V>(value));
+	}
+
+	holder_t root_holder(this, root);
+
+	const auto height = left.m_black_height - (root->m_black ? 1 : 0);
+	const auto child = this->join_right_i(subtree_type(acquire_i(root->m_right), height), std::forward<V>(value), right);
+	const auto copy = this->new_node_i(acquire_i(root->m_left), child, root->m_black, root->m_value);
+
+	// Two red nodes below a black one, rotate left. All of them are new.
+	if (copy->m_black && !child->m_black && child->m_right != 0 && !child->m_right->m_black) {
+		child->m_right->m_black = true;
+		copy->m_right = child->m_left;
+		child->m_left = copy;
+
+		return child;
+	}
+
+	return copy;
+}
+
+template <class T, class Compare, class Allocator>
+template <class V>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::node_type* persistent_rbtree_t<T, Compare, Allocator>::join_left_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type left, V&& value,
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type right) {
+	const auto root = right.m_root;
+
+	if (left.m_black_height == right.m_black_height && (root == 0 || root->m_black)) {
+		return this->new_node_i(left.m_root, root, false, std::forward<V>(value));
+	}
+
+	holder_t root_holder(this, root);
+
+	const auto height = right.m_black_height - (root->m_black ? 1 : 0);
+	const auto child = this->join_left_i(left, std::forward<V>(value), subtree_type(acquire_i(root->m_left), height));
+	const auto copy = this->new_node_i(child, acquire_i(root->m_right), root->m_black, root->m_value);
+
+	// Two red nodes below a black one, rotate right. All of them are new.
+	if (copy->m_black && !child->m_black && child->m_left != 0 && !child->m_left->m_black) {
+		child->m_left->m_black = true;
+		copy->m_left = child->m_right;
+		child->m_right = copy;
+
+		return child;
+	}
+
+	return copy;
+}
+
+// Join "left" < "right", the biggest value of "left" is taken out to be the middle.
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type persistent_rbtree_t<T, Compare, Allocator>::join_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type left,
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type right) {
+	if (left.m_root == 0) {
+		return right;
+	}
+
+	if (right.m_root == 0) {
+		return left;
+	}
+
+	holder_t right_holder(this, right.m_root);
+
+	node_type* last = 0;
+	const auto rest = this->split_last_i(left, last);
+	holder_t last_holder(this, last);
+
+	right_holder.release();
+	return this->join_i(rest, last->m_value, right);
+}
+
+// Take the biggest node out of "tree", the reference to it is given by "last".
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type persistent_rbtree_t<T, Compare, Allocator>::split_last_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type tree,
+	typename persistent_rbtree_t<T, Compare, Allocator>::node_type*& last) {
+	const auto root = tree.m_root;
+	const auto height = tree.m_black_height - (root->m_black ? 1 : 0);
+	holder_t root_holder(this, root);
+
+	if (root->m_right == 0) {
+		last = root_holder.release();
+		return subtree_type(acquire_i(root->m_left), height);
+	}
+
+	node_type* last_ptr = 0;
+	const auto rest = this->split_last_i(subtree_type(acquire_i(root->m_right), height), last_ptr);
+	holder_t last_holder(this, last_ptr);
+
+	const auto result = this->join_i(subtree_type(acquire_i(root->m_left), height), root->m_value, rest);
+	last = last_holder.release();
+
+	return result;
+}
+
+template <class T, class Compare, class Allocator>
+template <class V>
+inline bool persistent_rbtree_t<T, Compare, Allocator>::insert_value_i(V&& value) {
+	bool inserted = false;
+	const auto result = this->insert_i(subtree_type(m_root, m_black_height), std::forward<V>(value), inserted);
+
+	if (inserted) {
+		this->replace_root_i(result, m_size + 1);
+	}
+
+	return inserted;
+}
+
+// Recursion depth is the tree height, i.e. O(log n).
+template <class T, class Compare, class Allocator>
+template <class V>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type persistent_rbtree_t<T, Compare, Allocator>::insert_i(
+	const typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type& tree, V&& value, bool& inserted) {
+	const auto root = tree.m_root;
+
+	if (root == 0) {
+		inserted = true;
+		return subtree_type(this->new_node_i(0, 0, false, std::forward<V>(value)), 0);
+	}
+
+	const auto height = tree.m_black_height - (root->m_black ? 1 : 0);
+
+	if (this->m_less(value, root->m_value)) {
+		const auto left = this->insert_i(subtree_type(root->m_left, height), std::forward<V>(value), inserted);
+
+		if (inserted) {
+			return this->join_i(left, root->m_value, subtree_type(acquire_i(root->m_right), height));
+		}
+	}
+	else if (this->m_less(root->m_value, value)) {
+		const auto right = this->insert_i(subtree_type(root->m_right, height), std::forward<V>(value), inserted);
+
+		if (inserted) {
+			return this->join_i(subtree_type(acquire_i(root->m_left), height), root->m_value, right);
+		}
+	}
+
+	return subtree_type();
+}
+
+// Recursion depth is the tree height, i.e. O(log n).
+template <class T, class Compare, class Allocator>
+inline typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type persistent_rbtree_t<T, Compare, Allocator>::erase_i(
+	const typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type& tree, const T& value, bool& erased) {
+	const auto root = tree.m_root;
+
+	if (root == 0) {
+		return subtree_type();
+	}
+
+	const auto height = tree.m_black_height - (root->m_black ? 1 : 0);
+
+	if (this->m_less(value, root->m_value)) {
+		const auto left = this->erase_i(subtree_type(root->m_left, height), value, erased);
+
+		if (erased) {
+			return this->join_i(left, root->m_value, subtree_type(acquire_i(root->m_right), height));
+		}
+	}
+	else if (this->m_less(root->m_value, value)) {
+		const auto right = this->erase_i(subtree_type(root->m_right, height), value, erased);
+
+		if (erased) {
+			return this->join_i(subtree_type(acquire_i(root->m_left), height), root->m_value, right);
+		}
+	}
+	else {
+		erased = true;
+		return this->join_i(subtree_type(acquire_i(root->m_left), height), subtree_type(acquire_i(root->m_right), height));
+	}
+
+	return subtree_type();
+}
+
+// Replace the root by a new version, the old one is released.
+template <class T, class Compare, class Allocator>
+inline void persistent_rbtree_t<T, Compare, Allocator>::replace_root_i(
+	typename persistent_rbtree_t<T, Compare, Allocator>::subtree_type tree, size_t size) {
+	tree = this->blacken_i(tree);
+
+	this->release_i(m_root);
+	m_root = tree.m_root;
+	m_black_height = tree.m_black_height;
+	m_size = size;
+}
+
+template <class T, class Compare, class Allocator>
+inline size_t persistent_rbtree_t<T, Compare, Allocator>::height_i(
+	const typename persistent_rbtree_t<T, Compare, Allocator>::node_type* node_ptr) {
+	if (node_ptr == 0) {
+		return 0;
+	}
+
+	const auto left = height_i(node_ptr->m_left);
+	const auto right = height_i(node_ptr->m_right);
+
+	return (left > right ? left : right) + 1;
+}
+
+// Black height of a subtree (counting the null leaf), or 0 if it's invalid.
+// Nodes are visited in order, "prev" is the last one and "count" is increased.
+template <class T, class Compare, class Allocator>
+inline size_t persistent_rbtree_t<T, Compare, Allocator>::black_height_i(
+	const typename persistent_rbtree_t<T, Compare, Allocator>::node_type* node_ptr,
+	const typename persistent_rbtree_t<T, Compare, Allocator>::node_type*& prev, size_t& count) const {
+	if (node_ptr == 0) {
+		return 1;
+	}
+
+	const auto left = node_ptr->m_left;
+	const auto right = node_ptr->m_right;
+
+	if (node_ptr->m_refs.load() == 0
+		|| (!node_ptr->m_black && ((left != 0 && !left->m_black) || (right != 0 && !right->m_black)))) {
+		return 0;
+	}
+
+	const auto left_height = this->black_height_i(left, prev, count);
+
+	if (prev != 0 && !this->m_less(prev->m_value, node_ptr->m_value)) {
+		return 0;
+	}
+
+	prev = node_ptr;
+	++count;
+
+	if (left_height == 0 || left_height != this->black_height_i(right, prev, count)) {
+		return 0;
+	}
+
+	return left_height + (node_ptr->m_black ? 1 : 0);
+}
+
+} // namespace algo
+
+
+namespace std {
+
+// Override std::swap() to offer better performance.
+template <class T, class Compare, class Allocator>
+inline void swap(algo::persistent_rbtree_t<T, Compare, Allocator>& v1, algo::persistent_rbtree_t<T, Compare, Allocator>& v2) {
+	v1.swap(v2);
+}
+
+}
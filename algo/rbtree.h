@@ -7,11 +7,19 @@
 #pragma once
 
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <functional>
 #include <iterator>
 #include <initializer_list>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <thread>
 #include <utility>
 #include <type_traits>
+#include <vector>
 
 
 namespace algo {
@@ -20,10 +28,26 @@ namespace algo {
 // Red-Black Tree internal implementation
 namespace rbtree__ {
 
+	// Node base without augmented data, it takes no space.
+	struct no_augment_t {
+	};
+
+	// Node base with the size of the subtree rooted at the node.
+	struct subtree_size_t {
+		subtree_size_t() : m_subtree_size(1) {
+		}
+
+		size_t m_subtree_size;
+	};
+
+	// Tag of constructing a node value in place.
+	struct emplace_t {
+	};
+
 	// Tree node.
-	template <class T>
-	struct node_t {
-		typedef node_t<T> self_type;
+	template <class T, class Base = no_augment_t>
+	struct node_t : public Base {
+		typedef node_t<T, Base> self_type;
 		typedef T value_type;
 
 		explicit node_t(const T& value)
@@ -34,6 +58,11 @@ namespace rbtree__ {
 			: m_parent(0), m_left(0), m_right(0), m_value(std::move(value)), m_black(false) {
 		}
 
+		template <class... Args>
+		node_t(const emplace_t&, Args&&... args)
+			: m_parent(0), m_left(0), m_right(0), m_value(std::forward<Args>(args)...), m_black(false) {
+		}
+
 		self_type* m_parent;
 		self_type* m_left;
 		self_type* m_right;
@@ -59,27 +88,485 @@ namespace rbtree__ {
 	};
 
 	// Finding result.
-	template <class T>
+	template <class Node>
 	struct find_t {
 		find_t() : m_node_ptr(0), m_result(find_result_no_root) {}
+		find_t(Node* node_ptr, find_result_t result) : m_node_ptr(node_ptr), m_result(result) {}
 
-		node_t<T>* m_node_ptr;
+		Node* m_node_ptr;
 		find_result_t m_result;
 	};
 
+	// Augmented data of nodes deriving from subtree_size_t is maintained
+	// by the primitives below, other nodes pay nothing.
+	template <class Node>
+	struct is_size_augmented_t : std::is_base_of<subtree_size_t, Node> {
+	};
+
+	template <class Node>
+	inline size_t subtree_size(const Node* node_ptr) {
+		return node_ptr == 0 ? 0 : node_ptr->m_subtree_size;
+	}
+
+	// "upper" has been rotated above "lower", its former parent.
+	template <class Node>
+	inline void augment_after_rotate(Node* lower, Node* upper, const std::false_type&) {
+	}
+
+	template <class Node>
+	inline void augment_after_rotate(Node* lower, Node* upper, const std::true_type&) {
+		upper->m_subtree_size = lower->m_subtree_size;
+		lower->m_subtree_size = subtree_size(lower->m_left) + subtree_size(lower->m_right) + 1;
+	}
+
+	// "node_ptr" has been linked as a leaf.
+	template <class Node>
+	inline void augment_after_link(Node* node_ptr, const std::false_type&) {
+	}
+
+	template <class Node>
+	inline void augment_after_link(Node* node_ptr, const std::true_type&) {
+		node_ptr->m_subtree_size = 1;
+
+		for (auto ptr = node_ptr->m_parent; ptr != 0; ptr = ptr->m_parent) {
+			++ptr->m_subtree_size;
+		}
+	}
+
+	// "node_ptr" is about to be unlinked. "removed" is the node leaving
+	// its position, i.e. the successor which replaces "node_ptr" if it
+	// has two children, otherwise "node_ptr" itself.
+	template <class Node>
+	inline void augment_before_erase(Node* node_ptr, Node* removed, const std::false_type&) {
+	}
+
+	template <class Node>
+	inline void augment_before_erase(Node* node_ptr, Node* removed, const std::true_type&) {
+		for (auto ptr = removed->m_parent; ptr != 0; ptr = ptr->m_parent) {
+			--ptr->m_subtree_size;
+		}
+
+		removed->m_subtree_size = node_ptr->m_subtree_size;
+	}
+
+	// "node_ptr" has been linked above its (already built) subtrees.
+	template <class Node>
+	inline void augment_after_build(Node* node_ptr, const std::false_type&) {
+	}
+
+	template <class Node>
+	inline void augment_after_build(Node* node_ptr, const std::true_type&) {
+		node_ptr->m_subtree_size = subtree_size(node_ptr->m_left) + subtree_size(node_ptr->m_right) + 1;
+	}
+
+	// "node_ptr" has been linked above two subtrees, somewhere inside a tree.
+	template <class Node>
+	inline void augment_after_join(Node* node_ptr, const std::false_type&) {
+	}
+
+	template <class Node>
+	inline void augment_after_join(Node* node_ptr, const std::true_type&) {
+		for (auto ptr = node_ptr; ptr != 0; ptr = ptr->m_parent) {
+			ptr->m_subtree_size = subtree_size(ptr->m_left) + subtree_size(ptr->m_right) + 1;
+		}
+	}
+
+	// Red-Black rebalancing primitives.
+	//
+	// They work on any node type with "m_parent", "m_left", "m_right"
+	// and "m_black" members, so other containers could use them to
+	// keep their own trees balanced (e.g. treeified hash_table_t buckets).
+	template <class Node>
+	inline void rotate_left(Node*& root, Node* node_ptr) {
+		auto right = node_ptr->m_right;
+
+		node_ptr->m_right = right->m_left;
+		if (right->m_left != 0) {
+			right->m_left->m_parent = node_ptr;
+		}
+
+		right->m_parent = node_ptr->m_parent;
+		if (node_ptr->m_parent == 0) {
+			root = right;
+		}
+		else if (node_ptr == node_ptr->m_parent->m_left) {
+			node_ptr->m_parent->m_left = right;
+		}
+		else {
+			node_ptr->m_parent->m_right = right;
+		}
+
+		right->m_left = node_ptr;
+		node_ptr->m_parent = right;
+
+		augment_after_rotate(node_ptr, right, is_size_augmented_t<Node>());
+	}
+
+	template <class Node>
+	inline void rotate_right(Node*& root, Node* node_ptr) {
+		auto left = node_ptr->m_left;
+
+		node_ptr->m_left = left->m_right;
+		if (left->m_right != 0) {
+			left->m_right->m_parent = node_ptr;
+		}
+
+		left->m_parent = node_ptr->m_parent;
+		if (node_ptr->m_parent == 0) {
+			root = left;
+		}
+		else if (node_ptr == node_ptr->m_parent->m_right) {
+			node_ptr->m_parent->m_right = left;
+		}
+		else {
+			node_ptr->m_parent->m_left = left;
+		}
+
+		left->m_right = node_ptr;
+		node_ptr->m_parent = left;
+
+		augment_after_rotate(node_ptr, left, is_size_augmented_t<Node>());
+	}
+
+	// Restore Red-Black properties after red "node_ptr" was linked above
+	// two black-balanced subtrees (e.g. null leaves). Return true if
+	// the root was turned black, i.e. the black height has grown.
+	template <class Node>
+	inline bool rebalance_after_link(Node*& root, Node* node_ptr) {
+		while (node_ptr != root && !node_ptr->m_parent->m_black) {
+			auto parent = node_ptr->m_parent;
+			auto grand = parent->m_parent;
+
+			if (parent == grand->m_left) {
+				auto uncle = grand->m_right;
+
+				if (uncle != 0 && !uncle->m_black) {
+					parent->m_black = true;
+					uncle->m_black = true;
+					grand->m_black = false;
+					node_ptr = grand;
+				}
+				else {
+					if (node_ptr == parent->m_right) {
+						node_ptr = parent;
+						rotate_left(root, node_ptr);
+						parent = node_ptr->m_parent;
+					}
+
+					parent->m_black = true;
+					grand->m_black = false;
+					rotate_right(root, grand);
+				}
+			}
+			else {
+				auto uncle = grand->m_left;
+
+				if (uncle != 0 && !uncle->m_black) {
+					parent->m_black = true;
+					uncle->m_black = true;
+					grand->m_black = false;
+					node_ptr = grand;
+				}
+				else {
+					if (node_ptr == parent->m_left) {
+						node_ptr = parent;
+						rotate_right(root, node_ptr);
+						parent = node_ptr->m_parent;
+					}
+
+					parent->m_black = true;
+					grand->m_black = false;
+					rotate_left(root, grand);
+				}
+			}
+		}
+
+		const auto grown = !root->m_black;
+		root->m_black = true;
+
+		return grown;
+	}
+
+	// Restore Red-Black properties after "node_ptr" was linked as a leaf.
+	template <class Node>
+	inline void rebalance_after_insert(Node*& root, Node* node_ptr) {
+		augment_after_link(node_ptr, is_size_augmented_t<Node>());
+		node_ptr->m_black = false;
+
+		rebalance_after_link(root, node_ptr);
+	}
+
+	// Unlink "node_ptr" from the tree and restore Red-Black properties.
+	template <class Node>
+	inline void erase_and_rebalance(Node*& root, Node* node_ptr) {
+		Node* removed = node_ptr;
+		Node* child = 0;
+		Node* child_parent = 0;
+
+		if (node_ptr->m_left == 0) {
+			child = node_ptr->m_right;
+		}
+		else if (node_ptr->m_right == 0) {
+			child = node_ptr->m_left;
+		}
+		else {
+			removed = node_ptr->m_right;
+			while (removed->m_left != 0) {
+				removed = removed->m_left;
+			}
+			child = removed->m_right;
+		}
+
+		augment_before_erase(node_ptr, removed, is_size_augmented_t<Node>());
+
+		if (removed != node_ptr) {
+			// Move the successor ("removed") to the place of "node_ptr".
+			node_ptr->m_left->m_parent = removed;
+			removed->m_left = node_ptr->m_left;
+
+			if (removed != node_ptr->m_right) {
+				child_parent = removed->m_parent;
+				if (child != 0) {
+					child->m_parent = child_parent;
+				}
+
+				child_parent->m_left = child;
+				removed->m_right = node_ptr->m_right;
+				node_ptr->m_right->m_parent = removed;
+			}
+			else {
+				child_parent = removed;
+			}
+
+			if (node_ptr->m_parent == 0) {
+				root = removed;
+			}
+			else if (node_ptr == node_ptr->m_parent->m_left) {
+				node_ptr->m_parent->m_left = removed;
+			}
+			else {
+				node_ptr->m_parent->m_right = removed;
+			}
+
+			removed->m_parent = node_ptr->m_parent;
+
+			const auto black = removed->m_black;
+			removed->m_black = node_ptr->m_black;
+			node_ptr->m_black = black;
+		}
+		else {
+			child_parent = node_ptr->m_parent;
+			if (child != 0) {
+				child->m_parent = child_parent;
+			}
+
+			if (node_ptr->m_parent == 0) {
+				root = child;
+			}
+			else if (node_ptr == node_ptr->m_parent->m_left) {
+				node_ptr->m_parent->m_left = child;
+			}
+			else {
+				node_ptr->m_parent->m_right = child;
+			}
+		}
+
+		// Removing a red node does not change any black height.
+		if (!node_ptr->m_black) {
+			return;
+		}
+
+		while (child != root && (child == 0 || child->m_black)) {
+			if (child == child_parent->m_left) {
+				auto sibling = child_parent->m_right;
+
+				if (!sibling->m_black) {
+					sibling->m_black = true;
+					child_parent->m_black = false;
+					rotate_left(root, child_parent);
+					sibling = child_parent->m_right;
+				}
+
+				if ((sibling->m_left == 0 || sibling->m_left->m_black)
+					&& (sibling->m_right == 0 || sibling->m_right->m_black)) {
+					sibling->m_black = false;
+					child = child_parent;
+					child_parent = child_parent->m_parent;
+				}
+				else {
+					if (sibling->m_right == 0 || sibling->m_right->m_black) {
+						sibling->m_left->m_black = true;
+						sibling->m_black = false;
+						rotate_right(root, sibling);
+						sibling = child_parent->m_right;
+					}
+
+					sibling->m_black = child_parent->m_black;
+					child_parent->m_black = true;
+					if (sibling->m_right != 0) {
+						sibling->m_right->m_black = true;
+					}
+					rotate_left(root, child_parent);
+					break;
+				}
+			}
+			else {
+				auto sibling = child_parent->m_left;
+
+				if (!sibling->m_black) {
+					sibling->m_black = true;
+					child_parent->m_black = false;
+					rotate_right(root, child_parent);
+					sibling = child_parent->m_left;
+				}
+
+				if ((sibling->m_right == 0 || sibling->m_right->m_black)
+					&& (sibling->m_left == 0 || sibling->m_left->m_black)) {
+					sibling->m_black = false;
+					child = child_parent;
+					child_parent = child_parent->m_parent;
+				}
+				else {
+					if (sibling->m_left == 0 || sibling->m_left->m_black) {
+						sibling->m_right->m_black = true;
+						sibling->m_black = false;
+						rotate_left(root, sibling);
+						sibling = child_parent->m_left;
+					}
+
+					sibling->m_black = child_parent->m_black;
+					child_parent->m_black = true;
+					if (sibling->m_left != 0) {
+						sibling->m_left->m_black = true;
+					}
+					rotate_right(root, child_parent);
+					break;
+				}
+			}
+		}
+
+		if (child != 0) {
+			child->m_black = true;
+		}
+	}
+
+	// A destroyed node, waiting to be reused.
+	struct free_slot_t {
+		free_slot_t* m_next;
+	};
+
+	// Chunk header, it takes the first node slot of every chunk.
+	struct chunk_t {
+		chunk_t* m_next;
+
+		// Number of node slots, including the header.
+		size_t m_slots;
+	};
+
+	// Chunks shared by trees. Nodes move between trees by split(), join()
+	// and set operations, but never between chunks, so every tree keeps
+	// the arenas of its nodes, and the last one leaving an arena gives its
+	// chunks back. New chunks are only added to arenas used by one tree,
+	// so trees sharing arenas could still be used by different threads.
+	template <class NodeAllocator>
+	struct arena_t {
+		explicit arena_t(const NodeAllocator& allocator)
+			: m_chunks(0), m_users(1), m_allocator(allocator) {
+		}
+
+		chunk_t* m_chunks;
+		std::atomic<size_t> m_users;
+		NodeAllocator m_allocator;
+	};
+
+	// Detached subtree, the root could be red.
+	template <class Node>
+	struct subtree_t {
+		subtree_t() : m_root(0), m_black_height(0) {}
+		subtree_t(Node* root, size_t black_height) : m_root(root), m_black_height(black_height) {}
+
+		Node* m_root;
+
+		// Number of black nodes on every path from the root down to a leaf.
+		size_t m_black_height;
+	};
+
+	// Detached subtrees, linked by the "m_parent" of their roots.
+	template <class Node>
+	struct subtree_list_t {
+		subtree_list_t() : m_first(0), m_last(0) {}
+
+		void push(Node* root) {
+			root->m_parent = 0;
+
+			if (m_last == 0) {
+				m_first = root;
+			}
+			else {
+				m_last->m_parent = root;
+			}
+
+			m_last = root;
+		}
+
+		void splice(subtree_list_t& another) {
+			if (another.m_first != 0) {
+				if (m_last == 0) {
+					m_first = another.m_first;
+				}
+				else {
+					m_last->m_parent = another.m_first;
+				}
+
+				m_last = another.m_last;
+				another.m_first = 0;
+				another.m_last = 0;
+			}
+		}
+
+		Node* m_first;
+		Node* m_last;
+	};
+
+	// Operations of rbtree_t::unite(), intersect() and subtract().
+	enum set_operation_t {
+		set_operation_union,
+		set_operation_intersection,
+		set_operation_difference
+	};
+
 	// Internal data container.
-	template <class T, class Compare>
+	//
+	// Nodes live in chunks taken from "Allocator" (rebound to the node type),
+	// so inserting does not call the allocator in steady state. Erased nodes
+	// are kept in a free list for later inserts, and all chunks are given
+	// back at once by clear(), which does not even walk the tree if nodes
+	// are trivially destructible. Chunks are grouped in arenas shared with
+	// trees which nodes have been moved to, see arena_t.
+	template <class T, class Compare, class Policy, class Allocator>
 	class ctner_t {
 	public:
-		typedef ctner_t<T, Compare> self_type;
+		typedef ctner_t<T, Compare, Policy, Allocator> self_type;
 		typedef T value_type;
+		typedef node_t<T, typename Policy::node_base_type> node_type;
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<node_type> node_allocator_type;
+		typedef std::allocator_traits<node_allocator_type> node_allocator_traits;
+		typedef arena_t<node_allocator_type> arena_type;
+		typedef subtree_t<node_type> subtree_type;
+		typedef subtree_list_t<node_type> subtree_list_type;
 
-	public:
-		ctner_t() : m_root(0), m_smallest(0), m_biggest(0), m_size(0) {
-		}
+		// Chunks grow from this number of nodes.
+		static const size_t const_min_chunk_nodes = 16;
+
+		// Chunks stop growing at this size.
+		static const size_t const_max_chunk_bytes = 64 * 1024;
 
-		explicit ctner_t(const Compare& less)
-			: m_root(0), m_smallest(0), m_biggest(0), m_size(0), m_less(less) {
+	public:
+		explicit ctner_t(const Compare& less = Compare(), const Allocator& allocator = Allocator())
+			: m_root(0), m_smallest(0), m_biggest(0), m_size(0),
+			m_current(0), m_end(0), m_free_slots(0),
+			m_chunk_nodes(const_min_chunk_nodes), m_less(less), m_allocator(allocator) {
+			static_assert(sizeof(chunk_t) <= sizeof(node_type), "A chunk header must fit in a node slot.");
 		}
 
 		~ctner_t() {
@@ -101,26 +588,43 @@ namespace rbtree__ {
 		void clear() {
 			assert(this->is_valid());
 
-			if (m_root == 0) {
-				return;
+			if (m_root != 0) {
+				this->destroy_i(m_root, std::is_trivially_destructible<node_type>());
+				m_root = 0;
+				m_smallest = 0;
+				m_biggest = 0;
+				this->m_size = 0;
+			}
+
+			this->release_chunks_i();
+		}
+
+		node_allocator_type get_allocator() const {
+			return m_allocator;
+		}
+
+		// Bytes of all chunks, including those shared with other trees.
+		size_t memory_bytes() const {
+			size_t result = 0;
+
+			for (auto arena : m_arenas) {
+				for (auto chunk = arena->m_chunks; chunk != 0; chunk = chunk->m_next) {
+					result += chunk->m_slots * sizeof(node_type);
+				}
 			}
 
-			this->clear_i(m_root);
-			m_root = 0;
-			m_smallest = 0;
-			m_biggest = 0;
-			this->m_size = 0;
+			return result;
 		}
 
-		node_t<T>* get_smallest() const {
+		node_type* get_smallest() const {
 			return this->m_smallest;
 		}
 
-		node_t<T>* get_biggest() const {
+		node_type* get_biggest() const {
 			return this->m_biggest;
 		}
 
-		static node_t<T>* get_smallest_i(const node_t<T>* node_ptr) {
+		static node_type* get_smallest_i(const node_type* node_ptr) {
 			if (node_ptr == 0) {
 				return 0;
 			}
@@ -130,10 +634,10 @@ namespace rbtree__ {
 				ptr = ptr->m_left;
 			}
 
-			return (node_t<T>*)ptr;
+			return (node_type*)ptr;
 		}
 
-		static node_t<T>* get_biggest_i(const node_t<T>* node_ptr) {
+		static node_type* get_biggest_i(const node_type* node_ptr) {
 			if (node_ptr == 0) {
 				return 0;
 			}
@@ -143,13 +647,13 @@ namespace rbtree__ {
 				ptr = ptr->m_right;
 			}
 
-			return (node_t<T>*)ptr;
+			return (node_type*)ptr;
 		}
 
-		static node_t<T>* next(const node_t<T>* node_ptr) {
+		static node_type* next(const node_type* node_ptr) {
 			assert(node_ptr != 0);
 
-			const node_t<T>* result_ptr = 0;
+			const node_type* result_ptr = 0;
 
 			if (node_ptr->m_right != 0) {
 				result_ptr = node_ptr->m_right;
@@ -169,11 +673,11 @@ namespace rbtree__ {
 				result_ptr = parent;
 			}
 
-			return (node_t<T>*)result_ptr;
+			return (node_type*)result_ptr;
 		}
 
-		static node_t<T>* prev(const node_t<T>* node_ptr) {
-			const node_t<T>* result_ptr = 0;
+		static node_type* prev(const node_type* node_ptr) {
+			const node_type* result_ptr = 0;
 
 			if (node_ptr->m_left != 0) {
 				result_ptr = node_ptr->m_left;
@@ -193,69 +697,77 @@ namespace rbtree__ {
 				result_ptr = parent;
 			}
 
-			return (node_t<T>*) result_ptr;
+			return (node_type*) result_ptr;
 		}
 
 		template <class RvalueBool>
-		std::pair<node_t<T>*, bool> insert(const T& value, const RvalueBool& rvalue_bool) {
+		std::pair<node_type*, bool> insert(const T& value, const RvalueBool& rvalue_bool) {
 			assert(this->is_valid());
 
-			const auto found(this->find(value));
+			return this->insert_i(this->find_for_insert(value), value, rvalue_bool);
+		}
 
-			// The key already exists.
-			if (found.m_result == find_result_yes) {
-				return std::pair<node_t<T>*, bool>(found.m_node_ptr, false);
-			}
+		// Insert "value" around "hint" (null for the end), see find_hint().
+		template <class RvalueBool>
+		std::pair<node_type*, bool> insert(const node_type* hint, const T& value, const RvalueBool& rvalue_bool) {
+			assert(this->is_valid());
 
-			// Create a new node.
-			auto new_ptr = new_node_i(value, rvalue_bool);
-			if (found.m_result == find_result_no_root) {
-				this->m_root = new_ptr;
-				this->m_smallest = new_ptr;
-				this->m_biggest = new_ptr;
-			}
-			else if (found.m_result == find_result_left) {
-				found.m_node_ptr->m_left = new_ptr;
-				new_ptr->m_parent = found.m_node_ptr;
+			return this->insert_i(this->find_hint(hint, value), value, rvalue_bool);
+		}
 
-				// If the new node is left child of the current smallest node,
-				// then the new node becomes the new smallest node.
-				if (this->m_smallest == found.m_node_ptr) {
-					this->m_smallest = new_ptr;
-				}
-			}
-			else {
-				found.m_node_ptr->m_right = new_ptr;
-				new_ptr->m_parent = found.m_node_ptr;
+		// Construct a value from "args", and insert it around "hint" (null for
+		// the end). The new node is given back if the value already exists.
+		template <class... Args>
+		std::pair<node_type*, bool> emplace_hint(const node_type* hint, Args&&... args) {
+			assert(this->is_valid());
 
-				// If the new node is right child of the current biggest node,
-				// then the new node becomes the new biggest node.
-				if (this->m_biggest == found.m_node_ptr) {
-					this->m_biggest = new_ptr;
-				}
+			auto new_ptr = this->construct_node_i(emplace_t(), std::forward<Args>(args)...);
+			const auto found(this->find_hint(hint, new_ptr->m_value));
+
+			if (found.m_result == find_result_yes) {
+				this->delete_node_i(new_ptr);
+				return std::pair<node_type*, bool>(found.m_node_ptr, false);
 			}
 
-			this->m_size++;
+			this->link_i(found, new_ptr);
+			return std::pair<node_type*, bool>(new_ptr, true);
+		}
 
-			// TO-DO: Rotate.
+		/**
+		 * Construct a value from "args" in place, and link it at "found".
+		 *
+		 * "found" is the result of find() of the value's key, which
+		 * was not found, and the tree has not been changed since then.
+		 * So inserting does not descend the tree again.
+		 */
+		template <class... Args>
+		node_type* emplace_at(const find_t<node_type>& found, Args&&... args) {
+			assert(this->is_valid());
+			assert(found.m_result != find_result_yes);
+
+			auto new_ptr = this->construct_node_i(emplace_t(), std::forward<Args>(args)...);
+			this->link_i(found, new_ptr);
 
-			return std::pair<node_t<T>*, bool>(new_ptr, true);
+			return new_ptr;
 		}
 
-		find_t<T> find(const T& value) const {
+		// Where "key" is, or would be linked. "Compare" must accept
+		// "key" on either side if it's not a "T".
+		template <class K>
+		find_t<node_type> find(const K& key) const {
 			assert(this->is_valid());
 
-			find_t<T> result;
+			find_t<node_type> result;
 
-			auto ptr = (node_t<T>*) m_root;
+			auto ptr = (node_type*) m_root;
 			while (ptr != 0) {
 				result.m_node_ptr = ptr;
 
-				if (this->m_less(value, ptr->m_value)) {
+				if (this->m_less(key, ptr->m_value)) {
 					result.m_result = find_result_left;
 					ptr = ptr->m_left;
 				}
-				else if (this->m_less(ptr->m_value, value)) {
+				else if (this->m_less(ptr->m_value, key)) {
 					result.m_result = find_result_right;
 					ptr = ptr->m_right;
 				}
@@ -268,79 +780,218 @@ namespace rbtree__ {
 			return result;
 		}
 
-		void replace_subtree(node_t<T>* node_old, node_t<T>* node_new) {
-			if (this->m_root == node_old) {
-				this->m_root = node_new;
+		/**
+		 * Like find(), but checks whether "key" belongs right before "hint"
+		 * (null for the end) or right after it first, by comparing "key"
+		 * with "hint" and its neighbor. If so, the tree is not descended,
+		 * which is amortized O(1) when walking the tree with "hint".
+		 */
+		template <class K>
+		find_t<node_type> find_hint(const node_type* hint, const K& key) const {
+			if (m_root == 0) {
+				return find_t<node_type>();
+			}
+
+			if (hint == 0 || this->m_less(key, hint->m_value)) {
+				const auto before = hint == 0 ? m_biggest : prev(hint);
+
+				if (before == 0 || this->m_less(before->m_value, key)) {
+					// One of them has no child on the side facing the other.
+					if (hint != 0 && hint->m_left == 0) {
+						return find_t<node_type>((node_type*) hint, find_result_left);
+					}
+					else {
+						return find_t<node_type>(before, find_result_right);
+					}
+				}
 			}
-			else if (node_old == node_old->m_parent->m_left) {
-				node_old->m_parent->m_left = node_new;
+			else if (this->m_less(hint->m_value, key)) {
+				const auto after = next(hint);
+
+				if (after == 0 || this->m_less(key, after->m_value)) {
+					if (hint->m_right == 0) {
+						return find_t<node_type>((node_type*) hint, find_result_right);
+					}
+					else {
+						return find_t<node_type>(after, find_result_left);
+					}
+				}
 			}
 			else {
-				node_old->m_parent->m_right = node_new;
+				return find_t<node_type>((node_type*) hint, find_result_yes);
 			}
 
-			if (node_new != 0) {
-				node_new->m_parent = node_old->m_parent;
-			}
+			// Wrong hint.
+			return this->find(key);
 		}
 
-		void erase(node_t<T>* node_ptr) {
-			assert(this->is_valid());
-
-			// Update smallest & biggest node pointers first.
-			if (this->m_size == 1) {
-				this->m_smallest = 0;
-				this->m_biggest = 0;
-			}
-			else {
-				if (this->m_smallest == node_ptr) {
-					this->m_smallest = this->next(node_ptr);
+		// Like find(), but appending after the biggest value or prepending
+		// before the smallest one does not descend the tree.
+		template <class K>
+		find_t<node_type> find_for_insert(const K& key) const {
+			if (m_root != 0) {
+				if (this->m_less(m_biggest->m_value, key)) {
+					return find_t<node_type>(m_biggest, find_result_right);
 				}
 
-				if (this->m_biggest == node_ptr) {
-					this->m_biggest = this->prev(node_ptr);
+				if (this->m_less(key, m_smallest->m_value)) {
+					return find_t<node_type>(m_smallest, find_result_left);
 				}
 			}
 
-			if (node_ptr->m_left == 0) {
-				this->replace_subtree(node_ptr, node_ptr->m_right);
-			}
-			else if (node_ptr->m_right == 0) {
-				this->replace_subtree(node_ptr, node_ptr->m_left);
-			}
-			else {
-				node_t<T>* next_ptr = this->get_smallest_i(node_ptr->m_right);
+			return this->find(key);
+		}
 
-				if (next_ptr->m_parent != node_ptr) {
-					this->replace_subtree(next_ptr, next_ptr->m_right);
-					next_ptr->m_right = node_ptr->m_right;
-					next_ptr->m_right->m_parent = next_ptr;
-				}
+		// The first node which is not less than "key", or null.
+		template <class K>
+		node_type* lower_bound(const K& key) const {
+			node_type* result = 0;
 
-				this->replace_subtree(node_ptr, next_ptr);
-				next_ptr->m_left = node_ptr->m_left;
-				next_ptr->m_left->m_parent = next_ptr;
+			for (auto ptr = m_root; ptr != 0;) {
+				if (this->m_less(ptr->m_value, key)) {
+					ptr = ptr->m_right;
+				}
+				else {
+					result = ptr;
+					ptr = ptr->m_left;
+				}
 			}
 
-			this->m_size--;
-
-			// TO-DO: Rotate.
+			return result;
 		}
 
-		void assign(self_type& another) {
-			assert(this->is_valid());
-			assert(another.is_valid());
-
-			if (this != &another) {
-				// Delete old data.
-				this->clear();
+		// The first node which is greater than "key", or null.
+		template <class K>
+		node_type* upper_bound(const K& key) const {
+			node_type* result = 0;
+
+			for (auto ptr = m_root; ptr != 0;) {
+				if (this->m_less(key, ptr->m_value)) {
+					result = ptr;
+					ptr = ptr->m_left;
+				}
+				else {
+					ptr = ptr->m_right;
+				}
+			}
+
+			return result;
+		}
+
+		// Number of values less than "key".
+		template <class K>
+		size_t rank(const K& key) const {
+			static_assert(is_size_augmented_t<node_type>::value, "rbtree_order_statistic_policy_t is required.");
+
+			size_t result = 0;
+
+			for (auto ptr = m_root; ptr != 0;) {
+				if (this->m_less(ptr->m_value, key)) {
+					result += subtree_size(ptr->m_left) + 1;
+					ptr = ptr->m_right;
+				}
+				else {
+					ptr = ptr->m_left;
+				}
+			}
+
+			return result;
+		}
+
+		// The node at zero-based "index" in order, or null.
+		node_type* select(size_t index) const {
+			static_assert(is_size_augmented_t<node_type>::value, "rbtree_order_statistic_policy_t is required.");
+
+			for (auto ptr = m_root; ptr != 0;) {
+				const auto left = subtree_size(ptr->m_left);
+
+				if (index < left) {
+					ptr = ptr->m_left;
+				}
+				else if (index > left) {
+					index -= left + 1;
+					ptr = ptr->m_right;
+				}
+				else {
+					return ptr;
+				}
+			}
+
+			return 0;
+		}
+
+		// Zero-based index of a node in order, size() for null (the end).
+		size_t position(const node_type* node_ptr) const {
+			static_assert(is_size_augmented_t<node_type>::value, "rbtree_order_statistic_policy_t is required.");
+
+			if (node_ptr == 0) {
+				return m_size;
+			}
+
+			auto result = subtree_size(node_ptr->m_left);
+
+			for (auto ptr = node_ptr; ptr->m_parent != 0; ptr = ptr->m_parent) {
+				if (ptr == ptr->m_parent->m_right) {
+					result += subtree_size(ptr->m_parent->m_left) + 1;
+				}
+			}
+
+			return result;
+		}
+
+		void erase(node_type* node_ptr) {
+			assert(this->is_valid());
+
+			// Update smallest & biggest node pointers first.
+			if (this->m_size == 1) {
+				this->m_smallest = 0;
+				this->m_biggest = 0;
+			}
+			else {
+				if (this->m_smallest == node_ptr) {
+					this->m_smallest = this->next(node_ptr);
+				}
+
+				if (this->m_biggest == node_ptr) {
+					this->m_biggest = this->prev(node_ptr);
+				}
+			}
+
+			erase_and_rebalance(this->m_root, node_ptr);
+			this->delete_node_i(node_ptr);
+
+			this->m_size--;
+
+		#ifdef ALGO_RBTREE_CHECK_INVARIANTS
+			assert(this->check_invariants());
+		#endif
+		}
+
+		void assign(self_type& another) {
+			assert(this->is_valid());
+			assert(another.is_valid());
+
+			if (this != &another) {
+				// Delete old data.
+				this->clear();
 
 				// Copy key-compare.
 				this->m_less = another.m_less;
 
-				// Copy nodes one by one.
+				// Copy nodes one by one, into one chunk.
 				if (another.m_root != 0) {
-					this->copy_i(&m_root, another.m_root);
+					this->reserve_i(another.m_size);
+
+					try {
+						this->copy_i(&m_root, 0, another.m_root);
+					}
+					catch (...) {
+						// Nodes copied so far are linked, so they could be destroyed.
+						this->destroy_i(m_root, std::is_trivially_destructible<node_type>());
+						m_root = 0;
+						this->release_chunks_i();
+						throw;
+					}
 				}
 				this->m_size = another.m_size;
 
@@ -350,37 +1001,367 @@ namespace rbtree__ {
 			}
 		}
 
+		/**
+		 * Replace all values by a strictly increasing range in O(n).
+		 *
+		 * Nodes are constructed in order in one chunk, and then linked by
+		 * splitting every range in the middle, so the tree is perfectly
+		 * balanced. Nodes on the deepest level are red if it's not the
+		 * root level, other nodes are black, so every path has the same
+		 * number of black nodes.
+		 */
+		template <class Iterator>
+		void assign_sorted(Iterator first, Iterator last) {
+			assert(this->is_valid());
+
+			const auto count = (size_t) std::distance(first, last);
+			if (count == 0) {
+				this->clear();
+				return;
+			}
+
+			this->assign_chunk_i(count, [this, &first](node_type* ptr) {
+				node_allocator_traits::construct(this->m_allocator, ptr, *first);
+				++first;
+			});
+		}
+
+		/**
+		 * Move all values into one new chunk in order, and give all
+		 * other chunks back, so that iterating walks memory forwards
+		 * and the memory of erased nodes is released. It's O(n).
+		 */
+		void compact() {
+			assert(this->is_valid());
+
+			if (m_size == 0) {
+				this->clear();
+				return;
+			}
+
+			const node_type* current = m_smallest;
+
+			this->assign_chunk_i(m_size, [this, &current](node_type* ptr) {
+				node_allocator_traits::construct(this->m_allocator, ptr,
+					std::move_if_noexcept(((node_type*) current)->m_value));
+				current = next(current);
+			});
+		}
+
+		/**
+		 * Move values which are not less than "key" into empty "right".
+		 *
+		 * The tree is cut along the path to "key", and the pieces are joined
+		 * back into two trees, so it's O(log n), plus counting the smaller
+		 * part if nodes are not augmented by subtree sizes.
+		 */
+		template <class K>
+		void split(const K& key, self_type& right) {
+			assert(this->is_valid());
+			assert(this != &right && right.m_root == 0 && right.m_arenas.empty());
+
+			// Nodes of both trees live in the same chunks afterwards.
+			right.m_arenas = m_arenas;
+			for (auto arena : m_arenas) {
+				++arena->m_users;
+			}
+
+			if (m_root == 0) {
+				return;
+			}
+
+			const auto size = m_size;
+			const auto left_size = this->count_less_i(key, is_size_augmented_t<node_type>());
+
+			subtree_type left;
+			subtree_type rest;
+			node_type* found = 0;
+
+			this->split_i(whole_i(m_root), key, left, found, rest);
+			if (found != 0) {
+				rest = join_i(subtree_type(), found, rest);
+			}
+
+			this->set_root_i(left.m_root, left_size);
+			right.set_root_i(rest.m_root, size - left_size);
+		}
+
+		/**
+		 * Move all values of "right", which are greater than all values
+		 * of this tree, in O(log n). "right" is left empty.
+		 *
+		 * The smallest node of "right" is linked in between, on the
+		 * spine of the taller tree where black heights are equal.
+		 */
+		void join(self_type& right) {
+			assert(this->is_valid());
+			assert(right.is_valid());
+			assert(this != &right);
+			assert(m_root == 0 || right.m_root == 0 || this->m_less(m_biggest->m_value, right.m_smallest->m_value));
+
+			this->reserve_adopt_i(right);
+
+			const auto size = m_size + right.m_size;
+			auto joined = whole_i(m_root);
+
+			if (right.m_root != 0) {
+				auto rest = right.m_root;
+				const auto middle = right.m_smallest;
+
+				erase_and_rebalance(rest, middle);
+				joined = join_i(joined, middle, whole_i(rest));
+			}
+
+			this->adopt_i(right);
+			this->set_root_i(joined.m_root, size);
+		}
+
+		/**
+		 * Replace values by the union, intersection or difference of values
+		 * of this tree and "another", which is left empty. Nodes are moved,
+		 * the value of this tree is kept if both trees have it.
+		 *
+		 * The root of "another" splits this tree, both halves are merged
+		 * recursively, and the results are joined back. It's O(m log(n/m + 1))
+		 * for sizes m <= n. Merging halves of the top log2(threads) levels is
+		 * forked to new threads, so "Compare" must be callable concurrently.
+		 *
+		 * Subtrees dropped by intersection & difference are freed later
+		 * by inserts if nodes are trivially destructible, otherwise they
+		 * are destroyed afterwards in O(number of dropped values).
+		 */
+		void set_operation(self_type& another, set_operation_t operation, size_t threads) {
+			assert(this->is_valid());
+			assert(another.is_valid());
+			assert(this != &another);
+
+			this->reserve_adopt_i(another);
+
+			size_t matches = 0;
+			subtree_list_type dropped;
+
+			const auto result = this->set_operation_i(whole_i(m_root), whole_i(another.m_root),
+				operation, threads, matches, dropped);
+
+			size_t size = matches;
+			if (operation == set_operation_union) {
+				size = m_size + another.m_size - matches;
+			}
+			else if (operation == set_operation_difference) {
+				size = m_size - matches;
+			}
+
+			this->adopt_i(another);
+			this->set_root_i(result.m_root, size);
+			this->release_subtrees_i(dropped, std::is_trivially_destructible<node_type>());
+		}
+
+		// Number of nodes on the longest path from the root to a leaf.
+		size_t height() const {
+			return this->height_i(m_root);
+		}
+
+		/**
+		 * Check all Red-Black properties, it's O(n).
+		 *
+		 * 1) The root is black.
+		 * 2) A red node has no red child.
+		 * 3) Every path from a node to its leaves has the same number of black nodes.
+		 *
+		 * Parent pointers, the order of values, the size and
+		 * the smallest & biggest nodes are checked as well.
+		 *
+		 * If ALGO_RBTREE_CHECK_INVARIANTS is defined, it's asserted
+		 * after every insert & erase of debug builds.
+		 */
+		bool check_invariants() const {
+			if (m_root == 0) {
+				return m_size == 0 && m_smallest == 0 && m_biggest == 0;
+			}
+
+			if (!m_root->m_black || m_root->m_parent != 0) {
+				return false;
+			}
+
+			if (this->black_height_i(m_root) == 0) {
+				return false;
+			}
+
+			if (m_smallest != get_smallest_i(m_root) || m_biggest != get_biggest_i(m_root)) {
+				return false;
+			}
+
+			size_t count = 1;
+			for (auto ptr = m_smallest, next_ptr = next(ptr); next_ptr != 0; ptr = next_ptr, next_ptr = next(ptr)) {
+				if (!this->m_less(ptr->m_value, next_ptr->m_value)) {
+					return false;
+				}
+
+				++count;
+			}
+
+			return count == m_size;
+		}
+
 	private:
 		// Disable copy contructor & operator=().
 		ctner_t(const self_type&) = delete;
 		self_type& operator=(const self_type&) = delete;
 
-		void clear_i(node_t<T>* node_ptr) {
-			if (node_ptr->m_left != 0) {
-				this->clear_i(node_ptr->m_left);
+		template <class RvalueBool>
+		std::pair<node_type*, bool> insert_i(const find_t<node_type>& found, const T& value, const RvalueBool& rvalue_bool) {
+			// The key already exists.
+			if (found.m_result == find_result_yes) {
+				return std::pair<node_type*, bool>(found.m_node_ptr, false);
 			}
 
-			if (node_ptr->m_right != 0) {
-				this->clear_i(node_ptr->m_right);
+			// Create a new node.
+			auto new_ptr = new_node_i(value, rvalue_bool);
+			this->link_i(found, new_ptr);
+
+			return std::pair<node_type*, bool>(new_ptr, true);
+		}
+
+		// Link a new node at "found", and rebalance.
+		void link_i(const find_t<node_type>& found, node_type* new_ptr) {
+			if (found.m_result == find_result_no_root) {
+				this->m_root = new_ptr;
+				this->m_smallest = new_ptr;
+				this->m_biggest = new_ptr;
 			}
+			else if (found.m_result == find_result_left) {
+				found.m_node_ptr->m_left = new_ptr;
+				new_ptr->m_parent = found.m_node_ptr;
 
-			delete node_ptr;
+				// If the new node is left child of the current smallest node,
+				// then the new node becomes the new smallest node.
+				if (this->m_smallest == found.m_node_ptr) {
+					this->m_smallest = new_ptr;
+				}
+			}
+			else {
+				found.m_node_ptr->m_right = new_ptr;
+				new_ptr->m_parent = found.m_node_ptr;
+
+				// If the new node is right child of the current biggest node,
+				// then the new node becomes the new biggest node.
+				if (this->m_biggest == found.m_node_ptr) {
+					this->m_biggest = new_ptr;
+				}
+			}
+
+			this->m_size++;
+			rebalance_after_insert(this->m_root, new_ptr);
+
+		#ifdef ALGO_RBTREE_CHECK_INVARIANTS
+			assert(this->check_invariants());
+		#endif
 		}
 
-		void copy_i(node_t<T>** pptr, const node_t<T>* another) {
-			*pptr = new node_t<T>(another->m_value);
+		// Nothing to do, the memory is given back with chunks.
+		void destroy_i(node_type* node_ptr, const std::true_type&) {
+		}
+
+		void destroy_i(node_type* node_ptr, const std::false_type&) {
+			post_order_i(node_ptr, [this](node_type* ptr) {
+				node_allocator_traits::destroy(m_allocator, ptr);
+			});
+		}
+
+		// Post-order walk by parent pointers, without recursion. Nodes are
+		// unlinked before "visit(node_type*)", so they could be freed.
+		template <class Visitor>
+		static void post_order_i(node_type* node_ptr, Visitor visit) {
+			while (node_ptr != 0) {
+				if (node_ptr->m_left != 0) {
+					node_ptr = node_ptr->m_left;
+				}
+				else if (node_ptr->m_right != 0) {
+					node_ptr = node_ptr->m_right;
+				}
+				else {
+					auto parent = node_ptr->m_parent;
+
+					if (parent != 0) {
+						if (parent->m_left == node_ptr) {
+							parent->m_left = 0;
+						}
+						else {
+							parent->m_right = 0;
+						}
+					}
+
+					visit(node_ptr);
+					node_ptr = parent;
+				}
+			}
+		}
+
+		// Recursion depth is the tree height, i.e. O(log n).
+		void copy_i(node_type** pptr, node_type* parent, const node_type* another) {
+			*pptr = this->new_node_i(another->m_value, std::false_type());
+			(*pptr)->m_parent = parent;
+			(*pptr)->m_black = another->m_black;
+			(typename Policy::node_base_type&) **pptr = (const typename Policy::node_base_type&) *another;
 
 			if (another->m_left != 0) {
-				this->copy_i(&((*pptr)->m_left), another->m_left);
-				(*pptr)->m_left->m_parent = *pptr;
+				this->copy_i(&((*pptr)->m_left), *pptr, another->m_left);
 			}
 
 			if (another->m_right != 0) {
-				this->copy_i(&((*pptr)->m_right), another->m_right);
-				(*pptr)->m_right->m_parent = *pptr;
+				this->copy_i(&((*pptr)->m_right), *pptr, another->m_right);
 			}
 		}
 
+		static size_t height_i(const node_type* node_ptr) {
+			if (node_ptr == 0) {
+				return 0;
+			}
+
+			const auto left = height_i(node_ptr->m_left);
+			const auto right = height_i(node_ptr->m_right);
+
+			return (left > right ? left : right) + 1;
+		}
+
+		static bool check_augment_i(const node_type* node_ptr, const std::false_type&) {
+			return true;
+		}
+
+		static bool check_augment_i(const node_type* node_ptr, const std::true_type&) {
+			return node_ptr->m_subtree_size
+				== subtree_size(node_ptr->m_left) + subtree_size(node_ptr->m_right) + 1;
+		}
+
+		// Black height of a subtree (counting the null leaf), or 0 if it's invalid.
+		size_t black_height_i(const node_type* node_ptr) const {
+			if (node_ptr == 0) {
+				return 1;
+			}
+
+			const auto left = node_ptr->m_left;
+			const auto right = node_ptr->m_right;
+
+			if ((left != 0 && left->m_parent != node_ptr) || (right != 0 && right->m_parent != node_ptr)) {
+				return 0;
+			}
+
+			if (!node_ptr->m_black && ((left != 0 && !left->m_black) || (right != 0 && !right->m_black))) {
+				return 0;
+			}
+
+			const auto left_height = this->black_height_i(left);
+			if (left_height == 0 || left_height != this->black_height_i(right)) {
+				return 0;
+			}
+
+			if (!check_augment_i(node_ptr, is_size_augmented_t<node_type>())) {
+				return 0;
+			}
+
+			return left_height + (node_ptr->m_black ? 1 : 0);
+		}
+
 	#ifndef NDEBUG
 		bool is_valid() const {
 			if (this->m_smallest != this->get_smallest_i(m_root)
@@ -392,20 +1373,645 @@ namespace rbtree__ {
 		}
 	#endif
 
-		node_t<T>* new_node_i(const T& value, const std::false_type&) {
-			return new node_t<T>(value);
+		// Number of values less than "key".
+		template <class K>
+		size_t count_less_i(const K& key, const std::true_type&) const {
+			return this->rank(key);
 		}
 
-		node_t<T>* new_node_i(const T& value, const std::true_type&) {
-			return new node_t<T>(std::move((T&&)value));
+		// Walk from both ends in turn, it's O(min(k, n - k)).
+		template <class K>
+		size_t count_less_i(const K& key, const std::false_type&) const {
+			auto forward = m_smallest;
+			auto backward = m_biggest;
+			size_t less = 0;
+			size_t not_less = 0;
+
+			for (;;) {
+				if (forward == 0 || !this->m_less(forward->m_value, key)) {
+					return less;
+				}
+
+				++less;
+				forward = next(forward);
+
+				if (backward == 0 || this->m_less(backward->m_value, key)) {
+					return m_size - not_less;
+				}
+
+				++not_less;
+				backward = prev(backward);
+			}
+		}
+
+		// Make the root of a joined or split tree the new root.
+		void set_root_i(node_type* root, size_t size) {
+			if (root != 0) {
+				root->m_parent = 0;
+				root->m_black = true;
+			}
+
+			m_root = root;
+			m_smallest = get_smallest_i(root);
+			m_biggest = get_biggest_i(root);
+			m_size = size;
+
+		#ifdef ALGO_RBTREE_CHECK_INVARIANTS
+			assert(this->check_invariants());
+		#endif
+		}
+
+		// A whole tree as a subtree, its black height is counted on the left spine.
+		static subtree_type whole_i(node_type* root) {
+			size_t height = 0;
+
+			for (auto ptr = root; ptr != 0; ptr = ptr->m_left) {
+				if (ptr->m_black) {
+					++height;
+				}
+			}
+
+			return subtree_type(root, height);
+		}
+
+		// Unlink "node_ptr" from its parent, "height" is its black height.
+		static subtree_type detach_i(node_type* node_ptr, size_t height) {
+			if (node_ptr != 0) {
+				node_ptr->m_parent = 0;
+			}
+
+			return subtree_type(node_ptr, height);
+		}
+
+		static subtree_type blacken_i(const subtree_type& tree) {
+			if (tree.m_root == 0 || tree.m_root->m_black) {
+				return tree;
+			}
+
+			tree.m_root->m_black = true;
+			return subtree_type(tree.m_root, tree.m_black_height + 1);
+		}
+
+		/**
+		 * Join "left" < "middle" < "right", "middle" is a detached node.
+		 *
+		 * If black heights are not equal, red "middle" replaces the first
+		 * black node on the facing spine of the taller tree with the black
+		 * height of the other tree, which becomes its children, and the
+		 * taller tree is rebalanced like inserting. So it's O(difference of
+		 * black heights), plus walking the spine.
+		 */
+		static subtree_type join_i(subtree_type left, node_type* middle, subtree_type right) {
+			left = blacken_i(left);
+			right = blacken_i(right);
+
+			middle->m_parent = 0;
+			middle->m_black = false;
+
+			if (left.m_black_height == right.m_black_height) {
+				middle->m_left = left.m_root;
+				middle->m_right = right.m_root;
+				middle->m_black = true;
+
+				if (left.m_root != 0) {
+					left.m_root->m_parent = middle;
+				}
+
+				if (right.m_root != 0) {
+					right.m_root->m_parent = middle;
+				}
+
+				augment_after_build(middle, is_size_augmented_t<node_type>());
+				return subtree_type(middle, left.m_black_height + 1);
+			}
+
+			const auto taller_left = left.m_black_height > right.m_black_height;
+			const auto& taller = taller_left ? left : right;
+			const auto& lower = taller_left ? right : left;
+
+			auto root = taller.m_root;
+			auto height = taller.m_black_height;
+			node_type* parent = 0;
+
+			while (root != 0 && !(root->m_black && height == lower.m_black_height)) {
+				if (root->m_black) {
+					--height;
+				}
+
+				parent = root;
+				root = taller_left ? root->m_right : root->m_left;
+			}
+
+			if (taller_left) {
+				parent->m_right = middle;
+				middle->m_left = root;
+				middle->m_right = lower.m_root;
+			}
+			else {
+				parent->m_left = middle;
+				middle->m_left = lower.m_root;
+				middle->m_right = root;
+			}
+
+			middle->m_parent = parent;
+			if (root != 0) {
+				root->m_parent = middle;
+			}
+
+			if (lower.m_root != 0) {
+				lower.m_root->m_parent = middle;
+			}
+
+			augment_after_join(middle, is_size_augmented_t<node_type>());
+
+			root = taller.m_root;
+			height = taller.m_black_height;
+
+			if (rebalance_after_link(root, middle)) {
+				++height;
+			}
+
+			return subtree_type(root, height);
+		}
+
+		// Join "left" < "right", the biggest node of "left" is taken out to be the middle.
+		static subtree_type join_i(subtree_type left, subtree_type right) {
+			if (left.m_root == 0) {
+				return right;
+			}
+
+			if (right.m_root == 0) {
+				return left;
+			}
+
+			auto root = blacken_i(left).m_root;
+			const auto middle = get_biggest_i(root);
+
+			erase_and_rebalance(root, middle);
+			return join_i(whole_i(root), middle, right);
+		}
+
+		/**
+		 * Split "tree" into "left" < "key" < "right", and the node equal to "key"
+		 * (or null) is given by "found". Subtrees hanging off the path to "key"
+		 * are joined, their black heights increase along the way back, so the
+		 * joins cost O(log n) in total. Recursion depth is the tree height.
+		 */
+		template <class K>
+		void split_i(subtree_type tree, const K& key, subtree_type& left, node_type*& found, subtree_type& right) const {
+			const auto node_ptr = tree.m_root;
+
+			if (node_ptr == 0) {
+				left = subtree_type();
+				right = subtree_type();
+				found = 0;
+				return;
+			}
+
+			const auto height = tree.m_black_height - (node_ptr->m_black ? 1 : 0);
+			const auto left_child = detach_i(node_ptr->m_left, height);
+			const auto right_child = detach_i(node_ptr->m_right, height);
+
+			if (this->m_less(key, node_ptr->m_value)) {
+				this->split_i(left_child, key, left, found, right);
+				right = join_i(right, node_ptr, right_child);
+			}
+			else if (this->m_less(node_ptr->m_value, key)) {
+				this->split_i(right_child, key, left, found, right);
+				left = join_i(left_child, node_ptr, left);
+			}
+			else {
+				node_ptr->m_left = 0;
+				node_ptr->m_right = 0;
+
+				left = left_child;
+				right = right_child;
+				found = node_ptr;
+			}
+		}
+
+		/**
+		 * Merge "tree1" and "tree2" by "operation", see set_operation().
+		 *
+		 * "matches" is increased by the number of values in both trees,
+		 * and nodes left out are added to "dropped".
+		 */
+		subtree_type set_operation_i(subtree_type tree1, subtree_type tree2, set_operation_t operation,
+			size_t threads, size_t& matches, subtree_list_type& dropped) const {
+			if (tree1.m_root == 0 || tree2.m_root == 0) {
+				if (operation == set_operation_union) {
+					return tree1.m_root == 0 ? tree2 : tree1;
+				}
+
+				if (tree2.m_root != 0) {
+					dropped.push(tree2.m_root);
+				}
+
+				if (operation == set_operation_difference) {
+					return tree1;
+				}
+
+				if (tree1.m_root != 0) {
+					dropped.push(tree1.m_root);
+				}
+
+				return subtree_type();
+			}
+
+			const auto key = tree2.m_root;
+			const auto height = tree2.m_black_height - (key->m_black ? 1 : 0);
+			const auto left2 = detach_i(key->m_left, height);
+			const auto right2 = detach_i(key->m_right, height);
+
+			subtree_type left1;
+			subtree_type right1;
+			node_type* found = 0;
+
+			this->split_i(tree1, key->m_value, left1, found, right1);
+
+			subtree_type left;
+			subtree_type right;
+
+			if (threads <= 1) {
+				left = this->set_operation_i(left1, left2, operation, 1, matches, dropped);
+				right = this->set_operation_i(right1, right2, operation, 1, matches, dropped);
+			}
+			else {
+				size_t left_matches = 0;
+				subtree_list_type left_dropped;
+				std::exception_ptr error;
+				std::thread worker;
+
+				const auto merge_left = [&](size_t left_threads) {
+					try {
+						left = this->set_operation_i(left1, left2, operation, left_threads, left_matches, left_dropped);
+					}
+					catch (...) {
+						error = std::current_exception();
+					}
+				};
+
+				try {
+					worker = std::thread(merge_left, threads / 2);
+				}
+				catch (const std::system_error&) {
+					// No more threads, merge the left halves here.
+					merge_left(1);
+				}
+
+				try {
+					right = this->set_operation_i(right1, right2, operation, threads - threads / 2, matches, dropped);
+				}
+				catch (...) {
+					if (worker.joinable()) {
+						worker.join();
+					}
+
+					throw;
+				}
+
+				if (worker.joinable()) {
+					worker.join();
+				}
+
+				if (error) {
+					std::rethrow_exception(error);
+				}
+
+				matches += left_matches;
+				dropped.splice(left_dropped);
+			}
+
+			key->m_left = 0;
+			key->m_right = 0;
+
+			if (found != 0) {
+				++matches;
+			}
+
+			if (operation == set_operation_union) {
+				if (found == 0) {
+					return join_i(left, key, right);
+				}
+
+				dropped.push(key);
+				return join_i(left, found, right);
+			}
+
+			dropped.push(key);
+
+			if (operation == set_operation_intersection && found != 0) {
+				return join_i(left, found, right);
+			}
+
+			if (found != 0) {
+				dropped.push(found);
+			}
+
+			return join_i(left, right);
+		}
+
+		// Nodes of trivially destructible values are reused by later inserts.
+		void release_subtrees_i(subtree_list_type& subtrees, const std::true_type&) {
+			m_garbage.splice(subtrees);
+		}
+
+		void release_subtrees_i(subtree_list_type& subtrees, const std::false_type&) {
+			for (auto root = subtrees.m_first; root != 0;) {
+				const auto next_root = root->m_parent;
+
+				root->m_parent = 0;
+				post_order_i(root, [this](node_type* ptr) {
+					this->delete_node_i(ptr);
+				});
+
+				root = next_root;
+			}
+
+			subtrees = subtree_list_type();
+		}
+
+		// Make room for adopt_i(), so that it does not throw.
+		void reserve_adopt_i(const self_type& another) {
+			m_arenas.reserve(m_arenas.size() + another.m_arenas.size());
+			m_free_lists.reserve(m_free_lists.size() + another.m_free_lists.size() + 1);
+		}
+
+		// Take the pool of "another" whose nodes have been moved here, and empty it.
+		void adopt_i(self_type& another) {
+			for (auto arena : another.m_arenas) {
+				if (std::find(m_arenas.begin(), m_arenas.end(), arena) == m_arenas.end()) {
+					m_arenas.push_back(arena);
+				}
+				else {
+					--arena->m_users;
+				}
+			}
+
+			if (another.m_free_slots != 0) {
+				m_free_lists.push_back(another.m_free_slots);
+			}
+
+			m_free_lists.insert(m_free_lists.end(), another.m_free_lists.begin(), another.m_free_lists.end());
+			m_garbage.splice(another.m_garbage);
+
+			// The rest of its current chunk, at most one chunk of nodes.
+			for (auto ptr = another.m_current; ptr != another.m_end; ++ptr) {
+				this->deallocate_node_i(ptr);
+			}
+
+			another.m_arenas.clear();
+			another.m_root = 0;
+			another.m_smallest = 0;
+			another.m_biggest = 0;
+			another.m_size = 0;
+			another.release_chunks_i();
+		}
+
+		// Construct "count" nodes in a new chunk by "construct(node_type*)" in order,
+		// and then replace all nodes by them.
+		template <class Constructor>
+		void assign_chunk_i(size_t count, Constructor construct) {
+			std::unique_ptr<arena_type> arena(new arena_type(m_allocator));
+			m_arenas.reserve(m_arenas.size() + 1);
+
+			const auto nodes = this->allocate_chunk_i(count);
+			size_t constructed = 0;
+
+			try {
+				for (; constructed < count; ++constructed) {
+					construct(nodes + constructed);
+				}
+			}
+			catch (...) {
+				while (constructed > 0) {
+					node_allocator_traits::destroy(m_allocator, nodes + --constructed);
+				}
+
+				this->deallocate_chunk_i(nodes);
+				throw;
+			}
+
+		#ifndef NDEBUG
+			for (size_t i = 1; i < count; ++i) {
+				assert(this->m_less(nodes[i - 1].m_value, nodes[i].m_value));
+			}
+		#endif
+
+			// There is room for the arena, clear() only removes arenas.
+			this->clear();
+			m_arenas.push_back(arena.release());
+			this->link_chunk_i(m_arenas.back(), nodes);
+
+			// Depth of the deepest level, the root level is 0.
+			size_t deepest = 0;
+			while (((size_t) 2 << deepest) <= count) {
+				++deepest;
+			}
+
+			m_root = this->link_sorted_i(nodes, 0, count, 0, deepest);
+			m_root->m_parent = 0;
+			m_smallest = nodes;
+			m_biggest = nodes + count - 1;
+			m_size = count;
+
+		#ifdef ALGO_RBTREE_CHECK_INVARIANTS
+			assert(this->check_invariants());
+		#endif
+		}
+
+		// Link nodes in [first, last) as a subtree at "depth", return its root.
+		// Recursion depth is the tree height, i.e. O(log n).
+		static node_type* link_sorted_i(node_type* nodes, size_t first, size_t last, size_t depth, size_t deepest) {
+			const auto middle = first + (last - first) / 2;
+			const auto node_ptr = nodes + middle;
+
+			if (first < middle) {
+				node_ptr->m_left = link_sorted_i(nodes, first, middle, depth + 1, deepest);
+				node_ptr->m_left->m_parent = node_ptr;
+			}
+
+			if (middle + 1 < last) {
+				node_ptr->m_right = link_sorted_i(nodes, middle + 1, last, depth + 1, deepest);
+				node_ptr->m_right->m_parent = node_ptr;
+			}
+
+			node_ptr->m_black = depth == 0 || depth != deepest;
+			augment_after_build(node_ptr, is_size_augmented_t<node_type>());
+
+			return node_ptr;
+		}
+
+		// Memory for "count" nodes, after the chunk header.
+		node_type* allocate_chunk_i(size_t count) {
+			const auto slots = count + 1;
+			const auto ptr = node_allocator_traits::allocate(m_allocator, slots);
+
+			new (ptr) chunk_t();
+			((chunk_t*) ptr)->m_slots = slots;
+
+			return ptr + 1;
+		}
+
+		void deallocate_chunk_i(node_type* nodes) {
+			const auto ptr = nodes - 1;
+			node_allocator_traits::deallocate(m_allocator, ptr, ((chunk_t*) ptr)->m_slots);
+		}
+
+		static void link_chunk_i(arena_type* arena, node_type* nodes) {
+			const auto chunk = (chunk_t*) (nodes - 1);
+
+			chunk->m_next = arena->m_chunks;
+			arena->m_chunks = chunk;
+		}
+
+		// The last arena if no other tree uses it, otherwise a new one.
+		arena_type* private_arena_i() {
+			if (m_arenas.empty() || m_arenas.back()->m_users != 1) {
+				std::unique_ptr<arena_type> arena(new arena_type(m_allocator));
+
+				m_arenas.push_back(arena.get());
+				arena.release();
+			}
+
+			return m_arenas.back();
+		}
+
+		// Leave all arenas, the last tree leaving an arena gives its chunks back.
+		void release_chunks_i() {
+			for (auto arena : m_arenas) {
+				if (arena->m_users-- == 1) {
+					for (auto chunk = arena->m_chunks; chunk != 0;) {
+						const auto ptr = (node_type*) chunk;
+						chunk = chunk->m_next;
+						node_allocator_traits::deallocate(arena->m_allocator, ptr, ((chunk_t*) ptr)->m_slots);
+					}
+
+					delete arena;
+				}
+			}
+
+			m_arenas.clear();
+			m_current = 0;
+			m_end = 0;
+			m_free_slots = 0;
+			m_free_lists.clear();
+			m_garbage = subtree_list_type();
+			m_chunk_nodes = const_min_chunk_nodes;
+		}
+
+		// Make sure that the next "count" new nodes are contiguous.
+		void reserve_i(size_t count) {
+			if ((size_t) (m_end - m_current) < count) {
+				const auto arena = this->private_arena_i();
+
+				m_current = this->allocate_chunk_i(count);
+				m_end = m_current + count;
+				this->link_chunk_i(arena, m_current);
+			}
+		}
+
+		// Reuse a free node first, then nodes of dropped subtrees,
+		// and then the rest of the current chunk.
+		node_type* allocate_node_i() {
+			if (m_free_slots != 0) {
+				const auto slot = m_free_slots;
+				m_free_slots = slot->m_next;
+				return (node_type*) slot;
+			}
+
+			if (!m_free_lists.empty()) {
+				m_free_slots = m_free_lists.back();
+				m_free_lists.pop_back();
+				return this->allocate_node_i();
+			}
+
+			if (m_garbage.m_first != 0) {
+				const auto root = m_garbage.m_first;
+
+				m_garbage.m_first = root->m_parent;
+				if (m_garbage.m_first == 0) {
+					m_garbage.m_last = 0;
+				}
+
+				if (root->m_left != 0) {
+					m_garbage.push(root->m_left);
+				}
+
+				if (root->m_right != 0) {
+					m_garbage.push(root->m_right);
+				}
+
+				return root;
+			}
+
+			if (m_current == m_end) {
+				this->reserve_i(m_chunk_nodes);
+
+				if (m_chunk_nodes < const_max_chunk_bytes / sizeof(node_type)) {
+					m_chunk_nodes *= 2;
+				}
+			}
+
+			return m_current++;
+		}
+
+		void deallocate_node_i(node_type* node_ptr) {
+			const auto slot = (free_slot_t*) node_ptr;
+
+			slot->m_next = m_free_slots;
+			m_free_slots = slot;
+		}
+
+		template <class... Args>
+		node_type* construct_node_i(Args&&... args) {
+			const auto ptr = this->allocate_node_i();
+
+			try {
+				node_allocator_traits::construct(m_allocator, ptr, std::forward<Args>(args)...);
+			}
+			catch (...) {
+				this->deallocate_node_i(ptr);
+				throw;
+			}
+
+			return ptr;
+		}
+
+		node_type* new_node_i(const T& value, const std::false_type&) {
+			return this->construct_node_i(value);
+		}
+
+		node_type* new_node_i(const T& value, const std::true_type&) {
+			return this->construct_node_i(std::move((T&&)value));
+		}
+
+		void delete_node_i(node_type* node_ptr) {
+			node_allocator_traits::destroy(m_allocator, node_ptr);
+			this->deallocate_node_i(node_ptr);
 		}
 
 	private:
-		node_t<T>* m_root;
-		node_t<T>* m_smallest;
-		node_t<T>* m_biggest;
+		node_type* m_root;
+		node_type* m_smallest;
+		node_type* m_biggest;
 		size_t m_size;
+
+		// Node pool.
+		std::vector<arena_type*> m_arenas;
+		node_type* m_current;
+		node_type* m_end;
+		free_slot_t* m_free_slots;
+
+		// Free lists taken from other trees.
+		std::vector<free_slot_t*> m_free_lists;
+
+		// Dropped subtrees of trivially destructible nodes.
+		subtree_list_type m_garbage;
+		size_t m_chunk_nodes;
+
 		Compare m_less;
+		node_allocator_type m_allocator;
 	};
 
 	// Iterator implementation.
@@ -432,6 +2038,13 @@ namespace rbtree__ {
 			: m_ctner(ctner), m_current(current) {
 		}
 
+		// From iterator to const_iterator.
+		template <class OtherPointer, class OtherReference, class OtherCtnerPointer, class OtherNodePointer>
+		iterator_t(const iterator_t<T, OtherPointer, OtherReference, OtherCtnerPointer, OtherNodePointer>& it,
+			typename std::enable_if<std::is_convertible<OtherNodePointer, NodePointer>::value>::type* = 0)
+			: m_ctner(it.get_ctner_ptr__()), m_current(it.get_node_ptr__()) {
+		}
+
 		Reference operator*() const {
 			assert(m_ctner != 0);
 			assert(m_current != 0);
@@ -486,7 +2099,7 @@ namespace rbtree__ {
 			return *this;
 		}
 
-		bool operator==(const self_type& it) {
+		bool operator==(const self_type& it) const {
 			if (this->m_ctner == it.m_ctner
 				&& this->m_current == it.m_current) {
 				return true;
@@ -495,10 +2108,17 @@ namespace rbtree__ {
 			return false;
 		}
 
-		bool operator!=(const self_type& it) {
+		bool operator!=(const self_type& it) const {
 			return !this->operator==(it);
 		}
 
+		// Distance in O(log n), rbtree_order_statistic_policy_t is required.
+		std::ptrdiff_t operator-(const self_type& it) const {
+			assert(m_ctner != 0 && m_ctner == it.m_ctner);
+
+			return (std::ptrdiff_t) m_ctner->position(m_current) - (std::ptrdiff_t) m_ctner->position(it.m_current);
+		}
+
 		CtnerPointer get_ctner_ptr__() const {
 			return this->m_ctner;
 		}
@@ -515,20 +2135,54 @@ namespace rbtree__ {
 } // namespace rbtree__
 
 
+// Default policy of rbtree_t, nodes are not augmented.
+struct rbtree_default_policy_t {
+	typedef rbtree__::no_augment_t node_base_type;
+};
+
+// Order statistics policy of rbtree_t, every node keeps its subtree
+// size (one more word per node), so that rank(), select() and
+// iterator difference are O(log n).
+struct rbtree_order_statistic_policy_t {
+	typedef rbtree__::subtree_size_t node_base_type;
+};
+
+
 /**
  * Red-Black Tree.
+ *
+ * The tree is rebalanced on every insert & erase, so its height
+ * is at most 2 * log2(n + 1), and find(), insert() and erase()
+ * are O(log n) whatever the insertion order is.
+ *
+ * "Policy" decides what nodes are augmented with, e.g.
+ * rbtree_order_statistic_policy_t enables rank() and select().
+ *
+ * Nodes are pooled in chunks taken from "Allocator" (rebound to the
+ * internal node type). Erased nodes are reused by later inserts, and
+ * the memory is given back by clear(), compact() or the destructor.
+ *
+ * split() and join() cut and glue trees without moving values. join() is
+ * O(log n), and so is split() with rbtree_order_statistic_policy_t (it's
+ * O(min(k, n - k)) otherwise, to count the smaller part). See rbtree_union(),
+ * rbtree_intersection() and rbtree_difference() for set algebra built on them.
  */
-template <class T, class Compare = std::less<T>>
+template <class T, class Compare = std::less<T>, class Policy = rbtree_default_policy_t,
+	class Allocator = std::allocator<T>>
 class rbtree_t {
 private:
-	typedef rbtree_t<T, Compare> self_type;
-	typedef rbtree__::node_t<T>* node_ptr_t;
-	typedef const rbtree__::node_t<T>* const_node_ptr_t;
-	typedef rbtree__::ctner_t<T, Compare> ctner_type;
+	typedef rbtree_t<T, Compare, Policy, Allocator> self_type;
+
+protected:
+	typedef rbtree__::ctner_t<T, Compare, Policy, Allocator> ctner_type;
+	typedef typename ctner_type::node_type* node_ptr_t;
+	typedef const typename ctner_type::node_type* const_node_ptr_t;
 
 public:
 	typedef Compare key_compare;
 	typedef Compare value_compare;
+	typedef Policy policy_type;
+	typedef Allocator allocator_type;
 	typedef T key_type;
 	typedef T value_type;
 	typedef value_type& reference;
@@ -549,13 +2203,21 @@ public:
 	rbtree_t() : rbtree_t(Compare()){
 	}
 
-	explicit rbtree_t(const Compare& less) {
-		m_ctner = new ctner_type(less);
+	explicit rbtree_t(const Compare& less, const Allocator& allocator = Allocator()) {
+		m_ctner = new ctner_type(less, allocator);
 	}
 
 	rbtree_t(const self_type& another) {
-		m_ctner = new ctner_type();
-		*this = another;
+		m_ctner = new ctner_type(another.key_comp(),
+			std::allocator_traits<Allocator>::select_on_container_copy_construction(another.get_allocator()));
+
+		try {
+			*this = another;
+		}
+		catch (...) {
+			delete m_ctner;
+			throw;
+		}
 	}
 
 	rbtree_t(self_type&& another) {
@@ -563,8 +2225,9 @@ public:
 		another.m_ctner = 0;
 	}
 
-	rbtree_t(std::initializer_list<T> list, const Compare& less = Compare())
-		: rbtree_t(less) {
+	rbtree_t(std::initializer_list<T> list, const Compare& less = Compare(),
+		const Allocator& allocator = Allocator())
+		: rbtree_t(less, allocator) {
 		this->insert(list);
 	}
 
@@ -604,22 +2267,176 @@ public:
 		return this->key_comp();
 	}
 
-	iterator find(const T& value);
-	const_iterator find(const T& value) const;
+	allocator_type get_allocator() const {
+		if (this->m_ctner != 0) {
+			return allocator_type(this->m_ctner->get_allocator());
+		}
+		else {
+			return allocator_type();
+		}
+	}
 
-	template <class Iterator>
-	void insert(Iterator first, Iterator last) {
-		for (auto it = first; it != last; ++it) {
-			this->insert(*it);
+	// Bytes taken from the allocator for nodes.
+	size_t memory_bytes() const {
+		return this->m_ctner == 0 ? 0 : this->m_ctner->memory_bytes();
+	}
+
+	/**
+	 * Move all elements into one contiguous block in order, and give
+	 * memory of erased nodes back, e.g. after heavy churn. It's O(n),
+	 * and the tree is perfectly balanced afterwards.
+	 */
+	void compact() {
+		if (this->m_ctner != 0) {
+			this->m_ctner->compact();
 		}
 	}
+
+	// Number of nodes on the longest path from the root to a leaf, it's O(n).
+	size_t height() const {
+		return this->m_ctner == 0 ? 0 : this->m_ctner->height();
+	}
+
+	// Check Red-Black properties, it's O(n). See rbtree__::ctner_t::check_invariants().
+	bool check_invariants() const {
+		return this->m_ctner == 0 || this->m_ctner->check_invariants();
+	}
+
+	iterator find(const T& value);
+	const_iterator find(const T& value) const;
+	size_t count(const T& value) const;
+
+	// The first element which is not less than "value".
+	iterator lower_bound(const T& value);
+	const_iterator lower_bound(const T& value) const;
+
+	// The first element which is greater than "value".
+	iterator upper_bound(const T& value);
+	const_iterator upper_bound(const T& value) const;
+
+	// Range of elements equal to "value", i.e. [lower_bound(), upper_bound()).
+	std::pair<iterator, iterator> equal_range(const T& value);
+	std::pair<const_iterator, const_iterator> equal_range(const T& value) const;
+
+	// Heterogeneous lookup, available if "Compare::is_transparent" is defined.
+	// "Compare" must order "key" and elements consistently in both directions.
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K& key);
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K& key) const;
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K& key) const;
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K& key);
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator lower_bound(const K& key) const;
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator upper_bound(const K& key);
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator upper_bound(const K& key) const;
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	std::pair<iterator, iterator> equal_range(const K& key);
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	std::pair<const_iterator, const_iterator> equal_range(const K& key) const;
+
+	/**
+	 * Call "functor(const T& value)" for elements in [low, high) in order.
+	 *
+	 * It descends the tree once to find "low", and then walks the
+	 * successors, so it costs O(log n + k) for k elements.
+	 *
+	 * @return Number of visited elements.
+	 */
+	template <class Functor>
+	size_t for_each_in_range(const T& low, const T& high, Functor functor) const;
+
+	// Number of elements less than "value", rbtree_order_statistic_policy_t is required.
+	size_t rank(const T& value) const;
+
+	// Element at zero-based "index" in order (end() if it's out of range),
+	// rbtree_order_statistic_policy_t is required.
+	iterator select(size_t index);
+	const_iterator select(size_t index) const;
+
+	/**
+	 * Insert a range of values.
+	 *
+	 * If the tree is empty, the tree is built in O(n) by assign_sorted(),
+	 * after sorting & deduplicating the values if they are not strictly
+	 * increasing yet (the first one of equal values is kept, like inserting
+	 * them one by one). Otherwise, values are inserted one by one.
+	 */
+	template <class Iterator>
+	void insert(Iterator first, Iterator last);
+
+	/**
+	 * Replace all elements by a strictly increasing range in O(n).
+	 *
+	 * The tree is perfectly balanced, and all nodes are allocated
+	 * in one contiguous block.
+	 */
+	template <class Iterator>
+	void assign_sorted(Iterator first, Iterator last);
+
+	/**
+	 * Insert a value.
+	 *
+	 * Appending a value bigger than all others, or prepending one smaller
+	 * than all others does not descend the tree, so inserting increasing
+	 * (or decreasing) values costs amortized O(1) plus rebalancing.
+	 */
 	std::pair<iterator, bool> insert(const T& value);
 	std::pair<iterator, bool> insert(T&& value);
 	void insert(std::initializer_list<T> list);
 
+	/**
+	 * Insert a value which is expected to be right before "hint", e.g.
+	 * end() for appending, or lower_bound() of a nearby value.
+	 *
+	 * "hint" and its neighbor are compared with the value first, and
+	 * the tree is descended only if "hint" is wrong.
+	 *
+	 * @return The inserted element, or the existing equal one.
+	 */
+	iterator insert(const_iterator hint, const T& value);
+	iterator insert(const_iterator hint, T&& value);
+
+	// Like insert(hint, value), but the value is constructed from "args" first.
+	template <class... Args>
+	iterator emplace_hint(const_iterator hint, Args&&... args);
+
 	void erase(iterator it);
 	void erase(iterator first, iterator last);
 	size_t erase(const T& value);
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	size_t erase(const K& key);
+
+	/**
+	 * Move elements which are not less than "value" into a new tree.
+	 *
+	 * It's O(log n), plus counting elements of the smaller part unless
+	 * rbtree_order_statistic_policy_t is used. Nodes are not moved, so
+	 * both trees share the memory of their nodes until the last one of
+	 * them gives it back. Iterators of the new tree's elements are invalidated.
+	 */
+	self_type split(const T& value);
+
+	/**
+	 * Move all elements of "right" into this tree in O(log n), they must
+	 * be greater than all elements of this tree. "right" is left empty.
+	 */
+	self_type& join(self_type& right);
+	self_type& join(self_type&& right);
+
+	/**
+	 * Union, intersection and difference of this tree and "another", in place.
+	 *
+	 * Nodes of "another" are moved or dropped, so it's left empty. The element
+	 * of this tree is kept if both trees have equal ones. See rbtree_union().
+	 */
+	self_type& unite(self_type&& another, size_t threads = 1);
+	self_type& intersect(self_type&& another, size_t threads = 1);
+	self_type& subtract(self_type&& another, size_t threads = 1);
 
 	iterator begin();
 	iterator end();
@@ -637,12 +2454,24 @@ public:
 	self_type& swap(self_type& another);
 
 private:
+	template <class Iterator>
+	bool is_strictly_sorted_i(Iterator first, Iterator last) const;
+
+	template <class Iterator>
+	void bulk_load_i(Iterator first, Iterator last, const std::forward_iterator_tag&);
+
+	template <class Iterator>
+	void bulk_load_i(Iterator first, Iterator last, const std::input_iterator_tag&);
+
+	self_type& set_operation_i(self_type& another, rbtree__::set_operation_t operation, size_t threads);
+
+protected:
 	ctner_type* m_ctner;
 };
 
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::iterator rbtree_t<T, Compare>::find(const T& value) {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::find(const T& value) {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -657,8 +2486,8 @@ inline typename rbtree_t<T, Compare>::iterator rbtree_t<T, Compare>::find(const
 	}
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::const_iterator rbtree_t<T, Compare>::find(const T& value) const {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::find(const T& value) const {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -673,37 +2502,326 @@ inline typename rbtree_t<T, Compare>::const_iterator rbtree_t<T, Compare>::find(
 	}
 }
 
-template <class T, class Compare>
-inline std::pair<typename rbtree_t<T, Compare>::iterator, bool> rbtree_t<T, Compare>::insert(const T& value) {
+template <class T, class Compare, class Policy, class Allocator>
+inline size_t rbtree_t<T, Compare, Policy, Allocator>::count(const T& value) const {
+	if (this->m_ctner == 0) {
+		return 0;
+	}
+
+	return this->m_ctner->find(value).m_result == rbtree__::find_result_yes ? 1 : 0;
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::lower_bound(const T& value) {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return iterator(this->m_ctner, this->m_ctner->lower_bound(value));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::lower_bound(const T& value) const {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return const_iterator(this->m_ctner, this->m_ctner->lower_bound(value));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::upper_bound(const T& value) {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return iterator(this->m_ctner, this->m_ctner->upper_bound(value));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::upper_bound(const T& value) const {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return const_iterator(this->m_ctner, this->m_ctner->upper_bound(value));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::iterator, typename rbtree_t<T, Compare, Policy, Allocator>::iterator>
+rbtree_t<T, Compare, Policy, Allocator>::equal_range(const T& value) {
+	return std::pair<iterator, iterator>(this->lower_bound(value), this->upper_bound(value));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator, typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator>
+rbtree_t<T, Compare, Policy, Allocator>::equal_range(const T& value) const {
+	return std::pair<const_iterator, const_iterator>(this->lower_bound(value), this->upper_bound(value));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::find(const K& key) {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	const auto found(this->m_ctner->find(key));
+	return iterator(this->m_ctner, found.m_result == rbtree__::find_result_yes ? found.m_node_ptr : 0);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::find(const K& key) const {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	const auto found(this->m_ctner->find(key));
+	return const_iterator(this->m_ctner, found.m_result == rbtree__::find_result_yes ? found.m_node_ptr : 0);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline size_t rbtree_t<T, Compare, Policy, Allocator>::count(const K& key) const {
+	if (this->m_ctner == 0) {
+		return 0;
+	}
+
+	return this->m_ctner->find(key).m_result == rbtree__::find_result_yes ? 1 : 0;
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::lower_bound(const K& key) {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return iterator(this->m_ctner, this->m_ctner->lower_bound(key));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::lower_bound(const K& key) const {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return const_iterator(this->m_ctner, this->m_ctner->lower_bound(key));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::upper_bound(const K& key) {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return iterator(this->m_ctner, this->m_ctner->upper_bound(key));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::upper_bound(const K& key) const {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return const_iterator(this->m_ctner, this->m_ctner->upper_bound(key));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::iterator, typename rbtree_t<T, Compare, Policy, Allocator>::iterator>
+rbtree_t<T, Compare, Policy, Allocator>::equal_range(const K& key) {
+	return std::pair<iterator, iterator>(this->lower_bound(key), this->upper_bound(key));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator, typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator>
+rbtree_t<T, Compare, Policy, Allocator>::equal_range(const K& key) const {
+	return std::pair<const_iterator, const_iterator>(this->lower_bound(key), this->upper_bound(key));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class Functor>
+inline size_t rbtree_t<T, Compare, Policy, Allocator>::for_each_in_range(const T& low, const T& high, Functor functor) const {
+	if (this->m_ctner == 0) {
+		return 0;
+	}
+
+	const auto less = this->m_ctner->key_compare();
+	size_t count = 0;
+
+	for (const_node_ptr_t ptr = this->m_ctner->lower_bound(low);
+		ptr != 0 && less(ptr->m_value, high); ptr = ctner_type::next(ptr)) {
+		functor((const T&) ptr->m_value);
+		++count;
+	}
+
+	return count;
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline size_t rbtree_t<T, Compare, Policy, Allocator>::rank(const T& value) const {
+	return this->m_ctner == 0 ? 0 : this->m_ctner->rank(value);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::select(size_t index) {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return iterator(this->m_ctner, this->m_ctner->select(index));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::select(size_t index) const {
+	if (this->m_ctner == 0) {
+		return this->end();
+	}
+
+	return const_iterator(this->m_ctner, this->m_ctner->select(index));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class Iterator>
+inline void rbtree_t<T, Compare, Policy, Allocator>::insert(Iterator first, Iterator last) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	if (this->m_ctner->size() == 0) {
+		this->bulk_load_i(first, last, typename std::iterator_traits<Iterator>::iterator_category());
+		return;
+	}
+
+	for (auto it = first; it != last; ++it) {
+		this->insert(*it);
+	}
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class Iterator>
+inline void rbtree_t<T, Compare, Policy, Allocator>::assign_sorted(Iterator first, Iterator last) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	this->m_ctner->assign_sorted(first, last);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class Iterator>
+inline bool rbtree_t<T, Compare, Policy, Allocator>::is_strictly_sorted_i(Iterator first, Iterator last) const {
+	const auto less = this->m_ctner->key_compare();
+
+	if (first == last) {
+		return true;
+	}
+
+	for (auto prev = first++; first != last; prev = first++) {
+		if (!less(*prev, *first)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Forward iterators could be walked twice, sorted input is built directly.
+template <class T, class Compare, class Policy, class Allocator>
+template <class Iterator>
+inline void rbtree_t<T, Compare, Policy, Allocator>::bulk_load_i(Iterator first, Iterator last, const std::forward_iterator_tag&) {
+	if (this->is_strictly_sorted_i(first, last)) {
+		this->m_ctner->assign_sorted(first, last);
+	}
+	else {
+		this->bulk_load_i(first, last, std::input_iterator_tag());
+	}
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+template <class Iterator>
+inline void rbtree_t<T, Compare, Policy, Allocator>::bulk_load_i(Iterator first, Iterator last, const std::input_iterator_tag&) {
+	const auto less = this->m_ctner->key_compare();
+	std::vector<T> values(first, last);
+
+	// Stable, so that the first one of equal values is kept.
+	std::stable_sort(values.begin(), values.end(), less);
+	values.erase(std::unique(values.begin(), values.end(),
+		[&less](const T& v1, const T& v2) { return !less(v1, v2); }), values.end());
+
+	this->m_ctner->assign_sorted(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::iterator, bool> rbtree_t<T, Compare, Policy, Allocator>::insert(const T& value) {
 	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
 	assert(this->m_ctner != 0);
 
 	auto result = this->m_ctner->insert(value, std::false_type());
 
-	return std::pair<typename rbtree_t<T, Compare>::iterator, bool>(
+	return std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::iterator, bool>(
 		iterator(this->m_ctner, result.first), result.second);
 }
 
-template <class T, class Compare>
-inline std::pair<typename rbtree_t<T, Compare>::iterator, bool> rbtree_t<T, Compare>::insert(T&& value) {
+template <class T, class Compare, class Policy, class Allocator>
+inline std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::iterator, bool> rbtree_t<T, Compare, Policy, Allocator>::insert(T&& value) {
 	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
 	assert(this->m_ctner != 0);
 
 	auto result = this->m_ctner->insert(value, std::true_type());
 
-	return std::pair<typename rbtree_t<T, Compare>::iterator, bool>(
+	return std::pair<typename rbtree_t<T, Compare, Policy, Allocator>::iterator, bool>(
 		iterator(this->m_ctner, result.first), result.second);
 }
 
-template <class T, class Compare>
-inline void rbtree_t<T, Compare>::insert(std::initializer_list<T> list) {
-	for (auto it = list.begin(); it != list.end(); ++it) {
-		this->insert(*it);
-	}
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::insert(
+	typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator hint, const T& value) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	// Iterators of other trees are taken as end().
+	const auto hint_ptr = hint.get_ctner_ptr__() == this->m_ctner ? hint.get_node_ptr__() : 0;
+
+	return iterator(this->m_ctner, this->m_ctner->insert(hint_ptr, value, std::false_type()).first);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::insert(
+	typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator hint, T&& value) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	// Iterators of other trees are taken as end().
+	const auto hint_ptr = hint.get_ctner_ptr__() == this->m_ctner ? hint.get_node_ptr__() : 0;
+
+	return iterator(this->m_ctner, this->m_ctner->insert(hint_ptr, value, std::true_type()).first);
 }
 
-template <class T, class Compare>
-inline void rbtree_t<T, Compare>::erase(typename rbtree_t<T, Compare>::iterator it) {
+template <class T, class Compare, class Policy, class Allocator>
+template <class... Args>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::emplace_hint(
+	typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator hint, Args&&... args) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	// Iterators of other trees are taken as end().
+	const auto hint_ptr = hint.get_ctner_ptr__() == this->m_ctner ? hint.get_node_ptr__() : 0;
+
+	return iterator(this->m_ctner, this->m_ctner->emplace_hint(hint_ptr, std::forward<Args>(args)...).first);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline void rbtree_t<T, Compare, Policy, Allocator>::insert(std::initializer_list<T> list) {
+	this->insert(list.begin(), list.end());
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline void rbtree_t<T, Compare, Policy, Allocator>::erase(typename rbtree_t<T, Compare, Policy, Allocator>::iterator it) {
 	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
 	assert(this->m_ctner != 0);
 
@@ -718,17 +2836,17 @@ inline void rbtree_t<T, Compare>::erase(typename rbtree_t<T, Compare>::iterator
 	}
 }
 
-template <class T, class Compare>
-inline void rbtree_t<T, Compare>::erase(
-	typename rbtree_t<T, Compare>::iterator first,
-	typename rbtree_t<T, Compare>::iterator last) {
+template <class T, class Compare, class Policy, class Allocator>
+inline void rbtree_t<T, Compare, Policy, Allocator>::erase(
+	typename rbtree_t<T, Compare, Policy, Allocator>::iterator first,
+	typename rbtree_t<T, Compare, Policy, Allocator>::iterator last) {
 	for (auto it = first; it != last;) {
 		this->erase(it++);
 	}
 }
 
-template <class T, class Compare>
-inline size_t rbtree_t<T, Compare>::erase(const T& value) {
+template <class T, class Compare, class Policy, class Allocator>
+inline size_t rbtree_t<T, Compare, Policy, Allocator>::erase(const T& value) {
 	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
 	assert(this->m_ctner != 0);
 
@@ -742,8 +2860,90 @@ inline size_t rbtree_t<T, Compare>::erase(const T& value) {
 	return 1;
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::iterator rbtree_t<T, Compare>::begin() {
+template <class T, class Compare, class Policy, class Allocator>
+template <class K, class C, class>
+inline size_t rbtree_t<T, Compare, Policy, Allocator>::erase(const K& key) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	const auto found(this->m_ctner->find(key));
+
+	if (found.m_result != rbtree__::find_result_yes) {
+		return 0;
+	}
+
+	this->m_ctner->erase(found.m_node_ptr);
+	return 1;
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type rbtree_t<T, Compare, Policy, Allocator>::split(const T& value) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	self_type right(this->key_comp(), this->get_allocator());
+	this->m_ctner->split(value, *right.m_ctner);
+
+	return right;
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::join(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type& right) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	if (this != &right && right.m_ctner != 0) {
+		this->m_ctner->join(*right.m_ctner);
+	}
+
+	return *this;
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::join(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type&& right) {
+	return this->join(right);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::unite(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type&& another, size_t threads) {
+	return this->set_operation_i(another, rbtree__::set_operation_union, threads);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::intersect(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type&& another, size_t threads) {
+	return this->set_operation_i(another, rbtree__::set_operation_intersection, threads);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::subtract(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type&& another, size_t threads) {
+	return this->set_operation_i(another, rbtree__::set_operation_difference, threads);
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::set_operation_i(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type& another, rbtree__::set_operation_t operation, size_t threads) {
+	// Once a rvalue tree has been moved, we do not allow to update the tree any more.
+	assert(this->m_ctner != 0);
+
+	if (this == &another) {
+		if (operation == rbtree__::set_operation_difference) {
+			this->clear();
+		}
+	}
+	else if (another.m_ctner != 0) {
+		this->m_ctner->set_operation(*another.m_ctner, operation, threads);
+	}
+
+	return *this;
+}
+
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::begin() {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -751,13 +2951,13 @@ inline typename rbtree_t<T, Compare>::iterator rbtree_t<T, Compare>::begin() {
 	return iterator(this->m_ctner, this->m_ctner->get_smallest());
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::iterator rbtree_t<T, Compare>::end() {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::iterator rbtree_t<T, Compare, Policy, Allocator>::end() {
 	return iterator(this->m_ctner);
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::const_iterator rbtree_t<T, Compare>::begin() const {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::begin() const {
 	if (this->m_ctner == 0) {
 		return this->end();
 	}
@@ -765,34 +2965,34 @@ inline typename rbtree_t<T, Compare>::const_iterator rbtree_t<T, Compare>::begin
 	return const_iterator(this->m_ctner, this->m_ctner->get_smallest());
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::const_iterator rbtree_t<T, Compare>::end() const {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::const_iterator rbtree_t<T, Compare, Policy, Allocator>::end() const {
 	return const_iterator(this->m_ctner);
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::reverse_iterator rbtree_t<T, Compare>::rbegin() {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::reverse_iterator rbtree_t<T, Compare, Policy, Allocator>::rbegin() {
 	return reverse_iterator(this->end());
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::reverse_iterator rbtree_t<T, Compare>::rend() {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::reverse_iterator rbtree_t<T, Compare, Policy, Allocator>::rend() {
 	return reverse_iterator(this->begin());
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::reverse_const_iterator rbtree_t<T, Compare>::rbegin() const {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::reverse_const_iterator rbtree_t<T, Compare, Policy, Allocator>::rbegin() const {
 	return reverse_const_iterator(this->end());
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::reverse_const_iterator rbtree_t<T, Compare>::rend() const {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::reverse_const_iterator rbtree_t<T, Compare, Policy, Allocator>::rend() const {
 	return reverse_const_iterator(this->begin());
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::self_type& rbtree_t<T, Compare>::operator=(
-	const typename rbtree_t<T, Compare>::self_type& another) {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::operator=(
+	const typename rbtree_t<T, Compare, Policy, Allocator>::self_type& another) {
 
 	if (this == &another) {
 		return *this;
@@ -814,9 +3014,9 @@ inline typename rbtree_t<T, Compare>::self_type& rbtree_t<T, Compare>::operator=
 	return *this;
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::self_type& rbtree_t<T, Compare>::operator=(
-	typename rbtree_t<T, Compare>::self_type&& another) {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::operator=(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type&& another) {
 	
 	if (this == &another) {
 		return *this;
@@ -829,16 +3029,16 @@ inline typename rbtree_t<T, Compare>::self_type& rbtree_t<T, Compare>::operator=
 	return *this;
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::self_type& rbtree_t<T, Compare>::operator=(std::initializer_list<T> list) {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::operator=(std::initializer_list<T> list) {
 	this->clear();
 	this->insert(list);
 	return *this;
 }
 
-template <class T, class Compare>
-inline typename rbtree_t<T, Compare>::self_type& rbtree_t<T, Compare>::swap(
-	typename rbtree_t<T, Compare>::self_type& another) {
+template <class T, class Compare, class Policy, class Allocator>
+inline typename rbtree_t<T, Compare, Policy, Allocator>::self_type& rbtree_t<T, Compare, Policy, Allocator>::swap(
+	typename rbtree_t<T, Compare, Policy, Allocator>::self_type& another) {
 	if (this != &another) {
 		auto tmp(this->m_ctner);
 		this->m_ctner = another.m_ctner;
@@ -848,14 +3048,50 @@ inline typename rbtree_t<T, Compare>::self_type& rbtree_t<T, Compare>::swap(
 	return *this;
 }
 
+/**
+ * Elements of "tree1" or "tree2", the element of "tree1" is kept if both have it.
+ *
+ * "tree2" splits "tree1" by its root, halves are merged recursively and
+ * joined back by rbtree_t::unite(), so it's O(m log(n/m + 1)) for sizes
+ * m <= n. Merging halves of the top log2(threads) levels is forked to new
+ * threads, "Compare" must be callable concurrently and must not throw.
+ *
+ * Trees are taken by value, pass them by std::move() to avoid copies.
+ */
+template <class T, class Compare, class Policy, class Allocator>
+inline rbtree_t<T, Compare, Policy, Allocator> rbtree_union(
+	rbtree_t<T, Compare, Policy, Allocator> tree1,
+	rbtree_t<T, Compare, Policy, Allocator> tree2, size_t threads = 1) {
+	tree1.unite(std::move(tree2), threads);
+	return tree1;
+}
+
+// Elements of "tree1" which "tree2" also has, see rbtree_union().
+template <class T, class Compare, class Policy, class Allocator>
+inline rbtree_t<T, Compare, Policy, Allocator> rbtree_intersection(
+	rbtree_t<T, Compare, Policy, Allocator> tree1,
+	rbtree_t<T, Compare, Policy, Allocator> tree2, size_t threads = 1) {
+	tree1.intersect(std::move(tree2), threads);
+	return tree1;
+}
+
+// Elements of "tree1" which "tree2" does not have, see rbtree_union().
+template <class T, class Compare, class Policy, class Allocator>
+inline rbtree_t<T, Compare, Policy, Allocator> rbtree_difference(
+	rbtree_t<T, Compare, Policy, Allocator> tree1,
+	rbtree_t<T, Compare, Policy, Allocator> tree2, size_t threads = 1) {
+	tree1.subtract(std::move(tree2), threads);
+	return tree1;
+}
+
 } // namespace algo
 
 
 namespace std {
 
 // Override std::swap() to offer better performance.
-template <class T, class Compare>
-inline void swap(algo::rbtree_t<T, Compare>& v1, algo::rbtree_t<T, Compare>& v2) {
+template <class T, class Compare, class Policy, class Allocator>
+inline void swap(algo::rbtree_t<T, Compare, Policy, Allocator>& v1, algo::rbtree_t<T, Compare, Policy, Allocator>& v2) {
 	v1.swap(v2);
 }
 
@@ -0,0 +1,444 @@
+/**
+ * Ordered map based on Red-Black Tree.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/rbtree.h"
+#include <assert.h>
+#include <stddef.h>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <initializer_list>
+#include <tuple>
+
+
+namespace algo {
+
+// Internal implementation.
+namespace rbtree_map__ {
+
+	// Order elements by keys only. Keys could be on either side,
+	// so that the tree is always searched without creating an element.
+	template <class Key, class T, class Compare>
+	class value_compare_t {
+	public:
+		typedef void is_transparent;
+		typedef std::pair<const Key, T> value_type;
+
+	public:
+		explicit value_compare_t(const Compare& less = Compare()) : m_less(less) {
+		}
+
+		bool operator()(const value_type& value1, const value_type& value2) const {
+			return m_less(value1.first, value2.first);
+		}
+
+		template <class K>
+		bool operator()(const value_type& value, const K& key) const {
+			return m_less(value.first, key);
+		}
+
+		template <class K>
+		bool operator()(const K& key, const value_type& value) const {
+			return m_less(key, value.first);
+		}
+
+		Compare key_comp() const {
+			return m_less;
+		}
+
+	private:
+		Compare m_less;
+	};
+
+} // namespace rbtree_map__
+
+
+/**
+ * Ordered map, i.e. a rbtree_t whose elements are (key, value) pairs
+ * ordered by keys.
+ *
+ * Balancing, policies, the node pool and iterators are all the same as
+ * rbtree_t. Keys could not be modified through iterators, values could.
+ *
+ * If "Compare::is_transparent" is defined (e.g. string_less_t), the map
+ * could be searched by anything "Compare" accepts, e.g. a map of
+ * std::string by basic_string_ref_t, without creating a temporary key.
+ *
+ * operator[](), try_emplace() and insert_or_assign() descend the tree
+ * only once, the new element is linked where the key was not found.
+ */
+template <class Key, class T, class Compare = std::less<Key>, class Policy = rbtree_default_policy_t,
+	class Allocator = std::allocator<std::pair<const Key, T>>>
+class rbtree_map_t : private rbtree_t<std::pair<const Key, T>,
+	rbtree_map__::value_compare_t<Key, T, Compare>, Policy, Allocator> {
+private:
+	typedef rbtree_map_t<Key, T, Compare, Policy, Allocator> self_type;
+	typedef rbtree_t<std::pair<const Key, T>,
+		rbtree_map__::value_compare_t<Key, T, Compare>, Policy, Allocator> base_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef Compare key_compare;
+	typedef rbtree_map__::value_compare_t<Key, T, Compare> value_compare;
+	typedef typename base_type::value_type value_type;
+	typedef typename base_type::policy_type policy_type;
+	typedef typename base_type::allocator_type allocator_type;
+	typedef typename base_type::reference reference;
+	typedef typename base_type::const_reference const_reference;
+	typedef typename base_type::size_type size_type;
+	typedef typename base_type::difference_type difference_type;
+	typedef typename base_type::pointer pointer;
+	typedef typename base_type::const_pointer const_pointer;
+	typedef typename base_type::iterator iterator;
+	typedef typename base_type::const_iterator const_iterator;
+	typedef typename base_type::reverse_iterator reverse_iterator;
+	typedef typename base_type::reverse_const_iterator reverse_const_iterator;
+
+public:
+	rbtree_map_t() {
+	}
+
+	explicit rbtree_map_t(const Compare& less, const Allocator& allocator = Allocator())
+		: base_type(value_compare(less), allocator) {
+	}
+
+	rbtree_map_t(std::initializer_list<value_type> list, const Compare& less = Compare(),
+		const Allocator& allocator = Allocator())
+		: base_type(value_compare(less), allocator) {
+		this->insert(list);
+	}
+
+	using base_type::size;
+	using base_type::max_size;
+	using base_type::empty;
+	using base_type::clear;
+	using base_type::get_allocator;
+	using base_type::memory_bytes;
+	using base_type::compact;
+	using base_type::height;
+	using base_type::check_invariants;
+	using base_type::assign_sorted;
+	using base_type::select;
+	using base_type::begin;
+	using base_type::end;
+	using base_type::rbegin;
+	using base_type::rend;
+
+	key_compare key_comp() const {
+		return base_type::key_comp().key_comp();
+	}
+
+	value_compare value_comp() const {
+		return base_type::key_comp();
+	}
+
+	iterator find(const Key& key) {
+		return base_type::find(key);
+	}
+
+	const_iterator find(const Key& key) const {
+		return base_type::find(key);
+	}
+
+	size_t count(const Key& key) const {
+		return base_type::count(key);
+	}
+
+	bool contains(const Key& key) const {
+		return base_type::count(key) != 0;
+	}
+
+	// The first element whose key is not less than "key".
+	iterator lower_bound(const Key& key) {
+		return base_type::lower_bound(key);
+	}
+
+	const_iterator lower_bound(const Key& key) const {
+		return base_type::lower_bound(key);
+	}
+
+	// The first element whose key is greater than "key".
+	iterator upper_bound(const Key& key) {
+		return base_type::upper_bound(key);
+	}
+
+	const_iterator upper_bound(const Key& key) const {
+		return base_type::upper_bound(key);
+	}
+
+	std::pair<iterator, iterator> equal_range(const Key& key) {
+		return base_type::equal_range(key);
+	}
+
+	std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+		return base_type::equal_range(key);
+	}
+
+	// Number of elements whose keys are less than "key",
+	// rbtree_order_statistic_policy_t is required.
+	size_t rank(const Key& key) const {
+		return this->m_ctner == 0 ? 0 : this->m_ctner->rank(key);
+	}
+
+	// Heterogeneous lookup, available if "Compare::is_transparent" is defined.
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K& key) {
+		return base_type::find(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K& key) const {
+		return base_type::find(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K& key) const {
+		return base_type::count(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K& key) const {
+		return base_type::count(key) != 0;
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K& key) {
+		return base_type::lower_bound(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator lower_bound(const K& key) const {
+		return base_type::lower_bound(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator upper_bound(const K& key) {
+		return base_type::upper_bound(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator upper_bound(const K& key) const {
+		return base_type::upper_bound(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	std::pair<iterator, iterator> equal_range(const K& key) {
+		return base_type::equal_range(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+		return base_type::equal_range(key);
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return base_type::insert(value);
+	}
+
+	std::pair<iterator, bool> insert(value_type&& value) {
+		return base_type::insert(std::move(value));
+	}
+
+	// Elements are inserted one by one, see assign_sorted()
+	// for building the map from sorted elements in O(n).
+	template <class Iterator>
+	void insert(Iterator first, Iterator last) {
+		for (; first != last; ++first) {
+			this->insert(*first);
+		}
+	}
+
+	void insert(std::initializer_list<value_type> list) {
+		this->insert(list.begin(), list.end());
+	}
+
+	// See rbtree_t::insert(hint, value).
+	iterator insert(const_iterator hint, const value_type& value) {
+		return base_type::insert(hint, value);
+	}
+
+	iterator insert(const_iterator hint, value_type&& value) {
+		return base_type::insert(hint, std::move(value));
+	}
+
+	using base_type::emplace_hint;
+
+	/**
+	 * Insert an element whose value is constructed from "args"
+	 * if the key does not exist, otherwise nothing is changed
+	 * ("args" are not even moved).
+	 *
+	 * @return The element, and true if it's newly inserted.
+	 */
+	template <class... Args>
+	std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args);
+
+	template <class... Args>
+	std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args);
+
+	// The key is created from "key" only if it's inserted,
+	// available if "Compare::is_transparent" is defined.
+	template <class K, class... Args, class C = Compare, class = typename C::is_transparent>
+	std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+
+	/**
+	 * Insert an element if the key does not exist,
+	 * otherwise assign "value" to the existing one.
+	 *
+	 * @return The element, and true if it's newly inserted.
+	 */
+	template <class M>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, M&& value);
+
+	template <class M>
+	std::pair<iterator, bool> insert_or_assign(Key&& key, M&& value);
+
+	template <class K, class M, class C = Compare, class = typename C::is_transparent>
+	std::pair<iterator, bool> insert_or_assign(const K& key, M&& value);
+
+	// Value of "key", a default-constructed one is inserted if the key does not exist.
+	T& operator[](const Key& key) {
+		return this->try_emplace(key).first->second;
+	}
+
+	T& operator[](Key&& key) {
+		return this->try_emplace(std::move(key)).first->second;
+	}
+
+	void erase(iterator it) {
+		base_type::erase(it);
+	}
+
+	void erase(iterator first, iterator last) {
+		base_type::erase(first, last);
+	}
+
+	size_t erase(const Key& key) {
+		return base_type::erase(key);
+	}
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	size_t erase(const K& key) {
+		return base_type::erase(key);
+	}
+
+	self_type& operator=(std::initializer_list<value_type> list) {
+		this->clear();
+		this->insert(list);
+		return *this;
+	}
+
+	self_type& swap(self_type& another) {
+		base_type::swap(another);
+		return *this;
+	}
+
+private:
+	template <class KeyArg, class... Args>
+	std::pair<iterator, bool> try_emplace_i(KeyArg&& key, Args&&... args);
+
+	template <class KeyArg, class M>
+	std::pair<iterator, bool> insert_or_assign_i(KeyArg&& key, M&& value);
+};
+
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class... Args>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::try_emplace(const Key& key, Args&&... args) {
+	return this->try_emplace_i(key, std::forward<Args>(args)...);
+}
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class... Args>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::try_emplace(Key&& key, Args&&... args) {
+	return this->try_emplace_i(std::move(key), std::forward<Args>(args)...);
+}
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class K, class... Args, class C, class>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::try_emplace(const K& key, Args&&... args) {
+	return this->try_emplace_i(key, std::forward<Args>(args)...);
+}
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class M>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::insert_or_assign(const Key& key, M&& value) {
+	return this->insert_or_assign_i(key, std::forward<M>(value));
+}
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class M>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::insert_or_assign(Key&& key, M&& value) {
+	return this->insert_or_assign_i(std::move(key), std::forward<M>(value));
+}
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class K, class M, class C, class>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::insert_or_assign(const K& key, M&& value) {
+	return this->insert_or_assign_i(key, std::forward<M>(value));
+}
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class KeyArg, class... Args>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::try_emplace_i(KeyArg&& key, Args&&... args) {
+	// Once a rvalue map has been moved, we do not allow to update the map any more.
+	assert(this->m_ctner != 0);
+
+	const auto found(this->m_ctner->find_for_insert(key));
+
+	if (found.m_result == rbtree__::find_result_yes) {
+		return std::pair<iterator, bool>(iterator(this->m_ctner, found.m_node_ptr), false);
+	}
+
+	const auto node_ptr = this->m_ctner->emplace_at(found, std::piecewise_construct,
+		std::forward_as_tuple(std::forward<KeyArg>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+
+	return std::pair<iterator, bool>(iterator(this->m_ctner, node_ptr), true);
+}
+
+template <class Key, class T, class Compare, class Policy, class Allocator>
+template <class KeyArg, class M>
+inline std::pair<typename rbtree_map_t<Key, T, Compare, Policy, Allocator>::iterator, bool>
+rbtree_map_t<Key, T, Compare, Policy, Allocator>::insert_or_assign_i(KeyArg&& key, M&& value) {
+	// Once a rvalue map has been moved, we do not allow to update the map any more.
+	assert(this->m_ctner != 0);
+
+	const auto found(this->m_ctner->find_for_insert(key));
+
+	if (found.m_result == rbtree__::find_result_yes) {
+		found.m_node_ptr->m_value.second = std::forward<M>(value);
+		return std::pair<iterator, bool>(iterator(this->m_ctner, found.m_node_ptr), false);
+	}
+
+	const auto node_ptr = this->m_ctner->emplace_at(found, std::piecewise_construct,
+		std::forward_as_tuple(std::forward<KeyArg>(key)), std::forward_as_tuple(std::forward<M>(value)));
+
+	return std::pair<iterator, bool>(iterator(this->m_ctner, node_ptr), true);
+}
+
+} // namespace algo
+
+
+namespace std {
+
+// Override std::swap() to offer better performance.
+template <class Key, class T, class Compare, class Policy, class Allocator>
+inline void swap(algo::rbtree_map_t<Key, T, Compare, Policy, Allocator>& v1,
+	algo::rbtree_map_t<Key, T, Compare, Policy, Allocator>& v2) {
+	v1.swap(v2);
+}
+
+}
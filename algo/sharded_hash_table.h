@@ -0,0 +1,518 @@
+/**
+ * Sharded hash table.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "algo/hash_table.h"
+#include "algo/key_traits.h"
+#include "algo/node_pool.h"
+#include <assert.h>
+#include <stdint.h>
+#include <iterator>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+
+namespace algo {
+
+// Internal implementation.
+namespace sharded_hash_table__ {
+
+	// Most CPUs have 64-byte cache lines.
+	const size_t const_cache_line_size = 64;
+
+	// Shard index is taken from the high bits of the mixed hash value,
+	// while hash_table_t uses "hash % array_size", so both stay independent
+	// even for identity hashes of small integers.
+	template <size_t Shards>
+	inline size_t shard_index(size_t hash) {
+		static_assert(Shards > 0 && (Shards & (Shards - 1)) == 0, "Shards must be a power of two");
+
+		size_t bits = 0;
+		while ((size_t(1) << bits) < Shards) {
+			++bits;
+		}
+
+		if (bits == 0) {
+			return 0;
+		}
+
+		return (size_t)((uint64_t(hash) * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+	}
+
+	// One shard: its own lock, its own node arena and its own table.
+	// Padding keeps the lock of one shard away from its neighbours' cache lines.
+	template <class Table>
+	struct shard_t {
+		template <class KeyTraits>
+		shard_t(const KeyTraits& key_traits, size_t array_size) : m_table(key_traits, array_size) {
+		}
+
+		char m_padding1[const_cache_line_size];
+		std::mutex m_mutex;
+		Table m_table;
+		char m_padding2[const_cache_line_size];
+	};
+
+	// Indexes "0, 1, ..., N - 1" as a parameter pack, to construct every shard in place.
+	template <size_t... Indexes>
+	struct indexes_t {
+	};
+
+	template <size_t N, size_t... Indexes>
+	struct make_indexes_t : make_indexes_t<N - 1, N - 1, Indexes...> {
+	};
+
+	template <size_t... Indexes>
+	struct make_indexes_t<0, Indexes...> {
+		typedef indexes_t<Indexes...> type;
+	};
+
+	// "value" itself, for each index of a pack expansion.
+	template <size_t Index, class T>
+	inline const T& repeat(const T& value) {
+		return value;
+	}
+
+	template <class Key, class T, class Pointer, class Reference, class ShardPointer, class TableIterator>
+	class iterator_t : public std::iterator<
+			std::forward_iterator_tag,
+			std::pair<const Key, T>, std::ptrdiff_t, Pointer, Reference> {
+	private:
+		typedef iterator_t<Key, T, Pointer, Reference, ShardPointer, TableIterator> self_type;
+
+	public:
+		iterator_t() : m_shards(0), m_shard_count(0), m_index(0) {
+		}
+
+		iterator_t(ShardPointer shards, size_t shard_count, size_t index)
+			: m_shards(shards), m_shard_count(shard_count), m_index(index) {
+			if (m_index < m_shard_count) {
+				m_current = m_shards[m_index].m_table.begin();
+				this->skip_empty_i();
+			}
+		}
+
+		Reference operator*() const {
+			assert(m_index < m_shard_count);
+			return *m_current;
+		}
+
+		Pointer operator->() const {
+			assert(m_index < m_shard_count);
+			return &(*m_current);
+		}
+
+		self_type& operator++() {
+			assert(m_index < m_shard_count);
+
+			++m_current;
+			this->skip_empty_i();
+
+			return *this;
+		}
+
+		self_type operator++(int) {
+			const self_type old(*this);
+			this->operator++();
+			return old;
+		}
+
+		bool operator==(const self_type& it) const {
+			if (this->m_shards != it.m_shards || this->m_index != it.m_index) {
+				return false;
+			}
+
+			return this->m_index >= this->m_shard_count || this->m_current == it.m_current;
+		}
+
+		bool operator!=(const self_type& it) const {
+			return !this->operator==(it);
+		}
+
+	private:
+		void skip_empty_i() {
+			while (m_current == m_shards[m_index].m_table.end()) {
+				if (++m_index == m_shard_count) {
+					return;
+				}
+
+				m_current = m_shards[m_index].m_table.begin();
+			}
+		}
+
+	private:
+		ShardPointer m_shards;
+		size_t m_shard_count;
+		size_t m_index;
+		TableIterator m_current;
+	};
+}
+
+
+/**
+ * Sharded hash table.
+ *
+ * Keys are routed to "Shards" independent hash_table_t instances by the
+ * high bits of the hash value. Each shard has its own lock and node arena,
+ * so writers on different shards never touch the same cache lines.
+ *
+ * Bulk functions group a batch by shard first, and then take each
+ * shard lock only once for the whole batch.
+ *
+ * All functions except iterators are thread-safe. Iterators must not be
+ * used while other threads are updating the table, use for_each() instead.
+ */
+template <class Key, class T, class KeyTraits = key_traits_t<Key>, size_t Shards = 16>
+class sharded_hash_table_t {
+private:
+	typedef sharded_hash_table_t<Key, T, KeyTraits, Shards> self_type;
+
+public:
+	typedef Key key_type;
+	typedef T mapped_type;
+	typedef std::pair<const Key, T> value_type;
+	typedef KeyTraits key_traits;
+	typedef size_t size_type;
+	typedef value_type& reference;
+	typedef const value_type& const_reference;
+	typedef value_type* pointer;
+	typedef const value_type* const_pointer;
+
+	// Table of a single shard.
+	typedef hash_table_t<Key, T, KeyTraits, pool_allocator_t<value_type>> shard_table_type;
+
+private:
+	typedef sharded_hash_table__::shard_t<shard_table_type> shard_type;
+
+public:
+	typedef sharded_hash_table__::iterator_t<Key, T, pointer, reference,
+		shard_type*, typename shard_table_type::iterator> iterator;
+	typedef sharded_hash_table__::iterator_t<Key, T, const_pointer, const_reference,
+		const shard_type*, typename shard_table_type::const_iterator> const_iterator;
+
+	static const size_t const_shard_count = Shards;
+
+	// Default hash table array size of each shard.
+	static const size_t const_default_array_size = shard_table_type::const_default_array_size;
+
+public:
+	sharded_hash_table_t() : sharded_hash_table_t(KeyTraits(), const_default_array_size) {
+	}
+
+	explicit sharded_hash_table_t(size_t array_size)
+		: sharded_hash_table_t(KeyTraits(), array_size) {
+	}
+
+	explicit sharded_hash_table_t(const KeyTraits& key_traits, size_t array_size = const_default_array_size)
+		: sharded_hash_table_t(key_traits, array_size, typename sharded_hash_table__::make_indexes_t<Shards>::type()) {
+	}
+
+	size_t size() const;
+
+	bool empty() const {
+		return this->size() == 0;
+	}
+
+	key_traits key_comp() const {
+		return m_key_traits;
+	}
+
+	// Which shard the key goes to.
+	size_t shard_of(const Key& key) const {
+		return sharded_hash_table__::shard_index<Shards>(m_key_traits.hash(key));
+	}
+
+	// Number of elements in a shard.
+	size_t shard_size(size_t index) const {
+		assert(index < Shards);
+
+		std::lock_guard<std::mutex> lock(m_shards[index].m_mutex);
+		return m_shards[index].m_table.size();
+	}
+
+	void clear();
+
+	bool find(const Key& key, T* value) const;
+	bool contains(const Key& key) const;
+	bool insert(const Key& key, const T& value);
+	bool insert_or_assign(const Key& key, const T& value);
+	size_t erase(const Key& key);
+
+	/**
+	 * Insert a batch of std::pair<Key, T>, existing keys are kept.
+	 *
+	 * @return Number of inserted elements.
+	 */
+	template <class Iterator>
+	size_t insert(Iterator first, Iterator last);
+
+	/**
+	 * Erase a batch of keys.
+	 *
+	 * @return Number of erased elements.
+	 */
+	template <class Iterator>
+	size_t erase(Iterator first, Iterator last);
+
+	/**
+	 * Look up a batch of keys.
+	 *
+	 * Functor prototype: void functor(const Key& key, const T* value);
+	 * "value" is 0 if the key does not exist. The functor is called with
+	 * the shard lock held, and the order of calls is grouped by shard.
+	 */
+	template <class Iterator, class Functor>
+	void find(Iterator first, Iterator last, const Functor& functor) const;
+
+	/**
+	 * Visit all elements, one shard at a time with the shard lock held.
+	 *
+	 * Functor prototype: void functor(const std::pair<const Key, T>& value);
+	 */
+	template <class Functor>
+	void for_each(const Functor& functor) const;
+
+	iterator begin() {
+		return iterator(m_shards, Shards, 0);
+	}
+
+	iterator end() {
+		return iterator(m_shards, Shards, Shards);
+	}
+
+	const_iterator begin() const {
+		return const_iterator(m_shards, Shards, 0);
+	}
+
+	const_iterator end() const {
+		return const_iterator(m_shards, Shards, Shards);
+	}
+
+private:
+	sharded_hash_table_t(const self_type&) = delete;
+	self_type& operator=(const self_type&) = delete;
+
+	// Every shard's table is built once, with a new arena.
+	template <size_t... Indexes>
+	sharded_hash_table_t(const KeyTraits& key_traits, size_t array_size, sharded_hash_table__::indexes_t<Indexes...>)
+		: m_key_traits(key_traits), m_shards{ { sharded_hash_table__::repeat<Indexes>(key_traits), array_size }... } {
+	}
+
+	// Stable order of "[first, last)" grouped by shard.
+	// "offsets[i]" ~ "offsets[i + 1]" is the range of shard "i" in the result.
+	template <class Iterator, class Extractor>
+	std::vector<Iterator> group_i(Iterator first, Iterator last,
+		const Extractor& extractor, size_t (&offsets)[Shards + 1]) const;
+
+private:
+	KeyTraits m_key_traits;
+	mutable shard_type m_shards[Shards];
+};
+
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+inline size_t sharded_hash_table_t<Key, T, KeyTraits, Shards>::size() const {
+	size_t total = 0;
+
+	for (size_t i = 0; i < Shards; ++i) {
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+		total += m_shards[i].m_table.size();
+	}
+
+	return total;
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+inline void sharded_hash_table_t<Key, T, KeyTraits, Shards>::clear() {
+	for (size_t i = 0; i < Shards; ++i) {
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+		m_shards[i].m_table.clear();
+	}
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+inline bool sharded_hash_table_t<Key, T, KeyTraits, Shards>::find(const Key& key, T* value) const {
+	assert(value != 0);
+
+	auto& shard = m_shards[this->shard_of(key)];
+	std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+	const auto& table = shard.m_table;
+	const auto it = table.find(key);
+	if (it == table.end()) {
+		return false;
+	}
+
+	*value = (*it).second;
+	return true;
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+inline bool sharded_hash_table_t<Key, T, KeyTraits, Shards>::contains(const Key& key) const {
+	auto& shard = m_shards[this->shard_of(key)];
+	std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+	const auto& table = shard.m_table;
+	return table.find(key) != table.end();
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+inline bool sharded_hash_table_t<Key, T, KeyTraits, Shards>::insert(const Key& key, const T& value) {
+	auto& shard = m_shards[this->shard_of(key)];
+	std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+	return shard.m_table.insert(key, value).second;
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+inline bool sharded_hash_table_t<Key, T, KeyTraits, Shards>::insert_or_assign(const Key& key, const T& value) {
+	auto& shard = m_shards[this->shard_of(key)];
+	std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+	auto result = shard.m_table.insert(key, value);
+	if (!result.second) {
+		(*result.first).second = value;
+	}
+
+	return result.second;
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+inline size_t sharded_hash_table_t<Key, T, KeyTraits, Shards>::erase(const Key& key) {
+	auto& shard = m_shards[this->shard_of(key)];
+	std::lock_guard<std::mutex> lock(shard.m_mutex);
+
+	return shard.m_table.erase(key);
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+template <class Iterator>
+inline size_t sharded_hash_table_t<Key, T, KeyTraits, Shards>::insert(Iterator first, Iterator last) {
+	size_t offsets[Shards + 1];
+	const auto grouped(this->group_i(first, last,
+		[](const Iterator& it) -> const Key& { return (*it).first; }, offsets));
+
+	size_t inserted = 0;
+
+	for (size_t i = 0; i < Shards; ++i) {
+		if (offsets[i] == offsets[i + 1]) {
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+
+		for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+			if (m_shards[i].m_table.insert((*grouped[k]).first, (*grouped[k]).second).second) {
+				++inserted;
+			}
+		}
+	}
+
+	return inserted;
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+template <class Iterator>
+inline size_t sharded_hash_table_t<Key, T, KeyTraits, Shards>::erase(Iterator first, Iterator last) {
+	size_t offsets[Shards + 1];
+	const auto grouped(this->group_i(first, last,
+		[](const Iterator& it) -> const Key& { return *it; }, offsets));
+
+	size_t erased = 0;
+
+	for (size_t i = 0; i < Shards; ++i) {
+		if (offsets[i] == offsets[i + 1]) {
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+
+		for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+			erased += m_shards[i].m_table.erase(*grouped[k]);
+		}
+	}
+
+	return erased;
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+template <class Iterator, class Functor>
+inline void sharded_hash_table_t<Key, T, KeyTraits, Shards>::find(
+	Iterator first, Iterator last, const Functor& functor) const {
+	size_t offsets[Shards + 1];
+	const auto grouped(this->group_i(first, last,
+		[](const Iterator& it) -> const Key& { return *it; }, offsets));
+
+	for (size_t i = 0; i < Shards; ++i) {
+		if (offsets[i] == offsets[i + 1]) {
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+		const auto& table = m_shards[i].m_table;
+
+		for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+			const Key& key = *grouped[k];
+			const auto it = table.find(key);
+
+			functor(key, it == table.end() ? (const T*) 0 : &(*it).second);
+		}
+	}
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+template <class Functor>
+inline void sharded_hash_table_t<Key, T, KeyTraits, Shards>::for_each(const Functor& functor) const {
+	for (size_t i = 0; i < Shards; ++i) {
+		std::lock_guard<std::mutex> lock(m_shards[i].m_mutex);
+		const auto& table = m_shards[i].m_table;
+
+		for (auto it = table.begin(); it != table.end(); ++it) {
+			functor(*it);
+		}
+	}
+}
+
+template <class Key, class T, class KeyTraits, size_t Shards>
+template <class Iterator, class Extractor>
+inline std::vector<Iterator> sharded_hash_table_t<Key, T, KeyTraits, Shards>::group_i(
+	Iterator first, Iterator last, const Extractor& extractor, size_t (&offsets)[Shards + 1]) const {
+
+	// Counting sort by shard index.
+	std::vector<size_t> indexes;
+	for (auto it = first; it != last; ++it) {
+		indexes.push_back(this->shard_of(extractor(it)));
+	}
+
+	for (size_t i = 0; i <= Shards; ++i) {
+		offsets[i] = 0;
+	}
+
+	for (auto it = indexes.begin(); it != indexes.end(); ++it) {
+		++offsets[*it + 1];
+	}
+
+	for (size_t i = 1; i <= Shards; ++i) {
+		offsets[i] += offsets[i - 1];
+	}
+
+	std::vector<Iterator> result(indexes.size());
+	size_t positions[Shards];
+	for (size_t i = 0; i < Shards; ++i) {
+		positions[i] = offsets[i];
+	}
+
+	size_t k = 0;
+	for (auto it = first; it != last; ++it, ++k) {
+		result[positions[indexes[k]]++] = it;
+	}
+
+	return result;
+}
+
+} // namespace algo
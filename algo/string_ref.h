@@ -0,0 +1,140 @@
+/**
+ * String reference.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <string>
+#include <ostream>
+
+
+namespace algo {
+
+/**
+ * Non-owning reference to a character sequence (pointer + length),
+ * e.g. a slice of a network buffer.
+ *
+ * The referenced characters must outlive the object,
+ * and they are not necessarily null-terminated.
+ */
+template <class Char, class CharTraits = std::char_traits<Char>>
+class basic_string_ref_t {
+private:
+	typedef basic_string_ref_t<Char, CharTraits> self_type;
+
+public:
+	typedef Char value_type;
+	typedef const Char* const_iterator;
+
+public:
+	basic_string_ref_t() : m_data(0), m_size(0) {
+	}
+
+	basic_string_ref_t(const Char* data, size_t size) : m_data(data), m_size(size) {
+		assert(data != 0 || size == 0);
+	}
+
+	basic_string_ref_t(const Char* str) : m_data(str), m_size(str == 0 ? 0 : CharTraits::length(str)) {
+	}
+
+	template <class Allocator>
+	basic_string_ref_t(const std::basic_string<Char, CharTraits, Allocator>& str)
+		: m_data(str.data()), m_size(str.size()) {
+	}
+
+	const Char* data() const {
+		return m_data;
+	}
+
+	size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	const_iterator begin() const {
+		return m_data;
+	}
+
+	const_iterator end() const {
+		return m_data + m_size;
+	}
+
+	Char operator[](size_t index) const {
+		assert(index < m_size);
+		return m_data[index];
+	}
+
+	std::basic_string<Char, CharTraits> str() const {
+		return std::basic_string<Char, CharTraits>(m_data, m_size);
+	}
+
+	// It's explicit, so that copying the characters is never hidden.
+	template <class Allocator>
+	explicit operator std::basic_string<Char, CharTraits, Allocator>() const {
+		return std::basic_string<Char, CharTraits, Allocator>(m_data, m_size);
+	}
+
+	int compare(const self_type& another) const {
+		const auto length = m_size < another.m_size ? m_size : another.m_size;
+		const auto result = CharTraits::compare(m_data, another.m_data, length);
+
+		if (result != 0) {
+			return result;
+		}
+
+		return m_size < another.m_size ? -1 : (m_size > another.m_size ? 1 : 0);
+	}
+
+	bool operator==(const self_type& another) const {
+		return m_size == another.m_size && CharTraits::compare(m_data, another.m_data, m_size) == 0;
+	}
+
+	bool operator!=(const self_type& another) const {
+		return !this->operator==(another);
+	}
+
+	bool operator<(const self_type& another) const {
+		return this->compare(another) < 0;
+	}
+
+private:
+	const Char* m_data;
+	size_t m_size;
+};
+
+typedef basic_string_ref_t<char> string_ref_t;
+typedef basic_string_ref_t<wchar_t> wstring_ref_t;
+
+
+// Transparent "less" of strings ("is_transparent" is defined), so that
+// an ordered container (e.g. rbtree_map_t) of std::basic_string could be
+// searched by "const Char*" or basic_string_ref_t without creating
+// a temporary string. All of them are compared as basic_string_ref_t.
+template <class Char, class CharTraits = std::char_traits<Char>>
+struct basic_string_less_t {
+	typedef void is_transparent;
+
+	bool operator()(const basic_string_ref_t<Char, CharTraits>& str1,
+		const basic_string_ref_t<Char, CharTraits>& str2) const {
+		return str1 < str2;
+	}
+};
+
+typedef basic_string_less_t<char> string_less_t;
+typedef basic_string_less_t<wchar_t> wstring_less_t;
+
+
+template <class Char, class CharTraits>
+inline std::basic_ostream<Char, CharTraits>& operator<<(
+	std::basic_ostream<Char, CharTraits>& os, const basic_string_ref_t<Char, CharTraits>& str) {
+	return os.write(str.data(), str.size());
+}
+
+} // namespace algo
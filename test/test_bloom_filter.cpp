@@ -0,0 +1,112 @@
+/**
+ * Test case for bloom_filter_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_bloom_filter.h"
+#include "algo/bloom_filter.h"
+#include <stdint.h>
+#include <iostream>
+#include <string>
+
+
+namespace {
+
+test_bloom_filter_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_bloom_filter_t::run() {
+	typedef bool (test_bloom_filter_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_bloom_filter_t::test_integers,
+		&test_bloom_filter_t::test_strings
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_bloom_filter_t::test_integers() {
+
+	std::cout << "test_bloom_filter_t::" << __func__ << "():" << std::endl;
+
+	const uint32_t count = 100000;
+	algo::bloom_filter_t<uint32_t> filter(count);
+
+	for (uint32_t i = 0; i < count; ++i) {
+		filter.insert(i * 2);
+	}
+
+	// No false negatives.
+	for (uint32_t i = 0; i < count; ++i) {
+		if (!filter.contains(i * 2)) {
+			return false;
+		}
+	}
+
+	size_t false_positives = 0;
+	for (uint32_t i = 0; i < count * 10; ++i) {
+		if (filter.contains(i * 2 + 1)) {
+			++false_positives;
+		}
+	}
+
+	const double rate = (double) false_positives / (count * 10);
+	if (rate > 0.02) {
+		return false;
+	}
+
+	// A copy is independent.
+	algo::bloom_filter_t<uint32_t> another(filter);
+	filter.clear();
+
+	if (filter.contains(2) || !another.contains(2)) {
+		return false;
+	}
+
+	std::cout << "Keys: " << count << ", Bytes: " << another.memory_bytes()
+		<< ", False positive rate: " << rate * 100 << "%" << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_bloom_filter_t::test_strings() {
+
+	std::cout << "test_bloom_filter_t::" << __func__ << "():" << std::endl;
+
+	algo::bloom_filter_t<std::string> filter(1000, 16);
+
+	for (int i = 0; i < 1000; ++i) {
+		filter.insert(std::string("key") + std::to_string(i));
+	}
+
+	const char buffer[] = "key999 and more";
+	if (!filter.contains("key7") || !filter.contains(algo::string_ref_t(buffer, 6))
+		|| !filter.contains(std::string("key123"))) {
+		return false;
+	}
+
+	size_t false_positives = 0;
+	for (int i = 0; i < 1000; ++i) {
+		if (filter.contains(std::string("other") + std::to_string(i))) {
+			++false_positives;
+		}
+	}
+
+	std::cout << "False positives: " << false_positives << " / 1000" << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
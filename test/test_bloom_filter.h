@@ -0,0 +1,22 @@
+/**
+ * Test case for bloom_filter_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/bloom_filter.h"
+
+
+// Test case for bloom_filter_t.
+class test_bloom_filter_t : public test_case_t {
+public:
+	test_bloom_filter_t() : test_case_t("test_bloom_filter_t") {}
+	virtual bool run();
+
+private:
+	bool test_integers();
+	bool test_strings();
+};
@@ -0,0 +1,260 @@
+/**
+ * Test case for btree_set_t & btree_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_btree.h"
+#include "algo/btree.h"
+#include "algo/rbtree.h"
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+
+namespace {
+
+test_btree_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_btree_t::run() {
+	if (!this->test_set() || !this->test_range()
+		|| !this->test_map() || !this->test_memory()) {
+		return false;
+	}
+
+	return true;
+}
+
+bool test_btree_t::test_set() {
+
+	std::cout << "test_btree_t::" << __func__ << "():" << std::endl;
+
+	// Small key ranges, so that splits, borrows and merges all happen.
+	const int ranges[] = { 50, 2000, 20000 };
+
+	for (auto range : ranges) {
+		std::mt19937 random(range);
+		std::uniform_int_distribution<int> keys(0, range);
+
+		algo::btree_set_t<int> tree;
+		std::set<int> expected;
+
+		for (int i = 0; i < 30000; ++i) {
+			const auto key = keys(random);
+
+			if (i % 3 == 0) {
+				if (tree.erase(key) != expected.erase(key)) {
+					return false;
+				}
+			}
+			else if (tree.insert(key).second != expected.insert(key).second) {
+				return false;
+			}
+
+			if (i % 5000 == 0 && !tree.check_invariants()) {
+				return false;
+			}
+		}
+
+		if (!tree.check_invariants() || tree.size() != expected.size()
+			|| !std::equal(expected.begin(), expected.end(), tree.begin())
+			|| !std::equal(expected.rbegin(), expected.rend(), tree.rbegin())) {
+			return false;
+		}
+
+		// Erase every other element by iterator.
+		auto it = tree.begin();
+		auto expected_it = expected.begin();
+
+		for (size_t i = 0; it != tree.end(); ++i) {
+			if (i % 2 == 0) {
+				++it;
+				++expected_it;
+			}
+			else {
+				it = tree.erase(it);
+				expected_it = expected.erase(expected_it);
+			}
+
+			if (expected_it == expected.end() ? it != tree.end() : *it != *expected_it) {
+				return false;
+			}
+		}
+
+		const auto copy(tree);
+		tree.erase(tree.begin(), tree.end());
+
+		if (!tree.empty() || !tree.check_invariants() || !copy.check_invariants()
+			|| copy.size() != expected.size() || !std::equal(expected.begin(), expected.end(), copy.begin())) {
+			return false;
+		}
+
+		std::cout << "Range: " << range << ", Size: " << copy.size() << ", Height: " << copy.height() << std::endl;
+	}
+
+	// Non-arithmetic keys and a custom order go through the binary search.
+	algo::btree_set_t<std::string, std::greater<std::string>> strings({ "b", "d", "a", "c", "b" });
+	const std::string sorted[] = { "d", "c", "b", "a" };
+
+	if (strings.size() != 4 || !std::equal(strings.begin(), strings.end(), sorted)) {
+		return false;
+	}
+
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_btree_t::test_range() {
+
+	std::cout << "test_btree_t::" << __func__ << "():" << std::endl;
+
+	// Even numbers only.
+	algo::btree_set_t<int> tree;
+	for (int i = 0; i < 10000; i += 2) {
+		tree.insert(i);
+	}
+
+	const auto& const_tree = tree;
+
+	if (*tree.lower_bound(10) != 10 || *tree.lower_bound(11) != 12 || *const_tree.lower_bound(-5) != 0
+		|| tree.lower_bound(9999) != tree.end() || *tree.upper_bound(10) != 12 || *tree.upper_bound(-1) != 0
+		|| const_tree.upper_bound(9998) != const_tree.end() || *--tree.end() != 9998) {
+		return false;
+	}
+
+	const auto found = tree.equal_range(100);
+	const auto missing = const_tree.equal_range(101);
+
+	if (*found.first != 100 || *found.second != 102 || *missing.first != 102 || missing.first != missing.second) {
+		return false;
+	}
+
+	if (tree.count(100) != 1 || tree.count(101) != 0 || tree.find(101) != tree.end()) {
+		return false;
+	}
+
+	// Erase [1000, 2000).
+	tree.erase(tree.lower_bound(1000), tree.lower_bound(2000));
+
+	if (tree.size() != 4500 || !tree.check_invariants() || *tree.lower_bound(999) != 2000
+		|| *--tree.lower_bound(999) != 998) {
+		return false;
+	}
+
+	std::cout << "Size: " << tree.size() << ", Height: " << tree.height() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_btree_t::test_map() {
+
+	std::cout << "test_btree_t::" << __func__ << "():" << std::endl;
+
+	std::mt19937 random(5);
+
+	algo::btree_map_t<std::string, std::string> tree;
+	std::map<std::string, std::string> expected;
+
+	for (int i = 0; i < 20000; ++i) {
+		const auto key = std::to_string(random() % 3000);
+
+		if (i % 4 == 0) {
+			if (tree.erase(key) != expected.erase(key)) {
+				return false;
+			}
+		}
+		else {
+			tree[key] += "a";
+			expected[key] += "a";
+		}
+	}
+
+	if (!tree.check_invariants() || tree.size() != expected.size()) {
+		return false;
+	}
+
+	auto it = tree.begin();
+	for (auto expected_it = expected.begin(); expected_it != expected.end(); ++expected_it, ++it) {
+		if (it->first != expected_it->first || (*it).second != expected_it->second) {
+			return false;
+		}
+	}
+
+	// Values are modified through iterators.
+	tree.begin()->second = "first";
+	if (tree.find(expected.begin()->first)->second != "first") {
+		return false;
+	}
+
+	const auto copy(tree);
+	if (!copy.check_invariants() || copy.size() != tree.size()
+		|| copy.begin()->second != "first" || copy.find("none") != copy.end()) {
+		return false;
+	}
+
+	algo::btree_map_t<int, int> numbers({ { 3, 30 }, { 1, 10 }, { 2, 20 } });
+	if (!numbers.insert(4, 40).second || numbers.insert(std::make_pair(2, 0)).second
+		|| numbers.size() != 4 || numbers[2] != 20 || (--numbers.end())->second != 40) {
+		return false;
+	}
+
+	std::cout << "Size: " << tree.size() << ", Height: " << tree.height() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_btree_t::test_memory() {
+
+	std::cout << "test_btree_t::" << __func__ << "():" << std::endl;
+
+	const int count = 50000;
+	std::mt19937 random(17);
+
+	algo::btree_set_t<uint64_t> tree;
+	algo::rbtree_t<uint64_t> rbtree;
+
+	for (int i = 0; i < count; ++i) {
+		const uint64_t key = random();
+		tree.insert(key);
+		rbtree.insert(key);
+	}
+
+	// Nodes hold dozens of keys each, so a lookup touches few cache lines.
+	const auto bytes = (double) tree.memory_bytes() / tree.size();
+	const auto rbtree_bytes = (double) rbtree.memory_bytes() / rbtree.size();
+
+	if (!tree.check_invariants() || tree.size() != rbtree.size() || bytes * 2 > rbtree_bytes
+		|| tree.height() * 3 > rbtree.height() || !std::equal(rbtree.begin(), rbtree.end(), tree.begin())) {
+		return false;
+	}
+
+	// Leaves split by appending stay full.
+	algo::btree_set_t<int> sorted;
+	for (int i = 0; i < count; ++i) {
+		sorted.insert(i);
+	}
+
+	const auto sorted_bytes = (double) sorted.memory_bytes() / sorted.size();
+
+	if (!sorted.check_invariants() || sorted_bytes > 6.0) {
+		return false;
+	}
+
+	std::cout << "Size: " << count << ", Bytes per element: " << bytes
+		<< " (rbtree_t: " << rbtree_bytes << "), Height: " << tree.height()
+		<< " (rbtree_t: " << rbtree.height() << "), Sorted int bytes per element: " << sorted_bytes << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
@@ -0,0 +1,24 @@
+/**
+ * Test case for btree_set_t & btree_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/btree.h"
+
+
+// Test case for btree_set_t & btree_map_t.
+class test_btree_t : public test_case_t {
+public:
+	test_btree_t() : test_case_t("test_btree_t") {}
+	virtual bool run();
+
+private:
+	bool test_set();
+	bool test_range();
+	bool test_map();
+	bool test_memory();
+};
@@ -0,0 +1,296 @@
+/**
+ * Test case for concurrent_hash_table_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_concurrent_hash_table.h"
+#include "algo/concurrent_hash_table.h"
+#include "algo/hash_table.h"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+test_concurrent_hash_table_t st_test;
+
+// Run "functor(thread_index, &stop)" on "threads" threads for "milliseconds",
+// returns total number of operations reported by all threads.
+template <class Functor>
+size_t run_for(int threads, int milliseconds, const Functor& functor) {
+	std::atomic<bool> stop(false);
+	std::vector<size_t> counts(threads, 0);
+	std::vector<std::thread> workers;
+
+	for (int i = 0; i < threads; ++i) {
+		workers.push_back(std::thread([&, i]() {
+			counts[i] = functor(i, stop);
+		}));
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+	stop.store(true);
+
+	size_t total = 0;
+	for (int i = 0; i < threads; ++i) {
+		workers[i].join();
+		total += counts[i];
+	}
+
+	return total;
+}
+
+} // unnamed namespace.
+
+
+bool test_concurrent_hash_table_t::run() {
+	typedef bool (test_concurrent_hash_table_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_concurrent_hash_table_t::test_single_thread,
+		&test_concurrent_hash_table_t::test_multiple_threads,
+		&test_concurrent_hash_table_t::test_clear,
+		&test_concurrent_hash_table_t::test_read_scalability
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_concurrent_hash_table_t::test_single_thread() {
+
+	std::cout << "test_concurrent_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t table(4);
+	int value = 0;
+
+	for (int i = 0; i < 1000; ++i) {
+		if (!table.insert(i, i * 10)) {
+			return false;
+		}
+	}
+
+	if (table.insert(5, 0) || table.size() != 1000 || table.array_size() < 1000 / my_table_t::const_max_load_factor) {
+		return false;
+	}
+
+	if (!table.find(5, &value) || value != 50 || table.find(1000, &value)) {
+		return false;
+	}
+
+	if (table.insert_or_assign(5, 55) || !table.find(5, &value) || value != 55) {
+		return false;
+	}
+
+	if (table.erase(5) != 1 || table.erase(5) != 0 || table.contains(5) || table.size() != 999) {
+		return false;
+	}
+
+	size_t count = 0;
+	table.for_each([&count](const std::pair<const int, int>& value) {
+		if (value.second == value.first * 10) {
+			++count;
+		}
+	});
+
+	if (count != 999) {
+		return false;
+	}
+
+	table.clear();
+	if (!table.empty() || table.contains(1)) {
+		return false;
+	}
+
+	std::cout << "Array size: " << table.array_size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_concurrent_hash_table_t::test_multiple_threads() {
+
+	std::cout << "test_concurrent_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t table;
+	std::atomic<bool> done(false);
+	std::atomic<bool> failed(false);
+	std::vector<std::thread> writers;
+
+	// Readers check that a visible value is always consistent with its key.
+	std::thread reader([&]() {
+		while (!done.load()) {
+			for (int key = 0; key < const_threads * const_keys_per_thread; key += 7) {
+				int value = 0;
+				if (table.find(key, &value) && value != key && value != -key) {
+					failed.store(true);
+				}
+			}
+		}
+	});
+
+	for (int i = 0; i < const_threads; ++i) {
+		writers.push_back(std::thread([&table, i]() {
+			const int first = i * const_keys_per_thread;
+
+			for (int key = first; key < first + const_keys_per_thread; ++key) {
+				table.insert(key, key);
+			}
+
+			for (int key = first; key < first + const_keys_per_thread; key += 2) {
+				table.insert_or_assign(key, -key);
+			}
+
+			for (int key = first + 1; key < first + const_keys_per_thread; key += 2) {
+				table.erase(key);
+			}
+		}));
+	}
+
+	for (auto it = writers.begin(); it != writers.end(); ++it) {
+		(*it).join();
+	}
+
+	done.store(true);
+	reader.join();
+
+	if (failed.load() || table.size() != size_t(const_threads * const_keys_per_thread / 2)) {
+		return false;
+	}
+
+	for (int key = 0; key < const_threads * const_keys_per_thread; ++key) {
+		int value = 0;
+		const bool found = table.find(key, &value);
+
+		if (found != (key % 2 == 0) || (found && value != -key)) {
+			return false;
+		}
+	}
+
+	std::cout << "Size: " << table.size() << ", Array size: " << table.array_size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_concurrent_hash_table_t::test_clear() {
+
+	std::cout << "test_concurrent_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t table;
+	std::atomic<bool> done(false);
+	std::vector<std::thread> writers;
+	size_t clears = 0;
+
+	// size() must stay exact while clear() races with inserts.
+	std::thread clearer([&]() {
+		while (!done.load()) {
+			table.clear();
+			++clears;
+		}
+	});
+
+	for (int i = 0; i < const_threads; ++i) {
+		writers.push_back(std::thread([&table, i]() {
+			const int first = i * const_keys_per_thread;
+
+			for (int key = first; key < first + const_keys_per_thread; ++key) {
+				if (key % 2 == 0) {
+					table.insert(key, key);
+				}
+				else {
+					table.insert_or_assign(key, key);
+				}
+			}
+		}));
+	}
+
+	for (auto it = writers.begin(); it != writers.end(); ++it) {
+		(*it).join();
+	}
+
+	done.store(true);
+	clearer.join();
+
+	size_t count = 0;
+	table.for_each([&count](const std::pair<const int, int>&) {
+		++count;
+	});
+
+	if (table.size() != count) {
+		return false;
+	}
+
+	std::cout << "Clears: " << clears << ", Size: " << table.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_concurrent_hash_table_t::test_read_scalability() {
+
+	std::cout << "test_concurrent_hash_table_t::" << __func__ << "():" << std::endl;
+
+	const int keys = 100000;
+	const int milliseconds = 100;
+
+	my_table_t table;
+	algo::hash_table_t<int, int> locked_table(keys);
+	std::mutex mutex;
+
+	for (int key = 0; key < keys; ++key) {
+		table.insert(key, key);
+		locked_table.insert(key, key);
+	}
+
+	int max_threads = (int)std::thread::hardware_concurrency();
+	if (max_threads < 2) {
+		max_threads = 2;
+	}
+
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		const auto concurrent = run_for(threads, milliseconds, [&table](int index, const std::atomic<bool>& stop) {
+			size_t count = 0;
+			int value = 0;
+
+			for (int key = index; !stop.load(std::memory_order_relaxed); key = (key + 7919) % keys) {
+				table.find(key, &value);
+				++count;
+			}
+
+			return count;
+		});
+
+		const auto locked = run_for(threads, milliseconds, [&](int index, const std::atomic<bool>& stop) {
+			size_t count = 0;
+
+			for (int key = index; !stop.load(std::memory_order_relaxed); key = (key + 7919) % keys) {
+				std::lock_guard<std::mutex> lock(mutex);
+				locked_table.find(key);
+				++count;
+			}
+
+			return count;
+		});
+
+		std::cout << "Threads: " << threads
+			<< ", concurrent_hash_table_t: " << concurrent * 1000 / milliseconds << " reads/s"
+			<< ", hash_table_t + mutex: " << locked * 1000 / milliseconds << " reads/s" << std::endl;
+	}
+
+	std::cout << std::endl;
+
+	return true;
+}
@@ -0,0 +1,31 @@
+/**
+ * Test case for concurrent_hash_table_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/concurrent_hash_table.h"
+
+
+// Test case for concurrent_hash_table_t.
+class test_concurrent_hash_table_t : public test_case_t {
+private:
+	typedef algo::concurrent_hash_table_t<int, int> my_table_t;
+
+public:
+	test_concurrent_hash_table_t() : test_case_t("test_concurrent_hash_table_t") {}
+	virtual bool run();
+
+public:
+	static const int const_threads = 4;
+	static const int const_keys_per_thread = 20000;
+
+private:
+	bool test_single_thread();
+	bool test_multiple_threads();
+	bool test_clear();
+	bool test_read_scalability();
+};
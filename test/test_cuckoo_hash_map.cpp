@@ -0,0 +1,430 @@
+/**
+ * Test case for cuckoo_hash_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_cuckoo_hash_map.h"
+#include "algo/cuckoo_hash_map.h"
+#include "algo/hash_table.h"
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+
+test_cuckoo_hash_map_t st_test;
+
+// Keys less than 100 share one hash value.
+struct colliding_traits_t {
+	size_t hash(int key) const {
+		return key < 100 ? 7 : (size_t) key;
+	}
+
+	bool equal(int key1, int key2) const {
+		return key1 == key2;
+	}
+};
+
+// Value whose copy constructor throws once "st_copies_left" runs out.
+int st_copies_left = -1;
+int st_alive = 0;
+
+struct throwing_value_t {
+	explicit throwing_value_t(int value = 0) : m_value(value) {
+		++st_alive;
+	}
+
+	throwing_value_t(const throwing_value_t& another) : m_value(another.m_value) {
+		if (st_copies_left == 0) {
+			throw std::runtime_error("copy failed");
+		}
+
+		if (st_copies_left > 0) {
+			--st_copies_left;
+		}
+
+		++st_alive;
+	}
+
+	~throwing_value_t() {
+		--st_alive;
+	}
+
+	int m_value;
+};
+
+// Lookup latencies (nanoseconds) of every key.
+template <class Table, class Key>
+std::vector<int64_t> measure_lookups(const Table& table, const std::vector<Key>& keys, bool* found) {
+	std::vector<int64_t> latencies;
+	latencies.reserve(keys.size());
+	*found = true;
+
+	for (size_t i = 0; i < keys.size(); ++i) {
+		const auto start = std::chrono::steady_clock::now();
+		const auto it = table.find(keys[i]);
+		const auto stop = std::chrono::steady_clock::now();
+
+		if (it == table.end()) {
+			*found = false;
+		}
+
+		latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	return latencies;
+}
+
+void print_latencies(const char* name, const std::vector<int64_t>& latencies) {
+	const auto size = latencies.size();
+
+	std::cout << name << " (ns): p50=" << latencies[size / 2]
+		<< ", p99=" << latencies[size * 99 / 100]
+		<< ", p99.9=" << latencies[size * 999 / 1000]
+		<< ", max=" << latencies[size - 1] << std::endl;
+}
+
+} // unnamed namespace.
+
+
+bool test_cuckoo_hash_map_t::run() {
+	typedef bool (test_cuckoo_hash_map_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_cuckoo_hash_map_t::test_basic,
+		&test_cuckoo_hash_map_t::test_random,
+		&test_cuckoo_hash_map_t::test_colliding,
+		&test_cuckoo_hash_map_t::test_exceptions,
+		&test_cuckoo_hash_map_t::test_tail_latency
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_cuckoo_hash_map_t::test_basic() {
+
+	std::cout << "test_cuckoo_hash_map_t::" << __func__ << "():" << std::endl;
+
+	algo::cuckoo_hash_map_t<std::string, int> map = {
+		{"one", 1}, {"two", 2}, {"three", 3}
+	};
+
+	if (map.size() != 3 || map.count("two") != 1 || map.count("four") != 0) {
+		return false;
+	}
+
+	if (map.insert("one", 100).second || map["one"] != 1 || !map.insert("four", 4).second) {
+		return false;
+	}
+
+	map["five"] = 5;
+
+	if (map.erase("two") != 1 || map.erase("two") != 0 || map.find("two") != map.end()) {
+		return false;
+	}
+
+	int sum = 0;
+	for (auto it = map.begin(); it != map.end(); ++it) {
+		sum += (*it).second;
+	}
+
+	if (sum != 1 + 3 + 4 + 5 || map.size() != 4) {
+		return false;
+	}
+
+	// Copy and move.
+	auto another(map);
+	another.clear();
+	another["six"] = 6;
+
+	const auto moved(std::move(another));
+
+	if (moved.size() != 1 || moved.find("six") == moved.end() || map.size() != 4 || map.count("six") != 0) {
+		return false;
+	}
+
+	// Grow from the smallest table, the load factor must stay high.
+	algo::cuckoo_hash_map_t<uint32_t, uint32_t> numbers;
+	for (uint32_t i = 0; i < 100000; ++i) {
+		if (!numbers.insert(i, i * 2).second) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < 100000; ++i) {
+		const auto it = numbers.find(i);
+
+		if (it == numbers.end() || (*it).second != i * 2 || numbers.count(i + 100000) != 0) {
+			return false;
+		}
+	}
+
+	std::cout << "Size: " << numbers.size() << ", Capacity: " << numbers.capacity()
+		<< ", Bucket alignment: " << numbers.const_bucket_align << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_cuckoo_hash_map_t::test_random() {
+
+	std::cout << "test_cuckoo_hash_map_t::" << __func__ << "():" << std::endl;
+
+	// Small key range, so that inserting and erasing keep colliding.
+	std::mt19937 random(11);
+	std::uniform_int_distribution<uint32_t> keys(0, 20000);
+
+	algo::cuckoo_hash_map_t<uint32_t, uint32_t> map;
+	std::unordered_map<uint32_t, uint32_t> expected;
+	double max_load_factor = 0;
+
+	for (int i = 0; i < 200000; ++i) {
+		const auto key = keys(random);
+
+		if (i % 3 == 0) {
+			if (map.erase(key) != expected.erase(key)) {
+				return false;
+			}
+		}
+		else {
+			const auto old_capacity = map.capacity();
+			const auto load_factor = map.load_factor();
+
+			if (map.insert(key, i).second != expected.insert(std::make_pair(key, i)).second) {
+				return false;
+			}
+
+			// Tiny tables could be completely full.
+			if (map.capacity() != old_capacity && old_capacity >= 4096) {
+				max_load_factor = std::max(max_load_factor, load_factor);
+			}
+		}
+	}
+
+	if (map.size() != expected.size() || max_load_factor < 0.9) {
+		return false;
+	}
+
+	for (auto it = expected.begin(); it != expected.end(); ++it) {
+		const auto found = map.find((*it).first);
+
+		if (found == map.end() || (*found).second != (*it).second) {
+			return false;
+		}
+	}
+
+	size_t count = 0;
+	for (auto it = map.begin(); it != map.end(); ++it) {
+		++count;
+	}
+
+	if (count != expected.size()) {
+		return false;
+	}
+
+	std::cout << "Size: " << map.size() << ", Max load factor before growing: " << max_load_factor << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_cuckoo_hash_map_t::test_colliding() {
+
+	std::cout << "test_cuckoo_hash_map_t::" << __func__ << "():" << std::endl;
+
+	// Permutations of a string share its hash value.
+	std::string word = "abcd";
+	algo::cuckoo_hash_map_t<std::string, int> words;
+	int count = 0;
+
+	do {
+		if (!words.insert(word, count++).second) {
+			return false;
+		}
+	} while (std::next_permutation(word.begin(), word.end()));
+
+	if (words.size() != 24 || words.capacity() > 64) {
+		return false;
+	}
+
+	word = "abcd";
+	count = 0;
+
+	do {
+		const auto it = words.find(word);
+
+		if (it == words.end() || (*it).second != count++ || words.insert(word, -1).second) {
+			return false;
+		}
+	} while (std::next_permutation(word.begin(), word.end()));
+
+	// Colliding keys among many others, through growing, copying and erasing.
+	algo::cuckoo_hash_map_t<int, int, colliding_traits_t> numbers;
+
+	for (int i = 0; i < 10000; ++i) {
+		if (!numbers.insert(i, i * 2).second) {
+			return false;
+		}
+	}
+
+	auto copy(numbers);
+	for (int i = 0; i < 10000; i += 2) {
+		if (copy.erase(i) != 1) {
+			return false;
+		}
+	}
+
+	size_t iterated = 0;
+	for (auto it = copy.begin(); it != copy.end(); ++it) {
+		if ((*it).first % 2 != 1 || (*it).second != (*it).first * 2) {
+			return false;
+		}
+
+		++iterated;
+	}
+
+	if (numbers.size() != 10000 || copy.size() != 5000 || iterated != 5000 || copy.count(2) != 0 || copy.count(3) != 1) {
+		return false;
+	}
+
+	for (int i = 0; i < 10000; ++i) {
+		const auto it = numbers.find(i);
+
+		if (it == numbers.end() || (*it).second != i * 2 || numbers.count(i + 10000) != 0) {
+			return false;
+		}
+	}
+
+	// Colliding keys must not blow up the table.
+	if (numbers.capacity() > 32768) {
+		return false;
+	}
+
+	std::cout << "Words: " << words.size() << ", Capacity: " << words.capacity()
+		<< ", Numbers: " << numbers.size() << ", Capacity: " << numbers.capacity() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_cuckoo_hash_map_t::test_exceptions() {
+
+	std::cout << "test_cuckoo_hash_map_t::" << __func__ << "():" << std::endl;
+
+	{
+		algo::cuckoo_hash_map_t<int, throwing_value_t> map;
+		const int count = 1000;
+
+		for (int i = 0; i < count; ++i) {
+			map.insert(i, throwing_value_t(i));
+		}
+
+		// A copy fails while growing, the map must be unchanged.
+		const auto capacity = map.capacity();
+		st_copies_left = 10;
+
+		try {
+			map.reserve(capacity * 2);
+			return false;
+		}
+		catch (const std::runtime_error&) {
+		}
+
+		st_copies_left = -1;
+
+		if (map.size() != (size_t) count || map.capacity() != capacity || (size_t) st_alive != map.size()) {
+			return false;
+		}
+
+		for (int i = 0; i < count; ++i) {
+			const auto it = map.find(i);
+
+			if (it == map.end() || (*it).second.m_value != i) {
+				return false;
+			}
+		}
+
+		// A failed copy frees what it has copied.
+		st_copies_left = 10;
+
+		try {
+			const auto copy(map);
+			return false;
+		}
+		catch (const std::runtime_error&) {
+		}
+
+		st_copies_left = -1;
+
+		if ((size_t) st_alive != map.size()) {
+			return false;
+		}
+
+		std::cout << "Size: " << map.size() << ", Capacity: " << map.capacity() << std::endl;
+	}
+
+	if (st_alive != 0) {
+		return false;
+	}
+
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_cuckoo_hash_map_t::test_tail_latency() {
+
+	std::cout << "test_cuckoo_hash_map_t::" << __func__ << "():" << std::endl;
+
+	const uint64_t count = 100000;
+
+	std::mt19937_64 random(3);
+	std::vector<uint64_t> keys;
+	keys.reserve(count);
+
+	for (uint64_t i = 0; i < count; ++i) {
+		keys.push_back(random());
+	}
+
+	algo::cuckoo_hash_map_t<uint64_t, uint64_t> cuckoo;
+	algo::hash_table_t<uint64_t, uint64_t> chained;
+
+	for (size_t i = 0; i < keys.size(); ++i) {
+		cuckoo.insert(keys[i], i);
+		chained.insert(keys[i], i);
+	}
+
+	std::shuffle(keys.begin(), keys.end(), random);
+
+	bool cuckoo_found = false;
+	bool chained_found = false;
+	const auto cuckoo_latencies = measure_lookups(cuckoo, keys, &cuckoo_found);
+	const auto chained_latencies = measure_lookups(chained, keys, &chained_found);
+
+	if (!cuckoo_found || !chained_found) {
+		return false;
+	}
+
+	print_latencies("cuckoo_hash_map_t", cuckoo_latencies);
+	print_latencies("hash_table_t", chained_latencies);
+	std::cout << std::endl;
+
+	return true;
+}
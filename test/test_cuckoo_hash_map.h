@@ -0,0 +1,25 @@
+/**
+ * Test case for cuckoo_hash_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/cuckoo_hash_map.h"
+
+
+// Test case for cuckoo_hash_map_t.
+class test_cuckoo_hash_map_t : public test_case_t {
+public:
+	test_cuckoo_hash_map_t() : test_case_t("test_cuckoo_hash_map_t") {}
+	virtual bool run();
+
+private:
+	bool test_basic();
+	bool test_random();
+	bool test_colliding();
+	bool test_exceptions();
+	bool test_tail_latency();
+};
@@ -0,0 +1,195 @@
+/**
+ * Test case for hash_set_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_hash_set.h"
+#include "algo/hash_set.h"
+#include "algo/hash_table.h"
+#include <stdint.h>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+test_hash_set_t st_test;
+
+template <class Set>
+std::set<int> to_std_set(const Set& set) {
+	return std::set<int>(set.begin(), set.end());
+}
+
+} // unnamed namespace.
+
+
+bool test_hash_set_t::run() {
+	typedef bool (test_hash_set_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_hash_set_t::test_basic,
+		&test_hash_set_t::test_memory,
+		&test_hash_set_t::test_algebra
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_hash_set_t::test_basic() {
+
+	std::cout << "test_hash_set_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_set_t<std::string> set = {"apple", "banana", "cherry"};
+
+	if (set.size() != 3 || !set.contains("banana") || set.contains("durian") || set.count(std::string("apple")) != 1) {
+		return false;
+	}
+
+	if (!set.insert("durian").second || set.insert("apple").second || *set.insert("apple").first != "apple") {
+		return false;
+	}
+
+	if (set.erase("banana") != 1 || set.erase("banana") != 0 || set.find("banana") != set.end()) {
+		return false;
+	}
+
+	std::vector<std::string> keys(set.begin(), set.end());
+	std::sort(keys.begin(), keys.end());
+
+	if (keys.size() != 3 || keys[0] != "apple" || keys[1] != "cherry" || keys[2] != "durian") {
+		return false;
+	}
+
+	// Node handles.
+	algo::hash_set_t<std::string> another = {"cherry", "elderberry"};
+	auto node = set.extract("apple");
+
+	if (node.empty() || node.key() != "apple" || set.contains("apple")) {
+		return false;
+	}
+
+	const auto result = another.insert(std::move(node));
+	if (!result.inserted || *result.position != "apple" || another.size() != 3) {
+		return false;
+	}
+
+	// "cherry" exists in both sets, so it's left in "set".
+	another.merge(set);
+	if (another.size() != 4 || set.size() != 1 || !set.contains("cherry")) {
+		return false;
+	}
+
+	auto copy(another);
+	copy = {"fig"};
+	if (copy.size() != 1 || !copy.contains("fig") || another.contains("fig")) {
+		return false;
+	}
+
+	std::cout << "Size: " << another.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_set_t::test_memory() {
+
+	std::cout << "test_hash_set_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_set_t<uint64_t> set(4096);
+	algo::hash_table_t<uint64_t, bool> table(4096);
+
+	for (uint64_t i = 0; i < 10000; ++i) {
+		set.insert(i * 3);
+		table.insert(i * 3, true);
+	}
+
+	const auto set_stats = set.stats();
+	const auto table_stats = table.stats();
+
+	if (set.size() != 10000 || set_stats.m_payload_bytes >= table_stats.m_payload_bytes) {
+		return false;
+	}
+
+	std::cout << "Node bytes: " << sizeof(algo::hash_table__::node_t<uint64_t, algo::hash_table__::no_value_t>)
+		<< " vs " << sizeof(algo::hash_table__::node_t<uint64_t, bool>)
+		<< ", Payload bytes: " << set_stats.m_payload_bytes << " vs " << table_stats.m_payload_bytes << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_set_t::test_algebra() {
+
+	std::cout << "test_hash_set_t::" << __func__ << "():" << std::endl;
+
+	// Multiples of 2 and 3.
+	algo::hash_set_t<int> set1;
+	algo::hash_set_t<int> set2;
+	std::set<int> expected1;
+	std::set<int> expected2;
+
+	for (int i = 0; i < 20000; ++i) {
+		set1.insert(i * 2);
+		expected1.insert(i * 2);
+	}
+
+	for (int i = 0; i < 10000; ++i) {
+		set2.insert(i * 3);
+		expected2.insert(i * 3);
+	}
+
+	std::set<int> union_set;
+	std::set<int> intersection_set;
+	std::set<int> difference1;
+	std::set<int> difference2;
+
+	std::set_union(expected1.begin(), expected1.end(), expected2.begin(), expected2.end(),
+		std::inserter(union_set, union_set.end()));
+	std::set_intersection(expected1.begin(), expected1.end(), expected2.begin(), expected2.end(),
+		std::inserter(intersection_set, intersection_set.end()));
+	std::set_difference(expected1.begin(), expected1.end(), expected2.begin(), expected2.end(),
+		std::inserter(difference1, difference1.end()));
+	std::set_difference(expected2.begin(), expected2.end(), expected1.begin(), expected1.end(),
+		std::inserter(difference2, difference2.end()));
+
+	for (size_t threads = 1; threads <= 4; threads += 3) {
+		const auto u1 = algo::hash_set_union(set1, set2, threads);
+		const auto u2 = algo::hash_set_union(set2, set1, threads);
+		const auto i1 = algo::hash_set_intersection(set1, set2, threads);
+		const auto i2 = algo::hash_set_intersection(set2, set1, threads);
+		const auto d1 = algo::hash_set_difference(set1, set2, threads);
+		const auto d2 = algo::hash_set_difference(set2, set1, threads);
+
+		if (u1.size() != union_set.size() || to_std_set(u1) != union_set || to_std_set(u2) != union_set) {
+			return false;
+		}
+
+		if (i1.size() != intersection_set.size() || to_std_set(i1) != intersection_set
+			|| to_std_set(i2) != intersection_set) {
+			return false;
+		}
+
+		if (to_std_set(d1) != difference1 || to_std_set(d2) != difference2) {
+			return false;
+		}
+	}
+
+	std::cout << "Union: " << union_set.size() << ", Intersection: " << intersection_set.size()
+		<< ", Difference: " << difference1.size() << ", " << difference2.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
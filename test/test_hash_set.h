@@ -0,0 +1,23 @@
+/**
+ * Test case for hash_set_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/hash_set.h"
+
+
+// Test case for hash_set_t.
+class test_hash_set_t : public test_case_t {
+public:
+	test_hash_set_t() : test_case_t("test_hash_set_t") {}
+	virtual bool run();
+
+private:
+	bool test_basic();
+	bool test_memory();
+	bool test_algebra();
+};
@@ -6,16 +6,64 @@
 
 #include "test/test_hash_table.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
 
 
 namespace {
 
 test_hash_table_t st_test;
 
+// Value whose copy constructor throws once "*m_budget" runs out.
+struct throwing_copy_t {
+	explicit throwing_copy_t(int* budget = 0) : m_budget(budget) {
+	}
+
+	throwing_copy_t(const throwing_copy_t& another) : m_budget(another.m_budget) {
+		if (m_budget != 0 && (*m_budget)-- == 0) {
+			throw std::runtime_error("copy failed");
+		}
+	}
+
+	int* m_budget;
+};
+
 } // unnamed namespace.
 
 
 bool test_hash_table_t::run() {
+	typedef bool (test_hash_table_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_hash_table_t::test_basic,
+		&test_hash_table_t::test_heterogeneous,
+		&test_hash_table_t::test_treeify,
+		&test_hash_table_t::test_treeify_limits,
+		&test_hash_table_t::test_node_handle,
+		&test_hash_table_t::test_aggregate,
+		&test_hash_table_t::test_filter,
+		&test_hash_table_t::test_stats,
+		&test_hash_table_t::test_build
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_hash_table_t::test_basic() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
 
 	my_table_t table(3);
 
@@ -49,6 +97,523 @@ bool test_hash_table_t::run() {
 	my_table_t v3({ { "11", "11 value" }, { "22", "22 value" }, { "33", "33 value" } });
 	v3.insert({ { "44", "44 value" },{ "55", "55 value" },{ "66", "66 value" } });
 	this->dump_4(&v3);
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_table_t::test_heterogeneous() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t table;
+	table.insert("GET", "get");
+	table.insert("POST", "post");
+	table.insert("a rather long key that does not fit in SSO", "long");
+
+	const algo::key_traits_t<std::string> traits;
+	if (traits.hash(std::string("POST")) != traits.hash("POST")
+		|| traits.hash(std::string("POST")) != traits.hash(algo::string_ref_t("POST"))) {
+		return false;
+	}
+
+	// Slices of a request buffer, not null-terminated.
+	const char buffer[] = "POSTGET a rather long key that does not fit in SSO!";
+	const algo::string_ref_t post(buffer, 4);
+	const algo::string_ref_t get(buffer + 4, 3);
+	const algo::string_ref_t long_key(buffer + 8, sizeof(buffer) - 10);
+	const algo::string_ref_t prefix(buffer, 3);
+
+	if (table.find(post) == table.end() || (*table.find(post)).second != "post"
+		|| table.find(get) == table.end() || (*table.find(get)).second != "get"
+		|| table.count(long_key) != 1 || table.count(prefix) != 0) {
+		return false;
+	}
+
+	const my_table_t& const_table = table;
+	if (const_table.find("GET") == const_table.end() || const_table.count("PUT") != 0
+		|| const_table.count(std::string("GET")) != 1) {
+		return false;
+	}
+
+	if (table.erase(get) != 1 || table.erase("GET") != 0 || table.size() != 2) {
+		return false;
+	}
+
+	std::cout << "Found: " << post << ", " << long_key << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_table_t::test_treeify() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_table_t<int, int, colliding_traits_t> table;
+	if (!this->check_colliding(&table, 20000)) {
+		return false;
+	}
+
+	algo::hash_table_t<int, int, colliding_no_less_traits_t> no_less_table;
+	if (!this->check_colliding(&no_less_table, 200)) {
+		return false;
+	}
+
+	// The additive string hash maps all permutations to the same bucket.
+	my_table_t strings;
+	std::string key("abcdefg");
+	do {
+		strings.insert(key, key);
+	} while (std::next_permutation(key.begin(), key.end()));
+
+	const char buffer[] = "gfedcbaXYZ";
+	if (strings.size() != 5040 || strings.count("gfedcba") != 1 || strings.count("gfedcbb") != 0
+		|| strings.find(algo::string_ref_t(buffer, 7)) == strings.end()
+		|| strings.count(algo::string_ref_t(buffer, 6)) != 0) {
+		return false;
+	}
+
+	do {
+		if (strings.erase(key) != 1) {
+			return false;
+		}
+	} while (std::next_permutation(key.begin(), key.end()) && strings.size() > 2);
+
+	if (strings.size() != 2 || strings.find("abcdefg") != strings.end()) {
+		return false;
+	}
+
+	std::cout << "Size: " << table.size() << ", " << no_less_table.size()
+		<< ", " << strings.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_table_t::test_treeify_limits() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	// Chains of a table loaded beyond its array size are long, but not
+	// long compared with the average chain, so none is treeified.
+	algo::hash_table_t<int, int> loaded(16);
+	for (int i = 0; i < 10000; ++i) {
+		loaded.insert(i, i);
+	}
+
+	if (loaded.stats().m_treeified_buckets != 0) {
+		return false;
+	}
+
+	// Nothing is linked if treeifying or adding a tree node throws.
+	int budget = 1 << 30;
+	algo::hash_table_t<int, int, throwing_traits_t> table((throwing_traits_t(&budget)));
+	size_t failures = 0;
+
+	for (int key = 0; key < 100; ++key) {
+		for (int limit = 0; ; ++limit) {
+			budget = limit;
+			bool done = true;
+
+			try {
+				table.insert(key, key);
+			}
+			catch (const std::runtime_error&) {
+				done = false;
+				++failures;
+			}
+
+			budget = 1 << 30;
+
+			size_t count = 0;
+			for (auto it = table.begin(); it != table.end(); ++it) {
+				++count;
+			}
+
+			const auto expected = (size_t) key + (done ? 1 : 0);
+			if (table.size() != expected || count != expected || (table.count(key) != 0) != done) {
+				return false;
+			}
+
+			if (done) {
+				break;
+			}
+		}
+	}
+
+	if (table.stats().m_treeified_buckets != 1 || failures == 0) {
+		return false;
+	}
+
+	std::cout << "Loaded size: " << loaded.size() << ", Failed inserts: " << failures << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_table_t::test_node_handle() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t staging({ { "a", "1" }, { "b", "2" }, { "c", "3" }, { "d", "4" } });
+	my_table_t table({ { "a", "old" } });
+
+	// Extract & insert, the node is relinked rather than copied.
+	auto node(staging.extract("b"));
+	const auto address = &node.mapped();
+
+	if (node.empty() || node.key() != "b" || staging.size() != 3 || staging.count("b") != 0
+		|| !staging.extract("b").empty()) {
+		return false;
+	}
+
+	auto result(table.insert(std::move(node)));
+	if (!result.inserted || !node.empty() || &(*result.position).second != address) {
+		return false;
+	}
+
+	// A duplicate key gives the node back.
+	result = table.insert(staging.extract(staging.find("a")));
+	if (result.inserted || result.node.empty() || result.node.mapped() != "1"
+		|| (*result.position).second != "old" || staging.size() != 2) {
+		return false;
+	}
+
+	// Erase by iterator.
+	const auto next(table.erase(table.find("a")));
+	if (table.size() != 1 || next != table.find("b") || table.count("a") != 0) {
+		return false;
+	}
+
+	table.merge(staging);
+	if (table.size() != 3 || staging.size() != 0 || table["c"] != "3" || table["d"] != "4") {
+		return false;
+	}
+
+	// Merge tables with different pools, elements are copied.
+	typedef algo::hash_table_t<int, int, algo::key_traits_t<int>,
+		algo::pool_allocator_t<std::pair<const int, int>>> pooled_table_t;
+
+	pooled_table_t pooled1;
+	pooled_table_t pooled2;
+
+	for (int i = 0; i < 100; ++i) {
+		pooled1.insert(i, i);
+		pooled2.insert(i + 50, i + 50);
+	}
+
+	pooled1.merge(pooled2);
+	if (pooled1.size() != 150 || pooled2.size() != 50 || pooled2.get_allocator().get_pool()->allocated() != 50) {
+		return false;
+	}
+
+	// Tables sharing a pool relink nodes.
+	pooled_table_t pooled3(algo::key_traits_t<int>(), 64, pooled1.get_allocator());
+	pooled3.insert(pooled1.extract(7));
+	pooled3.merge(pooled1);
+
+	if (pooled3.size() != 150 || pooled1.size() != 0 || pooled3.get_allocator().get_pool()->allocated() != 150) {
+		return false;
+	}
+
+	// Copy bucket by bucket.
+	const pooled_table_t copy(pooled3);
+	auto it2 = copy.begin();
+	for (auto it = pooled3.begin(); it != pooled3.end(); ++it, ++it2) {
+		if (it2 == copy.end() || (*it).first != (*it2).first) {
+			return false;
+		}
+	}
+
+	std::cout << "Size: " << table.size() << ", " << pooled3.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_table_t::test_aggregate() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_table_t<std::string, int> words;
+	const char* text[] = { "a", "b", "a", "c", "a", "b" };
+
+	for (size_t i = 0; i < sizeof(text) / sizeof(text[0]); ++i) {
+		const auto result = words.upsert(text[i], []() { return 1; }, [](int& count) { ++count; });
+
+		if (result.second != (i < 2 || i == 3) || (*result.first).first != text[i]) {
+			return false;
+		}
+	}
+
+	if (words.size() != 3 || words["a"] != 3 || words["b"] != 2 || words["c"] != 1) {
+		return false;
+	}
+
+	// Group by "key % 1000", sum of values.
+	std::vector<std::pair<int, long long>> records;
+	std::map<int, long long> expected;
+
+	for (int i = 0; i < 100000; ++i) {
+		records.push_back(std::make_pair(i * 7 % 1000, (long long) i));
+		expected[i * 7 % 1000] += i;
+	}
+
+	const auto key_fn = [](const std::pair<int, long long>& record) { return record.first; };
+	const auto value_fn = [](const std::pair<int, long long>& record) { return record.second; };
+	const auto combine_fn = [](long long& value, const long long& another) { value += another; };
+
+	algo::hash_table_t<int, long long> serial;
+	serial.aggregate(records.begin(), records.end(), key_fn, value_fn, combine_fn);
+
+	algo::hash_table_t<int, long long> parallel;
+	parallel.insert(5, 1000);
+	parallel.aggregate(records.begin(), records.end(), key_fn, value_fn, combine_fn, 4);
+
+	// Partial tables have their own pools, so nodes are copied when merged.
+	algo::hash_table_t<int, long long, algo::key_traits_t<int>,
+		algo::pool_allocator_t<std::pair<const int, long long>>> pooled;
+	pooled.aggregate(records.begin(), records.end(), key_fn, value_fn, combine_fn, 3);
+
+	if (serial.size() != expected.size() || parallel.size() != expected.size()
+		|| pooled.size() != expected.size() || pooled.get_allocator().get_pool()->allocated() != expected.size()) {
+		return false;
+	}
+
+	for (auto it = expected.begin(); it != expected.end(); ++it) {
+		if (serial[(*it).first] != (*it).second || pooled[(*it).first] != (*it).second
+			|| parallel[(*it).first] != (*it).second + ((*it).first == 5 ? 1000 : 0)) {
+			return false;
+		}
+	}
+
+	// A throwing functor must not terminate the program, and the table is left as is.
+	const auto throwing_key_fn = [](const std::pair<int, long long>& record) {
+		if (record.second == 99999) {
+			throw std::runtime_error("bad record");
+		}
+
+		return record.first;
+	};
+
+	algo::hash_table_t<int, long long> failed;
+	failed.insert(5, 1000);
+	bool thrown = false;
+
+	try {
+		failed.aggregate(records.begin(), records.end(), throwing_key_fn, value_fn, combine_fn, 4);
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+
+	if (!thrown || failed.size() != 1 || failed[5] != 1000) {
+		return false;
+	}
+
+	std::cout << "Groups: " << serial.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_table_t::test_filter() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_table_t<int, int> table(4096);
+	for (int i = 0; i < 1000; ++i) {
+		table.insert(i, i);
+	}
+
+	table.enable_filter();
+	if (!table.filter_enabled()) {
+		return false;
+	}
+
+	// Grow beyond the filter's capacity, and erase enough keys to rebuild it.
+	for (int i = 1000; i < 10000; ++i) {
+		table.insert(i, i);
+	}
+
+	for (int i = 0; i < 10000; i += 2) {
+		if (table.erase(i) != 1) {
+			return false;
+		}
+	}
+
+	const auto copy(table);
+
+	for (int i = 0; i < 20000; ++i) {
+		const bool expected = i < 10000 && i % 2 == 1;
+
+		if (table.count(i) != (expected ? 1 : 0) || copy.count(i) != (expected ? 1 : 0)) {
+			return false;
+		}
+	}
+
+	table.clear();
+	table[7] = 7;
+	if (table.count(7) != 1 || table.count(9) != 0) {
+		return false;
+	}
+
+	table.disable_filter();
+	if (table.filter_enabled() || !copy.filter_enabled() || table.count(7) != 1) {
+		return false;
+	}
+
+	// A failed copy must not leave keys copied so far out of the filter.
+	int budget = -1;
+	algo::hash_table_t<int, throwing_copy_t> source(64);
+	algo::hash_table_t<int, throwing_copy_t> target(64);
+
+	for (int i = 0; i < 1000; ++i) {
+		source.insert(i, throwing_copy_t(&budget));
+	}
+
+	target.insert(5000, throwing_copy_t());
+	target.enable_filter();
+	budget = 500;
+
+	try {
+		target = source;
+		return false;
+	}
+	catch (const std::runtime_error&) {
+	}
+
+	budget = -1;
+
+	if (target.size() != 500 || target.count(5000) != 0) {
+		return false;
+	}
+
+	for (auto it = target.begin(); it != target.end(); ++it) {
+		if (target.count((*it).first) != 1) {
+			return false;
+		}
+	}
+
+	std::cout << "Size: " << copy.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_hash_table_t::test_stats() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	std::mt19937 random(5);
+	algo::hash_table_t<int, int> table(1024);
+	while (table.size() < 8192) {
+		table.insert((int) (random() >> 1), 0);
+	}
+
+	table.enable_filter();
+	const auto stats = table.stats();
+
+	size_t buckets = 0;
+	for (size_t i = 0; i < algo::hash_table_stats_t::const_histogram_size; ++i) {
+		buckets += stats.m_histogram[i];
+	}
+
+	if (stats.m_size != 8192 || stats.m_bucket_count != 1024 || stats.m_load_factor != 8.0
+		|| buckets != 1024 || stats.m_empty_buckets != stats.m_histogram[0]
+		|| stats.m_max_probe_length > stats.m_max_chain_length) {
+		return false;
+	}
+
+	// A good hash function.
+	if (stats.m_mean_probe_length < 1.0 || stats.m_mean_probe_length > 5.0
+		|| stats.m_chi_squared > 1.5 || table.hash_quality(256) > 1.5) {
+		return false;
+	}
+
+	if (stats.m_total_bytes < stats.m_payload_bytes
+		|| stats.m_payload_bytes < 8192 * sizeof(std::pair<const int, int>)) {
+		return false;
+	}
+
+	// A clustering hash function.
+	algo::hash_table_t<int, int, clustering_traits_t> clustered(1024);
+	for (int i = 0; i < 8192; ++i) {
+		clustered.insert(i, i);
+	}
+
+	const auto clustered_stats = clustered.stats();
+
+	if (clustered_stats.m_chi_squared < 10.0 || clustered.hash_quality(256) < 10.0
+		|| clustered_stats.m_max_chain_length != 512 || clustered_stats.m_empty_buckets != 1024 - 16) {
+		return false;
+	}
+
+	// Treeified buckets are probed by depth.
+	algo::hash_table_t<int, int, colliding_traits_t> colliding(16);
+	for (int i = 0; i < 1000; ++i) {
+		colliding.insert(i, i);
+	}
+
+	const auto colliding_stats = colliding.stats();
+
+	if (colliding_stats.m_treeified_buckets != 1 || colliding_stats.m_max_chain_length != 1000
+		|| colliding_stats.m_max_probe_length > 20 || colliding_stats.m_histogram[15] != 1) {
+		return false;
+	}
+
+	std::cout << "Load factor: " << stats.m_load_factor << ", Empty buckets: " << stats.m_empty_buckets
+		<< ", Max chain: " << stats.m_max_chain_length << ", Mean probe: " << stats.m_mean_probe_length
+		<< ", Chi-squared: " << stats.m_chi_squared << " (clustered: " << clustered_stats.m_chi_squared
+		<< "), Bytes: " << stats.m_payload_bytes << " / " << stats.m_total_bytes << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+template <class Table>
+bool test_hash_table_t::check_colliding(Table* table, int count) {
+	// Insert in an order which would make an unbalanced tree degenerate.
+	for (int i = 0; i < count; ++i) {
+		if (!table->insert(i, i * 2).second || table->insert(i, 0).second) {
+			return false;
+		}
+	}
+
+	for (int i = 0; i < count; ++i) {
+		const auto it = table->find(i);
+		if (it == table->end() || (*it).second != i * 2) {
+			return false;
+		}
+	}
+
+	if (table->count(count) != 0 || (int) std::distance(table->begin(), table->end()) != count) {
+		return false;
+	}
+
+	// Shrink the bucket until it goes back to a plain chain.
+	for (int i = 0; i < count - 3; ++i) {
+		if (table->erase(i) != 1 || table->count(i) != 0) {
+			return false;
+		}
+	}
+
+	for (int i = count - 3; i < count; ++i) {
+		if (table->count(i) != 1) {
+			return false;
+		}
+	}
+
+	// Grow it again, and copy it.
+	for (int i = 0; i < 20; ++i) {
+		table->insert(i, i);
+	}
+
+	Table another(*table);
+	if (another.size() != 23 || another.count(19) != 1 || another.count(20) != 0) {
+		return false;
+	}
 
 	return true;
 }
@@ -62,3 +627,70 @@ void test_hash_table_t::dump_4(test_hash_table_t::my_table_t* table) {
 	std::cout << std::endl;
 	dump((const my_table_t*)table, true);
 }
+
+bool test_hash_table_t::test_build() {
+
+	std::cout << "test_hash_table_t::" << __func__ << "():" << std::endl;
+
+	// Duplicated keys, the value is the position of the record.
+	std::vector<std::pair<int, int>> records;
+	for (int i = 0; i < 200000; ++i) {
+		records.push_back(std::make_pair((int) ((i * 7919LL) % 150000), i));
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	algo::hash_table_t<int, int> inserted(65536);
+	for (auto it = records.begin(); it != records.end(); ++it) {
+		inserted.insert((*it).first, (*it).second);
+	}
+
+	const auto middle = std::chrono::steady_clock::now();
+
+	algo::hash_table_t<int, int> built(65536);
+	built.insert(5, -1);
+	built.build(records.begin(), records.end(), 4);
+
+	const auto end = std::chrono::steady_clock::now();
+
+	if (built.size() != 150000 || inserted.size() != 150000 || built[5] != -1) {
+		return false;
+	}
+
+	// The first record of a key wins.
+	for (auto it = inserted.begin(); it != inserted.end(); ++it) {
+		const auto found = built.find((*it).first);
+
+		if (found == built.end() || ((*it).first != 5 && (*found).second != (*it).second)) {
+			return false;
+		}
+	}
+
+	// Colliding keys are treeified, nodes come from a pool, and the filter is rebuilt.
+	typedef algo::hash_table_t<int, int, colliding_traits_t,
+		algo::pool_allocator_t<std::pair<const int, int>>> pooled_table_t;
+
+	pooled_table_t pooled(colliding_traits_t(), 16, algo::pool_allocator_t<std::pair<const int, int>>());
+	pooled.enable_filter();
+	pooled.build(records.begin(), records.begin() + 3000, 2);
+
+	for (int i = 0; i < 3000; ++i) {
+		const auto found = pooled.find(records[i].first);
+
+		if (found == pooled.end() || (*found).second != i) {
+			return false;
+		}
+	}
+
+	if (pooled.size() != 3000 || pooled.count(150000) != 0 || pooled.stats().m_treeified_buckets != 1) {
+		return false;
+	}
+
+	std::cout << "Size: " << built.size()
+		<< ", Insert: " << std::chrono::duration_cast<std::chrono::milliseconds>(middle - start).count() << "ms"
+		<< ", Build: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - middle).count() << "ms"
+		<< std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
@@ -8,7 +8,9 @@
 
 #include "test/test.h"
 #include "algo/hash_table.h"
+#include "algo/node_pool.h"
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 
@@ -17,10 +19,85 @@ class test_hash_table_t : public test_case_t {
 private:
 	typedef algo::hash_table_t<std::string, std::string> my_table_t;
 
+	// All keys go to the same bucket.
+	struct colliding_traits_t {
+		size_t hash(int key) const {
+			return 7;
+		}
+
+		bool equal(int key1, int key2) const {
+			return key1 == key2;
+		}
+
+		bool less(int key1, int key2) const {
+			return key1 < key2;
+		}
+	};
+
+	// Same as above, but bucket chains could not be treeified.
+	struct colliding_no_less_traits_t {
+		size_t hash(int key) const {
+			return 7;
+		}
+
+		bool equal(int key1, int key2) const {
+			return key1 == key2;
+		}
+	};
+
+	// Only multiples of 64 are used as hash values.
+	struct clustering_traits_t {
+		size_t hash(int key) const {
+			return (size_t) key & ~(size_t) 63;
+		}
+
+		bool equal(int key1, int key2) const {
+			return key1 == key2;
+		}
+	};
+
+	// Colliding keys, less() throws once "*m_budget" calls are used up.
+	struct throwing_traits_t {
+		explicit throwing_traits_t(int* budget = 0) : m_budget(budget) {
+		}
+
+		size_t hash(int key) const {
+			return 7;
+		}
+
+		bool equal(int key1, int key2) const {
+			return key1 == key2;
+		}
+
+		bool less(int key1, int key2) const {
+			if (m_budget != 0 && (*m_budget)-- == 0) {
+				throw std::runtime_error("less() failed");
+			}
+
+			return key1 < key2;
+		}
+
+		int* m_budget;
+	};
+
+	template <class Table>
+	bool check_colliding(Table* table, int count);
+
 public:
 	test_hash_table_t() : test_case_t("test_hash_table_t") {}
 	virtual bool run();
 
+private:
+	bool test_basic();
+	bool test_heterogeneous();
+	bool test_treeify();
+	bool test_treeify_limits();
+	bool test_node_handle();
+	bool test_aggregate();
+	bool test_filter();
+	bool test_stats();
+	bool test_build();
+
 private:
 	template <class TablePointer>
 	void dump(TablePointer table, bool reverse) {
@@ -0,0 +1,187 @@
+/**
+ * Test case for int_hash_set_t & int_hash_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_int_hash_table.h"
+#include "algo/int_hash_table.h"
+#include <stdint.h>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+
+namespace {
+
+test_int_hash_table_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_int_hash_table_t::run() {
+	typedef bool (test_int_hash_table_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_int_hash_table_t::test_set,
+		&test_int_hash_table_t::test_map,
+		&test_int_hash_table_t::test_random
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_int_hash_table_t::test_set() {
+
+	std::cout << "test_int_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::int_hash_set_t<uint32_t> set;
+
+	for (uint32_t i = 0; i < 100000; ++i) {
+		if (!set.insert(i * 3) || set.insert(i * 3)) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < 300000; ++i) {
+		if (set.contains(i) != (i % 3 == 0)) {
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < 300000; i += 2) {
+		if (set.erase(i) != (i % 3 == 0)) {
+			return false;
+		}
+	}
+
+	size_t count = 0;
+	set.for_each([&count](uint32_t key) {
+		if (key % 6 == 3) {
+			++count;
+		}
+	});
+
+	if (set.size() != 50000 || count != 50000 || set.contains(6) || !set.contains(9)) {
+		return false;
+	}
+
+	// Copy, and reuse the slots.
+	auto another(set);
+	another.clear();
+	another.insert(5);
+
+	if (another.size() != 1 || !another.contains(5) || another.contains(9) || !set.contains(9)) {
+		return false;
+	}
+
+	std::cout << "Size: " << set.size() << ", Capacity: " << set.capacity()
+		<< ", Bytes per element: " << (double) set.memory_bytes() / set.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_int_hash_table_t::test_map() {
+
+	std::cout << "test_int_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::int_hash_map_t<uint32_t, uint32_t> map(1000);
+	const auto capacity = map.capacity();
+
+	for (uint32_t i = 0; i < 1000; ++i) {
+		map[i] = i + 1;
+	}
+
+	// Enough slots were reserved.
+	if (map.capacity() != capacity || map.size() != 1000 || map.insert(5, 0) || *map.find(5) != 6) {
+		return false;
+	}
+
+	// Signed and 64-bit keys, with another empty key.
+	algo::int_hash_map_t<int64_t, int, 0> map64;
+	for (int64_t i = -500; i <= 500; ++i) {
+		if (i != 0 && !map64.insert(i * 0x100000001LL, (int) i)) {
+			return false;
+		}
+	}
+
+	for (int64_t i = -500; i <= 500; ++i) {
+		const auto value = map64.find(i * 0x100000001LL);
+
+		if (i != 0 && (value == 0 || *value != (int) i)) {
+			return false;
+		}
+
+		if (map64.contains(i * 0x100000001LL + 1000)) {
+			return false;
+		}
+	}
+
+	int64_t sum = 0;
+	map64.for_each([&sum](int64_t key, int& value) {
+		sum += value;
+	});
+
+	if (sum != 0 || map64.size() != 1000) {
+		return false;
+	}
+
+	std::cout << "Size: " << map.size() << ", " << map64.size()
+		<< ", Bytes per element: " << (double) map.memory_bytes() / map.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_int_hash_table_t::test_random() {
+
+	std::cout << "test_int_hash_table_t::" << __func__ << "():" << std::endl;
+
+	// Small key range, so that inserting and erasing keep colliding.
+	std::mt19937 random(7);
+	std::uniform_int_distribution<uint32_t> keys(0, 4000);
+
+	algo::int_hash_map_t<uint32_t, uint32_t> map;
+	std::unordered_map<uint32_t, uint32_t> expected;
+
+	for (int i = 0; i < 200000; ++i) {
+		const auto key = keys(random);
+
+		if (i % 3 == 0) {
+			if (map.erase(key) != (expected.erase(key) != 0)) {
+				return false;
+			}
+		}
+		else {
+			if (map.insert(key, i) != expected.insert(std::make_pair(key, i)).second) {
+				return false;
+			}
+		}
+	}
+
+	if (map.size() != expected.size()) {
+		return false;
+	}
+
+	for (auto it = expected.begin(); it != expected.end(); ++it) {
+		const auto value = map.find((*it).first);
+
+		if (value == 0 || *value != (*it).second) {
+			return false;
+		}
+	}
+
+	std::cout << "Size: " << map.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
@@ -0,0 +1,23 @@
+/**
+ * Test case for int_hash_set_t & int_hash_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/int_hash_table.h"
+
+
+// Test case for int_hash_set_t & int_hash_map_t.
+class test_int_hash_table_t : public test_case_t {
+public:
+	test_int_hash_table_t() : test_case_t("test_int_hash_table_t") {}
+	virtual bool run();
+
+private:
+	bool test_set();
+	bool test_map();
+	bool test_random();
+};
@@ -0,0 +1,176 @@
+/**
+ * Test case for lru_cache_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_lru_cache.h"
+#include "algo/lru_cache.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+test_lru_cache_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_lru_cache_t::run() {
+	typedef bool (test_lru_cache_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_lru_cache_t::test_lru,
+		&test_lru_cache_t::test_clock,
+		&test_lru_cache_t::test_strings
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_lru_cache_t::test_lru() {
+
+	std::cout << "test_lru_cache_t::" << __func__ << "():" << std::endl;
+
+	algo::lru_cache_t<int, int> cache(3);
+
+	if (!cache.put(1, 10) || !cache.put(2, 20) || !cache.put(3, 30) || cache.put(3, 33)) {
+		return false;
+	}
+
+	// "1" becomes the most recently used one, so "2" is evicted.
+	if (cache.get(1) == 0 || *cache.get(1) != 10 || cache.get(4) != 0) {
+		return false;
+	}
+
+	cache.put(4, 40);
+	if (cache.size() != 3 || cache.contains(2) || !cache.contains(1) || cache.evictions() != 1) {
+		return false;
+	}
+
+	// Recency order: 4, 1, 3.
+	std::vector<int> order;
+	cache.for_each([&order](int key, int value) {
+		order.push_back(key);
+	});
+
+	if (order.size() != 3 || order[0] != 4 || order[1] != 1 || order[2] != 3) {
+		return false;
+	}
+
+	cache.put(5, 50);
+	if (cache.contains(3) || *cache.get(5) != 50 || !cache.erase(5) || cache.erase(5) || cache.size() != 2) {
+		return false;
+	}
+
+	if (cache.hits() != 3 || cache.misses() != 1 || cache.evictions() != 2) {
+		return false;
+	}
+
+	cache.clear();
+	cache.reset_counters();
+	for (int i = 0; i < 1000; ++i) {
+		cache.put(i, i);
+		cache.get(i - 3);
+	}
+
+	if (cache.size() != 3 || cache.evictions() != 997 || cache.hits() != 0 || cache.misses() != 1000) {
+		return false;
+	}
+
+	std::cout << "Hits: " << cache.hits() << ", Misses: " << cache.misses()
+		<< ", Evictions: " << cache.evictions() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_lru_cache_t::test_clock() {
+
+	std::cout << "test_lru_cache_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::lru_cache_t<int, int> cache_t;
+	cache_t cache(3, cache_t::mode_clock);
+
+	cache.put(1, 10);
+	cache.put(2, 20);
+	cache.put(3, 30);
+
+	// "1" gets a second chance, "2" is evicted.
+	cache.get(1);
+	cache.put(4, 40);
+
+	if (cache.size() != 3 || !cache.contains(1) || cache.contains(2)
+		|| !cache.contains(3) || !cache.contains(4)) {
+		return false;
+	}
+
+	// "1" has lost its "referenced" bit, and "3" is next to the hand.
+	cache.put(5, 50);
+	if (!cache.contains(1) || cache.contains(3)) {
+		return false;
+	}
+
+	// All referenced, the hand goes round and evicts the one it started from.
+	cache.get(1);
+	cache.get(4);
+	cache.get(5);
+	cache.put(6, 60);
+
+	if (cache.size() != 3 || cache.contains(1) || !cache.contains(4) || !cache.contains(5)) {
+		return false;
+	}
+
+	// A hot key survives a scan.
+	cache.clear();
+	cache.reset_counters();
+	for (int i = 0; i < 1000; ++i) {
+		cache.put(-1, -1);
+		cache.get(-1);
+		cache.put(i, i);
+	}
+
+	if (!cache.contains(-1) || cache.hits() != 1000 || cache.size() != 3) {
+		return false;
+	}
+
+	std::cout << "Hits: " << cache.hits() << ", Misses: " << cache.misses()
+		<< ", Evictions: " << cache.evictions() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_lru_cache_t::test_strings() {
+
+	std::cout << "test_lru_cache_t::" << __func__ << "():" << std::endl;
+
+	algo::lru_cache_t<std::string, std::string> cache(100);
+
+	for (int i = 0; i < 1000; ++i) {
+		cache.put(std::to_string(i), std::to_string(i * 2));
+	}
+
+	for (int i = 0; i < 1000; ++i) {
+		const auto value = cache.get(std::to_string(i));
+
+		if ((i < 900) != (value == 0) || (value != 0 && *value != std::to_string(i * 2))) {
+			return false;
+		}
+	}
+
+	std::cout << "Size: " << cache.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
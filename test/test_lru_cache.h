@@ -0,0 +1,23 @@
+/**
+ * Test case for lru_cache_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/lru_cache.h"
+
+
+// Test case for lru_cache_t.
+class test_lru_cache_t : public test_case_t {
+public:
+	test_lru_cache_t() : test_case_t("test_lru_cache_t") {}
+	virtual bool run();
+
+private:
+	bool test_lru();
+	bool test_clock();
+	bool test_strings();
+};
@@ -0,0 +1,325 @@
+/**
+ * Test case for mapped_hash_table_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_mapped_hash_table.h"
+#include "algo/mapped_hash_table.h"
+#include "algo/hash_table.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+
+
+namespace {
+
+test_mapped_hash_table_t st_test;
+
+const char* const st_path = "test_mapped_hash_table.bin";
+
+long get_file_size(const char* path) {
+	const auto file = fopen(path, "rb");
+	fseek(file, 0, SEEK_END);
+	const auto size = ftell(file);
+	fclose(file);
+
+	return size;
+}
+
+struct point_t {
+	int m_x;
+	int m_y;
+};
+
+// Case-insensitive traits of std::string.
+struct case_insensitive_traits_t {
+	size_t hash(const std::string& key) const {
+		size_t value = 0;
+
+		for (size_t i = 0; i < key.size(); ++i) {
+			value = value * 31 + (size_t) tolower((unsigned char) key[i]);
+		}
+
+		return value;
+	}
+
+	bool equal(const std::string& key1, const std::string& key2) const {
+		if (key1.size() != key2.size()) {
+			return false;
+		}
+
+		for (size_t i = 0; i < key1.size(); ++i) {
+			if (tolower((unsigned char) key1[i]) != tolower((unsigned char) key2[i])) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+} // unnamed namespace.
+
+
+bool test_mapped_hash_table_t::run() {
+	typedef bool (test_mapped_hash_table_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_mapped_hash_table_t::test_integers,
+		&test_mapped_hash_table_t::test_strings,
+		&test_mapped_hash_table_t::test_invalid_files
+	};
+
+	bool result = true;
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			result = false;
+			break;
+		}
+	}
+
+	remove(st_path);
+	return result;
+}
+
+bool test_mapped_hash_table_t::test_integers() {
+
+	std::cout << "test_mapped_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_table_t<long long, point_t> table(97);
+	for (int i = 0; i < 10000; ++i) {
+		point_t point = { i, -i };
+		table.insert((long long) i * 3, point);
+	}
+
+	if (!algo::freeze_hash_table(table, st_path)) {
+		return false;
+	}
+
+	algo::mapped_hash_table_t<long long, point_t> mapped;
+	if (!mapped.open(st_path) || mapped.size() != table.size() || mapped.array_size() != table.size()) {
+		return false;
+	}
+
+	for (int i = 0; i < 10000; ++i) {
+		point_t point;
+
+		if (!mapped.find((long long) i * 3, &point) || point.m_x != i || point.m_y != -i) {
+			return false;
+		}
+
+		if (mapped.contains((long long) i * 3 + 1)) {
+			return false;
+		}
+	}
+
+	size_t count = 0;
+	mapped.for_each([&count](long long key, const point_t& point) {
+		if (key == (long long) point.m_x * 3) {
+			++count;
+		}
+	});
+
+	if (count != table.size()) {
+		return false;
+	}
+
+	std::cout << "Size: " << mapped.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_mapped_hash_table_t::test_strings() {
+
+	std::cout << "test_mapped_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_table_t<std::string, std::string> table;
+	for (int i = 0; i < 1000; ++i) {
+		table.insert("key-" + std::to_string(i), std::string(i % 50, 'v'));
+	}
+	table.insert("", "empty key");
+
+	// A bucket count different from the table.
+	if (!algo::freeze_hash_table(table, st_path, 7)) {
+		return false;
+	}
+
+	algo::mapped_hash_table_t<std::string, std::string> mapped;
+	if (!mapped.open(st_path) || mapped.size() != table.size() || mapped.array_size() != 7) {
+		return false;
+	}
+
+	algo::string_ref_t value;
+	for (auto it = table.begin(); it != table.end(); ++it) {
+		if (!mapped.find((*it).first, &value) || value != (*it).second) {
+			return false;
+		}
+	}
+
+	// Heterogeneous lookup, no temporary string is created.
+	const char buffer[] = "key-123key-999999";
+	if (!mapped.find(algo::string_ref_t(buffer, 7), &value) || value.size() != 123 % 50
+		|| mapped.contains(algo::string_ref_t(buffer + 7, 10)) || !mapped.contains("key-7")) {
+		return false;
+	}
+
+	if (!mapped.find("", &value) || value != "empty key") {
+		return false;
+	}
+
+	// Keys are compared by KeyTraits, as they are hashed.
+	algo::hash_table_t<std::string, int, case_insensitive_traits_t> words({ { "Hello", 1 }, { "World", 2 } });
+	if (!algo::freeze_hash_table(words, st_path)) {
+		return false;
+	}
+
+	algo::mapped_hash_table_t<std::string, int, case_insensitive_traits_t> mapped_words;
+	int count = 0;
+
+	if (!mapped_words.open(st_path) || !mapped_words.find(std::string("HELLO"), &count) || count != 1
+		|| !mapped_words.contains(std::string("world")) || mapped_words.contains(std::string("word"))) {
+		return false;
+	}
+
+	std::cout << "Size: " << mapped.size() << ", [] = " << value << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_mapped_hash_table_t::test_invalid_files() {
+
+	std::cout << "test_mapped_hash_table_t::" << __func__ << "():" << std::endl;
+
+	algo::hash_table_t<int, int> table({ { 1, 10 }, { 2, 20 } });
+	if (!algo::freeze_hash_table(table, st_path)) {
+		return false;
+	}
+
+	// Type mismatch, even of types of the same size.
+	algo::mapped_hash_table_t<int, double> v1;
+	algo::mapped_hash_table_t<int, float> v1_float;
+	algo::mapped_hash_table_t<unsigned int, int> v1_unsigned;
+
+	if (v1.open(st_path) || v1.is_open() || v1_float.open(st_path) || v1_unsigned.open(st_path)) {
+		return false;
+	}
+
+	algo::hash_table_t<int64_t, double> doubles({ { 1, 0.5 } });
+	algo::mapped_hash_table_t<int64_t, int64_t> v1_integers;
+	algo::mapped_hash_table_t<int64_t, double> v1_doubles;
+
+	if (!algo::freeze_hash_table(doubles, st_path) || v1_integers.open(st_path) || !v1_doubles.open(st_path)) {
+		return false;
+	}
+
+	v1_doubles.close();
+
+	if (!algo::freeze_hash_table(table, st_path)) {
+		return false;
+	}
+
+	// Missing file.
+	algo::mapped_hash_table_t<int, int> v2;
+	if (v2.open("no-such-file.bin")) {
+		return false;
+	}
+
+	// Truncated file.
+	auto file = fopen(st_path, "r+b");
+	if (file == 0) {
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	const auto size = ftell(file);
+	fclose(file);
+
+	std::string content(size - 8, 'x');
+	file = fopen(st_path, "rb");
+	const auto bytes = fread(&content[0], 1, content.size(), file);
+	fclose(file);
+
+	file = fopen(st_path, "wb");
+	fwrite(content.data(), 1, bytes, file);
+	fclose(file);
+
+	if (v2.open(st_path)) {
+		return false;
+	}
+
+	// Corrupt offsets & string lengths, with a header matching the file size.
+	struct patch_t {
+		size_t m_position;
+		uint64_t m_value;
+		size_t m_bytes;
+	};
+
+	const algo::hash_table_t<std::string, std::string> strings({ { "one", "1" }, { "two", "2" }, { "three", "3" } });
+	algo::mapped_hash_table_t<std::string, std::string> v3;
+
+	// Freeze "strings" again, cut "truncated" bytes at the end and apply "patches".
+	const auto corrupt = [&strings](size_t truncated, std::initializer_list<patch_t> patches) {
+		if (!algo::freeze_hash_table(strings, st_path, 2)) {
+			return false;
+		}
+
+		auto file = fopen(st_path, "rb");
+		std::string content(4096, 0);
+		content.resize(fread(&content[0], 1, content.size(), file) - truncated);
+		fclose(file);
+
+		for (auto it = patches.begin(); it != patches.end(); ++it) {
+			memcpy(&content[(*it).m_position], &(*it).m_value, (*it).m_bytes);
+		}
+
+		file = fopen(st_path, "wb");
+		fwrite(content.data(), 1, content.size(), file);
+		fclose(file);
+
+		return true;
+	};
+
+	const size_t file_size = sizeof(algo::mapped_hash_table__::header_t) - sizeof(uint64_t);
+	const size_t offsets = sizeof(algo::mapped_hash_table__::header_t);
+	const size_t entries = algo::mapped_hash_table__::align(offsets + sizeof(uint64_t) * 3);
+
+	// The intact file is accepted.
+	if (!corrupt(0, {}) || !v3.open(st_path) || v3.size() != strings.size()) {
+		return false;
+	}
+
+	v3.close();
+	const auto entries_size = (uint64_t) (get_file_size(st_path) - entries);
+
+	// A bucket ends beyond the file, or in the middle of an entry.
+	if (!corrupt(0, { { offsets + sizeof(uint64_t), 1 << 20, sizeof(uint64_t) } }) || v3.open(st_path)
+		|| !corrupt(0, { { offsets + sizeof(uint64_t), 4, sizeof(uint64_t) } }) || v3.open(st_path)) {
+		return false;
+	}
+
+	// A string is longer than its bucket.
+	if (!corrupt(0, { { entries, 0xFFFFFFFF, sizeof(uint32_t) } }) || v3.open(st_path)
+		|| !corrupt(0, { { entries, 64, sizeof(uint32_t) } }) || v3.open(st_path)) {
+		return false;
+	}
+
+	// The last entry is cut, and the header & offsets are fixed to the new size.
+	if (!corrupt(8, { { file_size, entries + entries_size - 8, sizeof(uint64_t) },
+		{ offsets + sizeof(uint64_t) * 2, entries_size - 8, sizeof(uint64_t) } }) || v3.open(st_path)) {
+		return false;
+	}
+
+
+	std::cout << std::endl;
+
+	return true;
+}
@@ -0,0 +1,23 @@
+/**
+ * Test case for mapped_hash_table_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/mapped_hash_table.h"
+
+
+// Test case for mapped_hash_table_t.
+class test_mapped_hash_table_t : public test_case_t {
+public:
+	test_mapped_hash_table_t() : test_case_t("test_mapped_hash_table_t") {}
+	virtual bool run();
+
+private:
+	bool test_integers();
+	bool test_strings();
+	bool test_invalid_files();
+};
@@ -0,0 +1,224 @@
+/**
+ * Test case for perfect_hash_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_perfect_hash_map.h"
+#include "algo/perfect_hash_map.h"
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+test_perfect_hash_map_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_perfect_hash_map_t::run() {
+	typedef bool (test_perfect_hash_map_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_perfect_hash_map_t::test_integers,
+		&test_perfect_hash_map_t::test_strings,
+		&test_perfect_hash_map_t::test_bad_keys
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_perfect_hash_map_t::test_integers() {
+
+	std::cout << "test_perfect_hash_map_t::" << __func__ << "():" << std::endl;
+
+	std::vector<std::pair<unsigned int, unsigned int>> input;
+	for (unsigned int i = 0; i < 150000; ++i) {
+		input.push_back(std::make_pair(i * 7 + 1, i));
+	}
+
+	algo::perfect_hash_map_t<unsigned int, unsigned int> map;
+
+	const auto start = std::chrono::steady_clock::now();
+	if (!map.build(input.begin(), input.end(), 4)) {
+		return false;
+	}
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - start).count();
+
+	if (map.size() != input.size() || map.bits_per_key() > 4) {
+		return false;
+	}
+
+	for (auto it = input.begin(); it != input.end(); ++it) {
+		const auto value = map.find((*it).first);
+
+		if (value == 0 || *value != (*it).second) {
+			return false;
+		}
+
+		if (map.contains((*it).first + 1)) {
+			return false;
+		}
+	}
+
+	// Every element is stored exactly once.
+	std::vector<bool> seen(input.size(), false);
+	for (auto it = map.begin(); it != map.end(); ++it) {
+		if (seen[(*it).second]) {
+			return false;
+		}
+
+		seen[(*it).second] = true;
+	}
+
+	std::cout << "Size: " << map.size() << ", Bits per key: " << map.bits_per_key()
+		<< ", Build time: " << elapsed << " ms" << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_perfect_hash_map_t::test_strings() {
+
+	std::cout << "test_perfect_hash_map_t::" << __func__ << "():" << std::endl;
+
+	// An ordinary word list. The default string hash is additive, so
+	// anagrams like "listen", "silent" & "enlist" share a hash value.
+	const char* const words[] = {
+		"listen", "silent", "enlist", "tinsel", "inlets", "stop", "pots", "tops",
+		"spot", "post", "opts", "evil", "vile", "live", "veil", "angel", "glean",
+		"angle", "heart", "earth", "hater", "below", "elbow", "state", "taste",
+		"night", "thing", "dusty", "study", "save", "vase", "the", "quick", "brown",
+		"fox", "jumps", "over", "lazy", "dog", "apple", "banana", "cherry", "grape",
+		"lemon", "melon", "orange", "peach", "pear", "plum", "table", "chair", "house",
+		"garden", "river", "mountain", "ocean", "forest", "desert", "island", "valley",
+		"abc", "abcd", "cab", "bca", "a", "b", "ab", "ba", "zebra", "yellow", "window",
+		"winter", "summer", "spring", "autumn", "morning", "evening", "friend", "family",
+		"school", "teacher", "student", "letter", "number", "people", "water", "fire"
+	};
+
+	std::vector<std::pair<std::string, int>> input;
+	for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i) {
+		input.push_back(std::make_pair(std::string(words[i]), (int) i));
+	}
+
+	algo::perfect_hash_map_t<std::string, int> map;
+	if (!map.build(input.begin(), input.end())) {
+		return false;
+	}
+
+	for (auto it = input.begin(); it != input.end(); ++it) {
+		const auto value = map.find((*it).first);
+
+		if (value == 0 || *value != (*it).second) {
+			return false;
+		}
+	}
+
+	// Misses, anagrams of present words included.
+	if (map.contains("abd") || map.contains("acb") || map.contains("stpo") || map.contains("")
+		|| !map.contains(algo::string_ref_t("abcdef", 4)) || *map.find(algo::string_ref_t("silentx", 6)) != 1) {
+		return false;
+	}
+
+	size_t count = 0;
+	for (auto it = map.begin(); it != map.end(); ++it) {
+		if ((*it).first != words[(*it).second]) {
+			return false;
+		}
+
+		++count;
+	}
+
+	if (count != input.size()) {
+		return false;
+	}
+
+	// All keys share one hash value.
+	std::vector<std::pair<std::string, int>> permutations;
+	std::string letters = "abcdefg";
+
+	do {
+		permutations.push_back(std::make_pair(letters, (int) permutations.size()));
+	} while (std::next_permutation(letters.begin(), letters.end()));
+
+	if (!map.build(permutations.begin(), permutations.end()) || map.size() != permutations.size()) {
+		return false;
+	}
+
+	for (auto it = permutations.begin(); it != permutations.end(); ++it) {
+		const auto value = map.find((*it).first);
+
+		if (value == 0 || *value != (*it).second) {
+			return false;
+		}
+	}
+
+	if (map.contains("abcdeff") || map.contains("abcdefgh")) {
+		return false;
+	}
+
+	std::cout << "Words: " << input.size() << ", Permutations: " << map.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_perfect_hash_map_t::test_bad_keys() {
+
+	std::cout << "test_perfect_hash_map_t::" << __func__ << "():" << std::endl;
+
+	// Duplicate keys.
+	std::vector<std::pair<int, int>> v1({ { 1, 1 }, { 2, 2 }, { 1, 3 } });
+	algo::perfect_hash_map_t<int, int> m1;
+
+	if (m1.build(v1.begin(), v1.end()) || !m1.empty()) {
+		return false;
+	}
+
+	// Duplicate keys sharing a hash value with another key.
+	std::vector<std::pair<std::string, int>> v2({ { "ab", 1 }, { "ba", 2 }, { "ab", 3 } });
+	algo::perfect_hash_map_t<std::string, int> m2;
+
+	if (m2.build(v2.begin(), v2.end()) || !m2.empty()) {
+		return false;
+	}
+
+	// The duplicate is the third key of its hash value.
+	std::vector<std::pair<std::string, int>> v3({ { "ab", 1 }, { "ba", 2 }, { "ba", 3 } });
+	std::vector<std::pair<std::string, int>> v4({ { "abc", 1 }, { "bca", 2 }, { "cab", 3 }, { "bca", 4 } });
+
+	if (m2.build(v3.begin(), v3.end()) || !m2.empty() || m2.build(v4.begin(), v4.end()) || !m2.empty()) {
+		return false;
+	}
+
+	// Only the hash values collide.
+	v2.pop_back();
+	if (!m2.build(v2.begin(), v2.end()) || m2.size() != 2 || *m2.find("ab") != 1 || *m2.find("ba") != 2) {
+		return false;
+	}
+
+	// Empty input.
+	if (!m1.build(v1.begin(), v1.begin()) || m1.find(1) != 0) {
+		return false;
+	}
+
+	std::cout << std::endl;
+
+	return true;
+}
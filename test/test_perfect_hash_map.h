@@ -0,0 +1,23 @@
+/**
+ * Test case for perfect_hash_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/perfect_hash_map.h"
+
+
+// Test case for perfect_hash_map_t.
+class test_perfect_hash_map_t : public test_case_t {
+public:
+	test_perfect_hash_map_t() : test_case_t("test_perfect_hash_map_t") {}
+	virtual bool run();
+
+private:
+	bool test_integers();
+	bool test_strings();
+	bool test_bad_keys();
+};
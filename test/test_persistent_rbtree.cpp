@@ -0,0 +1,293 @@
+/**
+ * Test case for persistent_rbtree_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_persistent_rbtree.h"
+#include "algo/persistent_rbtree.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+test_persistent_rbtree_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_persistent_rbtree_t::run() {
+	if (!this->test_random() || !this->test_sharing() || !this->test_threads()) {
+		return false;
+	}
+
+	return true;
+}
+
+bool test_persistent_rbtree_t::test_random() {
+
+	std::cout << "test_persistent_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::persistent_rbtree_t<int> tree_t;
+
+	const int count = 50000;
+	const int range = 3000;
+	std::mt19937 random(31);
+
+	tree_t tree;
+	std::set<int> expected;
+
+	// Old versions, they must never change.
+	std::vector<std::pair<tree_t, std::set<int>>> snapshots;
+
+	for (int i = 0; i < count; ++i) {
+		const int value = random() % range;
+		bool ok;
+
+		if (random() % 3 != 0) {
+			ok = tree.insert(value) == expected.insert(value).second;
+		}
+		else {
+			ok = tree.erase(value) == expected.erase(value);
+		}
+
+		if (!ok || tree.size() != expected.size()) {
+			return false;
+		}
+
+		if (i % 1000 == 0) {
+			snapshots.push_back(std::make_pair(tree.snapshot(), expected));
+
+			if (!tree.check_invariants()) {
+				return false;
+			}
+		}
+	}
+
+	for (const auto& snapshot : snapshots) {
+		if (!snapshot.first.check_invariants() || snapshot.first.size() != snapshot.second.size()
+			|| !std::equal(snapshot.second.begin(), snapshot.second.end(), snapshot.first.begin())) {
+			return false;
+		}
+	}
+
+	// Lookups.
+	for (int value = -1; value <= range; ++value) {
+		const auto lower = tree.lower_bound(value);
+		const auto upper = tree.upper_bound(value);
+		const auto expected_lower = expected.lower_bound(value);
+		const auto expected_upper = expected.upper_bound(value);
+
+		if ((expected_lower == expected.end() ? lower != tree.end() : *lower != *expected_lower)
+			|| (expected_upper == expected.end() ? upper != tree.end() : *upper != *expected_upper)
+			|| tree.count(value) != expected.count(value)
+			|| (tree.find(value) == tree.end()) == (expected.find(value) != expected.end())) {
+			return false;
+		}
+	}
+
+	// Clearing keeps snapshots.
+	const auto last = snapshots.back();
+	snapshots.clear();
+	tree.clear();
+
+	if (!tree.empty() || tree.begin() != tree.end() || !tree.check_invariants()
+		|| !std::equal(last.second.begin(), last.second.end(), last.first.begin())) {
+		return false;
+	}
+
+	std::cout << "Operations: " << count << ", Snapshots: 50, Height: " << last.first.height()
+		<< ", Size: " << last.first.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_persistent_rbtree_t::test_sharing() {
+
+	std::cout << "test_persistent_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::persistent_rbtree_t<int, std::less<int>, counting_allocator_t<int>> tree_t;
+
+	const int count = 10000;
+	size_t calls[3] = {0, 0, size_t(-1)};
+	size_t insert_nodes = 0;
+	size_t erase_nodes = 0;
+	size_t height = 0;
+
+	{
+		tree_t tree((std::less<int>()), counting_allocator_t<int>(calls));
+
+		for (int i = 0; i < count; ++i) {
+			tree.insert(i * 2);
+		}
+
+		if (calls[0] - calls[1] != tree.size()) {
+			return false;
+		}
+
+		// Nothing is copied.
+		const auto allocated = calls[0];
+		auto snapshot = tree.snapshot();
+		height = snapshot.height();
+
+		if (calls[0] != allocated || snapshot.size() != tree.size()) {
+			return false;
+		}
+
+		// Only the path is copied, the old one is kept by the snapshot.
+		tree.insert(count * 2);
+		insert_nodes = calls[0] - allocated;
+
+		tree.erase(count / 2 * 2);
+		erase_nodes = calls[0] - allocated - insert_nodes;
+
+		if (insert_nodes > height + 2 || erase_nodes > height * 2 || snapshot.size() != count || !snapshot.check_invariants() || !tree.check_invariants()
+			|| snapshot.count(count * 2) != 0 || snapshot.count(count / 2 * 2) != 1
+			|| tree.count(count * 2) != 1 || tree.count(count / 2 * 2) != 0) {
+			return false;
+		}
+
+		// The tree is not changed if allocating fails.
+		auto saved = tree.snapshot();
+
+		for (size_t limit = 0; ; ++limit) {
+			calls[2] = calls[0] + limit;
+			bool done = true;
+
+			try {
+				tree.insert(-1);
+				tree.erase(1000);
+			}
+			catch (const std::bad_alloc&) {
+				done = false;
+			}
+
+			calls[2] = size_t(-1);
+
+			if (!tree.check_invariants()) {
+				return false;
+			}
+
+			if (done) {
+				break;
+			}
+
+			// The insertion succeeded or not.
+			tree.erase(-1);
+
+			if (tree.size() != saved.size() || !std::equal(saved.begin(), saved.end(), tree.begin())) {
+				return false;
+			}
+		}
+
+		if (tree.size() != count || tree.count(-1) != 1 || tree.count(1000) != 0) {
+			return false;
+		}
+
+		// Old paths are freed with the snapshots.
+		snapshot.clear();
+		saved.clear();
+
+		if (calls[0] - calls[1] != tree.size()) {
+			return false;
+		}
+	}
+
+	// All nodes are freed with the last version holding them.
+	if (calls[0] != calls[1]) {
+		return false;
+	}
+
+	std::cout << "Size: " << count << ", Height: " << height << ", Nodes copied by insert: " << insert_nodes
+		<< ", by erase: " << erase_nodes << ", Nodes allocated: " << calls[0] << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_persistent_rbtree_t::test_threads() {
+
+	std::cout << "test_persistent_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::persistent_rbtree_t<int> tree_t;
+
+	const int window = 1000;
+	const int steps = 20000;
+	const int thread_count = 4;
+
+	// The writer slides a window of "window" values, readers
+	// check that every version they see is a whole window.
+	tree_t tree;
+	for (int i = 0; i < window; ++i) {
+		tree.insert(i);
+	}
+
+	std::mutex lock;
+	tree_t published(tree);
+	std::atomic<bool> done(false);
+	std::atomic<bool> failed(false);
+	std::atomic<size_t> checked(0);
+
+	std::vector<std::thread> readers;
+
+	for (int i = 0; i < thread_count; ++i) {
+		readers.push_back(std::thread([&]() {
+			while (!done.load()) {
+				tree_t snapshot;
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					snapshot = published;
+				}
+
+				// Readers walk nodes without locks, while the writer copies and frees them.
+				int expected = *snapshot.begin();
+				for (auto it = snapshot.begin(); it != snapshot.end(); ++it, ++expected) {
+					if (*it != expected) {
+						failed = true;
+					}
+				}
+
+				if (snapshot.size() != window || expected != *snapshot.begin() + window || !snapshot.check_invariants()) {
+					failed = true;
+				}
+
+				++checked;
+			}
+		}));
+	}
+
+	for (int i = 0; i < steps; ++i) {
+		tree.insert(i + window);
+		tree.erase(i);
+
+		const auto snapshot = tree.snapshot();
+
+		std::lock_guard<std::mutex> guard(lock);
+		published = snapshot;
+	}
+
+	done = true;
+	for (auto& reader : readers) {
+		reader.join();
+	}
+
+	if (failed.load() || tree.size() != window || *tree.begin() != steps || !tree.check_invariants()) {
+		return false;
+	}
+
+	std::cout << "Readers: " << thread_count << ", Versions: " << steps
+		<< ", Snapshots checked: " << checked.load() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
@@ -0,0 +1,56 @@
+/**
+ * Test case for persistent_rbtree_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/persistent_rbtree.h"
+#include <memory>
+#include <new>
+
+
+// Test case for persistent_rbtree_t.
+class test_persistent_rbtree_t : public test_case_t {
+private:
+	// Allocator counting allocate() & deallocate() calls in "m_calls[0]" & "m_calls[1]",
+	// allocate() throws std::bad_alloc once "m_calls[0]" reaches "m_calls[2]".
+	template <class U>
+	struct counting_allocator_t {
+		typedef U value_type;
+
+		explicit counting_allocator_t(size_t* calls) : m_calls(calls) {
+		}
+
+		template <class V>
+		counting_allocator_t(const counting_allocator_t<V>& another) : m_calls(another.m_calls) {
+		}
+
+		U* allocate(size_t n) {
+			if (m_calls[0] == m_calls[2]) {
+				throw std::bad_alloc();
+			}
+
+			++m_calls[0];
+			return std::allocator<U>().allocate(n);
+		}
+
+		void deallocate(U* ptr, size_t n) {
+			++m_calls[1];
+			std::allocator<U>().deallocate(ptr, n);
+		}
+
+		size_t* m_calls;
+	};
+
+public:
+	test_persistent_rbtree_t() : test_case_t("test_persistent_rbtree_t") {}
+	virtual bool run();
+
+private:
+	bool test_random();
+	bool test_sharing();
+	bool test_threads();
+};
@@ -6,6 +6,12 @@
 
 #include "test/test_rbtree.h"
 #include "algo/rbtree.h"
+#include <math.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -57,5 +63,715 @@ bool test_rbtree_t::run() {
 		}
 	}
 
+	if (!this->test_balance() || !this->test_random() || !this->test_range()
+		|| !this->test_order_statistic() || !this->test_bulk()
+		|| !this->test_pool() || !this->test_hint()
+		|| !this->test_split_join() || !this->test_set_operations()) {
+		return false;
+	}
+
+	return true;
+}
+
+bool test_rbtree_t::test_balance() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	// Sorted input used to degenerate into a linked list.
+	const int count = 200000;
+	algo::rbtree_t<int> tree;
+
+	for (int i = 0; i < count; ++i) {
+		tree.insert(i);
+	}
+
+	const auto max_height = 2 * log2(count + 1.0);
+
+	if (tree.size() != (size_t) count || tree.height() > max_height || !tree.check_invariants()) {
+		return false;
+	}
+
+	const auto inserted_height = tree.height();
+
+	// Erase the smaller half, from the smallest one.
+	for (int i = 0; i < count / 2; ++i) {
+		if (tree.erase(i) != 1) {
+			return false;
+		}
+	}
+
+	if (tree.size() != (size_t) count / 2 || tree.height() > 2 * log2(count / 2 + 1.0)
+		|| !tree.check_invariants() || *tree.begin() != count / 2) {
+		return false;
+	}
+
+	const auto copy(tree);
+	if (!copy.check_invariants() || copy.height() != tree.height()) {
+		return false;
+	}
+
+	std::cout << "Size: " << count << ", Height: " << inserted_height
+		<< ", Limit: " << max_height << ", Height after erase: " << tree.height() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_random() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	// Small key range, so that inserting and erasing keep colliding.
+	std::mt19937 random(13);
+	std::uniform_int_distribution<int> keys(0, 2000);
+
+	algo::rbtree_t<int> tree;
+	std::set<int> expected;
+
+	for (int i = 0; i < 50000; ++i) {
+		const auto key = keys(random);
+
+		if (i % 3 == 0) {
+			if (tree.erase(key) != expected.erase(key)) {
+				return false;
+			}
+		}
+		else if (tree.insert(key).second != expected.insert(key).second) {
+			return false;
+		}
+
+		if (i % 5000 == 0 && !tree.check_invariants()) {
+			return false;
+		}
+	}
+
+	if (!tree.check_invariants() || tree.size() != expected.size()
+		|| !std::equal(expected.begin(), expected.end(), tree.begin())) {
+		return false;
+	}
+
+	std::cout << "Size: " << tree.size() << ", Height: " << tree.height() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_range() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	// Even numbers only.
+	algo::rbtree_t<int> tree;
+	for (int i = 0; i < 10000; i += 2) {
+		tree.insert(i);
+	}
+
+	const auto& const_tree = tree;
+
+	if (*tree.lower_bound(10) != 10 || *tree.lower_bound(11) != 12 || *const_tree.lower_bound(-5) != 0
+		|| tree.lower_bound(9999) != tree.end() || *tree.upper_bound(10) != 12 || *tree.upper_bound(-1) != 0
+		|| const_tree.upper_bound(9998) != const_tree.end()) {
+		return false;
+	}
+
+	const auto found = tree.equal_range(100);
+	const auto missing = const_tree.equal_range(101);
+
+	if (*found.first != 100 || *found.second != 102 || *missing.first != 102 || missing.first != missing.second) {
+		return false;
+	}
+
+	if (tree.count(100) != 1 || tree.count(101) != 0) {
+		return false;
+	}
+
+	// [1001, 2001) has 500 even numbers.
+	int sum = 0;
+	int previous = -1;
+	bool ordered = true;
+
+	const auto visited = tree.for_each_in_range(1001, 2001, [&](int value) {
+		ordered = ordered && value > previous;
+		previous = value;
+		sum += value;
+	});
+
+	if (visited != 500 || !ordered || sum != (1002 + 2000) * 500 / 2) {
+		return false;
+	}
+
+	if (tree.for_each_in_range(3000, 3000, [](int) {}) != 0 || tree.for_each_in_range(9998, 20000, [](int) {}) != 1) {
+		return false;
+	}
+
+	// Descending tree, the range follows the tree order.
+	algo::rbtree_t<int, std::greater<int>> descending({ 1, 5, 3, 9, 7 });
+	std::vector<int> values;
+	descending.for_each_in_range(8, 2, [&values](int value) {
+		values.push_back(value);
+	});
+
+	if (values != std::vector<int>({ 7, 5, 3 }) || *descending.lower_bound(6) != 5) {
+		return false;
+	}
+
+	std::cout << "Visited: " << visited << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_order_statistic() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::rbtree_t<int, std::less<int>, algo::rbtree_order_statistic_policy_t> tree_t;
+
+	// The default policy costs nothing.
+	if (sizeof(algo::rbtree__::node_t<int>) != sizeof(algo::rbtree__::node_t<int, algo::rbtree__::no_augment_t>)
+		|| sizeof(algo::rbtree__::node_t<int, algo::rbtree__::subtree_size_t>) <= sizeof(algo::rbtree__::node_t<int>)) {
+		return false;
+	}
+
+	std::mt19937 random(17);
+	std::uniform_int_distribution<int> keys(0, 5000);
+
+	tree_t tree;
+	std::set<int> expected;
+
+	for (int i = 0; i < 30000; ++i) {
+		const auto key = keys(random);
+
+		if (i % 3 == 0) {
+			tree.erase(key);
+			expected.erase(key);
+		}
+		else {
+			tree.insert(key);
+			expected.insert(key);
+		}
+	}
+
+	if (!tree.check_invariants() || tree.size() != expected.size()) {
+		return false;
+	}
+
+	// Every element, and values between them.
+	size_t index = 0;
+	for (auto it = expected.begin(); it != expected.end(); ++it, ++index) {
+		if (tree.rank(*it) != index || tree.rank(*it + 1) != index + 1 || *tree.select(index) != *it) {
+			return false;
+		}
+	}
+
+	if (tree.select(tree.size()) != tree.end() || tree.rank(-1) != 0 || tree.rank(100000) != tree.size()) {
+		return false;
+	}
+
+	// Iterator difference.
+	const auto first = tree.lower_bound(1000);
+	const auto last = tree.lower_bound(4000);
+
+	if (last - first != std::distance(first, last) || tree.end() - tree.begin() != (std::ptrdiff_t) tree.size()
+		|| first - last != -(last - first)) {
+		return false;
+	}
+
+	// Subtree sizes survive copies, and the median is found in O(log n).
+	const tree_t copy(tree);
+	const auto median = *copy.select(copy.size() / 2);
+
+	if (!copy.check_invariants() || median != *tree.select(tree.size() / 2)) {
+		return false;
+	}
+
+	std::cout << "Size: " << tree.size() << ", Median: " << median
+		<< ", Node bytes: " << sizeof(algo::rbtree__::node_t<int>)
+		<< " vs " << sizeof(algo::rbtree__::node_t<int, algo::rbtree__::subtree_size_t>) << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_bulk() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	const int count = 100000;
+	std::vector<int> sorted;
+	for (int i = 0; i < count; ++i) {
+		sorted.push_back(i * 2);
+	}
+
+	// Sorted input is built in O(n), compared with inserting one by one.
+	const auto start = std::chrono::steady_clock::now();
+	algo::rbtree_t<int> bulk;
+	bulk.insert(sorted.begin(), sorted.end());
+	const auto middle = std::chrono::steady_clock::now();
+	algo::rbtree_t<int> single;
+	for (auto it = sorted.begin(); it != sorted.end(); ++it) {
+		single.insert(*it);
+	}
+	const auto stop = std::chrono::steady_clock::now();
+
+	if (!bulk.check_invariants() || bulk.size() != (size_t) count
+		|| bulk.height() > (size_t) ceil(log2(count + 1.0))
+		|| !std::equal(sorted.begin(), sorted.end(), bulk.begin())) {
+		return false;
+	}
+
+	// Erased nodes go back to the slab, and are reused by later inserts.
+	for (int i = 0; i < count; i += 3) {
+		bulk.erase(i * 2);
+	}
+	for (int i = 0; i < count; i += 2) {
+		bulk.insert(i * 2 + 1);
+	}
+
+	std::set<int> expected(sorted.begin(), sorted.end());
+	for (int i = 0; i < count; i += 3) {
+		expected.erase(i * 2);
+	}
+	for (int i = 0; i < count; i += 2) {
+		expected.insert(i * 2 + 1);
+	}
+
+	if (!bulk.check_invariants() || bulk.size() != expected.size()
+		|| !std::equal(expected.begin(), expected.end(), bulk.begin())) {
+		return false;
+	}
+
+	// Unsorted input with duplicates is sorted first, the first one of equal values is kept.
+	typedef std::pair<int, int> pair_t;
+	struct first_less_t {
+		bool operator()(const pair_t& v1, const pair_t& v2) const {
+			return v1.first < v2.first;
+		}
+	};
+
+	std::mt19937 random(19);
+	std::uniform_int_distribution<int> keys(0, 5000);
+	std::vector<pair_t> pairs;
+	std::set<pair_t, first_less_t> expected_pairs;
+
+	for (int i = 0; i < 20000; ++i) {
+		pairs.push_back(pair_t(keys(random), i));
+		expected_pairs.insert(pairs.back());
+	}
+
+	algo::rbtree_t<pair_t, first_less_t> unsorted;
+	unsorted.insert(pairs.begin(), pairs.end());
+
+	if (!unsorted.check_invariants() || unsorted.size() != expected_pairs.size()
+		|| !std::equal(expected_pairs.begin(), expected_pairs.end(), unsorted.begin())) {
+		return false;
+	}
+
+	// Input iterators, and subtree sizes of the order statistics policy.
+	std::istringstream stream("9 3 7 1 3 5 9 0");
+	algo::rbtree_t<int, std::less<int>, algo::rbtree_order_statistic_policy_t> ranked;
+	ranked.insert(std::istream_iterator<int>(stream), std::istream_iterator<int>());
+
+	if (!ranked.check_invariants() || ranked.size() != 6 || *ranked.select(3) != 5 || ranked.rank(7) != 4) {
+		return false;
+	}
+
+	// Copies and clear().
+	auto copy(bulk);
+	bulk.clear();
+	bulk.assign_sorted(sorted.begin(), sorted.begin() + 3);
+
+	if (!copy.check_invariants() || copy.size() != expected.size()
+		|| !bulk.check_invariants() || bulk.size() != 3 || *bulk.rbegin() != 4) {
+		return false;
+	}
+
+	std::cout << "Size: " << count << ", Height: " << (size_t) ceil(log2(count + 1.0))
+		<< ", Bulk: " << std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count()
+		<< " us, One by one: " << std::chrono::duration_cast<std::chrono::microseconds>(stop - middle).count()
+		<< " us" << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_pool() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::rbtree_t<int, std::less<int>, algo::rbtree_default_policy_t, counting_allocator_t<int>> tree_t;
+
+	size_t calls[2] = { 0, 0 };
+	const counting_allocator_t<int> allocator(calls);
+	tree_t tree(std::less<int>(), allocator);
+
+	// Nodes are taken from growing chunks.
+	std::mt19937 random(23);
+	std::uniform_int_distribution<int> keys(0, 1000000);
+	std::set<int> expected;
+
+	for (int i = 0; i < 20000; ++i) {
+		const auto key = keys(random);
+		tree.insert(key);
+		expected.insert(key);
+	}
+
+	const auto inserted_calls = calls[0];
+	if (inserted_calls > 32 || calls[1] != 0) {
+		return false;
+	}
+
+	// Erased nodes are reused, the allocator is not called at all.
+	auto it = expected.begin();
+	for (int i = 0; i < 5000; ++i) {
+		tree.erase(*it);
+		expected.erase(it++);
+		++it;
+	}
+	for (int i = 0; i < 5000; ++i) {
+		const auto key = -1 - keys(random);
+		tree.insert(key);
+		expected.insert(key);
+	}
+
+	if (calls[0] != inserted_calls || !tree.check_invariants()
+		|| !std::equal(expected.begin(), expected.end(), tree.begin())) {
+		return false;
+	}
+
+	// Copies take one chunk.
+	const tree_t copy(tree);
+	if (calls[0] != inserted_calls + 1 || !copy.check_invariants()) {
+		return false;
+	}
+
+	// compact() lays out nodes in order, and gives other chunks back.
+	const auto bytes = tree.memory_bytes();
+	tree.compact();
+
+	if (calls[0] != inserted_calls + 2 || calls[1] != inserted_calls || tree.memory_bytes() >= bytes
+		|| !tree.check_invariants() || !std::equal(expected.begin(), expected.end(), tree.begin())) {
+		return false;
+	}
+
+	for (auto prev = tree.begin(), next = ++tree.begin(); next != tree.end(); ++prev, ++next) {
+		if (&*prev >= &*next) {
+			return false;
+		}
+	}
+
+	const auto compacted_bytes = tree.memory_bytes();
+	tree.clear();
+	if (calls[0] != calls[1] + 1 || tree.memory_bytes() != 0) {
+		return false;
+	}
+
+	// Values with destructors.
+	algo::rbtree_t<std::string> strings;
+	for (int i = 0; i < 1000; ++i) {
+		strings.insert(std::to_string(i * 7919 % 1000) + std::string(32, 'x'));
+	}
+	for (int i = 0; i < 1000; i += 2) {
+		strings.erase(std::to_string(i) + std::string(32, 'x'));
+	}
+	strings.compact();
+
+	if (strings.size() != 500 || !strings.check_invariants() || *strings.begin() != "101" + std::string(32, 'x')) {
+		return false;
+	}
+
+	std::cout << "Allocations: " << inserted_calls << ", Bytes: " << bytes
+		<< ", After compact(): " << compacted_bytes << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_hint() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::rbtree_t<int, counting_less_t> tree_t;
+
+	const int count = 20000;
+	size_t calls = 0;
+
+	// Appending & prepending compare with the biggest & smallest values only.
+	tree_t tree((counting_less_t(&calls)));
+	for (int i = 0; i < count; ++i) {
+		tree.insert(i);
+	}
+
+	const auto append_calls = calls;
+	calls = 0;
+
+	for (int i = -1; i >= -count; --i) {
+		tree.insert(i);
+	}
+
+	const auto prepend_calls = calls;
+
+	if (append_calls > (size_t) count || prepend_calls > (size_t) count * 2 || !tree.check_invariants()) {
+		return false;
+	}
+
+	// Fill the gaps of even numbers, the hint is always right.
+	tree_t hinted((counting_less_t(&calls)));
+	for (int i = 0; i < count; i += 2) {
+		hinted.insert(hinted.end(), i);
+	}
+
+	calls = 0;
+	auto it = hinted.begin();
+
+	for (int i = 1; i < count; i += 2) {
+		++it;
+		if (*hinted.insert(it, i) != i) {
+			return false;
+		}
+	}
+
+	const auto hinted_calls = calls;
+
+	if (hinted_calls > (size_t) count || hinted.size() != (size_t) count || !hinted.check_invariants()
+		|| !std::equal(hinted.begin(), hinted.end(), tree.lower_bound(0))) {
+		return false;
+	}
+
+	// Wrong hints only cost a normal descent.
+	std::mt19937 random(29);
+	std::uniform_int_distribution<int> keys(0, 5000);
+
+	algo::rbtree_t<int> random_tree;
+	std::set<int> expected;
+
+	for (int i = 0; i < 20000; ++i) {
+		const auto key = keys(random);
+		const auto hint = i % 3 == 0 ? random_tree.end() : random_tree.lower_bound(keys(random));
+		const auto result = i % 2 == 0 ? random_tree.insert(hint, key) : random_tree.emplace_hint(hint, key);
+
+		expected.insert(key);
+
+		if (*result != key) {
+			return false;
+		}
+	}
+
+	if (!random_tree.check_invariants() || random_tree.size() != expected.size()
+		|| !std::equal(expected.begin(), expected.end(), random_tree.begin())) {
+		return false;
+	}
+
+	std::cout << "Comparisons per insert, appending: " << (double) append_calls / count
+		<< ", prepending: " << (double) prepend_calls / count
+		<< ", right hint: " << (double) hinted_calls / (count / 2) << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_split_join() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::rbtree_t<int, counting_less_t, algo::rbtree_order_statistic_policy_t,
+		counting_allocator_t<int>> tree_t;
+
+	size_t calls = 0;
+	size_t allocations[2] = { 0, 0 };
+	tree_t tree((counting_less_t(&calls)), counting_allocator_t<int>(allocations));
+
+	std::mt19937 random(31);
+	std::uniform_int_distribution<int> keys(0, 100000);
+	std::set<int> expected;
+
+	for (int i = 0; i < 20000; ++i) {
+		const auto key = keys(random);
+		tree.insert(key);
+		expected.insert(key);
+	}
+
+	size_t split_calls = 0;
+
+	for (int round = 0; round < 20; ++round) {
+		const auto key = round == 0 ? -1 : (round == 1 ? 200000 : keys(random));
+
+		calls = 0;
+		auto right = tree.split(key);
+		split_calls = std::max(split_calls, calls);
+
+		const auto middle = expected.lower_bound(key);
+		const auto left_size = (size_t) std::distance(expected.begin(), middle);
+
+		if (tree.size() != left_size || right.size() != expected.size() - left_size
+			|| !tree.check_invariants() || !right.check_invariants()
+			|| !std::equal(expected.begin(), middle, tree.begin())
+			|| !std::equal(middle, expected.end(), right.begin())) {
+			return false;
+		}
+
+		// Both trees are usable on their own.
+		if (round % 2 == 0) {
+			tree.insert(key - 1);
+			right.erase(right.begin(), right.lower_bound(key + 100));
+			right.insert(key);
+
+			expected.erase(middle, expected.lower_bound(key + 100));
+			expected.insert(key - 1);
+			expected.insert(key);
+		}
+
+		tree.join(right);
+
+		if (!right.empty() || tree.size() != expected.size() || !tree.check_invariants()
+			|| !std::equal(expected.begin(), expected.end(), tree.begin())
+			|| tree.rank(key) != (size_t) std::distance(expected.begin(), expected.lower_bound(key))) {
+			return false;
+		}
+	}
+
+	// Cutting & gluing takes O(log n) comparisons with order statistics.
+	if (split_calls > 4 * tree.height()) {
+		return false;
+	}
+
+	// Chunks are shared, and given back by the last tree.
+	auto right = tree.split(50000);
+	tree.clear();
+
+	if (allocations[1] != 0 || right.size() != (size_t) std::distance(expected.lower_bound(50000), expected.end())) {
+		return false;
+	}
+
+	right.clear();
+	if (allocations[0] != allocations[1]) {
+		return false;
+	}
+
+	std::cout << "Size: " << expected.size() << ", comparisons per split: " << split_calls << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_t::test_set_operations() {
+
+	std::cout << "test_rbtree_t::" << __func__ << "():" << std::endl;
+
+	typedef std::pair<int, int> pair_t;
+	typedef algo::rbtree_t<pair_t, first_less_t> tree_t;
+
+	std::mt19937 random(37);
+
+	for (int round = 0; round < 40; ++round) {
+		const auto max_key = 1 + (int) (random() % 2000);
+		const auto size1 = (int) (random() % 1000);
+		const auto size2 = round % 4 == 0 ? (int) (random() % 10) : (int) (random() % 1000);
+		const size_t threads = 1 + round % 3;
+
+		// "second" is 1 for values of "tree1", 2 for values of "tree2".
+		std::set<pair_t, first_less_t> set1;
+		std::set<pair_t, first_less_t> set2;
+		tree_t tree1;
+		tree_t tree2;
+
+		for (int i = 0; i < size1; ++i) {
+			const pair_t value((int) (random() % max_key), 1);
+			set1.insert(value);
+			tree1.insert(value);
+		}
+
+		for (int i = 0; i < size2; ++i) {
+			const pair_t value((int) (random() % max_key), 2);
+			set2.insert(value);
+			tree2.insert(value);
+		}
+
+		std::vector<pair_t> expected;
+
+		std::set_union(set1.begin(), set1.end(), set2.begin(), set2.end(), std::back_inserter(expected), first_less_t());
+		const auto united = algo::rbtree_union(tree1, tree2, threads);
+
+		if (!united.check_invariants() || united.size() != expected.size()
+			|| !std::equal(expected.begin(), expected.end(), united.begin())) {
+			return false;
+		}
+
+		expected.clear();
+		std::set_intersection(set1.begin(), set1.end(), set2.begin(), set2.end(), std::back_inserter(expected), first_less_t());
+		auto intersected = algo::rbtree_intersection(tree1, tree2, threads);
+		const auto intersection_size = expected.size();
+
+		if (!intersected.check_invariants() || intersected.size() != intersection_size
+			|| !std::equal(expected.begin(), expected.end(), intersected.begin())) {
+			return false;
+		}
+
+		expected.clear();
+		std::set_difference(set1.begin(), set1.end(), set2.begin(), set2.end(), std::back_inserter(expected), first_less_t());
+		const auto subtracted = algo::rbtree_difference(tree1, tree2, threads);
+
+		if (!subtracted.check_invariants() || subtracted.size() != expected.size()
+			|| !std::equal(expected.begin(), expected.end(), subtracted.begin())) {
+			return false;
+		}
+
+		// Dropped nodes are reused.
+		for (int i = 0; i < 100; ++i) {
+			intersected.insert(pair_t(max_key + i, 3));
+		}
+
+		if (!intersected.check_invariants() || intersected.size() != intersection_size + 100) {
+			return false;
+		}
+	}
+
+	// Merging a small tree into a big one is O(m log(n/m + 1)).
+	typedef algo::rbtree_t<int, counting_less_t> counted_tree_t;
+
+	size_t calls = 0;
+	std::vector<int> big;
+	std::vector<int> small;
+
+	for (int i = 0; i < 100000; ++i) {
+		big.push_back(i * 2);
+	}
+
+	for (int i = 0; i < 100; ++i) {
+		small.push_back(i * 2000 + 1);
+	}
+
+	counted_tree_t big_tree((counting_less_t(&calls)));
+	counted_tree_t small_tree((counting_less_t(&calls)));
+	big_tree.assign_sorted(big.begin(), big.end());
+	small_tree.assign_sorted(small.begin(), small.end());
+
+	calls = 0;
+	const auto united = algo::rbtree_union(std::move(big_tree), std::move(small_tree));
+	const auto union_calls = calls;
+
+	if (union_calls > small.size() * 4 * (size_t) log2(big.size() / small.size() + 1.0)
+		|| united.size() != big.size() + small.size() || !united.check_invariants()) {
+		return false;
+	}
+
+	// Strings are destroyed, none of them is leaked or destroyed twice.
+	algo::rbtree_t<std::string> strings1;
+	algo::rbtree_t<std::string> strings2;
+
+	for (int i = 0; i < 1000; ++i) {
+		strings1.insert(std::to_string(i) + std::string(32, 'x'));
+		strings2.insert(std::to_string(i * 3) + std::string(32, 'x'));
+	}
+
+	strings1.intersect(std::move(strings2), 2);
+
+	if (strings1.size() != 334 || !strings2.empty() || !strings1.check_invariants()) {
+		return false;
+	}
+
+	std::cout << "Comparisons merging 100 into 100000 values: " << union_calls << std::endl;
+	std::cout << std::endl;
+
 	return true;
 }
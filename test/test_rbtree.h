@@ -9,17 +9,78 @@
 #include "test/test.h"
 #include "algo/rbtree.h"
 #include <iostream>
+#include <memory>
 #include <string>
 #include <algorithm>
 
 
 // Test case for rbtree_t.
 class test_rbtree_t : public test_case_t {
+private:
+	// Allocator counting allocate() & deallocate() calls in "m_calls[0]" & "m_calls[1]".
+	template <class U>
+	struct counting_allocator_t {
+		typedef U value_type;
+
+		counting_allocator_t() : m_calls(st_ignored) {
+		}
+
+		explicit counting_allocator_t(size_t* calls) : m_calls(calls) {
+		}
+
+		template <class V>
+		counting_allocator_t(const counting_allocator_t<V>& another) : m_calls(another.m_calls) {
+		}
+
+		U* allocate(size_t n) {
+			++m_calls[0];
+			return std::allocator<U>().allocate(n);
+		}
+
+		void deallocate(U* ptr, size_t n) {
+			++m_calls[1];
+			std::allocator<U>().deallocate(ptr, n);
+		}
+
+		size_t* m_calls;
+		static size_t st_ignored[2];
+	};
+
+	// "less" counting its calls in "*m_calls".
+	struct counting_less_t {
+		explicit counting_less_t(size_t* calls = 0) : m_calls(calls) {
+		}
+
+		bool operator()(int v1, int v2) const {
+			++*m_calls;
+			return v1 < v2;
+		}
+
+		size_t* m_calls;
+	};
+
+	// Compare pairs by "first" only, "second" tells equal ones apart.
+	struct first_less_t {
+		bool operator()(const std::pair<int, int>& v1, const std::pair<int, int>& v2) const {
+			return v1.first < v2.first;
+		}
+	};
+
 public:
 	test_rbtree_t() : test_case_t("test_rbtree_t") {}
 	virtual bool run();
 
 private:
+	bool test_balance();
+	bool test_random();
+	bool test_range();
+	bool test_order_statistic();
+	bool test_bulk();
+	bool test_pool();
+	bool test_hint();
+	bool test_split_join();
+	bool test_set_operations();
+
 	template <class Ctner>
 	bool run_single(const Ctner& ctner) {
 		// RAW.
@@ -76,6 +137,10 @@ private:
 		this->dump(is_less ? ascending : descending, v3.begin(), v3.end());
 		this->dump(is_less ? descending : ascending, v3.rbegin(), v3.rend());
 
+		if (!tree.check_invariants() || !v1.check_invariants() || !v2.check_invariants() || !v3.check_invariants()) {
+			return false;
+		}
+
 		return true;
 	}
 
@@ -86,3 +151,6 @@ private:
 		std::cout << std::endl;
 	}
 };
+
+template <class U>
+size_t test_rbtree_t::counting_allocator_t<U>::st_ignored[2];
@@ -0,0 +1,164 @@
+/**
+ * Test case for rbtree_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_rbtree_map.h"
+#include "algo/rbtree_map.h"
+#include "algo/string_ref.h"
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+
+
+namespace {
+
+test_rbtree_map_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_rbtree_map_t::run() {
+	if (!this->test_random() || !this->test_upsert() || !this->test_transparent()) {
+		return false;
+	}
+
+	return true;
+}
+
+bool test_rbtree_map_t::test_random() {
+
+	std::cout << "test_rbtree_map_t::" << __func__ << "():" << std::endl;
+
+	std::mt19937 random(7);
+	std::uniform_int_distribution<int> keys(0, 3000);
+
+	algo::rbtree_map_t<int, int> map;
+	std::map<int, int> expected;
+
+	for (int i = 0; i < 30000; ++i) {
+		const auto key = keys(random);
+
+		if (i % 3 == 0) {
+			if (map.erase(key) != expected.erase(key)) {
+				return false;
+			}
+		}
+		else if (i % 3 == 1) {
+			map[key] += i;
+			expected[key] += i;
+		}
+		else {
+			const auto result = map.try_emplace(key, i);
+			const auto expected_result = expected.insert(std::make_pair(key, i));
+
+			if (result.second != expected_result.second || result.first->second != expected_result.first->second) {
+				return false;
+			}
+		}
+	}
+
+	if (!map.check_invariants() || map.size() != expected.size()
+		|| !std::equal(expected.begin(), expected.end(), map.begin())) {
+		return false;
+	}
+
+	const auto& const_map = map;
+	const auto lower = const_map.lower_bound(1500);
+
+	if (lower == const_map.end() || lower->first != expected.lower_bound(1500)->first
+		|| map.upper_bound(3000) != map.end() || map.count(expected.begin()->first) != 1) {
+		return false;
+	}
+
+	// Copies are independent, and values are modified through iterators.
+	auto copy(map);
+	copy.begin()->second = -1;
+
+	if (!copy.check_invariants() || copy.size() != map.size() || map.begin()->second == -1) {
+		return false;
+	}
+
+	std::cout << "Size: " << map.size() << ", Height: " << map.height() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_map_t::test_upsert() {
+
+	std::cout << "test_rbtree_map_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::rbtree_map_t<int, std::unique_ptr<int>, std::less<int>, algo::rbtree_order_statistic_policy_t> map_t;
+	map_t map;
+	map.insert(std::make_pair(30, std::unique_ptr<int>()));
+
+	// "args" are not moved if the key exists.
+	std::unique_ptr<int> value(new int(10));
+	if (!map.try_emplace(10, std::move(value)).second || value || *map[10] != 10) {
+		return false;
+	}
+
+	value.reset(new int(11));
+	if (map.try_emplace(10, std::move(value)).second || !value || *map[10] != 10) {
+		return false;
+	}
+
+	// insert_or_assign() overwrites.
+	if (map.insert_or_assign(10, std::move(value)).second || value || *map[10] != 11) {
+		return false;
+	}
+
+	if (!map.insert_or_assign(20, std::unique_ptr<int>(new int(20))).second || *map[20] != 20) {
+		return false;
+	}
+
+	// operator[] inserts a default value.
+	if (map[40] || map.size() != 4 || map.rank(30) != 2 || map.select(3)->first != 40
+		|| !map.check_invariants()) {
+		return false;
+	}
+
+	std::cout << "Size: " << map.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_rbtree_map_t::test_transparent() {
+
+	std::cout << "test_rbtree_map_t::" << __func__ << "():" << std::endl;
+
+	algo::rbtree_map_t<std::string, int, algo::string_less_t> map({
+		{ "apple", 1 }, { "banana", 2 }, { "cherry", 3 } });
+
+	// Slices of a buffer, they are not null-terminated.
+	const char buffer[] = "bananapple";
+	const algo::string_ref_t banana(buffer, 6);
+	const algo::string_ref_t apple(buffer + 5, 5);
+	const algo::string_ref_t ban(buffer, 3);
+
+	if (map.find(banana)->second != 2 || map.find(apple)->second != 1 || map.find(ban) != map.end()
+		|| !map.contains("cherry") || map.count(ban) != 0 || map.lower_bound(ban)->first != "banana") {
+		return false;
+	}
+
+	// Keys are created only if they are inserted.
+	if (!map.try_emplace(ban, 4).second || map.try_emplace(banana, 5).second
+		|| map["ban"] != 4 || map["banana"] != 2) {
+		return false;
+	}
+
+	if (map.insert_or_assign("cherry", 6).second || map["cherry"] != 6
+		|| map.erase(apple) != 1 || map.size() != 3 || !map.check_invariants()) {
+		return false;
+	}
+
+	std::cout << "Size: " << map.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
@@ -0,0 +1,23 @@
+/**
+ * Test case for rbtree_map_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/rbtree_map.h"
+
+
+// Test case for rbtree_map_t.
+class test_rbtree_map_t : public test_case_t {
+public:
+	test_rbtree_map_t() : test_case_t("test_rbtree_map_t") {}
+	virtual bool run();
+
+private:
+	bool test_random();
+	bool test_upsert();
+	bool test_transparent();
+};
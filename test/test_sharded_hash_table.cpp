@@ -0,0 +1,250 @@
+/**
+ * Test case for sharded_hash_table_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#include "test/test_sharded_hash_table.h"
+#include "algo/sharded_hash_table.h"
+#include "algo/node_pool.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace {
+
+test_sharded_hash_table_t st_test;
+
+} // unnamed namespace.
+
+
+bool test_sharded_hash_table_t::run() {
+	typedef bool (test_sharded_hash_table_t::*mem_func_t)();
+
+	mem_func_t functions[] = {
+		&test_sharded_hash_table_t::test_node_pool,
+		&test_sharded_hash_table_t::test_single_thread,
+		&test_sharded_hash_table_t::test_bulk,
+		&test_sharded_hash_table_t::test_multiple_threads
+	};
+
+	for (size_t i = 0; i < sizeof(functions)/sizeof(functions[0]); ++i) {
+		auto ptr = functions[i];
+
+		if (!(this->*ptr)()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool test_sharded_hash_table_t::test_node_pool() {
+
+	std::cout << "test_sharded_hash_table_t::" << __func__ << "():" << std::endl;
+
+	typedef algo::hash_table_t<int, int, algo::key_traits_t<int>,
+		algo::pool_allocator_t<std::pair<const int, int>>> pooled_table_t;
+
+	pooled_table_t table(64);
+	for (int i = 0; i < 1000; ++i) {
+		table.insert(i, i);
+	}
+
+	const auto pool = table.get_allocator().get_pool();
+	if (pool->allocated() != 1000) {
+		return false;
+	}
+
+	for (int i = 0; i < 1000; i += 2) {
+		table.erase(i);
+	}
+
+	// Freed nodes are reused.
+	const auto capacity = pool->capacity();
+	for (int i = 0; i < 1000; i += 2) {
+		table.insert(i, i);
+	}
+
+	if (pool->allocated() != 1000 || pool->capacity() != capacity) {
+		return false;
+	}
+
+	// A copy has its own arena.
+	pooled_table_t v2(table);
+	if (v2.get_allocator() == table.get_allocator() || v2.size() != 1000) {
+		return false;
+	}
+
+	std::cout << "Pool capacity: " << pool->capacity() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_sharded_hash_table_t::test_single_thread() {
+
+	std::cout << "test_sharded_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t table(16);
+	std::string value;
+
+	for (int i = 0; i < 1000; ++i) {
+		if (!table.insert(i, std::to_string(i))) {
+			return false;
+		}
+	}
+
+	if (table.insert(1, "x") || table.size() != 1000) {
+		return false;
+	}
+
+	if (!table.find(7, &value) || value != "7" || table.find(1000, &value)) {
+		return false;
+	}
+
+	if (table.insert_or_assign(7, "seven") || !table.find(7, &value) || value != "seven") {
+		return false;
+	}
+
+	if (table.erase(7) != 1 || table.erase(7) != 0 || table.contains(7)) {
+		return false;
+	}
+
+	// Keys are spread over all shards.
+	for (size_t i = 0; i < my_table_t::const_shard_count; ++i) {
+		std::cout << "Shard " << i << ": " << table.shard_size(i) << std::endl;
+
+		if (table.shard_size(i) == 0) {
+			return false;
+		}
+	}
+
+	size_t count = 0;
+	for (auto it = table.begin(); it != table.end(); ++it) {
+		if ((*it).second != std::to_string((*it).first)) {
+			return false;
+		}
+
+		++count;
+	}
+
+	if (count != table.size()) {
+		return false;
+	}
+
+	count = 0;
+	table.for_each([&count](const std::pair<const int, std::string>&) { ++count; });
+	if (count != 999) {
+		return false;
+	}
+
+	table.clear();
+	if (!table.empty() || table.begin() != table.end()) {
+		return false;
+	}
+
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_sharded_hash_table_t::test_bulk() {
+
+	std::cout << "test_sharded_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t table;
+	std::vector<std::pair<int, std::string>> batch;
+	std::vector<int> keys;
+
+	for (int i = 0; i < 500; ++i) {
+		batch.push_back(std::make_pair(i, std::to_string(i)));
+		keys.push_back(i * 2);
+	}
+
+	if (table.insert(batch.begin(), batch.end()) != 500 || table.insert(batch.begin(), batch.end()) != 0) {
+		return false;
+	}
+
+	size_t found = 0;
+	size_t missing = 0;
+	table.find(keys.begin(), keys.end(), [&](const int& key, const std::string* value) {
+		if (value == 0) {
+			++missing;
+		}
+		else if (*value == std::to_string(key)) {
+			++found;
+		}
+	});
+
+	if (found != 250 || missing != 250) {
+		return false;
+	}
+
+	if (table.erase(keys.begin(), keys.end()) != 250 || table.size() != 250) {
+		return false;
+	}
+
+	std::cout << "Size: " << table.size() << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
+
+bool test_sharded_hash_table_t::test_multiple_threads() {
+
+	std::cout << "test_sharded_hash_table_t::" << __func__ << "():" << std::endl;
+
+	my_table_t table;
+	std::vector<std::thread> threads;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < const_threads; ++i) {
+		threads.push_back(std::thread([&table, i]() {
+			std::vector<std::pair<int, std::string>> batch;
+			const int first = i * const_keys_per_thread;
+
+			for (int key = first; key < first + const_keys_per_thread; ++key) {
+				batch.push_back(std::make_pair(key, std::to_string(key)));
+
+				if (batch.size() == 1000) {
+					table.insert(batch.begin(), batch.end());
+					batch.clear();
+				}
+			}
+
+			table.insert(batch.begin(), batch.end());
+
+			for (int key = first; key < first + const_keys_per_thread; key += 2) {
+				table.erase(key);
+			}
+		}));
+	}
+
+	for (auto it = threads.begin(); it != threads.end(); ++it) {
+		(*it).join();
+	}
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count();
+
+	if (table.size() != size_t(const_threads * const_keys_per_thread / 2)) {
+		return false;
+	}
+
+	for (int key = 0; key < const_threads * const_keys_per_thread; ++key) {
+		if (table.contains(key) != (key % 2 == 1)) {
+			return false;
+		}
+	}
+
+	std::cout << "Threads: " << const_threads << ", Size: " << table.size()
+		<< ", Time: " << elapsed << " us" << std::endl;
+	std::cout << std::endl;
+
+	return true;
+}
@@ -0,0 +1,32 @@
+/**
+ * Test case for sharded_hash_table_t.
+ *
+ * Copyright (c) 2015 Alex Jin (toalexjin@hotmail.com)
+ */
+
+#pragma once
+
+#include "test/test.h"
+#include "algo/sharded_hash_table.h"
+#include <string>
+
+
+// Test case for sharded_hash_table_t.
+class test_sharded_hash_table_t : public test_case_t {
+private:
+	typedef algo::sharded_hash_table_t<int, std::string, algo::key_traits_t<int>, 8> my_table_t;
+
+public:
+	test_sharded_hash_table_t() : test_case_t("test_sharded_hash_table_t") {}
+	virtual bool run();
+
+public:
+	static const int const_threads = 4;
+	static const int const_keys_per_thread = 20000;
+
+private:
+	bool test_node_pool();
+	bool test_single_thread();
+	bool test_bulk();
+	bool test_multiple_threads();
+};